@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "command_table.h"
+#include "parser.h"
+
+/* Number of lines in every generated corpus */
+#define BENCH_NB_LINES      (1000u)
+
+/* Minimum time spent on every corpus (in seconds) */
+#define BENCH_MIN_TIME      (0.5)
+
+/* Number of allocations made by the parser and the command table (the
+ * allocator calls are wrapped by the linker) */
+static unsigned long g_nb_allocs;
+
+void *__real_malloc(size_t size);
+void *__real_realloc(void *p_mem, size_t size);
+void *__real_calloc(size_t nb, size_t size);
+
+void *__wrap_malloc(size_t size) {
+
+    g_nb_allocs++;
+
+    return __real_malloc(size);
+}
+
+void *__wrap_realloc(void *p_mem, size_t size) {
+
+    g_nb_allocs++;
+
+    return __real_realloc(p_mem, size);
+}
+
+void *__wrap_calloc(size_t nb, size_t size) {
+
+    g_nb_allocs++;
+
+    return __real_calloc(nb, size);
+}
+
+/**
+ * @brief Corpus of command lines
+ */
+typedef struct __bench_corpus_t {
+
+    /* Name of the corpus */
+    const char *name;
+
+    /* Lines */
+    char **lines;
+
+    /* Number of lines */
+    size_t nb_lines;
+
+    /* Total number of bytes of the lines */
+    size_t nb_bytes;
+
+} bench_corpus_t;
+
+/**
+ * @brief Appends the formatted text to the line being generated
+ * @param[in,out] line Line buffer
+ * @param[in,out] p_len Length of the line
+ * @param[in] text Text to be appended
+ */
+static void __bench_append(char *line, size_t *p_len, const char *text) {
+
+    size_t len = strlen(text);
+
+    memcpy(line + *p_len, text, len + 1);
+    *p_len += len;
+}
+
+/**
+ * @brief Generates a corpus of lines of the given kind
+ * @param[out] p_corpus Pointer to the corpus
+ * @param[in] name Name of the corpus
+ * @param[in] kind 0 for short lines, 1 for deep pipelines, 2 for many
+ *                 redirections, 3 for 10k argument lines
+ */
+static void __bench_gen_corpus(bench_corpus_t *p_corpus, const char *name, int kind) {
+
+    /* Words used for the arguments */
+    static const char *words[] = {"ls", "-l", "grep", "main.c", "/usr/bin",
+                                  "--color", "wc", "sort", "-n", "x_1"};
+
+    char *line = (char *)malloc(256 * 1024);
+    char word[64];
+    size_t len;
+    size_t i;
+    int j;
+
+    p_corpus->name = name;
+    p_corpus->nb_lines = (kind == 3) ? (BENCH_NB_LINES / 20) : BENCH_NB_LINES;
+    p_corpus->nb_bytes = 0;
+    p_corpus->lines = (char **)malloc(p_corpus->nb_lines * sizeof(char *));
+
+    srand(kind + 1);
+
+    for (i = 0; i < p_corpus->nb_lines; i++) {
+
+        len = 0;
+        line[0] = '\0';
+
+        if (kind == 0) {
+
+            /* Typical interactive line */
+            snprintf(word, sizeof(word), "%s %s %s",
+                     words[rand() % 10], words[rand() % 10], words[rand() % 10]);
+            __bench_append(line, &len, word);
+        }
+        else if (kind == 1) {
+
+            /* Pipeline of 64 stages */
+            for (j = 0; j < 64; j++) {
+
+                snprintf(word, sizeof(word), "%s%s %s", j ? " | " : "",
+                         words[rand() % 10], words[rand() % 10]);
+                __bench_append(line, &len, word);
+            }
+        }
+        else if (kind == 2) {
+
+            /* Pipeline with redirections at every stage */
+            for (j = 0; j < 16; j++) {
+
+                snprintf(word, sizeof(word), "%s%s <in_%d.txt %s >out_%d.txt >log_%d",
+                         j ? " | " : "", words[rand() % 10], j, words[rand() % 10], j, j);
+                __bench_append(line, &len, word);
+            }
+        }
+        else {
+
+            /* Single command with 10000 arguments */
+            __bench_append(line, &len, "echo");
+
+            for (j = 0; j < 10000; j++) {
+
+                snprintf(word, sizeof(word), " %s", words[rand() % 10]);
+                __bench_append(line, &len, word);
+            }
+        }
+
+        p_corpus->lines[i] = strdup(line);
+        p_corpus->nb_bytes += len;
+    }
+
+    free(line);
+}
+
+/**
+ * @brief Returns the monotonic time in seconds
+ * @return Time
+ */
+static double __bench_now() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Parses the corpus repeatedly (as the shell does, with one command
+ *        table reused for every line) and prints the throughput
+ * @param[in] p_corpus Pointer to the corpus
+ */
+static void __bench_run(bench_corpus_t *p_corpus) {
+
+    cmd_tab_t cmd_tab;
+    parser_ctx_t ctx;
+    unsigned long nb_passes = 0;
+    unsigned long nb_allocs;
+    double start;
+    double elapsed;
+    size_t i;
+
+    cmd_tab_init(&cmd_tab);
+    parser_ctx_init(&ctx, &cmd_tab);
+
+    g_nb_allocs = 0;
+    start = __bench_now();
+
+    do {
+
+        for (i = 0; i < p_corpus->nb_lines; i++) {
+
+            if (parser_ctx_parse(&ctx, p_corpus->lines[i]) != PARSER_OK) {
+
+                fprintf(stderr, "bench: invalid line in corpus %s\n", p_corpus->name);
+                exit(1);
+            }
+
+            cmd_tab_reset(&cmd_tab);
+        }
+
+        nb_passes++;
+        elapsed = __bench_now() - start;
+
+    } while (elapsed < BENCH_MIN_TIME);
+
+    nb_allocs = g_nb_allocs;
+
+    printf("%-14s %12.0f %12.1f %10.3f\n", p_corpus->name,
+           nb_passes * p_corpus->nb_lines / elapsed,
+           nb_passes * p_corpus->nb_bytes / elapsed / 1e6,
+           (double)nb_allocs / (nb_passes * p_corpus->nb_lines));
+
+    cmd_tab_deinit(&cmd_tab);
+}
+
+/**
+ * @brief Benchmarks the parser over generated corpora, or over the lines of
+ *        the given file
+ * @param[in] argc Number of arguments
+ * @param[in] argv Arguments, <bench_parser [corpus_file]>
+ */
+int main(int argc, char *argv[]) {
+
+    bench_corpus_t corpus;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    FILE *p_file;
+
+    printf("%-14s %12s %12s %10s\n", "corpus", "lines/s", "MB/s", "allocs/line");
+
+    /* If a corpus file is given */
+    if (argc == 2) {
+
+        if (!(p_file = fopen(argv[1], "r"))) {
+
+            perror(argv[1]);
+            return 1;
+        }
+
+        corpus.name = argv[1];
+        corpus.lines = NULL;
+        corpus.nb_lines = 0;
+        corpus.nb_bytes = 0;
+
+        while ((len = getline(&line, &size, p_file)) > 0) {
+
+            if (line[len - 1] == '\n') {
+
+                line[--len] = '\0';
+            }
+
+            corpus.lines = (char **)realloc(corpus.lines, (corpus.nb_lines + 1) * sizeof(char *));
+            corpus.lines[corpus.nb_lines++] = strdup(line);
+            corpus.nb_bytes += len;
+        }
+
+        fclose(p_file);
+
+        __bench_run(&corpus);
+
+        return 0;
+    }
+
+    __bench_gen_corpus(&corpus, "short", 0);
+    __bench_run(&corpus);
+
+    __bench_gen_corpus(&corpus, "pipeline-64", 1);
+    __bench_run(&corpus);
+
+    __bench_gen_corpus(&corpus, "redirections", 2);
+    __bench_run(&corpus);
+
+    __bench_gen_corpus(&corpus, "args-10k", 3);
+    __bench_run(&corpus);
+
+    return 0;
+}
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "command_table.h"
+#include "parser.h"
+
+/* Aborts (reported as a crash by the fuzzer) if the condition fails */
+#define FUZZ_CHECK(cond)                                                \
+    ({                                                                  \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "fuzz: check failed: %s\n", #cond);         \
+            abort();                                                    \
+        }                                                               \
+    })
+
+/**
+ * @brief Checks that the tokens of the command table lie within the string
+ *        and the arrays are within their capacities
+ * @param[in] p_cmd_tab Pointer to the command table
+ * @param[in] p_tok Pointer to the token
+ */
+static void __fuzz_check_tok(cmd_tab_t *p_cmd_tab, cmd_tok_t *p_tok) {
+
+    if (p_tok->off == -1) {
+
+        return;
+    }
+
+    FUZZ_CHECK((p_tok->off >= 0) && (p_tok->len > 0));
+    FUZZ_CHECK(p_tok->off + p_tok->len <= p_cmd_tab->cmd_len);
+}
+
+/**
+ * @brief Expands a token to itself (the expanded copy of the command table
+ *        must then be the same as the source)
+ * @param[in] str Token
+ * @param[in] len Length of the token
+ * @param[out] out Output
+ * @param[in] size Size of the output
+ * @return Length of the token
+ */
+static size_t __fuzz_expand_same(const char *str, size_t len, char *out, size_t size) {
+
+    memcpy(out, str, (len < size) ? len : size);
+
+    return len;
+}
+
+/**
+ * @brief Expands a token to two words, itself twice (every argument of the
+ *        expanded copy then comes twice, the redirections are kept)
+ * @param[in] str Token
+ * @param[in] len Length of the token
+ * @param[out] out Output
+ * @param[in] size Size of the output
+ * @return Length of the expansion
+ */
+static size_t __fuzz_expand_twice(const char *str, size_t len, char *out, size_t size) {
+
+    if (2 * len + 1 <= size) {
+
+        memcpy(out, str, len);
+        out[len] = '\0';
+        memcpy(out + len + 1, str, len);
+    }
+
+    return 2 * len + 1;
+}
+
+/**
+ * @brief Parses the input as a command line and checks the command table,
+ *        the leaks and overruns are reported by the sanitizers
+ * @param[in] data Input
+ * @param[in] size Size of the input
+ * @return 0
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+
+    cmd_tab_t cmd_tab;
+    cmd_tab_t expanded;
+    cmd_tab_t doubled;
+    cmd_tab_t *p_packed;
+    void *p_mem;
+    char *cmd_str;
+    char **args;
+    int cmd_i;
+    int arg_i;
+    int nb_args;
+
+    /* The parser takes a NULL terminated line */
+    cmd_str = (char *)malloc(size + 1);
+    memcpy(cmd_str, data, size);
+    cmd_str[size] = '\0';
+
+    cmd_tab_init(&cmd_tab);
+    cmd_tab_init(&expanded);
+    cmd_tab_init(&doubled);
+
+    /* Blank lines (no command) are never executed, so are not checked */
+    if ((parser_set_cmd_tab(&cmd_tab, cmd_str) == PARSER_OK) &&
+        (cmd_tab_get_nb_cmds(&cmd_tab) > 0)) {
+
+        /* The arrays must be within their capacities */
+        FUZZ_CHECK(cmd_tab.nb_cmds <= cmd_tab.max_cmds);
+        FUZZ_CHECK(cmd_tab.nb_args <= cmd_tab.max_args);
+        FUZZ_CHECK(cmd_tab.nb_redirs <= cmd_tab.max_redirs);
+        FUZZ_CHECK(!strcmp(cmd_tab.cmd_str, cmd_str));
+
+        /* Pack the table (before materializing, so that the string must be
+         * restored by the packing) */
+        p_mem = malloc(cmd_tab_get_packed_size(&cmd_tab));
+        p_packed = cmd_tab_pack(p_mem, &cmd_tab);
+
+        FUZZ_CHECK(!strcmp(cmd_tab_get_cmd_str(p_packed), cmd_str));
+
+        for (cmd_i = 0; cmd_i < cmd_tab_get_nb_cmds(&cmd_tab); cmd_i++) {
+
+            nb_args = cmd_tab_get_nb_cmd_args(&cmd_tab, cmd_i);
+
+            FUZZ_CHECK(nb_args > 0);
+            FUZZ_CHECK(cmd_tab.cmds[cmd_i].arg_i + cmd_tab.cmds[cmd_i].nb_cmd_args <= cmd_tab.nb_args);
+
+            FUZZ_CHECK(cmd_tab.cmds[cmd_i].redir_i + cmd_tab.cmds[cmd_i].nb_redirs <= cmd_tab.nb_redirs);
+
+            for (arg_i = 0; arg_i < cmd_tab.cmds[cmd_i].nb_redirs; arg_i++) {
+
+                __fuzz_check_tok(&cmd_tab, &cmd_tab.redirs[cmd_tab.cmds[cmd_i].redir_i + arg_i].tok);
+                FUZZ_CHECK(cmd_tab.redirs[cmd_tab.cmds[cmd_i].redir_i + arg_i].fd >= 0);
+            }
+
+            /* Materialize the arguments and compare them with the tokens */
+            args = cmd_tab_get_cmd_args(&cmd_tab, cmd_i);
+
+            for (arg_i = 0; arg_i < nb_args; arg_i++) {
+
+                __fuzz_check_tok(&cmd_tab, &cmd_tab.toks[cmd_tab.cmds[cmd_i].arg_i + arg_i]);
+                FUZZ_CHECK(strlen(args[arg_i]) == (size_t)cmd_tab.toks[cmd_tab.cmds[cmd_i].arg_i + arg_i].len);
+            }
+
+            FUZZ_CHECK(args[nb_args] == NULL);
+
+            /* The packed copy must give the same arguments */
+            args = cmd_tab_get_cmd_args(p_packed, cmd_i);
+            FUZZ_CHECK(cmd_tab_get_nb_cmd_args(p_packed, cmd_i) == nb_args);
+            FUZZ_CHECK(args[nb_args] == NULL);
+        }
+
+        /* Expanding the materialized table must restore the string */
+        cmd_tab_expand(&expanded, &cmd_tab, __fuzz_expand_same);
+        FUZZ_CHECK(!strcmp(cmd_tab_get_cmd_str(&expanded), cmd_str));
+
+        for (cmd_i = 0; cmd_i < cmd_tab_get_nb_cmds(&cmd_tab); cmd_i++) {
+
+            nb_args = cmd_tab_get_nb_cmd_args(&cmd_tab, cmd_i);
+            args = cmd_tab_get_cmd_args(&expanded, cmd_i);
+            FUZZ_CHECK(cmd_tab_get_nb_cmd_args(&expanded, cmd_i) == nb_args);
+
+            for (arg_i = 0; arg_i < nb_args; arg_i++) {
+
+                FUZZ_CHECK(!strcmp(args[arg_i], cmd_tab_get_cmd_args(&cmd_tab, cmd_i)[arg_i]));
+            }
+
+            for (arg_i = 0; arg_i < cmd_tab_get_nb_redirs(&cmd_tab, cmd_i); arg_i++) {
+
+                FUZZ_CHECK(!strcmp(cmd_tab_get_redir_arg(&expanded, cmd_i, arg_i),
+                                   cmd_tab_get_redir_arg(&cmd_tab, cmd_i, arg_i)));
+            }
+        }
+
+        /* Expanding every argument to two words doubles the arguments */
+        cmd_tab_expand(&doubled, &cmd_tab, __fuzz_expand_twice);
+
+        for (cmd_i = 0; cmd_i < cmd_tab_get_nb_cmds(&cmd_tab); cmd_i++) {
+
+            nb_args = cmd_tab_get_nb_cmd_args(&cmd_tab, cmd_i);
+            args = cmd_tab_get_cmd_args(&doubled, cmd_i);
+            FUZZ_CHECK(cmd_tab_get_nb_cmd_args(&doubled, cmd_i) == 2 * nb_args);
+            FUZZ_CHECK(args[2 * nb_args] == NULL);
+
+            /* The batches get the words following the name */
+            FUZZ_CHECK(cmd_tab_get_batch_arg_i(&doubled, cmd_i) >= 1);
+            FUZZ_CHECK(cmd_tab_get_batch_arg_i(&doubled, cmd_i) + cmd_tab_get_nb_batch_args(&doubled, cmd_i) <=
+                       2 * nb_args);
+
+            for (arg_i = 0; arg_i < nb_args; arg_i++) {
+
+                FUZZ_CHECK(!strcmp(args[2 * arg_i], cmd_tab_get_cmd_args(&cmd_tab, cmd_i)[arg_i]));
+                FUZZ_CHECK(!strcmp(args[2 * arg_i + 1], cmd_tab_get_cmd_args(&cmd_tab, cmd_i)[arg_i]));
+            }
+
+            for (arg_i = 0; arg_i < cmd_tab_get_nb_redirs(&cmd_tab, cmd_i); arg_i++) {
+
+                FUZZ_CHECK(!strcmp(cmd_tab_get_redir_arg(&doubled, cmd_i, arg_i),
+                                   cmd_tab_get_redir_arg(&cmd_tab, cmd_i, arg_i)));
+            }
+        }
+
+        free(p_mem);
+    }
+
+    cmd_tab_deinit(&doubled);
+    cmd_tab_deinit(&expanded);
+    cmd_tab_deinit(&cmd_tab);
+    free(cmd_str);
+
+    return 0;
+}
+
+#ifdef FUZZ_STDIN
+
+/**
+ * @brief Runs a single input read from the standard input (for AFL)
+ */
+int main() {
+
+    static uint8_t data[1024 * 1024];
+    size_t size = 0;
+    ssize_t nb_read;
+
+    while ((size < sizeof(data)) &&
+           ((nb_read = read(STDIN_FILENO, data + size, sizeof(data) - size)) > 0)) {
+
+        size += nb_read;
+    }
+
+    return LLVMFuzzerTestOneInput(data, size);
+}
+
+#endif
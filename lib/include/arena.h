@@ -0,0 +1,54 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+/* Minimum size of a newly allocated arena chunk */
+#define ARENA_MIN_CHUNK_SIZE (256u)
+
+/**
+ * @brief Single chunk of memory in the arena
+ */
+typedef struct __arena_chunk_t {
+
+    /* Next (older) chunk in the arena */
+    struct __arena_chunk_t *p_next;
+
+    /* Size of the data area */
+    size_t size;
+
+    /* Number of bytes of the data area in use */
+    size_t used;
+
+    /* Data area */
+    char data[];
+
+} arena_chunk_t;
+
+/**
+ * @brief Bump allocator, all the allocations are released together
+ */
+typedef struct __arena_t {
+
+    /* Current (newest) chunk */
+    arena_chunk_t *p_head;
+
+} arena_t;
+
+void arena_init(arena_t *p_arena);
+
+void arena_reserve(arena_t *p_arena, size_t size);
+
+void *arena_alloc(arena_t *p_arena, size_t size, size_t align);
+
+char *arena_strndup(arena_t *p_arena, const char *str, size_t len);
+
+char *arena_strdup(arena_t *p_arena, const char *str);
+
+size_t arena_get_used(arena_t *p_arena);
+
+void arena_reset(arena_t *p_arena);
+
+void arena_deinit(arena_t *p_arena);
+
+#endif
@@ -2,22 +2,81 @@
 #define _BUILT_IN_H_
 
 #include "command_table.h"
+#include "utility.h"
+#include "filter.h"
+
+/* The built-in can run as a pipeline stage (on a thread of the shell, with
+ * its redirections), it does not change the state of the shell */
+#define BUILT_IN_PIPELINE (1u << 0)
+
+/* The built-in uses the job table (it runs on the main thread, with the job
+ * signals set) */
+#define BUILT_IN_JOBS     (1u << 1)
+
+/* The built-in runs as the last stage of a pipeline on the main thread (it
+ * starts jobs of its own), with its redirections */
+#define BUILT_IN_STAGE    (1u << 2)
+
+/* The built-in is a line filter run as a pipeline stage on a thread of the
+ * shell (in any stage, with its redirections) */
+#define BUILT_IN_FILTER   (1u << 3)
+
+/* Maximum length of a built-in name (a name fits a single hash word) */
+#define BUILT_IN_MAX_NAME_LEN (8u)
+
+/**
+ * @brief Function of a built-in changing the state of the shell
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_args Arguments of the first command
+ * @param[in] nb_cmd_args Number of arguments
+ */
+typedef void (*built_in_func_t)(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+
+/**
+ * @brief Function of a built-in run as the last stage of a pipeline
+ * @param[in] cmd_args Arguments of the command
+ * @param[in] nb_cmd_args Number of arguments
+ * @param[in] in_fd Standard input of the stage
+ * @param[in] out_fd Standard output of the stage
+ * @param[in] err_fd Standard error of the stage
+ * @param[in] is_bg Is the pipeline backgrounded
+ */
+typedef void (*built_in_stage_t)(char **cmd_args, int nb_cmd_args, int in_fd, int out_fd, int err_fd, bool is_bg);
 
 /**
- * @brief Built in command types
+ * @brief Built-in command descriptor
  */
-typedef enum __built_in_cmd_t {
+typedef struct __built_in_t {
+
+    /* Name of the command */
+    const char *name;
+
+    /* Length of the name */
+    unsigned int len;
+
+    /* Flags of the built-in (BUILT_IN_*) */
+    unsigned int flags;
+
+    /* Function of a built-in of the shell (NULL for a utility) */
+    built_in_func_t func;
+
+    /* Function of a utility (NULL for a built-in of the shell) */
+    utility_func_t utility;
+
+    /* Function of a built-in stage (NULL for the others) */
+    built_in_stage_t stage;
+
+    /* Function of a filter (NULL for the others) */
+    filter_func_t filter;
+
+} built_in_t;
+
+void built_in_init();
 
-    BUILT_IN_NOT = -1,
-    BUILT_IN_FG,
-    BUILT_IN_BG,
-    BUILT_IN_CD,
-    BUILT_IN_JOBS,
-    BUILT_IN_KILLPG
-} built_in_cmd_t;
+const built_in_t *built_in_lookup(const char *name);
 
-built_in_cmd_t is_built_in(cmd_tab_t *p_cmd_tab);
+void built_in_exec_cmd_tab(cmd_tab_t *p_cmd_tab, const built_in_t *p_built_in);
 
-void built_in_exec_cmd_tab(cmd_tab_t *p_cmd_tab, built_in_cmd_t built_in_type);
+void built_in_assign(cmd_tab_t *p_cmd_tab);
 
 #endif
@@ -2,38 +2,91 @@
 #define _COMMAND_TABLE_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include "arena.h"
 
-/* Maximum number of commands in a command table */
-#define MAX_NB_CMDS     (64u)
-/* Maximum number of command line arguments in a single command */
-#define MAX_NB_CMD_ARGS (128u)
-/* Maximum number of input redirection files */
-#define MAX_NB_IN_ARGS  (128u)
-/* Maximum number of output redirection files */
-#define MAX_NB_OUT_ARGS (128u)
+/**
+ * @brief Token of the command line, a slice of the command line string
+ */
+typedef struct __cmd_tok_t {
+
+    /* Offset of the token in the command line string (-1 for no token) */
+    int off;
+
+    /* Length of the token */
+    int len;
+
+    /* Character following the token in the command line string (it is
+     * overwritten by the terminator when the token is materialized) */
+    char term;
+
+} cmd_tok_t;
+
+/**
+ * @brief Type of a redirection
+ */
+typedef enum {
+
+    /* Input from the file, <file */
+    CMD_REDIR_IN,
+
+    /* Output to the truncated file, >file */
+    CMD_REDIR_OUT,
+
+    /* Output appended to the file, >>file */
+    CMD_REDIR_APPEND,
+
+    /* Duplicate of another file descriptor (or closed for -), <&fd >&fd */
+    CMD_REDIR_DUP
+
+} cmd_redir_type_t;
+
+/**
+ * @brief Redirection of a file descriptor of a command, the argument is a
+ *        slice of the command line string
+ */
+typedef struct __cmd_redir_t {
+
+    /* Type of the redirection */
+    cmd_redir_type_t type;
+
+    /* File descriptor redirected */
+    int fd;
+
+    /* Redirection argument (file name, or file descriptor to duplicate) */
+    cmd_tok_t tok;
+
+} cmd_redir_t;
 
 /**
  * @brief Single command entry in the command table
  */
 typedef struct __cmd_t {
 
-    /* Command arguments */
-    char *cmd_args[MAX_NB_CMD_ARGS];
+    /* Index of the first command argument in the argument pool */
+    int arg_i;
 
     /* Number of command arguments */
     int nb_cmd_args;
 
-    /* Input redirection file argument */
-    char *in_arg;
+    /* Index of the first redirection in the redirection pool */
+    int redir_i;
 
-    /* Boolean to check if the command is input redirected */
-    bool is_input_redirected;
+    /* Number of redirections (in the order of the command line) */
+    int nb_redirs;
 
-    /* Output redirection file argument */
-    char *out_arg;
+    /* Index (in the arguments of the command) of the first argument given
+     * out to the batches of an exec too long for ARG_MAX, the arguments
+     * before and after the slice are repeated by every batch */
+    int batch_i;
 
-    /* Boolean to check if the command is output redirected */
-    bool is_output_redirected;
+    /* Number of arguments given out to the batches (0 when no argument came
+     * from an expansion giving several words, all but the first then) */
+    int nb_batch_args;
+
+    /* Boolean to check if the tokens of the command are NULL terminated
+     * and the argument pointers are set */
+    bool is_materialized;
 
 } cmd_t;
 
@@ -42,31 +95,81 @@ typedef struct __cmd_t {
  */
 typedef struct __cmd_tab_t {
 
-    /* The entire command line string */
+    /* Arena holding every array and string of the command table */
+    arena_t arena;
+
+    /* The entire command line string (the only copy, tokens refer to it) */
     char *cmd_str;
 
+    /* Length of the command line string */
+    int cmd_len;
+
     /* List of commands */
-    cmd_t cmds[MAX_NB_CMDS];
+    cmd_t *cmds;
+
+    /* Pool of command arguments, each command owns a slice of it starting
+     * at #cmd_t.arg_i, ended by a no token entry */
+    cmd_tok_t *toks;
+
+    /* Argument pointers parallel to the pool, set when materialized */
+    char **args;
+
+    /* Pool of redirections, each command owns a slice of it starting at
+     * #cmd_t.redir_i */
+    cmd_redir_t *redirs;
 
     /* Number of commands */
     int nb_cmds;
 
+    /* Number of commands the list can hold */
+    int max_cmds;
+
+    /* Number of arguments in the pool */
+    int nb_args;
+
+    /* Number of arguments the pool can hold */
+    int max_args;
+
+    /* Number of redirections in the pool */
+    int nb_redirs;
+
+    /* Number of redirections the pool can hold */
+    int max_redirs;
+
     /* Are the commands backgrounded or not */
     bool is_background;
 
+    /* Does the command line string hold a $ (to be expanded before the
+     * execution) */
+    bool has_vars;
+
+    /* Does the command line string hold a wildcard, * ? [ (to be expanded
+     * before the execution) */
+    bool has_globs;
+
 } cmd_tab_t;
 
+/**
+ * @brief Function expanding a token of the command line, snprintf like (the
+ *        words of an expansion giving several are separated by NULL
+ *        characters)
+ * @param[in] str Token
+ * @param[in] len Length of the token
+ * @param[out] out Output (not NULL terminated)
+ * @param[in] size Size of the output
+ * @return Length of the expansion
+ */
+typedef size_t (*cmd_tab_expand_func_t)(const char *str, size_t len, char *out, size_t size);
+
 void cmd_tab_init(cmd_tab_t *p_cmd_tab);
 
 void cmd_tab_set_str(cmd_tab_t *p_cmd_tab, char *cmd_str);
 
 void cmd_tab_add_cmd(cmd_tab_t *p_cmd_tab);
 
-void cmd_tab_add_cmd_arg(cmd_tab_t *p_cmd_tab, char *cmd_arg);
+void cmd_tab_add_cmd_arg(cmd_tab_t *p_cmd_tab, int tok_off, int tok_len);
 
-void cmd_tab_set_in_arg(cmd_tab_t *p_cmd_tab, char *in_arg);
-
-void cmd_tab_set_out_arg(cmd_tab_t *p_cmd_tab, char *out_arg);
+void cmd_tab_add_redir(cmd_tab_t *p_cmd_tab, cmd_redir_type_t type, int fd, int tok_off, int tok_len);
 
 void cmd_tab_set_bg(cmd_tab_t *p_cmd_tab);
 
@@ -80,15 +183,29 @@ char **cmd_tab_get_cmd_args(cmd_tab_t *p_cmd_tab, int cmd_i);
 
 int cmd_tab_get_nb_cmd_args(cmd_tab_t *p_cmd_tab, int cmd_i);
 
-bool cmd_tab_is_input_redirected(cmd_tab_t *p_cmd_tab, int cmd_i);
+int cmd_tab_get_batch_arg_i(cmd_tab_t *p_cmd_tab, int cmd_i);
+
+int cmd_tab_get_nb_batch_args(cmd_tab_t *p_cmd_tab, int cmd_i);
+
+void cmd_tab_skip_args(cmd_tab_t *p_cmd_tab, int cmd_i, int nb_args);
+
+int cmd_tab_get_nb_redirs(cmd_tab_t *p_cmd_tab, int cmd_i);
+
+cmd_redir_type_t cmd_tab_get_redir_type(cmd_tab_t *p_cmd_tab, int cmd_i, int redir_i);
+
+int cmd_tab_get_redir_fd(cmd_tab_t *p_cmd_tab, int cmd_i, int redir_i);
+
+char *cmd_tab_get_redir_arg(cmd_tab_t *p_cmd_tab, int cmd_i, int redir_i);
+
+void cmd_tab_materialize(cmd_tab_t *p_cmd_tab);
 
-bool cmd_tab_is_output_redirected(cmd_tab_t *p_cmd_tab, int cmd_i);
+size_t cmd_tab_get_packed_size(cmd_tab_t *p_cmd_tab);
 
-char *cmd_tab_get_in_arg(cmd_tab_t *p_cmd_tab, int cmd_i);
+cmd_tab_t *cmd_tab_pack(void *p_mem, cmd_tab_t *p_cmd_tab);
 
-char *cmd_tab_get_out_arg(cmd_tab_t *p_cmd_tab, int cmd_i);
+void cmd_tab_expand(cmd_tab_t *p_dest, cmd_tab_t *p_src, cmd_tab_expand_func_t expand);
 
-void cmd_tab_copy(cmd_tab_t *p_cmd_tab_dest, cmd_tab_t *p_cmd_tab_src);
+void cmd_tab_reset(cmd_tab_t *p_cmd_tab);
 
 void cmd_tab_deinit(cmd_tab_t *p_cmd_tab);
 
@@ -0,0 +1,160 @@
+#ifndef _DAG_H_
+#define _DAG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "command_table.h"
+
+/* Separator of the name and the dependencies of a task from its command */
+#define DAG_SEP ':'
+
+/* Environment variable naming the file of the recorded durations (else
+ * #DAG_TIMES_FILE in the home directory) */
+#define DAG_TIMES_FILE_ENV "KAVACH_DAG_FILE"
+#define DAG_TIMES_FILE ".kavach_dag"
+
+/* Maximum number of workers */
+#define DAG_MAX_WORKERS (1024u)
+
+/* Size of a read of the specification */
+#define DAG_READ_SIZE (4096u)
+
+/**
+ * @brief State of a task
+ */
+typedef enum {
+
+    /* Waiting for its dependencies */
+    DAG_WAITING,
+
+    /* In the ready queue of a worker */
+    DAG_READY,
+
+    /* Started by a worker */
+    DAG_RUNNING,
+
+    /* Completed successfully */
+    DAG_DONE,
+
+    /* Completed with a failure (or interrupted) */
+    DAG_FAILED,
+
+    /* Not run, a dependency failed */
+    DAG_SKIPPED
+
+} dag_state_t;
+
+/**
+ * @brief Task of the graph, a command line run once its dependencies are
+ *        done
+ */
+typedef struct __dag_task_t {
+
+    /* Name of the task (in the specification) */
+    char *name;
+
+    /* Command line of the task (in the specification) */
+    char *cmd_str;
+
+    /* Command table of the command line */
+    cmd_tab_t cmd_tab;
+
+    /* Dependencies of the task, as the indexes of the tasks (the names in
+     * the specification till they are resolved) */
+    int dep_i;
+    int nb_deps;
+
+    /* Tasks depending on the task */
+    int dependent_i;
+    int nb_dependents;
+
+    /* Number of dependencies not done yet */
+    int nb_waiting;
+
+    /* Duration recorded by the previous runs in milliseconds (0 if none) */
+    uint64_t cost;
+
+    /* Cost of the longest chain of tasks starting with the task, the ready
+     * tasks are run from the longest */
+    uint64_t rank;
+
+    /* Process group id of the task while it runs */
+    int gpid;
+
+    /* Time when the task is started in milliseconds */
+    uint64_t start;
+
+    /* State of the task */
+    dag_state_t state;
+
+} dag_task_t;
+
+/**
+ * @brief Worker of a run, running a task at a time from its ready queue (or
+ *        stolen from the queue of another worker once it is empty)
+ */
+typedef struct __dag_worker_t {
+
+    /* Ready tasks, from the longest rank */
+    int *queue;
+
+    /* Number of ready tasks */
+    int nb_ready;
+
+    /* Task running (-1 if the worker is idle) */
+    int task_i;
+
+} dag_worker_t;
+
+/**
+ * @brief Run of a graph of tasks
+ */
+typedef struct __dag_t {
+
+    /* Specification (its words are terminated in place) */
+    char *spec;
+
+    /* Tasks */
+    dag_task_t *tasks;
+    int nb_tasks;
+
+    /* Names of the dependencies of the tasks, then their indexes */
+    char **dep_names;
+    int *deps;
+    int nb_deps;
+
+    /* Tasks depending on every task */
+    int *dependents;
+
+    /* Workers */
+    dag_worker_t *workers;
+    int nb_workers;
+
+    /* Command tables of the task started, with the variables and the
+     * wildcards expanded */
+    cmd_tab_t expanded;
+    cmd_tab_t globbed;
+
+    /* Number of tasks running */
+    int nb_running;
+
+    /* Number of tasks failed and skipped */
+    int nb_failed;
+    int nb_skipped;
+
+    /* Standard input of the tasks (the null device) */
+    int null_fd;
+
+    /* Standard output and error of the run */
+    int out_fd;
+    int err_fd;
+
+    /* Is the run interrupted (no task is started anymore) */
+    bool is_stopping;
+
+} dag_t;
+
+void dag_run(char **cmd_args, int nb_cmd_args, int in_fd, int out_fd, int err_fd, bool is_bg);
+
+#endif
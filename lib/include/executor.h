@@ -1,8 +1,16 @@
 #ifndef _EXECUTOR_H_
 #define _EXECUTOR_H_
 
+#include <stdbool.h>
+#include <sys/types.h>
 #include "command_table.h"
 
-void executor_exec_cmd_tab(cmd_tab_t *p_cmd_tab);
+int executor_exec_cmd_tab(cmd_tab_t *p_cmd_tab);
+
+pid_t executor_start_cmd_tab(cmd_tab_t *p_cmd_tab, int in_fd, int out_fd, int err_fd, int *p_status);
+
+void executor_split_cmd_tab(cmd_tab_t *p_cmd_tab, int nb_copies);
+
+bool executor_redirect_shell(cmd_tab_t *p_cmd_tab, int cmd_i);
 
 #endif
@@ -0,0 +1,92 @@
+#ifndef _FILTER_H_
+#define _FILTER_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Size of the input and output buffers of a filter */
+#define FILTER_BUF_SIZE (256u * 1024u)
+
+/* Number of lines printed by khead and ktail by default */
+#define FILTER_DEFAULT_NB_LINES (10u)
+
+/* Lowest file descriptor of the events of a filter (above the ones which
+ * can be redirected) */
+#define FILTER_MIN_FD (10)
+
+/* Buffered input and output of a filter (private to the filters) */
+typedef struct __filter_io_t filter_io_t;
+
+struct __filter_t;
+
+/**
+ * @brief Function of a filter (a pipeline stage run as a thread of the
+ *        shell), registered with the built-ins
+ * @param[in,out] p_io Pointer to the input and output of the filter
+ * @param[in] p_filter Pointer to the filter
+ * @return Exit status
+ */
+typedef int (*filter_func_t)(filter_io_t *p_io, struct __filter_t *p_filter);
+
+/**
+ * @brief Filter stage, the record and the copy of its arguments are
+ *        allocated as a single block
+ */
+typedef struct __filter_t {
+
+    /* Function of the filter */
+    filter_func_t func;
+
+    /* Input file descriptor (owned by the filter) */
+    int in_fd;
+
+    /* Output file descriptor (owned by the filter) */
+    int out_fd;
+
+    /* Does the filter free itself when done (not joined) */
+    bool is_detached;
+
+    /* Event signaled to stop the filter, its input is left and its output
+     * dropped (-1 if the filter cannot be stopped) */
+    int stop_fd;
+
+    /* Event signaled once the filter is done, so that it is waited for
+     * through the event loop of the jobs (-1 if the filter is detached) */
+    int done_fd;
+
+    /* Thread running the filter */
+    pthread_t thread;
+
+    /* Exit status of the filter (set once it is done) */
+    int status;
+
+    /* Number of arguments */
+    int nb_args;
+
+    /* Arguments (NULL terminated) */
+    char *args[];
+
+} filter_t;
+
+int filter_grep(filter_io_t *p_io, filter_t *p_filter);
+
+int filter_cut(filter_io_t *p_io, filter_t *p_filter);
+
+int filter_wc(filter_io_t *p_io, filter_t *p_filter);
+
+int filter_head(filter_io_t *p_io, filter_t *p_filter);
+
+int filter_tail(filter_io_t *p_io, filter_t *p_filter);
+
+filter_t *filter_create(filter_func_t func, char **args, int nb_args);
+
+void filter_start(filter_t *p_filter, int in_fd, int out_fd, bool is_detached);
+
+int filter_run(filter_t *p_filter, int in_fd, int out_fd);
+
+void filter_stop(filter_t *p_filter);
+
+int filter_join(filter_t *p_filter);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef _HASH_H_
+#define _HASH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Multiplier for mixing the words of the data */
+#define HASH_MUL (0x9e3779b97f4a7c15ull)
+
+/* Mixes a 64 bit word into the hash */
+#define HASH_MIX(h, w)                                  \
+    ({                                                  \
+        uint64_t __h = ((h) ^ (w)) * HASH_MUL;          \
+        __h ^ (__h >> 29);                              \
+    })
+
+/**
+ * @brief Computes a 64 bit hash of the data, eight bytes at a time
+ * @param[in] p_data Pointer to the data
+ * @param[in] len Number of bytes
+ * @return Hash value
+ */
+static inline uint64_t hash_bytes(const void *p_data, size_t len) {
+
+    const unsigned char *p_byte = (const unsigned char *)p_data;
+    uint64_t h = len * HASH_MUL;
+    uint64_t w;
+
+    /* Mix the whole words */
+    for (; len >= 8; len -= 8, p_byte += 8) {
+
+        memcpy(&w, p_byte, 8);
+        h = HASH_MIX(h, w);
+    }
+
+    /* Mix the remaining bytes as a single word */
+    if (len) {
+
+        w = 0;
+        memcpy(&w, p_byte, len);
+        h = HASH_MIX(h, w);
+    }
+
+    return HASH_MIX(h, h >> 32);
+}
+
+#endif
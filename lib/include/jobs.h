@@ -3,46 +3,156 @@
 
 #include "command_table.h"
 
-/* Maximum number of processes in a group */
-#define MAX_PROCS_IN_GRP  (128u)
+/* Number of events handled per wait of the event loop */
+#define JOBS_NB_EVENTS (64)
+
+/* Initial number of job slots (the ids of the jobs) */
+#define JOBS_MIN_SLOTS (16u)
+
+/* Initial number of slots of the process indexes (a power of 2) */
+#define JOBS_MIN_KEYS (64u)
+
+/**
+ * @brief State of a process (or of a job, from the states of its processes)
+ */
+typedef enum {
+
+    /* Running (or continued) */
+    JOB_RUNNING,
+
+    /* Stopped by a signal */
+    JOB_STOPPED,
+
+    /* Exited or killed, and reaped */
+    JOB_DONE
+
+} job_state_t;
+
+/**
+ * @brief Process of a job
+ */
+typedef struct __job_proc_t {
+
+    /* Process id */
+    int pid;
+
+    /* File descriptor of the process, readable once it exits (-1 once it is
+     * reaped) */
+    int pidfd;
+
+    /* State of the process */
+    job_state_t state;
+
+    /* Exit status of the process (128 plus the signal number if killed),
+     * set once it is reaped */
+    int status;
+
+} job_proc_t;
 
 /**
- * @brief Job structure to hold information of single job (or a process group)
+ * @brief Job structure to hold information of single job (or a process group),
+ *        the record and its arrays are allocated as a single block
  */
 typedef struct job_t {
 
-    /* Command table corresponding to the job */
-    cmd_tab_t cmd_tab;
+    /* Command table corresponding to the job (packed in the same block) */
+    cmd_tab_t *p_cmd_tab;
 
     /* Process group id */
     int gpid;
 
-    /* All the process ids in the group */
-    int pids[MAX_PROCS_IN_GRP];
-
     /* Number of processes */
     int nb_pids;
 
+    /* Number of processes the group can hold */
+    int max_pids;
+
     /* Number of processes completed */
     int nb_procs_comp;
 
+    /* Number of processes stopped */
+    int nb_procs_stopped;
+
+    /* All the processes in the group (one per command, per copy of the
+     * pipeline) */
+    job_proc_t procs[];
+
 } job_t;
 
-void jobs_init();
+/**
+ * @brief Entry of an index from a process id (or a process group id) to the
+ *        slot of its job
+ */
+typedef struct __job_key_t {
+
+    /* Process id or process group id (0 for a free slot) */
+    int key;
+
+    /* Slot of the job */
+    int job_i;
+
+    /* Index of the process in the job (-1 for a process group id) */
+    int proc_i;
+
+} job_key_t;
+
+/**
+ * @brief Index from the process ids (or the process group ids) to the
+ *        jobs, open addressed with linear probing
+ */
+typedef struct __job_index_t {
+
+    /* Entries */
+    job_key_t *keys;
+
+    /* Number of slots (a power of 2) */
+    size_t nb_slots;
+
+    /* Number of entries */
+    size_t nb_keys;
+
+} job_index_t;
+
+/**
+ * @brief Function called after the events of the loop are handled while the
+ *        shell waits for its input (runs driven by the completions of their
+ *        jobs)
+ */
+typedef void (*jobs_hook_t)();
+
+void jobs_init(bool is_interactive);
 
 void jobs_signal_init();
 
 void jobs_signal_deinit();
 
-void jobs_add_proc_grp(int gpid, cmd_tab_t *p_cmd_tab);
+void jobs_add_proc_grp(int gpid, cmd_tab_t *p_cmd_tab, int nb_procs);
 
 void jobs_add_proc(int gpid, int pid);
 
-void jobs_fg_proc_grp(int pid);
+bool jobs_fg_proc_grp(int pid, int *p_status);
 
 void jobs_bg_proc_grp(int pid);
 
-void jobs_mark_proc_comp(int pid, bool do_print);
+void jobs_wait_fd(int fd);
+
+void jobs_poll();
+
+void jobs_report();
+
+bool jobs_wait(int fd);
+
+bool jobs_is_interrupted();
+
+bool jobs_is_suspended();
+
+job_state_t jobs_get_grp_state(int gpid);
+
+int jobs_get_grp_status(int gpid);
+
+void jobs_remove_grp(int gpid);
+
+void jobs_set_hook(jobs_hook_t hook);
 
 void jobs_print();
 
@@ -0,0 +1,29 @@
+#ifndef _OPTIONS_H_
+#define _OPTIONS_H_
+
+/**
+ * @brief Options of the shell (set with the setopt built-in)
+ */
+typedef enum __option_t {
+
+    /* Capacity of the pipes between the commands in bytes (0 for the
+     * system default) */
+    OPTION_PIPE_SIZE = 0,
+
+    /* Number of execs run at once when the arguments of a command exceed
+     * ARG_MAX and are split into batches (0 to fail with E2BIG instead) */
+    OPTION_BATCH_WIDTH,
+
+    NB_OPTIONS
+
+} option_t;
+
+void options_init();
+
+long options_get(option_t option);
+
+int options_set(const char *name, const char *value);
+
+void options_print();
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "command_table.h"
+
+/* Separator of the command template from the arguments */
+#define PARALLEL_SEP ":::"
+
+/* Placeholder of the template replaced by the argument (the argument is
+ * appended if the template has none) */
+#define PARALLEL_ARG "{}"
+
+/* Maximum number of instances at a time */
+#define PARALLEL_MAX_SLOTS (1024u)
+
+/* Initial size of the buffer of the arguments (grown as needed) */
+#define PARALLEL_BUF_MIN_SIZE (4096u)
+
+/* Minimum space left in the buffer of the arguments for a read */
+#define PARALLEL_READ_MIN_SIZE (1024u)
+
+/* Size of the buffer copying the output of an instance (if it cannot be sent
+ * by the kernel) */
+#define PARALLEL_COPY_SIZE (64u * 1024u)
+
+/**
+ * @brief Slot of a run, an instance of the template at a time
+ */
+typedef struct __parallel_slot_t {
+
+    /* Process group id of the instance (-1 if the slot is free) */
+    int gpid;
+
+    /* Memory files holding the standard output and error of the instance
+     * till it is done (-1 till the slot is first used) */
+    int out_fd;
+    int err_fd;
+
+} parallel_slot_t;
+
+/**
+ * @brief Run of the instances of a command template, at most one per slot
+ *        at a time
+ */
+typedef struct __parallel_t {
+
+    /* Command table of the template (a single command) */
+    cmd_tab_t tmpl;
+
+    /* Command table of the current instance */
+    cmd_tab_t inst;
+
+    /* Arguments, one per line (the ones given and the ones read) */
+    char *buf;
+
+    /* Number of bytes of arguments */
+    size_t len;
+
+    /* Size of the buffer */
+    size_t size;
+
+    /* Offset of the next argument */
+    size_t pos;
+
+    /* Input of the arguments (-1 if there is none, or once it is read) */
+    int in_fd;
+
+    /* Standard input of the instances (the null device) */
+    int null_fd;
+
+    /* Standard output and error of the run */
+    int out_fd;
+    int err_fd;
+
+    /* Slots of the instances */
+    parallel_slot_t *slots;
+
+    /* Number of slots */
+    int nb_slots;
+
+    /* Number of instances running */
+    int nb_running;
+
+    /* Is the run interrupted (no instance is started anymore) */
+    bool is_stopping;
+
+} parallel_t;
+
+void parallel_run(char **cmd_args, int nb_cmd_args, int in_fd, int out_fd, int err_fd, bool is_bg);
+
+#endif
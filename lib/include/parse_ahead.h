@@ -0,0 +1,77 @@
+#ifndef _PARSE_AHEAD_H_
+#define _PARSE_AHEAD_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "reader.h"
+#include "command_table.h"
+#include "parser.h"
+
+/* Number of lines parsed ahead of the line being executed */
+#define PARSE_AHEAD_DEPTH (32u)
+
+/**
+ * @brief Line read and parsed ahead of its execution
+ */
+typedef struct __parse_ahead_line_t {
+
+    /* Copy of the command line string */
+    char *cmd_str;
+
+    /* Size of the copy buffer */
+    size_t cmd_size;
+
+    /* File offset of the end of the line */
+    off_t off;
+
+    /* Command table of the line */
+    cmd_tab_t cmd_tab;
+
+    /* Parser context of the line (holds the error, if any) */
+    parser_ctx_t ctx;
+
+} parse_ahead_line_t;
+
+/**
+ * @brief Queue of lines parsed by a helper thread, while the commands of the
+ *        previous lines execute
+ */
+typedef struct __parse_ahead_t {
+
+    /* Reader of the lines (used by the helper thread only) */
+    reader_t *p_reader;
+
+    /* Ring of the lines */
+    parse_ahead_line_t lines[PARSE_AHEAD_DEPTH];
+
+    /* Index of the next line to be executed */
+    unsigned int head;
+
+    /* Number of lines parsed and not released */
+    unsigned int nb_lines;
+
+    /* Has the end of the input been reached by the helper thread */
+    bool is_eof;
+
+    /* Lock of the ring */
+    pthread_mutex_t lock;
+
+    /* Signalled when a line is parsed */
+    pthread_cond_t parsed;
+
+    /* Signalled when a line is released */
+    pthread_cond_t released;
+
+    /* Helper thread */
+    pthread_t thread;
+
+} parse_ahead_t;
+
+void parse_ahead_start(parse_ahead_t *p_ahead, reader_t *p_reader);
+
+parse_ahead_line_t *parse_ahead_get(parse_ahead_t *p_ahead);
+
+void parse_ahead_release(parse_ahead_t *p_ahead);
+
+#endif
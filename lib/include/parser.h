@@ -40,6 +40,137 @@ typedef enum __parser_err_t {
 
 } parser_err_t;
 
+/**
+ * @brief Parser context, holds the complete state of parsing a single line so
+ *        that multiple lines can be parsed at once (on different threads)
+ */
+typedef struct __parser_ctx_t {
+
+    /* Command table being set */
+    cmd_tab_t *p_cmd_tab;
+
+    /* Command line string being parsed */
+    const char *cmd_str;
+
+    /* Length of the command line string */
+    size_t cmd_len;
+
+    /* Offset of the current token */
+    size_t cmd_i;
+
+    /* Current state */
+    parser_state_t state;
+
+    /* Expected argument type */
+    parser_arg_type_t arg_type;
+
+    /* Type of the redirection expecting its argument */
+    cmd_redir_type_t redir_type;
+
+    /* File descriptor of the redirection expecting its argument */
+    int redir_fd;
+
+    /* Result of the parsing */
+    parser_err_t err;
+
+} parser_ctx_t;
+
+/**
+ * @brief State of the lexer at a token boundary, the lexing can be resumed
+ *        from it
+ */
+typedef struct __parser_snap_t {
+
+    /* Offset of the token */
+    size_t off;
+
+    /* State before the token */
+    parser_state_t state;
+
+    /* Expected argument type before the token */
+    parser_arg_type_t arg_type;
+
+} parser_snap_t;
+
+/**
+ * @brief Type of a token given by the lexer
+ */
+typedef enum __parser_tok_type_t {
+
+    PARSER_TOK_INVALID = 0,
+    PARSER_TOK_WHITE,
+    PARSER_TOK_CMD,
+    PARSER_TOK_ARG,
+    PARSER_TOK_IN_FILE,
+    PARSER_TOK_OUT_FILE,
+    PARSER_TOK_IN,
+    PARSER_TOK_OUT,
+    PARSER_TOK_PIPE,
+    PARSER_TOK_BG,
+    PARSER_TOK_END
+
+} parser_tok_type_t;
+
+/**
+ * @brief Token given by the lexer
+ */
+typedef struct __parser_tok_t {
+
+    /* Offset of the token in the line */
+    size_t off;
+
+    /* Length of the token (0 for the end) */
+    size_t len;
+
+    /* Type of the token */
+    parser_tok_type_t type;
+
+    /* Error at the token */
+    parser_err_t err;
+
+} parser_tok_t;
+
+/**
+ * @brief Resumable lexer running the parser state machine without setting a
+ *        command table, for validating and colouring a line while it is
+ *        edited
+ */
+typedef struct __parser_lexer_t {
+
+    /* Line being lexed */
+    const char *str;
+
+    /* Length of the line */
+    size_t len;
+
+    /* Current state */
+    parser_snap_t snap;
+
+    /* Snapshots of the states before every token lexed */
+    parser_snap_t *snaps;
+
+    /* Number of snapshots */
+    size_t nb_snaps;
+
+    /* Capacity of the snapshots array */
+    size_t max_snaps;
+
+} parser_lexer_t;
+
+void parser_ctx_init(parser_ctx_t *p_ctx, cmd_tab_t *p_cmd_tab);
+
+parser_err_t parser_ctx_parse(parser_ctx_t *p_ctx, char *cmd_str);
+
+void parser_ctx_print_err(parser_ctx_t *p_ctx);
+
 parser_err_t parser_set_cmd_tab(cmd_tab_t *p_cmd_tab, char *cmd_str);
 
+void parser_lexer_init(parser_lexer_t *p_lex);
+
+void parser_lexer_set_str(parser_lexer_t *p_lex, const char *str, size_t len, size_t edit_off);
+
+parser_err_t parser_lexer_next(parser_lexer_t *p_lex, parser_tok_t *p_tok);
+
+void parser_lexer_deinit(parser_lexer_t *p_lex);
+
 #endif
@@ -0,0 +1,81 @@
+#ifndef _PATH_CACHE_H_
+#define _PATH_CACHE_H_
+
+#include <stdint.h>
+#include <time.h>
+
+/* Number of entries of the cache (power of two) */
+#define PATH_CACHE_SIZE     (1024u)
+
+/* Maximum number of entries in use, the cache is emptied beyond it */
+#define PATH_CACHE_MAX_USED (PATH_CACHE_SIZE * 3u / 4u)
+
+/* Maximum length of a cached command name (longer ones are not cached) */
+#define PATH_CACHE_NAME_LEN (48u)
+
+/* Maximum number of directories in PATH (the rest are not searched) */
+#define PATH_CACHE_MAX_DIRS (64u)
+
+/* Environment variable naming the file shared by the shells for the index */
+#define PATH_CACHE_FILE_ENV "KAVACH_HASH_FILE"
+
+/**
+ * @brief Entry of the command path cache
+ */
+typedef struct __path_entry_t {
+
+    /* Hash of the command name (0 for a free entry) */
+    uint64_t hash;
+
+    /* Check of the entry against partial writes by other shells */
+    uint64_t check;
+
+    /* Index of the directory in PATH holding the command (-1 if the command
+     * is not found) */
+    int dir_i;
+
+    /* Number of times the entry is used */
+    unsigned int hits;
+
+    /* Command name */
+    char name[PATH_CACHE_NAME_LEN];
+
+} path_entry_t;
+
+/**
+ * @brief Index of the command paths (in the memory of the shell or in a
+ *        mapped file shared by the shells)
+ */
+typedef struct __path_index_t {
+
+    /* Identifies an initialized index */
+    uint64_t magic;
+
+    /* Hash of the PATH the index is built for */
+    uint64_t path_hash;
+
+    /* Number of entries in use */
+    unsigned int nb_used;
+
+    /* Number of directories in PATH */
+    unsigned int nb_dirs;
+
+    /* Modification times of the directories when the index was built */
+    struct timespec dir_mtimes[PATH_CACHE_MAX_DIRS];
+
+    /* Entries, with linear probing */
+    path_entry_t entries[PATH_CACHE_SIZE];
+
+} path_index_t;
+
+void path_cache_init();
+
+void path_cache_revalidate();
+
+char *path_cache_lookup(char *name, char *path, size_t size);
+
+void path_cache_print();
+
+void path_cache_clear();
+
+#endif
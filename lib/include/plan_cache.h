@@ -0,0 +1,22 @@
+#ifndef _PLAN_CACHE_H_
+#define _PLAN_CACHE_H_
+
+#include "command_table.h"
+
+/* Maximum number of command plans held by the cache */
+#define PLAN_CACHE_SIZE     (256u)
+
+/* Number of hash buckets of the cache (power of two) */
+#define PLAN_CACHE_BUCKETS  (512u)
+
+void plan_cache_init();
+
+cmd_tab_t *plan_cache_get(char *cmd_str);
+
+cmd_tab_t *plan_cache_put(char *cmd_str, cmd_tab_t *p_cmd_tab);
+
+void plan_cache_print_stats();
+
+void plan_cache_clear();
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef _READER_H_
+#define _READER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Initial size of the read buffer (grows to hold the longest line) */
+#define READER_BUF_SIZE (64u * 1024u)
+
+/**
+ * @brief Line reader over a file descriptor or a string, without any limit
+ *        on the line length
+ */
+typedef struct __reader_t {
+
+    /* File descriptor being read (-1 for a string) */
+    int fd;
+
+    /* Buffer holding the data (mapped file, string copy or read buffer) */
+    char *buf;
+
+    /* Size of the buffer */
+    size_t size;
+
+    /* Offset of the first unread byte in the buffer */
+    size_t start;
+
+    /* Offset of the end of the valid data in the buffer */
+    size_t end;
+
+    /* Offset of the file corresponding to the start of the buffer */
+    off_t file_off;
+
+    /* Is the buffer a mapping of the whole file */
+    bool is_mapped;
+
+    /* Has the end of the input been read */
+    bool is_eof;
+
+    /* Copy of a last line not followed by a newline (mapped files only) */
+    char *tail;
+
+} reader_t;
+
+void reader_open_fd(reader_t *p_reader, int fd);
+
+void reader_open_str(reader_t *p_reader, const char *str);
+
+char *reader_get_line(reader_t *p_reader);
+
+off_t reader_tell(reader_t *p_reader);
+
+bool reader_is_empty(reader_t *p_reader);
+
+void reader_sync(reader_t *p_reader, off_t off);
+
+void reader_close(reader_t *p_reader);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _REDIRECT_H_
+#define _REDIRECT_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Size of a copy when the kernel cannot splice the files */
+#define REDIRECT_BUF_SIZE (64u * 1024u)
+
+/**
+ * @brief Copy of the inputs (one after the other) to all the outputs, done
+ *        by a thread of the shell without the data entering userspace
+ *        (multiple inputs are spliced to a single pipe, a single pipe is
+ *        teed to multiple outputs), the record and the file descriptors are
+ *        allocated as a single block
+ */
+typedef struct __redirect_t {
+
+    /* Number of input file descriptors */
+    int nb_in_fds;
+
+    /* Number of output file descriptors */
+    int nb_out_fds;
+
+    /* Does the redirection free itself when done (not joined) */
+    bool is_detached;
+
+    /* Thread copying the data */
+    pthread_t thread;
+
+    /* Mapped data given to the output instead of the inputs (NULL for
+     * none), the mapping is kept by the caller till the redirection is done */
+    const char *data;
+
+    /* Number of bytes of mapped data */
+    size_t len;
+
+    /* Input file descriptors followed by the output file descriptors (all
+     * owned by the redirection) */
+    int fds[];
+
+} redirect_t;
+
+redirect_t *redirect_start(int *in_fds, int nb_in_fds, int *out_fds, int nb_out_fds, bool is_detached);
+
+redirect_t *redirect_start_map(const char *data, size_t len, int out_fd, bool is_detached);
+
+void redirect_join(redirect_t *p_redirect);
+
+#endif
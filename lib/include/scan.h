@@ -0,0 +1,14 @@
+#ifndef _SCAN_H_
+#define _SCAN_H_
+
+#include <stddef.h>
+
+size_t scan_ident(const char *str, size_t len);
+
+size_t scan_white(const char *str, size_t len);
+
+size_t scan_count(const char *str, size_t len, char ch);
+
+const char *scan_find(const char *hay, size_t len, const char *needle, size_t nlen);
+
+#endif
@@ -44,15 +44,59 @@
 
 #define IS_VALID_IDENTIFIER(ch)                     \
     ({                                              \
-        (((ch) >= 'a') && ((ch) <= 'z')) ||         \
-        (((ch) >= 'A') && ((ch) <= 'Z')) ||         \
-        (((ch) >= '0') && ((ch) <= '9')) ||         \
-        ((ch) == '_')                    ||         \
-        ((ch) == '-')                    ||         \
-        ((ch) == '.')                    ||         \
-        ((ch) == '~')                    ||         \
-        ((ch) == ',')                    ||         \
-        ((ch) == '/');                              \
+        CHAR_CLASS(ch) == CHAR_CLASS_IDENT;         \
+    })
+
+#define IS_COMMENT_LINE(str)                        \
+    ({                                              \
+        const char *__p_ch = (str);                 \
+        while (IS_WHITESPACE(*__p_ch)) __p_ch++;    \
+        (*__p_ch == '#');                           \
+    })
+
+/**
+ * @brief Character classes of the command line string
+ */
+typedef enum __char_class_t {
+
+    CHAR_CLASS_INVALID = 0,
+    CHAR_CLASS_NULL,
+    CHAR_CLASS_WHITE,
+    CHAR_CLASS_IDENT,
+    CHAR_CLASS_IN,
+    CHAR_CLASS_OUT,
+    CHAR_CLASS_PIPE,
+    CHAR_CLASS_BG
+
+} char_class_t;
+
+#define NB_CHAR_CLASSES (8u)
+
+/* Class of every byte (bytes of UTF-8 sequences are identifiers), the
+ * vectorized scanner in scan.c mirrors the identifier ranges */
+static const unsigned char g_char_class[256] = {
+
+    ['\0']            = CHAR_CLASS_NULL,
+    [' ']             = CHAR_CLASS_WHITE,
+    ['\t']            = CHAR_CLASS_WHITE,
+    ['<']             = CHAR_CLASS_IN,
+    ['>']             = CHAR_CLASS_OUT,
+    ['|']             = CHAR_CLASS_PIPE,
+    ['&']             = CHAR_CLASS_BG,
+    ['!']             = CHAR_CLASS_IDENT,
+    ['$' ... '%']     = CHAR_CLASS_IDENT,
+    ['*' ... ':']     = CHAR_CLASS_IDENT,
+    ['=']             = CHAR_CLASS_IDENT,
+    ['?' ... '_']     = CHAR_CLASS_IDENT,
+    ['a' ... '{']     = CHAR_CLASS_IDENT,
+    ['}']             = CHAR_CLASS_IDENT,
+    ['~']             = CHAR_CLASS_IDENT,
+    [0x80 ... 0xff]   = CHAR_CLASS_IDENT
+};
+
+#define CHAR_CLASS(ch)                              \
+    ({                                              \
+        (char_class_t)g_char_class[(unsigned char)(ch)]; \
     })
 
 #endif
@@ -0,0 +1,71 @@
+#ifndef _UTILITY_H_
+#define _UTILITY_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+
+/* Size of the output buffer of a utility */
+#define UTILITY_BUF_SIZE (4096u)
+
+/**
+ * @brief Function of a utility, writing to the output and error file
+ *        descriptors (left open)
+ * @return Exit status
+ */
+typedef int (*utility_func_t)(char **args, int nb_args, int out_fd, int err_fd);
+
+/**
+ * @brief Utility run as a pipeline stage on a thread of the shell, the
+ *        record and the copy of its arguments are allocated as a single block
+ */
+typedef struct __utility_t {
+
+    /* Function of the utility */
+    utility_func_t func;
+
+    /* Output file descriptor (owned by the utility) */
+    int out_fd;
+
+    /* Error file descriptor (owned by the utility) */
+    int err_fd;
+
+    /* Does the utility free itself when done (not joined) */
+    bool is_detached;
+
+    /* Thread running the utility */
+    pthread_t thread;
+
+    /* Exit status of the utility (set once it is done) */
+    int status;
+
+    /* Number of arguments */
+    int nb_args;
+
+    /* Arguments (NULL terminated) */
+    char *args[];
+
+} utility_t;
+
+int utility_echo(char **args, int nb_args, int out_fd, int err_fd);
+
+int utility_printf(char **args, int nb_args, int out_fd, int err_fd);
+
+int utility_true(char **args, int nb_args, int out_fd, int err_fd);
+
+int utility_false(char **args, int nb_args, int out_fd, int err_fd);
+
+int utility_test(char **args, int nb_args, int out_fd, int err_fd);
+
+int utility_bracket(char **args, int nb_args, int out_fd, int err_fd);
+
+int utility_pwd(char **args, int nb_args, int out_fd, int err_fd);
+
+int utility_kill(char **args, int nb_args, int out_fd, int err_fd);
+
+utility_t *utility_create(utility_func_t func, char **args, int nb_args);
+
+void utility_start(utility_t *p_utility, int out_fd, int err_fd, bool is_detached);
+
+int utility_join(utility_t *p_utility);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _VARS_H_
+#define _VARS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Initial number of slots of the variable table (a power of 2) */
+#define VARS_MIN_SLOTS (64u)
+
+/**
+ * @brief Variable of the shell, its name and value are kept as a single
+ *        NAME=value string, which is the environment entry if exported
+ */
+typedef struct __var_t {
+
+    /* NAME=value string (NULL for a free slot) */
+    char *str;
+
+    /* Length of the name */
+    size_t name_len;
+
+    /* Hash of the name */
+    uint64_t hash;
+
+    /* Is the variable in the environment of the commands */
+    bool is_exported;
+
+} var_t;
+
+void vars_init(char **envp);
+
+size_t vars_get_name_len(const char *str, size_t len);
+
+size_t vars_get_assign_len(const char *str);
+
+const char *vars_get(const char *name, size_t name_len);
+
+void vars_set(const char *name, size_t name_len, const char *value, bool is_exported);
+
+void vars_unset(const char *name, size_t name_len);
+
+char **vars_get_envp();
+
+size_t vars_get_envp_size();
+
+void vars_print(bool is_exported_only);
+
+size_t vars_expand(const char *str, size_t len, char *out, size_t size);
+
+#endif
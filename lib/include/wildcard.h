@@ -0,0 +1,147 @@
+#ifndef _WILDCARD_H_
+#define _WILDCARD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+/* Number of directory listings kept in the cache */
+#define WILDCARD_NB_DIRS (8u)
+
+/* Initial size of the buffer of a directory listing (grown as needed) */
+#define WILDCARD_LIST_MIN_SIZE (64u * 1024u)
+
+/* Minimum space left in the listing buffer for a directory read */
+#define WILDCARD_READ_MIN_SIZE (32u * 1024u)
+
+/**
+ * @brief Name of a directory listing
+ */
+typedef struct __wildcard_name_t {
+
+    /* First bytes of the name, in the order of the name (compared before
+     * the names) */
+    uint64_t key;
+
+    /* Name (in the records of the listing) */
+    const char *name;
+
+    /* Length of the name */
+    size_t len;
+
+    /* Type of the entry (DT_*) */
+    unsigned char type;
+
+} wildcard_name_t;
+
+/**
+ * @brief Listing of a directory, the records read by getdents64 kept as
+ *        they are with a sorted index of the names (the matched names are
+ *        copied from them, in order)
+ */
+typedef struct __wildcard_dir_t {
+
+    /* Device of the directory */
+    dev_t dev;
+
+    /* Inode of the directory */
+    ino_t ino;
+
+    /* Modification time of the directory when it was read */
+    struct timespec mtime;
+
+    /* Is the listing reused while the modification time is the same (it
+     * was not modified around the time it was read) */
+    bool is_stable;
+
+    /* Records of the entries (NULL for a free slot) */
+    char *buf;
+
+    /* Number of bytes of records */
+    size_t len;
+
+    /* Size of the buffer */
+    size_t size;
+
+    /* Names sorted (without . and ..) */
+    wildcard_name_t *names;
+
+    /* Number of names */
+    size_t nb_names;
+
+    /* Number of names the array can hold */
+    size_t max_names;
+
+    /* Time of the last use (for the eviction) */
+    unsigned long last_use;
+
+} wildcard_dir_t;
+
+/**
+ * @brief Type of a compiled pattern operation
+ */
+typedef enum {
+
+    /* Literal characters */
+    WILDCARD_OP_LIT,
+
+    /* Any character, ? */
+    WILDCARD_OP_ANY,
+
+    /* Any string, * */
+    WILDCARD_OP_STAR,
+
+    /* Character of the set, [...] */
+    WILDCARD_OP_SET
+
+} wildcard_op_type_t;
+
+/**
+ * @brief Operation of a compiled pattern
+ */
+typedef struct __wildcard_op_t {
+
+    /* Type of the operation */
+    wildcard_op_type_t type;
+
+    /* Literal characters (in the pattern) */
+    const char *lit;
+
+    /* Number of literal characters */
+    size_t len;
+
+    /* Bitmap of the characters of the set */
+    unsigned char set[32];
+
+} wildcard_op_t;
+
+/**
+ * @brief Pattern of a path component compiled to operations, with the
+ *        literal prefix and suffix checked first
+ */
+typedef struct __wildcard_pat_t {
+
+    /* Operations */
+    wildcard_op_t *ops;
+
+    /* Number of operations */
+    int nb_ops;
+
+    /* Minimum length of a matching name */
+    size_t min_len;
+
+    /* Literal prefix (the leading literal operation) */
+    const char *prefix;
+    size_t prefix_len;
+
+    /* Literal suffix (the trailing literal operation after a *) */
+    const char *suffix;
+    size_t suffix_len;
+
+} wildcard_pat_t;
+
+size_t wildcard_expand(const char *str, size_t len, char *out, size_t size);
+
+#endif
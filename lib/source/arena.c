@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "arena.h"
+
+/* Rounds up the offset to the next multiple of align (power of two) */
+#define ALIGN_UP(off, align)                            \
+    ({                                                  \
+        (((off) + ((align) - 1)) & ~((align) - 1));     \
+    })
+
+/**
+ * @brief Allocates a new chunk and makes it the head of the arena
+ * @param[out] p_arena Pointer to the arena object
+ * @param[in] size Minimum size of the data area of the chunk
+ */
+static void __arena_new_chunk(arena_t *p_arena, size_t size) {
+
+    arena_chunk_t *p_chunk;
+
+    /* Do not create very small chunks */
+    if (size < ARENA_MIN_CHUNK_SIZE) {
+
+        size = ARENA_MIN_CHUNK_SIZE;
+    }
+
+    /* Allocate the chunk header along with its data area */
+    p_chunk = (arena_chunk_t *)malloc(sizeof(arena_chunk_t) + size);
+
+    /* Initialize the chunk */
+    p_chunk->size = size;
+    p_chunk->used = 0;
+
+    /* Link the chunk at the head of the arena */
+    p_chunk->p_next = p_arena->p_head;
+    p_arena->p_head = p_chunk;
+}
+
+/**
+ * @brief Initialize the arena (no memory is allocated)
+ * @param[out] p_arena Pointer to the arena object
+ */
+void arena_init(arena_t *p_arena) {
+
+    /* Set the chunk list to empty */
+    p_arena->p_head = NULL;
+}
+
+/**
+ * @brief Makes sure that the next #size bytes can be allocated without
+ *        going back to the system allocator
+ * @param[out] p_arena Pointer to the arena object
+ * @param[in] size Number of bytes to be reserved
+ */
+void arena_reserve(arena_t *p_arena, size_t size) {
+
+    /* If the current chunk does not have sufficient space */
+    if (!p_arena->p_head ||
+        (p_arena->p_head->size - p_arena->p_head->used) < size) {
+
+        /* Allocate a new chunk */
+        __arena_new_chunk(p_arena, size);
+    }
+}
+
+/**
+ * @brief Allocates memory from the arena
+ * @param[out] p_arena Pointer to the arena object
+ * @param[in] size Number of bytes to be allocated
+ * @param[in] align Alignment of the memory (power of two)
+ * @return Pointer to the memory, valid till the arena is reset
+ */
+void *arena_alloc(arena_t *p_arena, size_t size, size_t align) {
+
+    arena_chunk_t *p_chunk = p_arena->p_head;
+    size_t off = 0;
+
+    /* Get the aligned offset in the current chunk */
+    if (p_chunk) {
+
+        off = ALIGN_UP((uintptr_t)(p_chunk->data + p_chunk->used), align) -
+              (uintptr_t)p_chunk->data;
+    }
+
+    /* If there is no chunk or it cannot hold the data */
+    if (!p_chunk || (off + size > p_chunk->size)) {
+
+        /* Allocate a new chunk with space for the alignment padding */
+        __arena_new_chunk(p_arena, size + align);
+
+        p_chunk = p_arena->p_head;
+
+        off = ALIGN_UP((uintptr_t)p_chunk->data, align) -
+              (uintptr_t)p_chunk->data;
+    }
+
+    /* Bump the used count */
+    p_chunk->used = off + size;
+
+    return p_chunk->data + off;
+}
+
+/**
+ * @brief Copies #len bytes of the string into the arena (NULL terminated)
+ * @param[out] p_arena Pointer to the arena object
+ * @param[in] str Source string
+ * @param[in] len Number of bytes to be copied
+ * @return Pointer to the copy, valid till the arena is reset
+ */
+char *arena_strndup(arena_t *p_arena, const char *str, size_t len) {
+
+    /* Allocate the space for the string */
+    char *copy = (char *)arena_alloc(p_arena, len + 1, 1);
+
+    /* Copy the string */
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    return copy;
+}
+
+/**
+ * @brief Copies the string into the arena
+ * @param[out] p_arena Pointer to the arena object
+ * @param[in] str Source string
+ * @return Pointer to the copy, valid till the arena is reset
+ */
+char *arena_strdup(arena_t *p_arena, const char *str) {
+
+    return arena_strndup(p_arena, str, strlen(str));
+}
+
+/**
+ * @brief Returns the number of bytes used in the arena
+ * @param[in] p_arena Pointer to the arena object
+ * @return Number of bytes
+ */
+size_t arena_get_used(arena_t *p_arena) {
+
+    arena_chunk_t *p_chunk;
+    size_t used = 0;
+
+    /* Add the usage of every chunk */
+    for (p_chunk = p_arena->p_head; p_chunk; p_chunk = p_chunk->p_next) {
+
+        used += p_chunk->used;
+    }
+
+    return used;
+}
+
+/**
+ * @brief Releases every allocation, keeping the newest chunk for reuse
+ * @param[out] p_arena Pointer to the arena object
+ */
+void arena_reset(arena_t *p_arena) {
+
+    arena_chunk_t *p_chunk;
+    arena_chunk_t *p_next;
+
+    /* If the arena is empty */
+    if (!p_arena->p_head) {
+
+        return;
+    }
+
+    /* Free every chunk except the head */
+    for (p_chunk = p_arena->p_head->p_next; p_chunk; p_chunk = p_next) {
+
+        p_next = p_chunk->p_next;
+        free(p_chunk);
+    }
+
+    /* Rewind the head chunk */
+    p_arena->p_head->p_next = NULL;
+    p_arena->p_head->used = 0;
+}
+
+/**
+ * @brief Frees all the memory of the arena
+ * @param[out] p_arena Pointer to the arena object
+ */
+void arena_deinit(arena_t *p_arena) {
+
+    arena_chunk_t *p_chunk;
+    arena_chunk_t *p_next;
+
+    /* Free every chunk */
+    for (p_chunk = p_arena->p_head; p_chunk; p_chunk = p_next) {
+
+        p_next = p_chunk->p_next;
+        free(p_chunk);
+    }
+
+    /* Set the chunk list to empty */
+    p_arena->p_head = NULL;
+}
@@ -5,123 +5,517 @@
 #include <unistd.h>
 #include "builtin.h"
 #include "jobs.h"
+#include "plan_cache.h"
+#include "path_cache.h"
+#include "options.h"
+#include "executor.h"
+#include "hash.h"
+#include "vars.h"
+#include "parallel.h"
+#include "dag.h"
+#include <limits.h>
+#include <errno.h>
+
+/* Number of slots of the built-in hash table (a power of 2) */
+#define BUILT_IN_NB_SLOTS_LOG (6u)
+#define BUILT_IN_NB_SLOTS (1u << BUILT_IN_NB_SLOTS_LOG)
+
+/* Returns the slot of the name (given as a word, zero padded) */
+#define BUILT_IN_SLOT(word, seed)                                           \
+    ({                                                                      \
+        (unsigned int)(HASH_MIX(seed, word) >> (64u - BUILT_IN_NB_SLOTS_LOG)); \
+    })
+
+static void __fg_process_group(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __bg_process_group(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __change_directory(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __print_jobs(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __kill_process_group(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __plans(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __hash(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __set_option(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __exec_command(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __export_variables(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __unset_variables(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+static void __split_input(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args);
+
+/* Every built-in, registered in this single place: name, function of a
+ * built-in of the shell, function of a utility, function of a stage,
+ * function of a filter, flags */
+#define BUILT_IN_TABLE(X)                                                                                           \
+    X("fg",       __fg_process_group,   NULL,            NULL,         NULL,        BUILT_IN_JOBS)                  \
+    X("bg",       __bg_process_group,   NULL,            NULL,         NULL,        BUILT_IN_JOBS)                  \
+    X("cd",       __change_directory,   NULL,            NULL,         NULL,        0)                              \
+    X("jobs",     __print_jobs,         NULL,            NULL,         NULL,        BUILT_IN_JOBS)                  \
+    X("killpg",   __kill_process_group, NULL,            NULL,         NULL,        BUILT_IN_JOBS)                  \
+    X("plans",    __plans,              NULL,            NULL,         NULL,        0)                              \
+    X("hash",     __hash,               NULL,            NULL,         NULL,        0)                              \
+    X("setopt",   __set_option,         NULL,            NULL,         NULL,        0)                              \
+    X("exec",     __exec_command,       NULL,            NULL,         NULL,        0)                              \
+    X("export",   __export_variables,   NULL,            NULL,         NULL,        0)                              \
+    X("unset",    __unset_variables,    NULL,            NULL,         NULL,        0)                              \
+    X("psplit",   __split_input,        NULL,            NULL,         NULL,        BUILT_IN_JOBS)                  \
+    X("echo",     NULL,                 utility_echo,    NULL,         NULL,        BUILT_IN_PIPELINE)              \
+    X("printf",   NULL,                 utility_printf,  NULL,         NULL,        BUILT_IN_PIPELINE)              \
+    X("true",     NULL,                 utility_true,    NULL,         NULL,        BUILT_IN_PIPELINE)              \
+    X("false",    NULL,                 utility_false,   NULL,         NULL,        BUILT_IN_PIPELINE)              \
+    X("test",     NULL,                 utility_test,    NULL,         NULL,        BUILT_IN_PIPELINE)              \
+    X("[",        NULL,                 utility_bracket, NULL,         NULL,        BUILT_IN_PIPELINE)              \
+    X("pwd",      NULL,                 utility_pwd,     NULL,         NULL,        BUILT_IN_PIPELINE)              \
+    X("kill",     NULL,                 utility_kill,    NULL,         NULL,        BUILT_IN_PIPELINE)              \
+    X("kgrep",    NULL,                 NULL,            NULL,         filter_grep, BUILT_IN_FILTER)                \
+    X("kcut",     NULL,                 NULL,            NULL,         filter_cut,  BUILT_IN_FILTER)                \
+    X("kwc",      NULL,                 NULL,            NULL,         filter_wc,   BUILT_IN_FILTER)                \
+    X("khead",    NULL,                 NULL,            NULL,         filter_head, BUILT_IN_FILTER)                \
+    X("ktail",    NULL,                 NULL,            NULL,         filter_tail, BUILT_IN_FILTER)                \
+    X("parallel", NULL,                 NULL,            parallel_run, NULL,        BUILT_IN_JOBS | BUILT_IN_STAGE) \
+    X("dag",      NULL,                 NULL,            dag_run,      NULL,        BUILT_IN_JOBS | BUILT_IN_STAGE)
+
+/* Descriptor of a registered built-in (the length of the name is known at
+ * compile time) */
+#define BUILT_IN_DESC(name, func, utility, stage, filter, flags)            \
+    {name, sizeof(name) - 1, flags, func, utility, stage, filter},
+
+/* Descriptors of the built-ins */
+static const built_in_t g_built_ins[] = {
+
+    BUILT_IN_TABLE(BUILT_IN_DESC)
+};
+
+/* Number of built-ins */
+#define NB_BUILT_INS (sizeof(g_built_ins) / sizeof(g_built_ins[0]))
+
+/* Perfect hash table of the built-ins (every name has its own slot) */
+static const built_in_t *g_built_in_slots[BUILT_IN_NB_SLOTS];
+
+/* Seed of the hash making it perfect for the registered names */
+static uint64_t g_built_in_seed;
+
+/**
+ * @brief Returns the name as a word (zero padded)
+ * @param[in] name Name
+ * @param[in] len Length of the name (at most #BUILT_IN_MAX_NAME_LEN)
+ * @return Word
+ */
+static inline uint64_t __built_in_word(const char *name, unsigned int len) {
+
+    uint64_t word = 0;
+
+    memcpy(&word, name, len);
+
+    return word;
+}
 
-#define IS_COMMAND_FG(str)     (!strcmp(str, "fg"))
-#define IS_COMMAND_BG(str)     (!strcmp(str, "bg"))
-#define IS_COMMAND_CD(str)     (!strcmp(str, "cd"))
-#define IS_COMMAND_JOBS(str)   (!strcmp(str, "jobs"))
-#define IS_COMMAND_KILLPG(str) (!strcmp(str, "killpg"))
+/**
+ * @brief Finds the seed for which the names of all the built-ins hash to
+ *        different slots, and fills the hash table
+ */
+void built_in_init() {
 
-built_in_cmd_t is_built_in(cmd_tab_t *p_cmd_tab) {
+    /* Slots taken by the names */
+    uint64_t taken;
 
-    /* Command arguments */
-    char **cmd_args = cmd_tab_get_cmd_args(p_cmd_tab, 0);
+    unsigned int slot;
+    unsigned int built_in_i;
+
+    /* Try the seeds one after the other (a few are needed for the names) */
+    for (g_built_in_seed = 1; ; g_built_in_seed++) {
+
+        taken = 0;
+
+        for (built_in_i = 0; built_in_i < NB_BUILT_INS; built_in_i++) {
+
+            slot = BUILT_IN_SLOT(__built_in_word(g_built_ins[built_in_i].name, g_built_ins[built_in_i].len),
+                                 g_built_in_seed);
+
+            if (taken & (1ull << slot)) {
+
+                break;
+            }
+
+            taken |= (1ull << slot);
+        }
 
-    /* Check if the command is a builtin */
-    if (IS_COMMAND_FG(cmd_args[0])) {
+        /* If every name has its own slot */
+        if (built_in_i == NB_BUILT_INS) {
 
-        return BUILT_IN_FG;
+            break;
+        }
     }
-    else if (IS_COMMAND_BG(cmd_args[0])) {
 
-        return BUILT_IN_BG;
+    for (built_in_i = 0; built_in_i < NB_BUILT_INS; built_in_i++) {
+
+        slot = BUILT_IN_SLOT(__built_in_word(g_built_ins[built_in_i].name, g_built_ins[built_in_i].len),
+                             g_built_in_seed);
+
+        g_built_in_slots[slot] = &g_built_ins[built_in_i];
     }
-    else if (IS_COMMAND_CD(cmd_args[0])) {
+}
+
+/**
+ * @brief Returns the built-in of the command name, a single hash probe
+ * @param[in] name Command name
+ * @return Pointer to the built-in descriptor, NULL if not a built-in
+ */
+const built_in_t *built_in_lookup(const char *name) {
 
-        return BUILT_IN_CD;
+    const built_in_t *p_built_in;
+    unsigned int len;
+
+    /* Names longer than any built-in are not hashed */
+    for (len = 0; name[len]; len++) {
+
+        if (len == BUILT_IN_MAX_NAME_LEN) {
+
+            return NULL;
+        }
     }
-    else if (IS_COMMAND_JOBS(cmd_args[0])) {
 
-        return BUILT_IN_JOBS;
+    p_built_in = g_built_in_slots[BUILT_IN_SLOT(__built_in_word(name, len), g_built_in_seed)];
+
+    /* The slot may hold another name */
+    if (p_built_in && (p_built_in->len == len) && !memcmp(p_built_in->name, name, len)) {
+
+        return p_built_in;
     }
-    else if (IS_COMMAND_KILLPG(cmd_args[0])) {
 
-        return BUILT_IN_KILLPG;
+    return NULL;
+}
+
+static void __fg_process_group(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
+
+    /* Check if we have correct number of arguments */
+    if (nb_cmd_args == 2) {
+
+        jobs_fg_proc_grp(atoi(cmd_args[1]), NULL);
     }
     else {
 
-        /* The command is not a built-in */
-        return BUILT_IN_NOT;
+        fprintf(stderr, "kavach: incorrect number of arguments <fg pid>\n");
     }
 }
 
-static void __change_directory(char *str) {
+static void __bg_process_group(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
 
+    /* Check if we have correct number of arguments */
+    if (nb_cmd_args == 2) {
+
+        jobs_bg_proc_grp(atoi(cmd_args[1]));
+    }
+    else {
+
+        fprintf(stderr, "kavach: incorrect number of arguments <bg pid>\n");
+    }
+}
+
+static void __change_directory(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
+
+    /* Check if we have correct number of arguments */
+    if (nb_cmd_args != 2) {
+
+        fprintf(stderr, "kavach: incorrect number of arguments <cd path>\n");
+    }
     /* Change the directory to the specified argument */
-    if (chdir(str)) {
+    else if (chdir(cmd_args[1])) {
 
-        fprintf(stderr, "kavach: `%s` directory does not exist\n", str);
+        fprintf(stderr, "kavach: `%s` directory does not exist\n", cmd_args[1]);
     }
 }
 
-void built_in_exec_cmd_tab(cmd_tab_t *p_cmd_tab, built_in_cmd_t built_in_type) {
+static void __print_jobs(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
 
-    /* Command arguments */
-    char **cmd_args = cmd_tab_get_cmd_args(p_cmd_tab, 0);
-    /* Command arguments number */
-    int nb_cmd_args = cmd_tab_get_nb_cmd_args(p_cmd_tab, 0);
+    /* Check if we have correct number of arguments */
+    if (nb_cmd_args == 1) {
+
+        jobs_print();
+    }
+    else {
 
-    /* Call the respective built-in functions accordingly */
-    if (built_in_type == BUILT_IN_FG) {
+        fprintf(stderr, "kavach: incorrect number of arguments <jobs>\n");
+    }
+}
 
-        /* Check if we have correct number of arguments */
-        if (nb_cmd_args == 2) {
+static void __kill_process_group(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
 
-            jobs_signal_init();
+    /* Check if we have correct number of arguments */
+    if (nb_cmd_args == 3) {
 
-            jobs_fg_proc_grp(atoi(cmd_args[1]));
-        }
-        else {
+        jobs_kill_grp(atoi(cmd_args[2]), atoi(cmd_args[1]));
+    }
+    else {
 
-            fprintf(stderr, "kavach: incorrect number of arguments <fg pid>\n");
-        }
+        fprintf(stderr, "kavach: incorrect number of arguments <killpg sig_nb pid>\n");
+    }
+}
+
+static void __plans(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
+
+    /* Check if we have correct number of arguments */
+    if (nb_cmd_args == 1) {
+
+        plan_cache_print_stats();
+    }
+    else if ((nb_cmd_args == 2) && !strcmp(cmd_args[1], "-c")) {
+
+        plan_cache_clear();
     }
-    else if (built_in_type == BUILT_IN_BG) {
+    else {
+
+        fprintf(stderr, "kavach: incorrect number of arguments <plans [-c]>\n");
+    }
+}
+
+static void __hash_commands(char **cmd_args, int nb_cmd_args) {
 
-        /* Check if we have correct number of arguments */
-        if (nb_cmd_args == 2) {
+    /* Buffer for the path of the command */
+    char path[PATH_MAX];
 
-            jobs_bg_proc_grp(atoi(cmd_args[1]));
+    int arg_i;
+
+    /* Look up (and so cache) every command */
+    for (arg_i = 1; arg_i < nb_cmd_args; arg_i++) {
+
+        if (!path_cache_lookup(cmd_args[arg_i], path, sizeof(path))) {
+
+            fprintf(stderr, "kavach: `%s` command not found\n", cmd_args[arg_i]);
         }
-        else {
+    }
+}
+
+static void __hash(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
+
+    /* Check the arguments */
+    if (nb_cmd_args == 1) {
+
+        path_cache_print();
+    }
+    else if ((nb_cmd_args == 2) && !strcmp(cmd_args[1], "-r")) {
+
+        path_cache_clear();
+    }
+    else if (strcmp(cmd_args[1], "-r")) {
+
+        __hash_commands(cmd_args, nb_cmd_args);
+    }
+    else {
+
+        fprintf(stderr, "kavach: incorrect number of arguments <hash [-r | cmd ...]>\n");
+    }
+}
+
+static void __set_option(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
 
-            fprintf(stderr, "kavach: incorrect number of arguments <bg pid>\n");
+    /* Check if we have correct number of arguments */
+    if (nb_cmd_args == 1) {
+
+        options_print();
+    }
+    else if (nb_cmd_args == 3) {
+
+        if (options_set(cmd_args[1], cmd_args[2])) {
+
+            fprintf(stderr, "kavach: `%s` invalid option or value\n", cmd_args[1]);
         }
     }
-    else if (built_in_type == BUILT_IN_CD) {
+    else {
+
+        fprintf(stderr, "kavach: incorrect number of arguments <setopt [name value]>\n");
+    }
+}
+
+static void __exec_command(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
+
+    /* Buffer for the path of the command */
+    char path[PATH_MAX];
+
+    /* Signals unblocked for the command */
+    sigset_t sig_set;
+
+    /* Apply the redirections to the shell */
+    if (!executor_redirect_shell(p_cmd_tab, 0)) {
+
+        return;
+    }
+
+    /* Without a command the redirections stay for the next commands */
+    if (nb_cmd_args == 1) {
+
+        return;
+    }
+
+    if (!path_cache_lookup(cmd_args[1], path, sizeof(path))) {
 
-        /* Check if we have correct number of arguments */
-        if (nb_cmd_args == 2) {
+        fprintf(stderr, "kavach: `%s` command not found\n", cmd_args[1]);
+
+        return;
+    }
 
-            __change_directory(cmd_args[1]);
+    /* Give the command the default actions of the signals the shell
+     * handles or ignores */
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+
+    /* Unblock the signals taken by the event loop of the jobs */
+    sigemptyset(&sig_set);
+    sigprocmask(SIG_SETMASK, &sig_set, NULL);
+
+    /* Replace the shell by the command */
+    execve(path, cmd_args + 1, vars_get_envp());
+
+    fprintf(stderr, "kavach: %s: cannot execute the command (%s)\n", cmd_args[1], strerror(errno));
+    exit(126);
+}
+
+static void __export_variables(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
+
+    int arg_i;
+    size_t name_len;
+
+    /* Without arguments print the exported variables */
+    if (nb_cmd_args == 1) {
+
+        vars_print(true);
+
+        return;
+    }
+
+    for (arg_i = 1; arg_i < nb_cmd_args; arg_i++) {
+
+        /* Get the name, alone or assigned */
+        name_len = vars_get_name_len(cmd_args[arg_i], SIZE_MAX);
+
+        if (name_len && (cmd_args[arg_i][name_len] == '=')) {
+
+            vars_set(cmd_args[arg_i], name_len, cmd_args[arg_i] + name_len + 1, true);
+        }
+        else if (name_len && !cmd_args[arg_i][name_len]) {
+
+            vars_set(cmd_args[arg_i], name_len, NULL, true);
         }
         else {
 
-            fprintf(stderr, "kavach: incorrect number of arguments <cd path>\n");
+            fprintf(stderr, "kavach: export: `%s` invalid variable name\n", cmd_args[arg_i]);
         }
     }
-    else if (built_in_type == BUILT_IN_JOBS) {
+}
+
+static void __unset_variables(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
+
+    int arg_i;
+    size_t name_len;
 
-        /* Check if we have correct number of arguments */
-        if (nb_cmd_args == 1) {
+    for (arg_i = 1; arg_i < nb_cmd_args; arg_i++) {
 
-            jobs_print();
+        name_len = vars_get_name_len(cmd_args[arg_i], SIZE_MAX);
+
+        if (name_len && !cmd_args[arg_i][name_len]) {
+
+            vars_unset(cmd_args[arg_i], name_len);
         }
         else {
 
-            fprintf(stderr, "kavach: incorrect number of arguments <jobs>\n");
+            fprintf(stderr, "kavach: unset: `%s` invalid variable name\n", cmd_args[arg_i]);
         }
     }
-    else if (built_in_type == BUILT_IN_KILLPG) {
+}
+
+static void __split_input(cmd_tab_t *p_cmd_tab, char **cmd_args, int nb_cmd_args) {
+
+    /* Number of copies of the pipeline (one per processor by default) */
+    long nb_copies = sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* Number of arguments before the command */
+    int nb_skipped = 1;
+
+    char *p_end;
+
+    if ((nb_cmd_args > 2) && !strcmp(cmd_args[1], "-j")) {
+
+        nb_copies = strtol(cmd_args[2], &p_end, 10);
+        nb_skipped = 3;
+
+        if (*p_end || (p_end == cmd_args[2]) || (nb_copies < 1) || (nb_copies > INT_MAX)) {
 
-        /* Check if we have correct number of arguments */
-        if (nb_cmd_args == 3) {
+            fprintf(stderr, "kavach: psplit: `%s` invalid number of jobs\n", cmd_args[2]);
 
-            jobs_kill_grp(atoi(cmd_args[2]), atoi(cmd_args[1]));
+            return;
         }
-        else {
+    }
+
+    if (nb_cmd_args <= nb_skipped) {
+
+        fprintf(stderr, "kavach: incorrect number of arguments <psplit [-j jobs] command < file>\n");
+
+        return;
+    }
+
+    /* Run the rest of the first command as the command, the table is
+     * restored after (it may be kept by the plan cache) */
+    cmd_tab_skip_args(p_cmd_tab, 0, nb_skipped);
+    executor_split_cmd_tab(p_cmd_tab, (int)nb_copies);
+    cmd_tab_skip_args(p_cmd_tab, 0, -nb_skipped);
+}
 
-            fprintf(stderr, "kavach: incorrect number of arguments <killpg sig_nb pid>\n");
+/**
+ * @brief Sets the variables assigned by the command line, NAME=value ...
+ *        (a command following the assignments is not supported)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ */
+void built_in_assign(cmd_tab_t *p_cmd_tab) {
+
+    char **cmd_args = cmd_tab_get_cmd_args(p_cmd_tab, 0);
+    int nb_cmd_args = cmd_tab_get_nb_cmd_args(p_cmd_tab, 0);
+    int arg_i;
+    size_t name_len;
+
+    /* Check the whole line first, so that nothing is set on an error */
+    for (arg_i = 0; arg_i < nb_cmd_args; arg_i++) {
+
+        if (!vars_get_assign_len(cmd_args[arg_i])) {
+
+            fprintf(stderr, "kavach: `%s` assignments before a command are not supported\n", cmd_args[arg_i]);
+
+            return;
         }
     }
+
+    if ((cmd_tab_get_nb_cmds(p_cmd_tab) > 1) || cmd_tab_get_nb_redirs(p_cmd_tab, 0)) {
+
+        fprintf(stderr, "kavach: assignments cannot be piped or redirected\n");
+
+        return;
+    }
+
+    /* Set the shell variables (exported ones stay exported) */
+    for (arg_i = 0; arg_i < nb_cmd_args; arg_i++) {
+
+        name_len = vars_get_assign_len(cmd_args[arg_i]);
+        vars_set(cmd_args[arg_i], name_len, cmd_args[arg_i] + name_len + 1, false);
+    }
+}
+
+/**
+ * @brief Executes the built-in of the shell (the first command of the
+ *        command table)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] p_built_in Pointer to the built-in descriptor
+ */
+void built_in_exec_cmd_tab(cmd_tab_t *p_cmd_tab, const built_in_t *p_built_in) {
+
+    /* The job table is used with the job signals set */
+    if (p_built_in->flags & BUILT_IN_JOBS) {
+
+        jobs_signal_init();
+    }
+
+    /* Call the built-in */
+    p_built_in->func(p_cmd_tab,
+                     cmd_tab_get_cmd_args(p_cmd_tab, 0),
+                     cmd_tab_get_nb_cmd_args(p_cmd_tab, 0));
+
+    /* Write the output before the next commands write theirs */
+    fflush(stdout);
 }
@@ -1,125 +1,424 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include "../include/command_table.h"
 
+/* Upper bound of the number of commands (including the trailing empty one)
+ * in a command line string of the given length, as every command needs a
+ * character and a pipe */
+#define MAX_CMDS_IN_STR(len)                    \
+    ({                                          \
+        ((len) + 1) / 2 + 2;                    \
+    })
+
+/* Upper bound of the number of arguments (including the NULL terminators)
+ * in a command line string of the given length */
+#define MAX_ARGS_IN_STR(len)                    \
+    ({                                          \
+        ((len) + 1) / 2 + MAX_CMDS_IN_STR(len); \
+    })
+
+/* Alignment of the arrays in the arena */
+#define ARRAY_ALIGN (sizeof(void *))
+
+/* Rounds up the size to the array alignment */
+#define ALIGN_SIZE(size)                                        \
+    ({                                                          \
+        (((size) + (ARRAY_ALIGN - 1)) & ~(ARRAY_ALIGN - 1));    \
+    })
+
+/* Offset of the no token entry */
+#define NO_TOK_OFF (-1)
+
+/* Initial size of the buffer of the expansions */
+#define EXPAND_BUF_MIN_SIZE (4096u)
+
+/* Wildcard characters of the command line */
+#define GLOB_CHARS "*?["
+
 /**
- * @brief Initialize the command table (sets the variables to base values)
+ * @brief Expansion of a token of the command line
+ */
+typedef struct __cmd_tab_expansion_t {
+
+    /* Offset of the expansion in the buffer of the expansions */
+    size_t off;
+
+    /* Length of the expansion (of the token if kept) */
+    size_t len;
+
+    /* Number of words of the expansion */
+    int nb_words;
+
+    /* Is the token kept as it is */
+    bool is_kept;
+
+    /* Offset of the expansion in the expanded string */
+    int dest_off;
+
+    /* Index of the first word in the argument pool of the copy */
+    int dest_i;
+
+} cmd_tab_expansion_t;
+
+/**
+ * @brief Checks if the command line string holds a wildcard character
+ * @param[in] cmd_str Command line string
+ * @return true If it holds one
+ * @return false Otherwise
+ */
+static inline bool __cmd_tab_has_globs(const char *cmd_str) {
+
+    return strpbrk(cmd_str, GLOB_CHARS) != NULL;
+}
+
+/**
+ * @brief Sets the command table variables to base values (the arena is not
+ *        touched)
  * @param[out] p_cmd_tab Pointer to command table object
  */
-void cmd_tab_init(cmd_tab_t *p_cmd_tab) {
+static void __cmd_tab_clear(cmd_tab_t *p_cmd_tab) {
 
     /* Set the string to NULL */
     p_cmd_tab->cmd_str = NULL;
+    p_cmd_tab->cmd_len = 0;
+
+    /* Set the list of commands to empty */
+    p_cmd_tab->cmds = NULL;
+    p_cmd_tab->max_cmds = 0;
 
     /* Set the number of commands to -1 */
     p_cmd_tab->nb_cmds = -1;
 
+    /* Set the argument pool to empty */
+    p_cmd_tab->toks = NULL;
+    p_cmd_tab->args = NULL;
+    p_cmd_tab->nb_args = 0;
+    p_cmd_tab->max_args = 0;
+
+    /* Set the redirection pool to empty */
+    p_cmd_tab->redirs = NULL;
+    p_cmd_tab->nb_redirs = 0;
+    p_cmd_tab->max_redirs = 0;
+
     /* Set the background status */
     p_cmd_tab->is_background = false;
+
+    /* Nothing to expand */
+    p_cmd_tab->has_vars = false;
+    p_cmd_tab->has_globs = false;
 }
 
 /**
- * @brief Set the command line string for the command table
+ * @brief Makes sure that the command list can hold one more command
  * @param[out] p_cmd_tab Pointer to command table object
- * @param[in] cmd_str Command line string
  */
-void cmd_tab_set_str(cmd_tab_t *p_cmd_tab, char *cmd_str) {
+static void __cmd_tab_grow_cmds(cmd_tab_t *p_cmd_tab) {
 
-    /* Set the string */
-    p_cmd_tab->cmd_str = strdup(cmd_str);
+    cmd_t *cmds;
+    int max_cmds;
+
+    /* If there is space for one more command */
+    if (p_cmd_tab->nb_cmds + 1 < p_cmd_tab->max_cmds) {
+
+        return;
+    }
+
+    /* Double the capacity */
+    max_cmds = (p_cmd_tab->max_cmds) ? 2 * p_cmd_tab->max_cmds : 4;
+
+    /* Move the list to a larger array (the old one goes with the arena) */
+    cmds = (cmd_t *)arena_alloc(&p_cmd_tab->arena, max_cmds * sizeof(cmd_t), ARRAY_ALIGN);
+    if (p_cmd_tab->max_cmds) {
+        memcpy(cmds, p_cmd_tab->cmds, p_cmd_tab->max_cmds * sizeof(cmd_t));
+    }
+
+    p_cmd_tab->cmds = cmds;
+    p_cmd_tab->max_cmds = max_cmds;
 }
 
 /**
- * @brief Add a new empty command to the table
+ * @brief Makes sure that the argument pool can hold one more argument
  * @param[out] p_cmd_tab Pointer to command table object
  */
-void cmd_tab_add_cmd(cmd_tab_t *p_cmd_tab) {
+static void __cmd_tab_grow_args(cmd_tab_t *p_cmd_tab) {
 
-    /* If the command table has atleast one command */
-    if (p_cmd_tab->nb_cmds > -1) {
-        /* Set the current command's last argument as NULL */
-        cmd_tab_add_cmd_arg(p_cmd_tab, NULL);
+    cmd_tok_t *toks;
+    char **args;
+    int max_args;
+
+    /* If there is space for one more argument */
+    if (p_cmd_tab->nb_args < p_cmd_tab->max_args) {
+
+        return;
     }
 
-    /* Increment the commands count */
-    p_cmd_tab->nb_cmds++;
+    /* Double the capacity */
+    max_args = (p_cmd_tab->max_args) ? 2 * p_cmd_tab->max_args : 8;
 
-    /* Initialize the number of command line arguments for the command to zero */
-    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].nb_cmd_args = 0;
+    /* Move the pool to a larger array (the old one goes with the arena) */
+    toks = (cmd_tok_t *)arena_alloc(&p_cmd_tab->arena, max_args * sizeof(cmd_tok_t), ARRAY_ALIGN);
+    args = (char **)arena_alloc(&p_cmd_tab->arena, max_args * sizeof(char *), ARRAY_ALIGN);
+    if (p_cmd_tab->max_args) {
+        memcpy(toks, p_cmd_tab->toks, p_cmd_tab->max_args * sizeof(cmd_tok_t));
+        memcpy(args, p_cmd_tab->args, p_cmd_tab->max_args * sizeof(char *));
+    }
 
-    /* Initialize the input argument string */
-    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].in_arg = NULL;
+    p_cmd_tab->toks = toks;
+    p_cmd_tab->args = args;
+    p_cmd_tab->max_args = max_args;
+}
 
-    /* Initialize the status of input redirection */
-    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].is_input_redirected = false;
+/**
+ * @brief Makes sure that the redirection pool can hold one more redirection
+ *        (the pool is not reserved upfront, as most lines have none)
+ * @param[out] p_cmd_tab Pointer to command table object
+ */
+static void __cmd_tab_grow_redirs(cmd_tab_t *p_cmd_tab) {
 
-    /* Initialize the input argument string */
-    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].in_arg = NULL;
+    cmd_redir_t *redirs;
+    int max_redirs;
 
-    /* Initialize the status of output redirection */
-    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].is_output_redirected = false;
+    /* If there is space for one more redirection */
+    if (p_cmd_tab->nb_redirs < p_cmd_tab->max_redirs) {
+
+        return;
+    }
+
+    /* Double the capacity */
+    max_redirs = (p_cmd_tab->max_redirs) ? 2 * p_cmd_tab->max_redirs : 4;
+
+    /* Move the pool to a larger array (the old one goes with the arena) */
+    redirs = (cmd_redir_t *)arena_alloc(&p_cmd_tab->arena, max_redirs * sizeof(cmd_redir_t), ARRAY_ALIGN);
+    if (p_cmd_tab->max_redirs) {
+        memcpy(redirs, p_cmd_tab->redirs, p_cmd_tab->max_redirs * sizeof(cmd_redir_t));
+    }
+
+    p_cmd_tab->redirs = redirs;
+    p_cmd_tab->max_redirs = max_redirs;
 }
 
 /**
- * @brief Add a command line argument to the current command in the table
+ * @brief Creates the token for the slice of the command line string
+ * @param[in] p_cmd_tab Pointer to command table object
+ * @param[in] tok_off Offset of the token (#NO_TOK_OFF for no token)
+ * @param[in] tok_len Length of the token
+ * @return Token
+ */
+static cmd_tok_t __cmd_tab_tok(cmd_tab_t *p_cmd_tab, int tok_off, int tok_len) {
+
+    cmd_tok_t tok;
+
+    tok.off = tok_off;
+    tok.len = tok_len;
+
+    /* Remember the character which the terminator overwrites */
+    tok.term = (tok_off == NO_TOK_OFF) ? '\0' : p_cmd_tab->cmd_str[tok_off + tok_len];
+
+    return tok;
+}
+
+/**
+ * @brief NULL terminates the token in place
+ * @param[in] p_cmd_tab Pointer to command table object
+ * @param[in] p_tok Pointer to the token
+ * @return Token string (NULL for no token)
+ */
+static char *__cmd_tab_tok_str(cmd_tab_t *p_cmd_tab, cmd_tok_t *p_tok) {
+
+    /* If there is no token */
+    if (p_tok->off == NO_TOK_OFF) {
+
+        return NULL;
+    }
+
+    /* Overwrite the character following the token */
+    p_cmd_tab->cmd_str[p_tok->off + p_tok->len] = '\0';
+
+    return p_cmd_tab->cmd_str + p_tok->off;
+}
+
+/**
+ * @brief NULL terminates all the tokens of the command and sets its
+ *        argument pointers
+ * @param[in] p_cmd_tab Pointer to command table object
+ * @param[in] cmd_i The ith command in the command table
+ */
+static void __cmd_tab_materialize(cmd_tab_t *p_cmd_tab, int cmd_i) {
+
+    int arg_i;
+    int redir_i;
+
+    /* Get the command */
+    cmd_t *p_cmd = &p_cmd_tab->cmds[cmd_i];
+
+    /* If already done */
+    if (p_cmd->is_materialized) {
+
+        return;
+    }
+
+    /* Set the argument pointers to the terminated tokens */
+    for (arg_i = p_cmd->arg_i; arg_i < p_cmd->arg_i + p_cmd->nb_cmd_args; arg_i++) {
+
+        p_cmd_tab->args[arg_i] = __cmd_tab_tok_str(p_cmd_tab, &p_cmd_tab->toks[arg_i]);
+    }
+
+    /* Terminate the redirection file names */
+    for (redir_i = p_cmd->redir_i; redir_i < p_cmd->redir_i + p_cmd->nb_redirs; redir_i++) {
+
+        __cmd_tab_tok_str(p_cmd_tab, &p_cmd_tab->redirs[redir_i].tok);
+    }
+
+    p_cmd->is_materialized = true;
+}
+
+/**
+ * @brief Initialize the command table (sets the variables to base values)
+ * @param[out] p_cmd_tab Pointer to command table object
+ */
+void cmd_tab_init(cmd_tab_t *p_cmd_tab) {
+
+    /* Initialize the arena (allocated lazily) */
+    arena_init(&p_cmd_tab->arena);
+
+    /* Set the variables to base values */
+    __cmd_tab_clear(p_cmd_tab);
+}
+
+/**
+ * @brief Set the command line string for the command table, the tokens
+ *        added later are slices of this string
+ * @param[out] p_cmd_tab Pointer to command table object
+ * @param[in] cmd_str Command line string
+ */
+void cmd_tab_set_str(cmd_tab_t *p_cmd_tab, char *cmd_str) {
+
+    /* Get the length of the string */
+    size_t len = strlen(cmd_str);
+
+    /* Get the maximum number of commands and arguments in the string */
+    int max_cmds = MAX_CMDS_IN_STR(len);
+    int max_args = MAX_ARGS_IN_STR(len);
+
+    /* Reserve the space for the arrays and the string at once, so that the
+     * parsing does not go back to the allocator */
+    arena_reserve(&p_cmd_tab->arena,
+                  ALIGN_SIZE(max_cmds * sizeof(cmd_t)) +
+                  ALIGN_SIZE(max_args * sizeof(cmd_tok_t)) +
+                  ALIGN_SIZE(max_args * sizeof(char *)) +
+                  len + 1 + ARRAY_ALIGN);
+
+    /* Allocate the list of commands */
+    p_cmd_tab->cmds = (cmd_t *)arena_alloc(&p_cmd_tab->arena, max_cmds * sizeof(cmd_t), ARRAY_ALIGN);
+    p_cmd_tab->max_cmds = max_cmds;
+
+    /* Allocate the argument pool */
+    p_cmd_tab->toks = (cmd_tok_t *)arena_alloc(&p_cmd_tab->arena, max_args * sizeof(cmd_tok_t), ARRAY_ALIGN);
+    p_cmd_tab->args = (char **)arena_alloc(&p_cmd_tab->arena, max_args * sizeof(char *), ARRAY_ALIGN);
+    p_cmd_tab->max_args = max_args;
+
+    /* Set the string */
+    p_cmd_tab->cmd_str = arena_strndup(&p_cmd_tab->arena, cmd_str, len);
+    p_cmd_tab->cmd_len = len;
+
+    /* Check once for the variables and the wildcards, so that the lines
+     * without any are executed as parsed (or cached) */
+    p_cmd_tab->has_vars = memchr(cmd_str, '$', len) != NULL;
+    p_cmd_tab->has_globs = __cmd_tab_has_globs(cmd_str);
+}
+
+/**
+ * @brief Adds a token to the argument pool
  * @param[out] p_cmd_tab Pointer to command table object
- * @param[in] cmd_arg Command line argument
+ * @param[in] tok_off Offset of the token (#NO_TOK_OFF for no token)
+ * @param[in] tok_len Length of the token
  */
-void cmd_tab_add_cmd_arg(cmd_tab_t *p_cmd_tab, char *cmd_arg) {
+static void __cmd_tab_add_tok(cmd_tab_t *p_cmd_tab, int tok_off, int tok_len) {
 
-    /* Get the starting address of the command line arguments list */
-    char **cmd_args = p_cmd_tab->cmds[p_cmd_tab->nb_cmds].cmd_args;
-    /* Get the current number of command arguments */
-    int nb_cmd_args = p_cmd_tab->cmds[p_cmd_tab->nb_cmds].nb_cmd_args;
+    /* Make sure the pool has space for the argument */
+    __cmd_tab_grow_args(p_cmd_tab);
 
-    /* Add the command line argument to the current command */
-    cmd_args[nb_cmd_args] = (cmd_arg) ? strdup(cmd_arg) : NULL;
+    /* Add the command line argument at the end of the pool, right after the
+     * previous arguments of the current command */
+    p_cmd_tab->toks[p_cmd_tab->nb_args++] = __cmd_tab_tok(p_cmd_tab, tok_off, tok_len);
 
     /* Increment the number of command line arguments */
     p_cmd_tab->cmds[p_cmd_tab->nb_cmds].nb_cmd_args++;
 }
 
 /**
- * @brief Add a input redirection file to the command table
+ * @brief Add a new empty command to the table
  * @param[out] p_cmd_tab Pointer to command table object
- * @param[in] in_arg Input redirection file argument
  */
-void cmd_tab_set_in_arg(cmd_tab_t *p_cmd_tab, char *in_arg) {
-
-    /* If the command is already input redirected */
-    if(p_cmd_tab->cmds[p_cmd_tab->nb_cmds].is_input_redirected) {
+void cmd_tab_add_cmd(cmd_tab_t *p_cmd_tab) {
 
-        /* Deallocate the previously allocated string */
-        free(p_cmd_tab->cmds[p_cmd_tab->nb_cmds].in_arg);
+    /* If the command table has atleast one command */
+    if (p_cmd_tab->nb_cmds > -1) {
+        /* Set the current command's last argument as NULL */
+        __cmd_tab_add_tok(p_cmd_tab, NO_TOK_OFF, 0);
     }
 
-    /* Allocate the new string */
-    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].in_arg = (in_arg) ? strdup(in_arg) : NULL;
+    /* Make sure the list has space for the command */
+    __cmd_tab_grow_cmds(p_cmd_tab);
 
-    /* Update the input redirection status */
-    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].is_input_redirected = true;
+    /* Increment the commands count */
+    p_cmd_tab->nb_cmds++;
+
+    /* The arguments of the command start at the end of the pool */
+    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].arg_i = p_cmd_tab->nb_args;
+
+    /* Initialize the number of command line arguments for the command to zero */
+    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].nb_cmd_args = 0;
+
+    /* The redirections of the command start at the end of the pool */
+    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].redir_i = p_cmd_tab->nb_redirs;
+    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].nb_redirs = 0;
+
+    /* No argument came from an expansion */
+    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].batch_i = 0;
+    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].nb_batch_args = 0;
+
+    /* The tokens are not yet terminated */
+    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].is_materialized = false;
 }
 
 /**
- * @brief Add a output redirection file to the command table
+ * @brief Add a command line argument to the current command in the table
  * @param[out] p_cmd_tab Pointer to command table object
- * @param[in] out_arg Output redirection file argument
+ * @param[in] tok_off Offset of the argument in the command line string
+ * @param[in] tok_len Length of the argument
  */
-void cmd_tab_set_out_arg(cmd_tab_t *p_cmd_tab, char *out_arg) {
+void cmd_tab_add_cmd_arg(cmd_tab_t *p_cmd_tab, int tok_off, int tok_len) {
+
+    /* Add the slice to the pool */
+    __cmd_tab_add_tok(p_cmd_tab, tok_off, tok_len);
+}
 
-    /* If the command is already input redirected */
-    if(p_cmd_tab->cmds[p_cmd_tab->nb_cmds].is_output_redirected) {
+/**
+ * @brief Adds a redirection to the current command (every redirection is
+ *        kept, in the order of the command line)
+ * @param[out] p_cmd_tab Pointer to command table object
+ * @param[in] type Type of the redirection
+ * @param[in] fd File descriptor redirected
+ * @param[in] tok_off Offset of the argument in the command line string
+ * @param[in] tok_len Length of the argument
+ */
+void cmd_tab_add_redir(cmd_tab_t *p_cmd_tab, cmd_redir_type_t type, int fd, int tok_off, int tok_len) {
 
-        /* Deallocate the previously allocated string */
-        free(p_cmd_tab->cmds[p_cmd_tab->nb_cmds].out_arg);
-    }
+    /* Make sure the pool has space for the redirection */
+    __cmd_tab_grow_redirs(p_cmd_tab);
 
-    /* Allocate the new string */
-    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].out_arg = (out_arg) ? strdup(out_arg) : NULL;
+    /* Add the redirection at the end of the pool, right after the previous
+     * redirections of the current command */
+    p_cmd_tab->redirs[p_cmd_tab->nb_redirs].type = type;
+    p_cmd_tab->redirs[p_cmd_tab->nb_redirs].fd = fd;
+    p_cmd_tab->redirs[p_cmd_tab->nb_redirs].tok = __cmd_tab_tok(p_cmd_tab, tok_off, tok_len);
+    p_cmd_tab->nb_redirs++;
 
-    /* Update the input redirection status */
-    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].is_output_redirected = true;
+    /* Increment the number of redirections */
+    p_cmd_tab->cmds[p_cmd_tab->nb_cmds].nb_redirs++;
 }
 
 /**
@@ -133,14 +432,16 @@ void cmd_tab_set_bg(cmd_tab_t *p_cmd_tab) {
 }
 
 /**
- * @brief Returns the command line string entered by the user
+ * @brief Returns the command line string entered by the user (the tokens of
+ *        materialized commands are NULL terminated in it, a packed copy
+ *        always holds the whole string)
  * @param[in] p_cmd_tab Pointer to command table object
- * @return Pointer to dynamically allocated string
+ * @return Pointer to the string owned by the command table
  */
 char *cmd_tab_get_cmd_str(cmd_tab_t *p_cmd_tab) {
 
-    /* Return the copy of the command string */
-    return strdup(p_cmd_tab->cmd_str);
+    /* Return the command string */
+    return p_cmd_tab->cmd_str;
 }
 
 /**
@@ -166,15 +467,19 @@ bool cmd_tab_is_bg(cmd_tab_t *p_cmd_tab) {
 }
 
 /**
- * @brief Returns the command arguments for the specified command
+ * @brief Returns the command arguments for the specified command, the
+ *        arguments are NULL terminated in place on the first call
  * @param[in] p_cmd_tab Pointer to command table object
  * @param[in] cmd_i The ith command in the command table
  * @return Array of strings (NULL terminated)
  */
 char **cmd_tab_get_cmd_args(cmd_tab_t *p_cmd_tab, int cmd_i) {
 
-    /* Return the ith command arguments */
-    return p_cmd_tab->cmds[cmd_i].cmd_args;
+    /* Materialize the command */
+    __cmd_tab_materialize(p_cmd_tab, cmd_i);
+
+    /* Return the ith command's slice of the argument pool */
+    return p_cmd_tab->args + p_cmd_tab->cmds[cmd_i].arg_i;
 }
 
 /**
@@ -190,162 +495,567 @@ int cmd_tab_get_nb_cmd_args(cmd_tab_t *p_cmd_tab, int cmd_i) {
 }
 
 /**
- * @brief Returns the input redirection status for the specified command
+ * @brief Returns the index of the first argument given out to the batches
+ *        of an exec too long for ARG_MAX (the first word of an expansion
+ *        giving several, else the argument following the command name)
  * @param[in] p_cmd_tab Pointer to command table object
  * @param[in] cmd_i The ith command in the command table
- * @return Boolean status
+ * @return Index in the arguments of the command
+ */
+int cmd_tab_get_batch_arg_i(cmd_tab_t *p_cmd_tab, int cmd_i) {
+
+    /* Without an expansion every argument but the name is given out */
+    if (!p_cmd_tab->cmds[cmd_i].nb_batch_args) {
+
+        return 1;
+    }
+
+    return p_cmd_tab->cmds[cmd_i].batch_i;
+}
+
+/**
+ * @brief Returns the number of arguments given out to the batches of an
+ *        exec too long for ARG_MAX (from the first to the last word of the
+ *        expansions giving several, else every argument but the name)
+ * @param[in] p_cmd_tab Pointer to command table object
+ * @param[in] cmd_i The ith command in the command table
+ * @return Integer number
+ */
+int cmd_tab_get_nb_batch_args(cmd_tab_t *p_cmd_tab, int cmd_i) {
+
+    /* Without an expansion every argument but the name is given out */
+    if (!p_cmd_tab->cmds[cmd_i].nb_batch_args) {
+
+        return cmd_tab_get_nb_cmd_args(p_cmd_tab, cmd_i) - 1;
+    }
+
+    return p_cmd_tab->cmds[cmd_i].nb_batch_args;
+}
+
+/**
+ * @brief Drops the first arguments of the ith command, so that a prefix
+ *        command runs the rest as the command (undone by the opposite
+ *        number)
+ * @param[out] p_cmd_tab Pointer to command table object
+ * @param[in] cmd_i The ith command in the command table
+ * @param[in] nb_args Number of arguments dropped (negative to restore them)
  */
-bool cmd_tab_is_input_redirected(cmd_tab_t *p_cmd_tab, int cmd_i) {
+void cmd_tab_skip_args(cmd_tab_t *p_cmd_tab, int cmd_i, int nb_args) {
 
-    /* Return the input redirection status */
-    return p_cmd_tab->cmds[cmd_i].is_input_redirected;
+    /* The pointers of the arguments are set for the whole command */
+    __cmd_tab_materialize(p_cmd_tab, cmd_i);
+
+    p_cmd_tab->cmds[cmd_i].arg_i += nb_args;
+    p_cmd_tab->cmds[cmd_i].nb_cmd_args -= nb_args;
+
+    /* The batches keep their arguments */
+    p_cmd_tab->cmds[cmd_i].batch_i -= nb_args;
 }
 
 /**
- * @brief Returns the output redirection status for the specified command
+ * @brief Returns the number of redirections for the specified command
  * @param[in] p_cmd_tab Pointer to command table object
  * @param[in] cmd_i The ith command in the command table
- * @return Boolean status
+ * @return Integer number
  */
-bool cmd_tab_is_output_redirected(cmd_tab_t *p_cmd_tab, int cmd_i) {
+int cmd_tab_get_nb_redirs(cmd_tab_t *p_cmd_tab, int cmd_i) {
 
-    /* Return the output redirection status */
-    return p_cmd_tab->cmds[cmd_i].is_output_redirected;
+    /* Return the number of redirections */
+    return p_cmd_tab->cmds[cmd_i].nb_redirs;
 }
 
 /**
- * @brief Returns the input redirection argument for the specified command
+ * @brief Returns the type of a redirection of the specified command
  * @param[in] p_cmd_tab Pointer to command table object
  * @param[in] cmd_i The ith command in the command table
- * @return Dynamically allocated input argument string
+ * @param[in] redir_i The ith redirection of the command
+ * @return Type of the redirection
  */
-char *cmd_tab_get_in_arg(cmd_tab_t *p_cmd_tab, int cmd_i) {
+cmd_redir_type_t cmd_tab_get_redir_type(cmd_tab_t *p_cmd_tab, int cmd_i, int redir_i) {
 
-    /* Return the input redirected file name */
-    return strdup(p_cmd_tab->cmds[cmd_i].in_arg);
+    /* Return the type of the command's ith redirection */
+    return p_cmd_tab->redirs[p_cmd_tab->cmds[cmd_i].redir_i + redir_i].type;
 }
 
 /**
- * @brief Returns the output redirection argument for the specified command
+ * @brief Returns the file descriptor redirected by a redirection of the
+ *        specified command
  * @param[in] p_cmd_tab Pointer to command table object
  * @param[in] cmd_i The ith command in the command table
- * @return Dynamically allocated output argument string
+ * @param[in] redir_i The ith redirection of the command
+ * @return File descriptor
  */
-char *cmd_tab_get_out_arg(cmd_tab_t *p_cmd_tab, int cmd_i) {
+int cmd_tab_get_redir_fd(cmd_tab_t *p_cmd_tab, int cmd_i, int redir_i) {
 
-    /* Return the output redirected file name */
-    return strdup(p_cmd_tab->cmds[cmd_i].out_arg);
+    /* Return the file descriptor of the command's ith redirection */
+    return p_cmd_tab->redirs[p_cmd_tab->cmds[cmd_i].redir_i + redir_i].fd;
 }
 
 /**
- * @brief Copies one command table to another (allocating new memory)
- * @param[out] p_cmd_tab_dest Destination command table
- * @param[in] p_cmd_tab_src Source command table
+ * @brief Returns the argument of a redirection of the specified command
+ * @param[in] p_cmd_tab Pointer to command table object
+ * @param[in] cmd_i The ith command in the command table
+ * @param[in] redir_i The ith redirection of the command
+ * @return Argument string (file name or file descriptor) owned by the
+ *         command table
  */
-void cmd_tab_copy(cmd_tab_t *p_cmd_tab_dest, cmd_tab_t *p_cmd_tab_src) {
+char *cmd_tab_get_redir_arg(cmd_tab_t *p_cmd_tab, int cmd_i, int redir_i) {
+
+    /* Materialize the command */
+    __cmd_tab_materialize(p_cmd_tab, cmd_i);
 
-    int i;
-    int j;
+    /* Return the argument of the command's ith redirection */
+    return __cmd_tab_tok_str(p_cmd_tab, &p_cmd_tab->redirs[p_cmd_tab->cmds[cmd_i].redir_i + redir_i].tok);
+}
+
+/**
+ * @brief Materializes all the commands of the table, so that the accessors
+ *        never write to it afterwards
+ * @param[in] p_cmd_tab Pointer to command table object
+ */
+void cmd_tab_materialize(cmd_tab_t *p_cmd_tab) {
+
+    int cmd_i;
+
+    /* For each command */
+    for (cmd_i = 0; cmd_i < p_cmd_tab->nb_cmds; cmd_i++) {
+
+        __cmd_tab_materialize(p_cmd_tab, cmd_i);
+    }
+}
+
+/**
+ * @brief Restores the character following the token in the string (undoes
+ *        the terminator written by the materialization)
+ * @param[out] str Command line string
+ * @param[in] p_tok Pointer to the token
+ */
+static void __tok_restore(char *str, cmd_tok_t *p_tok) {
+
+    if (p_tok->off != NO_TOK_OFF) {
+
+        str[p_tok->off + p_tok->len] = p_tok->term;
+    }
+}
+
+/**
+ * @brief Returns the size of a single memory block which can hold the
+ *        compact copy of the command table (see #cmd_tab_pack)
+ * @param[in] p_cmd_tab Pointer to command table object
+ * @return Number of bytes
+ */
+size_t cmd_tab_get_packed_size(cmd_tab_t *p_cmd_tab) {
+
+    /* Size of the header, the exactly sized arrays and the string */
+    return ALIGN_SIZE(sizeof(cmd_tab_t)) +
+           ALIGN_SIZE(p_cmd_tab->nb_cmds * sizeof(cmd_t)) +
+           ALIGN_SIZE(p_cmd_tab->nb_args * sizeof(cmd_tok_t)) +
+           ALIGN_SIZE(p_cmd_tab->nb_args * sizeof(char *)) +
+           ALIGN_SIZE(p_cmd_tab->nb_redirs * sizeof(cmd_redir_t)) +
+           p_cmd_tab->cmd_len + 1;
+}
+
+/**
+ * @brief Copies the command table into a single contiguous block: the
+ *        header, the commands, the argument and redirection pools and the
+ *        string, each sized
+ *        to the actual command line (the table must not be blank)
+ * @param[out] p_mem Memory of atleast #cmd_tab_get_packed_size bytes
+ *             (pointer aligned), the copy is released by freeing it
+ * @param[in] p_cmd_tab Source command table
+ * @return Pointer to the copied command table (same as #p_mem)
+ */
+cmd_tab_t *cmd_tab_pack(void *p_mem, cmd_tab_t *p_cmd_tab) {
+
+    int cmd_i;
+    int arg_i;
+    int redir_i;
+
+    /* The header is at the start of the block */
+    cmd_tab_t *p_cmd_tab_dest = (cmd_tab_t *)p_mem;
+
+    /* Memory after the header */
+    char *p_next = (char *)p_mem + ALIGN_SIZE(sizeof(cmd_tab_t));
+
+    /* The copy does not own an arena */
+    arena_init(&p_cmd_tab_dest->arena);
+
+    /* Copy the commands (to be materialized again in the copy) */
+    p_cmd_tab_dest->cmds = (cmd_t *)p_next;
+    p_cmd_tab_dest->nb_cmds = p_cmd_tab->nb_cmds;
+    p_cmd_tab_dest->max_cmds = p_cmd_tab->nb_cmds;
+    memcpy(p_cmd_tab_dest->cmds, p_cmd_tab->cmds, p_cmd_tab->nb_cmds * sizeof(cmd_t));
+    p_next += ALIGN_SIZE(p_cmd_tab->nb_cmds * sizeof(cmd_t));
+
+    /* Copy the argument pool (the command's slice indices stay valid) */
+    p_cmd_tab_dest->toks = (cmd_tok_t *)p_next;
+    p_cmd_tab_dest->nb_args = p_cmd_tab->nb_args;
+    p_cmd_tab_dest->max_args = p_cmd_tab->nb_args;
+    memcpy(p_cmd_tab_dest->toks, p_cmd_tab->toks, p_cmd_tab->nb_args * sizeof(cmd_tok_t));
+    p_next += ALIGN_SIZE(p_cmd_tab->nb_args * sizeof(cmd_tok_t));
+
+    /* Place the argument pointers */
+    p_cmd_tab_dest->args = (char **)p_next;
+    p_next += ALIGN_SIZE(p_cmd_tab->nb_args * sizeof(char *));
+
+    /* Copy the redirection pool */
+    p_cmd_tab_dest->redirs = (cmd_redir_t *)p_next;
+    p_cmd_tab_dest->nb_redirs = p_cmd_tab->nb_redirs;
+    p_cmd_tab_dest->max_redirs = p_cmd_tab->nb_redirs;
+    if (p_cmd_tab->nb_redirs) {
+        memcpy(p_cmd_tab_dest->redirs, p_cmd_tab->redirs, p_cmd_tab->nb_redirs * sizeof(cmd_redir_t));
+    }
+    p_next += ALIGN_SIZE(p_cmd_tab->nb_redirs * sizeof(cmd_redir_t));
 
     /* Copy the command string */
-    if (p_cmd_tab_src->cmd_str) {
-        p_cmd_tab_dest->cmd_str = strdup(p_cmd_tab_src->cmd_str);
+    p_cmd_tab_dest->cmd_str = p_next;
+    p_cmd_tab_dest->cmd_len = p_cmd_tab->cmd_len;
+    memcpy(p_cmd_tab_dest->cmd_str, p_cmd_tab->cmd_str, p_cmd_tab->cmd_len + 1);
+
+    /* Restore the characters overwritten by the terminators */
+    for (arg_i = 0; arg_i < p_cmd_tab->nb_args; arg_i++) {
+
+        __tok_restore(p_cmd_tab_dest->cmd_str, &p_cmd_tab->toks[arg_i]);
     }
-    else {
-        p_cmd_tab_dest->cmd_str = NULL;
+
+    for (redir_i = 0; redir_i < p_cmd_tab->nb_redirs; redir_i++) {
+
+        __tok_restore(p_cmd_tab_dest->cmd_str, &p_cmd_tab->redirs[redir_i].tok);
     }
 
-    /* Copy the number of commands */
-    p_cmd_tab_dest->nb_cmds = p_cmd_tab_src->nb_cmds;
+    for (cmd_i = 0; cmd_i < p_cmd_tab->nb_cmds; cmd_i++) {
 
-    /* Copy the command arguments */
-    for (i = 0; i < p_cmd_tab_src->nb_cmds; i++) {
+        p_cmd_tab_dest->cmds[cmd_i].is_materialized = false;
+    }
 
-        /* Copy the number of command arguments */
-        p_cmd_tab_dest->cmds[i].nb_cmd_args = p_cmd_tab_src->cmds[i].nb_cmd_args;
+    /* Copy the background status */
+    p_cmd_tab_dest->is_background = p_cmd_tab->is_background;
+    p_cmd_tab_dest->has_vars = p_cmd_tab->has_vars;
+    p_cmd_tab_dest->has_globs = p_cmd_tab->has_globs;
+
+    return p_cmd_tab_dest;
+}
+
+/**
+ * @brief Returns the next token of the command line, in the order of the
+ *        string (the argument and redirection pools are each in order)
+ * @param[in] p_cmd_tab Pointer to command table object
+ * @param[in,out] p_arg_i Index of the next argument in the pool
+ * @param[in,out] p_redir_i Index of the next redirection in the pool
+ * @return Index of the token (the redirections follow the arguments), -1 if
+ *         none is left
+ */
+static int __cmd_tab_next_tok(cmd_tab_t *p_cmd_tab, int *p_arg_i, int *p_redir_i) {
+
+    /* Skip the no token entries */
+    while ((*p_arg_i < p_cmd_tab->nb_args) && (p_cmd_tab->toks[*p_arg_i].off == NO_TOK_OFF)) {
+
+        (*p_arg_i)++;
+    }
+
+    /* Take the token which comes first in the string */
+    if ((*p_arg_i < p_cmd_tab->nb_args) &&
+        ((*p_redir_i == p_cmd_tab->nb_redirs) ||
+         (p_cmd_tab->toks[*p_arg_i].off < p_cmd_tab->redirs[*p_redir_i].tok.off))) {
 
-        /* Copy the command arguments */
-        for (j = 0; j < p_cmd_tab_src->cmds[i].nb_cmd_args - 1; j++) {
+        return (*p_arg_i)++;
+    }
 
-            p_cmd_tab_dest->cmds[i].cmd_args[j] = strdup(p_cmd_tab_src->cmds[i].cmd_args[j]);
+    if (*p_redir_i < p_cmd_tab->nb_redirs) {
+
+        return p_cmd_tab->nb_args + (*p_redir_i)++;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Returns the token of the given index (see #__cmd_tab_next_tok)
+ * @param[in] p_cmd_tab Pointer to command table object
+ * @param[in] tok_i Index of the token
+ * @return Pointer to the token
+ */
+static cmd_tok_t *__cmd_tab_get_tok(cmd_tab_t *p_cmd_tab, int tok_i) {
+
+    return (tok_i < p_cmd_tab->nb_args) ? &p_cmd_tab->toks[tok_i] :
+                                          &p_cmd_tab->redirs[tok_i - p_cmd_tab->nb_args].tok;
+}
+
+/**
+ * @brief Copies the text of the command line between two tokens (restoring
+ *        the character overwritten by the terminator of the first one)
+ * @param[in] p_cmd_tab Pointer to command table object
+ * @param[in] p_tok Pointer to the token before the text (NULL for the start
+ *            of the string)
+ * @param[in] end Offset where the text ends
+ * @param[out] out Output (NULL to only get the length)
+ * @return Length of the text
+ */
+static size_t __cmd_tab_copy_gap(cmd_tab_t *p_cmd_tab, cmd_tok_t *p_tok, int end, char *out) {
+
+    int start = p_tok ? p_tok->off + p_tok->len : 0;
+
+    if (out && (end > start)) {
+
+        memcpy(out, p_cmd_tab->cmd_str + start, end - start);
+
+        if (p_tok) {
+            out[0] = p_tok->term;
         }
+    }
+
+    return end - start;
+}
+
+/**
+ * @brief Copies the command table with every token expanded, the string of
+ *        the copy is the expanded command line (so that the jobs show what
+ *        ran), an argument may expand to several words (separated by NULL
+ *        characters in the expansion), a redirection expanding to several
+ *        words is kept as it is
+ * @param[out] p_dest Command table (blank) receiving the copy
+ * @param[in] p_src Source command table (it may be materialized or packed)
+ * @param[in] expand Function expanding a token (called once per token,
+ *            unless the expansion does not fit the buffer)
+ */
+void cmd_tab_expand(cmd_tab_t *p_dest, cmd_tab_t *p_src, cmd_tab_expand_func_t expand) {
+
+    cmd_tab_expansion_t *exps;
+    cmd_tab_expansion_t *p_exp;
+    cmd_t *p_cmd;
+    cmd_tok_t *p_tok;
+    cmd_tok_t *p_prev = NULL;
+    char *buf;
+    char *p_sep;
+    char *p_end;
+    size_t buf_len = 0;
+    size_t buf_size = EXPAND_BUF_MIN_SIZE;
+    size_t exp_len;
+    size_t len = 0;
+    int nb_args;
+    int arg_i = 0;
+    int redir_i = 0;
+    int tok_i;
+    int cmd_i;
+    int dest_i;
+    int batch_start;
+    int batch_end;
+    int off;
+
+    /* Expansion of every token (the redirections follow the arguments) */
+    exps = (cmd_tab_expansion_t *)calloc(p_src->nb_args + p_src->nb_redirs, sizeof(cmd_tab_expansion_t));
+
+    /* Buffer holding every expansion */
+    if (buf_size < 2 * (size_t)p_src->cmd_len) {
+        buf_size = 2 * (size_t)p_src->cmd_len;
+    }
+    buf = (char *)malloc(buf_size);
 
-        /* Make the last command argument as NULL */
-        p_cmd_tab_dest->cmds[i].cmd_args[j] = NULL;
+    nb_args = p_src->nb_args;
 
-        /* Copy the input redirection status  */
-        p_cmd_tab_dest->cmds[i].is_input_redirected = p_cmd_tab_src->cmds[i].is_input_redirected;
+    /* Expand the tokens, in the order of the string */
+    while ((tok_i = __cmd_tab_next_tok(p_src, &arg_i, &redir_i)) != -1) {
 
-        /* Copy the input redirection file name */
-        if (p_cmd_tab_src->cmds[i].in_arg) {
-            p_cmd_tab_dest->cmds[i].in_arg = strdup(p_cmd_tab_src->cmds[i].in_arg);
+        p_tok = __cmd_tab_get_tok(p_src, tok_i);
+        p_exp = &exps[tok_i];
+
+        /* Grow the buffer and expand again if the expansion did not fit */
+        while ((exp_len = expand(p_src->cmd_str + p_tok->off, p_tok->len, buf + buf_len, buf_size - buf_len)) >
+               buf_size - buf_len) {
+
+            buf_size = (2 * buf_size > buf_len + exp_len) ? 2 * buf_size : buf_len + exp_len;
+            buf = (char *)realloc(buf, buf_size);
         }
-        else {
-            p_cmd_tab_dest->cmds[i].in_arg = NULL;
+
+        /* Count the words */
+        p_exp->nb_words = 1;
+        for (p_sep = buf + buf_len, p_end = buf + buf_len + exp_len;
+             (p_sep = (char *)memchr(p_sep, '\0', p_end - p_sep)); p_sep++) {
+
+            p_exp->nb_words++;
         }
 
-        /* Copy the output redirection status  */
-        p_cmd_tab_dest->cmds[i].is_output_redirected = p_cmd_tab_src->cmds[i].is_output_redirected;
+        /* A redirection needs a single word, else the token is kept */
+        if ((tok_i >= p_src->nb_args) && (p_exp->nb_words > 1)) {
 
-        /* Copy the output redirection file name */
-        if (p_cmd_tab_src->cmds[i].out_arg) {
-            p_cmd_tab_dest->cmds[i].out_arg = strdup(p_cmd_tab_src->cmds[i].out_arg);
+            p_exp->is_kept = true;
+            p_exp->nb_words = 1;
+            p_exp->len = p_tok->len;
         }
         else {
-            p_cmd_tab_dest->cmds[i].out_arg = NULL;
+
+            p_exp->off = buf_len;
+            p_exp->len = exp_len;
+            buf_len += exp_len;
         }
+
+        nb_args += p_exp->nb_words - 1;
+
+        /* Length of the text before the token and the expansion */
+        len += __cmd_tab_copy_gap(p_src, p_prev, p_tok->off, NULL) + p_exp->len;
+        p_prev = p_tok;
     }
 
-    /* Copy the background status */
-    p_cmd_tab_dest->is_background = p_cmd_tab_src->is_background;
-}
+    len += __cmd_tab_copy_gap(p_src, p_prev, p_src->cmd_len, NULL);
 
-/**
- * @brief Deallocates the memory assinged to the command table
- * @param[out] p_cmd_tab Pointer to command table object
- */
-void cmd_tab_deinit(cmd_tab_t *p_cmd_tab) {
+    /* Reserve the space for the arrays and the string at once */
+    arena_reserve(&p_dest->arena,
+                  ALIGN_SIZE(p_src->nb_cmds * sizeof(cmd_t)) +
+                  ALIGN_SIZE(nb_args * sizeof(cmd_tok_t)) +
+                  ALIGN_SIZE(nb_args * sizeof(char *)) +
+                  ALIGN_SIZE(p_src->nb_redirs * sizeof(cmd_redir_t)) +
+                  len + 1 + ARRAY_ALIGN);
 
-    int i;
-    int j;
+    p_dest->cmds = (cmd_t *)arena_alloc(&p_dest->arena, p_src->nb_cmds * sizeof(cmd_t), ARRAY_ALIGN);
+    p_dest->nb_cmds = p_src->nb_cmds;
+    p_dest->max_cmds = p_src->nb_cmds;
 
-    /* Free the command line string */
-    free(p_cmd_tab->cmd_str);
+    p_dest->toks = (cmd_tok_t *)arena_alloc(&p_dest->arena, nb_args * sizeof(cmd_tok_t), ARRAY_ALIGN);
+    p_dest->args = (char **)arena_alloc(&p_dest->arena, nb_args * sizeof(char *), ARRAY_ALIGN);
+    p_dest->nb_args = nb_args;
+    p_dest->max_args = nb_args;
 
-    /* For each command in the command table */
-    for (i = 0; i < p_cmd_tab->nb_cmds; i++) {
+    p_dest->redirs = (cmd_redir_t *)arena_alloc(&p_dest->arena, p_src->nb_redirs * sizeof(cmd_redir_t), ARRAY_ALIGN);
+    p_dest->nb_redirs = p_src->nb_redirs;
+    p_dest->max_redirs = p_src->nb_redirs;
 
-        /* For each command line arguments of the current command */
-        for (j = 0; j < p_cmd_tab->cmds[i].nb_cmd_args; j++) {
+    p_dest->cmd_str = (char *)arena_alloc(&p_dest->arena, len + 1, 1);
+    p_dest->cmd_len = len;
 
-            /* Free the command line argument string */
-            free(p_cmd_tab->cmds[i].cmd_args[j]);
-        }
+    /* Build the expanded string */
+    len = 0;
+    p_prev = NULL;
+    arg_i = 0;
+    redir_i = 0;
+
+    while ((tok_i = __cmd_tab_next_tok(p_src, &arg_i, &redir_i)) != -1) {
+
+        p_tok = __cmd_tab_get_tok(p_src, tok_i);
+        p_exp = &exps[tok_i];
 
-        /* Set the number of command line arguments to zero */
-        p_cmd_tab->cmds[i].nb_cmd_args = 0;
+        len += __cmd_tab_copy_gap(p_src, p_prev, p_tok->off, p_dest->cmd_str + len);
 
-        /* If the command was input redirected */
-        if (p_cmd_tab->cmds[i].is_input_redirected) {
+        p_exp->dest_off = len;
+        memcpy(p_dest->cmd_str + len, p_exp->is_kept ? p_src->cmd_str + p_tok->off : buf + p_exp->off, p_exp->len);
+        len += p_exp->len;
 
-            /* Free the input file argument */
-            free(p_cmd_tab->cmds[i].in_arg);
+        p_prev = p_tok;
+    }
+
+    len += __cmd_tab_copy_gap(p_src, p_prev, p_src->cmd_len, p_dest->cmd_str + len);
+    p_dest->cmd_str[len] = '\0';
+
+    /* Set the argument pool, a token gives a token for every word */
+    for (arg_i = 0, dest_i = 0; arg_i < p_src->nb_args; arg_i++) {
+
+        p_exp = &exps[arg_i];
+        p_exp->dest_i = dest_i;
+
+        /* Keep the no token entries */
+        if (p_src->toks[arg_i].off == NO_TOK_OFF) {
 
-            /* Update the input redirection status */
-            p_cmd_tab->cmds[i].is_input_redirected = false;
+            p_dest->toks[dest_i++] = p_src->toks[arg_i];
+            continue;
         }
 
-        /* If the command was output redirected */
-        if (p_cmd_tab->cmds[i].is_output_redirected) {
+        /* Split the words at the separators (written as spaces in the
+         * string) */
+        off = p_exp->dest_off;
+        p_end = p_dest->cmd_str + p_exp->dest_off + p_exp->len;
 
-            /* Free the output file argument */
-            free(p_cmd_tab->cmds[i].out_arg);
+        while ((p_sep = (char *)memchr(p_dest->cmd_str + off, '\0', p_end - (p_dest->cmd_str + off)))) {
 
-            /* Update the output redirection status */
-            p_cmd_tab->cmds[i].is_output_redirected = false;
+            *p_sep = ' ';
+            p_dest->toks[dest_i].off = off;
+            p_dest->toks[dest_i].len = p_sep - (p_dest->cmd_str + off);
+            p_dest->toks[dest_i++].term = ' ';
+            off = p_sep - p_dest->cmd_str + 1;
         }
+
+        p_dest->toks[dest_i].off = off;
+        p_dest->toks[dest_i].len = p_end - (p_dest->cmd_str + off);
+        p_dest->toks[dest_i++].term = *p_end;
+    }
+
+    /* Set the redirection pool */
+    for (redir_i = 0; redir_i < p_src->nb_redirs; redir_i++) {
+
+        p_exp = &exps[p_src->nb_args + redir_i];
+
+        p_dest->redirs[redir_i] = p_src->redirs[redir_i];
+        p_dest->redirs[redir_i].tok.off = p_exp->dest_off;
+        p_dest->redirs[redir_i].tok.len = p_exp->len;
+        p_dest->redirs[redir_i].tok.term = p_dest->cmd_str[p_exp->dest_off + p_exp->len];
     }
 
+    /* Set the commands to their slices of the pools (to be materialized) */
+    for (cmd_i = 0; cmd_i < p_src->nb_cmds; cmd_i++) {
+
+        p_cmd = &p_src->cmds[cmd_i];
+
+        p_dest->cmds[cmd_i] = *p_cmd;
+        p_dest->cmds[cmd_i].arg_i = exps[p_cmd->arg_i].dest_i;
+        p_dest->cmds[cmd_i].nb_cmd_args =
+            exps[p_cmd->arg_i + p_cmd->nb_cmd_args - 1].dest_i + 1 - p_dest->cmds[cmd_i].arg_i;
+        p_dest->cmds[cmd_i].is_materialized = false;
+
+        /* The batches get the words from the first to the last expansion
+         * giving several (and the ones of the source batches), the name is
+         * kept by every batch */
+        batch_start = -1;
+        batch_end = -1;
+
+        for (arg_i = p_cmd->arg_i + 1; arg_i < p_cmd->arg_i + p_cmd->nb_cmd_args - 1; arg_i++) {
+
+            if ((exps[arg_i].nb_words > 1) ||
+                (p_cmd->nb_batch_args &&
+                 (arg_i >= p_cmd->arg_i + p_cmd->batch_i) &&
+                 (arg_i < p_cmd->arg_i + p_cmd->batch_i + p_cmd->nb_batch_args))) {
+
+                if (batch_start == -1) {
+                    batch_start = exps[arg_i].dest_i;
+                }
+                batch_end = exps[arg_i].dest_i + exps[arg_i].nb_words;
+            }
+        }
+
+        p_dest->cmds[cmd_i].batch_i = (batch_start == -1) ? 0 : batch_start - p_dest->cmds[cmd_i].arg_i;
+        p_dest->cmds[cmd_i].nb_batch_args = (batch_start == -1) ? 0 : batch_end - batch_start;
+    }
+
+    /* Copy the background status, the expanded string is checked for the
+     * wildcards again (the variables may hold some) */
+    p_dest->is_background = p_src->is_background;
+    p_dest->has_vars = false;
+    p_dest->has_globs = __cmd_tab_has_globs(p_dest->cmd_str);
+
+    free(buf);
+    free(exps);
+}
+
+/**
+ * @brief Empties the command table so that it can be reused for the next
+ *        command line, the arena memory is kept for reuse
+ * @param[out] p_cmd_tab Pointer to command table object
+ */
+void cmd_tab_reset(cmd_tab_t *p_cmd_tab) {
+
+    /* Release all the arrays and the string at once */
+    arena_reset(&p_cmd_tab->arena);
+
+    /* Set the variables to base values */
+    __cmd_tab_clear(p_cmd_tab);
+}
+
+/**
+ * @brief Deallocates the memory assinged to the command table
+ * @param[out] p_cmd_tab Pointer to command table object
+ */
+void cmd_tab_deinit(cmd_tab_t *p_cmd_tab) {
+
+    /* Free the arena (the arrays and the string go with it) */
+    arena_deinit(&p_cmd_tab->arena);
+
     /* Reinitialize the command table */
     cmd_tab_init(p_cmd_tab);
 }
@@ -0,0 +1,1044 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "dag.h"
+#include "parser.h"
+#include "executor.h"
+#include "jobs.h"
+#include "vars.h"
+#include "wildcard.h"
+
+/* Lowest file descriptor of a run (above the ones which can be redirected) */
+#define DAG_MIN_FD (10)
+
+/* Writes an error of the built-in */
+#define WRITE_ERROR(err_fd, fmt, ...)                                       \
+    ({                                                                      \
+        dprintf(err_fd, "kavach: dag: " fmt "\n", ##__VA_ARGS__);          \
+    })
+
+/* Is the character a blank of the specification */
+#define IS_BLANK(ch)                                                        \
+    ({                                                                      \
+        ((ch) == ' ') || ((ch) == '\t') || ((ch) == '\r');                  \
+    })
+
+/**
+ * @brief Returns the time of the monotonic clock
+ * @return Time in milliseconds
+ */
+static uint64_t __dag_now() {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000u + (uint64_t)now.tv_nsec / 1000000u;
+}
+
+/**
+ * @brief Moves the file descriptor above the ones which can be redirected
+ * @param[in] fd File descriptor (closed)
+ * @return New file descriptor (-1 if the given one is)
+ */
+static int __dag_high_fd(int fd) {
+
+    int high_fd;
+
+    if (fd == -1) {
+
+        return -1;
+    }
+
+    high_fd = fcntl(fd, F_DUPFD_CLOEXEC, DAG_MIN_FD);
+    close(fd);
+
+    return high_fd;
+}
+
+/**
+ * @brief Reads the whole file
+ * @param[in] fd File descriptor
+ * @return Contents, NULL terminated (NULL if it cannot be read)
+ */
+static char *__dag_read(int fd) {
+
+    size_t size = DAG_READ_SIZE;
+    size_t len = 0;
+    ssize_t nb_read;
+    char *buf = (char *)malloc(size);
+
+    while (1) {
+
+        if (size - len < DAG_READ_SIZE) {
+
+            size *= 2;
+            buf = (char *)realloc(buf, size);
+        }
+
+        nb_read = read(fd, buf + len, size - len - 1);
+
+        if (nb_read > 0) {
+
+            len += nb_read;
+        }
+        else if (!nb_read) {
+
+            break;
+        }
+        else if (errno != EINTR) {
+
+            free(buf);
+            return NULL;
+        }
+    }
+
+    buf[len] = '\0';
+
+    return buf;
+}
+
+/**
+ * @brief Skips the blanks
+ * @param[in] str String
+ * @return First character which is not a blank
+ */
+static char *__dag_skip_blanks(char *str) {
+
+    while (IS_BLANK(*str)) {
+
+        str++;
+    }
+
+    return str;
+}
+
+/**
+ * @brief Terminates the word at the start of the string
+ * @param[in] str String (starting with the word)
+ * @return Start of the next word (at the end of the string if none)
+ */
+static char *__dag_end_word(char *str) {
+
+    while (*str && !IS_BLANK(*str)) {
+
+        str++;
+    }
+
+    if (*str) {
+
+        *str++ = '\0';
+    }
+
+    return __dag_skip_blanks(str);
+}
+
+/**
+ * @brief Adds the tasks of the specification, a task per line (name [dep]...
+ *        : command line), the blank lines and the ones starting with # are
+ *        skipped, the words are terminated in place
+ * @param[in,out] p_run Pointer to the run
+ * @return true If the specification is valid
+ * @return false Otherwise (the error is printed)
+ */
+static bool __dag_parse_spec(dag_t *p_run) {
+
+    /* Capacities of the tasks and of the dependencies */
+    int max_tasks = 0;
+    int max_deps = 0;
+
+    dag_task_t *p_task;
+    char *line = p_run->spec;
+    char *p_next;
+    char *p_sep;
+    char *word;
+    int line_nb;
+
+    for (line_nb = 1; line; line = p_next, line_nb++) {
+
+        /* Terminate the line */
+        if ((p_next = strchr(line, '\n'))) {
+
+            *p_next++ = '\0';
+        }
+
+        line = __dag_skip_blanks(line);
+
+        if (!*line || (*line == '#')) {
+
+            continue;
+        }
+
+        if (!(p_sep = strchr(line, DAG_SEP))) {
+
+            WRITE_ERROR(p_run->err_fd, "line %d: `%c` missing before the command", line_nb, DAG_SEP);
+            return false;
+        }
+
+        *p_sep = '\0';
+
+        if (!*line) {
+
+            WRITE_ERROR(p_run->err_fd, "line %d: task name missing", line_nb);
+            return false;
+        }
+
+        if (p_run->nb_tasks == max_tasks) {
+
+            max_tasks = max_tasks ? 2 * max_tasks : 16;
+            p_run->tasks = (dag_task_t *)realloc(p_run->tasks, max_tasks * sizeof(dag_task_t));
+        }
+
+        p_task = &p_run->tasks[p_run->nb_tasks++];
+        memset(p_task, 0, sizeof(dag_task_t));
+
+        /* The command line follows the separator */
+        p_task->cmd_str = __dag_skip_blanks(p_sep + 1);
+        p_task->gpid = -1;
+        p_task->state = DAG_WAITING;
+
+        if (!*p_task->cmd_str) {
+
+            WRITE_ERROR(p_run->err_fd, "line %d: command missing", line_nb);
+            return false;
+        }
+
+        /* The name is followed by the dependencies */
+        p_task->name = line;
+        word = __dag_end_word(line);
+        p_task->dep_i = p_run->nb_deps;
+
+        for (; *word; word = __dag_end_word(word)) {
+
+            if (p_run->nb_deps == max_deps) {
+
+                max_deps = max_deps ? 2 * max_deps : 16;
+                p_run->dep_names = (char **)realloc(p_run->dep_names, max_deps * sizeof(char *));
+            }
+
+            p_run->dep_names[p_run->nb_deps++] = word;
+            p_task->nb_deps++;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Returns the task of the name
+ * @param[in] p_run Pointer to the run
+ * @param[in] name Name
+ * @param[in] nb_tasks Number of tasks searched
+ * @return Index of the task (-1 if there is none)
+ */
+static int __dag_find(dag_t *p_run, const char *name, int nb_tasks) {
+
+    int task_i;
+
+    for (task_i = 0; task_i < nb_tasks; task_i++) {
+
+        if (!strcmp(p_run->tasks[task_i].name, name)) {
+
+            return task_i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Resolves the dependencies to the tasks and lists the tasks
+ *        depending on every task
+ * @param[in,out] p_run Pointer to the run
+ * @return true If every dependency is a task
+ * @return false Otherwise (the error is printed)
+ */
+static bool __dag_link(dag_t *p_run) {
+
+    dag_task_t *p_task;
+    dag_task_t *p_dep_task;
+    int *p_dep;
+    int task_i;
+    int dep_i;
+    int off = 0;
+
+    p_run->deps = (int *)malloc((p_run->nb_deps + 1) * sizeof(int));
+    p_run->dependents = (int *)malloc((p_run->nb_deps + 1) * sizeof(int));
+
+    for (task_i = 0; task_i < p_run->nb_tasks; task_i++) {
+
+        p_task = &p_run->tasks[task_i];
+
+        if (__dag_find(p_run, p_task->name, task_i) != -1) {
+
+            WRITE_ERROR(p_run->err_fd, "`%s` defined twice", p_task->name);
+            return false;
+        }
+
+        for (dep_i = p_task->dep_i; dep_i < p_task->dep_i + p_task->nb_deps; dep_i++) {
+
+            p_dep = &p_run->deps[dep_i];
+
+            if ((*p_dep = __dag_find(p_run, p_run->dep_names[dep_i], p_run->nb_tasks)) == -1) {
+
+                WRITE_ERROR(p_run->err_fd, "`%s` unknown task (a dependency of `%s`)",
+                            p_run->dep_names[dep_i], p_task->name);
+                return false;
+            }
+
+            p_run->tasks[*p_dep].nb_dependents++;
+        }
+
+        p_task->nb_waiting = p_task->nb_deps;
+    }
+
+    /* Give every task its range of the dependents */
+    for (task_i = 0; task_i < p_run->nb_tasks; task_i++) {
+
+        p_run->tasks[task_i].dependent_i = off;
+        off += p_run->tasks[task_i].nb_dependents;
+        p_run->tasks[task_i].nb_dependents = 0;
+    }
+
+    for (task_i = 0; task_i < p_run->nb_tasks; task_i++) {
+
+        p_task = &p_run->tasks[task_i];
+
+        for (dep_i = p_task->dep_i; dep_i < p_task->dep_i + p_task->nb_deps; dep_i++) {
+
+            p_dep_task = &p_run->tasks[p_run->deps[dep_i]];
+            p_run->dependents[p_dep_task->dependent_i + p_dep_task->nb_dependents++] = task_i;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Ranks the tasks by the cost of the longest chain of tasks they
+ *        start, in the reverse of a topological order
+ * @param[in,out] p_run Pointer to the run
+ * @return true If the graph has no cycle
+ * @return false Otherwise (the error is printed)
+ */
+static bool __dag_rank(dag_t *p_run) {
+
+    /* Tasks in a topological order (every task after its dependencies) */
+    int *order = (int *)malloc(p_run->nb_tasks * sizeof(int));
+    int *nb_waiting = (int *)malloc(p_run->nb_tasks * sizeof(int));
+    int nb_ordered = 0;
+    int order_i;
+    int task_i;
+    int dep_i;
+    dag_task_t *p_task;
+    dag_task_t *p_dependent;
+    bool is_acyclic;
+
+    for (task_i = 0; task_i < p_run->nb_tasks; task_i++) {
+
+        nb_waiting[task_i] = p_run->tasks[task_i].nb_deps;
+
+        if (!nb_waiting[task_i]) {
+
+            order[nb_ordered++] = task_i;
+        }
+    }
+
+    for (order_i = 0; order_i < nb_ordered; order_i++) {
+
+        p_task = &p_run->tasks[order[order_i]];
+
+        for (dep_i = 0; dep_i < p_task->nb_dependents; dep_i++) {
+
+            task_i = p_run->dependents[p_task->dependent_i + dep_i];
+
+            if (!--nb_waiting[task_i]) {
+
+                order[nb_ordered++] = task_i;
+            }
+        }
+    }
+
+    /* The tasks of a cycle are never ready */
+    if (!(is_acyclic = (nb_ordered == p_run->nb_tasks))) {
+
+        for (task_i = 0; nb_waiting[task_i] == 0; task_i++);
+
+        WRITE_ERROR(p_run->err_fd, "the dependencies of `%s` have a cycle", p_run->tasks[task_i].name);
+    }
+    else {
+
+        /* The dependents are ranked before the task */
+        for (order_i = nb_ordered - 1; order_i >= 0; order_i--) {
+
+            p_task = &p_run->tasks[order[order_i]];
+            p_task->rank = 0;
+
+            for (dep_i = 0; dep_i < p_task->nb_dependents; dep_i++) {
+
+                p_dependent = &p_run->tasks[p_run->dependents[p_task->dependent_i + dep_i]];
+
+                if (p_dependent->rank > p_task->rank) {
+
+                    p_task->rank = p_dependent->rank;
+                }
+            }
+
+            p_task->rank += p_task->cost;
+        }
+    }
+
+    free(nb_waiting);
+    free(order);
+
+    return is_acyclic;
+}
+
+/**
+ * @brief Parses the command lines of the tasks
+ * @param[in,out] p_run Pointer to the run
+ * @return true If every command line is valid
+ * @return false Otherwise (the error is printed)
+ */
+static bool __dag_parse_cmds(dag_t *p_run) {
+
+    dag_task_t *p_task;
+    int task_i;
+
+    for (task_i = 0; task_i < p_run->nb_tasks; task_i++) {
+
+        p_task = &p_run->tasks[task_i];
+        cmd_tab_init(&p_task->cmd_tab);
+    }
+
+    for (task_i = 0; task_i < p_run->nb_tasks; task_i++) {
+
+        p_task = &p_run->tasks[task_i];
+
+        if ((parser_set_cmd_tab(&p_task->cmd_tab, p_task->cmd_str) != PARSER_OK) ||
+            !cmd_tab_get_nb_cmds(&p_task->cmd_tab)) {
+
+            WRITE_ERROR(p_run->err_fd, "`%s` invalid command line", p_task->name);
+            return false;
+        }
+
+        /* The run waits for its tasks */
+        if (cmd_tab_is_bg(&p_task->cmd_tab)) {
+
+            WRITE_ERROR(p_run->err_fd, "`%s` cannot run in the background", p_task->name);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Returns the path of the file of the recorded durations
+ * @param[out] path Buffer of the path
+ * @param[in] size Size of the buffer
+ * @return true If there is a file
+ * @return false Otherwise
+ */
+static bool __dag_times_path(char *path, size_t size) {
+
+    const char *file = getenv(DAG_TIMES_FILE_ENV);
+    const char *home;
+
+    if (file) {
+
+        return *file && (snprintf(path, size, "%s", file) < (int)size);
+    }
+
+    if (!(home = vars_get("HOME", 4))) {
+
+        return false;
+    }
+
+    return snprintf(path, size, "%s/%s", home, DAG_TIMES_FILE) < (int)size;
+}
+
+/**
+ * @brief Reads the durations recorded by the previous runs, a line per
+ *        command line (milliseconds command line)
+ * @param[in,out] p_run Pointer to the run
+ * @return Contents of the file (NULL if there is none)
+ */
+static char *__dag_load_times(dag_t *p_run) {
+
+    char path[PATH_MAX];
+    char *times;
+    char *line;
+    char *p_end;
+    uint64_t cost;
+    int task_i;
+    int fd;
+
+    if (!__dag_times_path(path, sizeof(path)) || ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)) {
+
+        return NULL;
+    }
+
+    times = __dag_read(fd);
+    close(fd);
+
+    for (line = times; line && *line; line = p_end + (*p_end == '\n')) {
+
+        cost = strtoull(line, &p_end, 10);
+
+        if ((p_end != line) && (*p_end == ' ')) {
+
+            line = p_end + 1;
+            p_end = line + strcspn(line, "\n");
+
+            /* The first duration of the command line is taken */
+            for (task_i = 0; task_i < p_run->nb_tasks; task_i++) {
+
+                if (!p_run->tasks[task_i].cost &&
+                    !strncmp(p_run->tasks[task_i].cmd_str, line, p_end - line) &&
+                    !p_run->tasks[task_i].cmd_str[p_end - line]) {
+
+                    p_run->tasks[task_i].cost = cost;
+                }
+            }
+        }
+        else {
+
+            p_end += strcspn(p_end, "\n");
+        }
+    }
+
+    return times;
+}
+
+/**
+ * @brief Records the durations of the tasks done, the ones of the other
+ *        command lines are kept (the file is replaced at once)
+ * @param[in] p_run Pointer to the run
+ * @param[in] times Contents of the file read (NULL if there was none)
+ */
+static void __dag_save_times(dag_t *p_run, const char *times) {
+
+    char path[PATH_MAX];
+    char tmp_path[PATH_MAX + 8];
+    const char *line;
+    const char *p_cmd;
+    size_t len;
+    bool is_kept;
+    int task_i;
+    FILE *p_file;
+
+    if (!__dag_times_path(path, sizeof(path))) {
+
+        return;
+    }
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d", path, (int)getpid());
+
+    if (!(p_file = fopen(tmp_path, "we"))) {
+
+        return;
+    }
+
+    for (task_i = 0; task_i < p_run->nb_tasks; task_i++) {
+
+        if (p_run->tasks[task_i].state == DAG_DONE) {
+
+            fprintf(p_file, "%llu %s\n", (unsigned long long)p_run->tasks[task_i].cost, p_run->tasks[task_i].cmd_str);
+        }
+    }
+
+    for (line = times; line && *line; line += len + (line[len] == '\n')) {
+
+        len = strcspn(line, "\n");
+        p_cmd = memchr(line, ' ', len);
+        is_kept = (p_cmd != NULL);
+
+        /* The lines of the command lines done are replaced */
+        for (task_i = 0; is_kept && (task_i < p_run->nb_tasks); task_i++) {
+
+            is_kept = (p_run->tasks[task_i].state != DAG_DONE) ||
+                      strncmp(p_run->tasks[task_i].cmd_str, p_cmd + 1, line + len - p_cmd - 1) ||
+                      p_run->tasks[task_i].cmd_str[line + len - p_cmd - 1];
+        }
+
+        if (is_kept) {
+
+            fprintf(p_file, "%.*s\n", (int)len, line);
+        }
+    }
+
+    if (fclose(p_file) || rename(tmp_path, path)) {
+
+        unlink(tmp_path);
+    }
+}
+
+/**
+ * @brief Adds the ready task to the queue of the worker, after the ones of a
+ *        longer or equal rank
+ * @param[in,out] p_run Pointer to the run
+ * @param[in] worker_i Index of the worker
+ * @param[in] task_i Index of the task
+ */
+static void __dag_push(dag_t *p_run, int worker_i, int task_i) {
+
+    dag_worker_t *p_worker = &p_run->workers[worker_i];
+    uint64_t rank = p_run->tasks[task_i].rank;
+    int pos = p_worker->nb_ready;
+
+    while ((pos > 0) && (p_run->tasks[p_worker->queue[pos - 1]].rank < rank)) {
+
+        p_worker->queue[pos] = p_worker->queue[pos - 1];
+        pos--;
+    }
+
+    p_worker->queue[pos] = task_i;
+    p_worker->nb_ready++;
+
+    p_run->tasks[task_i].state = DAG_READY;
+}
+
+/**
+ * @brief Takes the next task of the worker, from its own queue, else stolen
+ *        from the queue of the worker whose next task has the longest rank
+ *        (so that the tasks are started from the longest across the
+ *        queues)
+ * @param[in,out] p_run Pointer to the run
+ * @param[in] worker_i Index of the worker
+ * @return Index of the task (-1 if no task is ready)
+ */
+static int __dag_pop(dag_t *p_run, int worker_i) {
+
+    dag_worker_t *p_victim = &p_run->workers[worker_i];
+    int victim_i;
+    int task_i;
+
+    if (!p_victim->nb_ready) {
+
+        p_victim = NULL;
+
+        for (victim_i = 0; victim_i < p_run->nb_workers; victim_i++) {
+
+            if (p_run->workers[victim_i].nb_ready &&
+                (!p_victim ||
+                 (p_run->tasks[p_run->workers[victim_i].queue[0]].rank > p_run->tasks[p_victim->queue[0]].rank))) {
+
+                p_victim = &p_run->workers[victim_i];
+            }
+        }
+
+        if (!p_victim) {
+
+            return -1;
+        }
+    }
+
+    task_i = p_victim->queue[0];
+    p_victim->nb_ready--;
+    memmove(p_victim->queue, p_victim->queue + 1, p_victim->nb_ready * sizeof(int));
+
+    return task_i;
+}
+
+/**
+ * @brief Skips the tasks depending on the failed task (and the ones
+ *        depending on them)
+ * @param[in,out] p_run Pointer to the run
+ * @param[in] task_i Index of the task failed
+ */
+static void __dag_skip(dag_t *p_run, int task_i) {
+
+    dag_task_t *p_task = &p_run->tasks[task_i];
+    dag_task_t *p_dependent;
+    int dep_i;
+
+    for (dep_i = 0; dep_i < p_task->nb_dependents; dep_i++) {
+
+        p_dependent = &p_run->tasks[p_run->dependents[p_task->dependent_i + dep_i]];
+
+        if (p_dependent->state == DAG_WAITING) {
+
+            p_dependent->state = DAG_SKIPPED;
+            p_run->nb_skipped++;
+
+            __dag_skip(p_run, p_run->dependents[p_task->dependent_i + dep_i]);
+        }
+    }
+}
+
+/**
+ * @brief Completes the task of the worker, its dependents ready are queued
+ *        to the worker (else they are skipped if it failed)
+ * @param[in,out] p_run Pointer to the run
+ * @param[in] worker_i Index of the worker
+ * @param[in] status Exit status of the task
+ */
+static void __dag_complete(dag_t *p_run, int worker_i, int status) {
+
+    int task_i = p_run->workers[worker_i].task_i;
+    dag_task_t *p_task = &p_run->tasks[task_i];
+    dag_task_t *p_dependent;
+    int dep_i;
+
+    p_run->workers[worker_i].task_i = -1;
+
+    if (status) {
+
+        p_task->state = DAG_FAILED;
+        p_run->nb_failed++;
+
+        if (!p_run->is_stopping) {
+
+            WRITE_ERROR(p_run->err_fd, "`%s` failed (status %d)", p_task->name, status);
+        }
+
+        __dag_skip(p_run, task_i);
+        return;
+    }
+
+    p_task->state = DAG_DONE;
+    p_task->cost = __dag_now() - p_task->start;
+
+    for (dep_i = 0; dep_i < p_task->nb_dependents; dep_i++) {
+
+        p_dependent = &p_run->tasks[p_run->dependents[p_task->dependent_i + dep_i]];
+
+        if (!--p_dependent->nb_waiting && (p_dependent->state == DAG_WAITING)) {
+
+            __dag_push(p_run, worker_i, p_run->dependents[p_task->dependent_i + dep_i]);
+        }
+    }
+}
+
+/**
+ * @brief Starts the task by the worker through the executor, its processes
+ *        are a job (the variables and the wildcards are expanded at start)
+ * @param[in,out] p_run Pointer to the run
+ * @param[in] worker_i Index of the worker
+ * @param[in] task_i Index of the task
+ */
+static void __dag_start(dag_t *p_run, int worker_i, int task_i) {
+
+    dag_task_t *p_task = &p_run->tasks[task_i];
+    cmd_tab_t *p_cmd_tab = &p_task->cmd_tab;
+    int status;
+
+    if (p_cmd_tab->has_vars) {
+
+        cmd_tab_reset(&p_run->expanded);
+        cmd_tab_expand(&p_run->expanded, p_cmd_tab, vars_expand);
+        p_cmd_tab = &p_run->expanded;
+    }
+
+    if (p_cmd_tab->has_globs) {
+
+        cmd_tab_reset(&p_run->globbed);
+        cmd_tab_expand(&p_run->globbed, p_cmd_tab, wildcard_expand);
+        p_cmd_tab = &p_run->globbed;
+    }
+
+    p_task->state = DAG_RUNNING;
+    p_task->start = __dag_now();
+    p_run->workers[worker_i].task_i = task_i;
+
+    p_task->gpid = executor_start_cmd_tab(p_cmd_tab, p_run->null_fd, p_run->out_fd, p_run->err_fd, &status);
+
+    /* The commands are started with the default handlers */
+    jobs_signal_init();
+
+    /* A task without a process (run by the shell, or not executed) is done
+     * already, with the status of its last command */
+    if (p_task->gpid == -1) {
+
+        __dag_complete(p_run, worker_i, status);
+        return;
+    }
+
+    p_run->nb_running++;
+}
+
+/**
+ * @brief Completes the tasks done, the jobs are removed without a report
+ * @param[in,out] p_run Pointer to the run
+ */
+static void __dag_collect(dag_t *p_run) {
+
+    dag_task_t *p_task;
+    int worker_i;
+    int status;
+
+    for (worker_i = 0; worker_i < p_run->nb_workers; worker_i++) {
+
+        if (p_run->workers[worker_i].task_i == -1) {
+
+            continue;
+        }
+
+        p_task = &p_run->tasks[p_run->workers[worker_i].task_i];
+
+        if (jobs_get_grp_state(p_task->gpid) == JOB_DONE) {
+
+            status = jobs_get_grp_status(p_task->gpid);
+            jobs_remove_grp(p_task->gpid);
+
+            p_task->gpid = -1;
+            p_run->nb_running--;
+
+            __dag_complete(p_run, worker_i, status);
+        }
+    }
+}
+
+/**
+ * @brief Signals the tasks running, no task is started anymore
+ * @param[in,out] p_run Pointer to the run
+ * @param[in] sig_num Signal number
+ */
+static void __dag_stop(dag_t *p_run, int sig_num) {
+
+    int worker_i;
+    int gpid;
+
+    p_run->is_stopping = true;
+
+    for (worker_i = 0; worker_i < p_run->nb_workers; worker_i++) {
+
+        if (p_run->workers[worker_i].task_i != -1) {
+
+            gpid = p_run->tasks[p_run->workers[worker_i].task_i].gpid;
+
+            killpg(gpid, sig_num);
+            killpg(gpid, SIGCONT);
+        }
+    }
+}
+
+/**
+ * @brief Completes the tasks done and starts the ready ones by the idle
+ *        workers
+ * @param[in,out] p_run Pointer to the run
+ * @return true If the run is done
+ * @return false Otherwise
+ */
+static bool __dag_step(dag_t *p_run) {
+
+    int worker_i;
+    int task_i;
+
+    __dag_collect(p_run);
+
+    for (worker_i = 0; !p_run->is_stopping && (worker_i < p_run->nb_workers); worker_i++) {
+
+        /* A task done at once leaves the worker idle */
+        while ((p_run->workers[worker_i].task_i == -1) && ((task_i = __dag_pop(p_run, worker_i)) != -1)) {
+
+            __dag_start(p_run, worker_i, task_i);
+        }
+    }
+
+    return !p_run->nb_running;
+}
+
+/**
+ * @brief Frees the run
+ * @param[in] p_run Pointer to the run
+ * @param[in] nb_tabs Number of command tables of the tasks initialized
+ */
+static void __dag_free(dag_t *p_run, int nb_tabs) {
+
+    int task_i;
+    int worker_i;
+
+    for (task_i = 0; task_i < nb_tabs; task_i++) {
+
+        cmd_tab_deinit(&p_run->tasks[task_i].cmd_tab);
+    }
+
+    for (worker_i = 0; worker_i < p_run->nb_workers; worker_i++) {
+
+        free(p_run->workers[worker_i].queue);
+    }
+
+    if (p_run->null_fd != -1) {
+
+        close(p_run->null_fd);
+    }
+
+    close(p_run->out_fd);
+    close(p_run->err_fd);
+
+    cmd_tab_deinit(&p_run->globbed);
+    cmd_tab_deinit(&p_run->expanded);
+
+    free(p_run->workers);
+    free(p_run->dependents);
+    free(p_run->deps);
+    free(p_run->dep_names);
+    free(p_run->tasks);
+    free(p_run->spec);
+    free(p_run);
+}
+
+/**
+ * @brief Runs the tasks of a specification, every task once its
+ *        dependencies are done, at most the given number at a time (a
+ *        worker per core by default), the ready tasks are started from the
+ *        longest chain of durations recorded by the previous runs
+ *        (dag [-j N] [file], the specification is read from the input
+ *        without a file)
+ * @param[in] cmd_args Arguments of the command
+ * @param[in] nb_cmd_args Number of arguments
+ * @param[in] in_fd Standard input (the specification without a file)
+ * @param[in] out_fd Standard output
+ * @param[in] err_fd Standard error
+ * @param[in] is_bg Whether to run in the background (not supported)
+ */
+void dag_run(char **cmd_args, int nb_cmd_args, int in_fd, int out_fd, int err_fd, bool is_bg) {
+
+    dag_t *p_run;
+    long nb_workers = sysconf(_SC_NPROCESSORS_ONLN);
+    char *times;
+    char *value;
+    char *p_end;
+    int spec_fd;
+    int arg_i = 1;
+    int task_i;
+    int worker_i;
+    bool is_ok;
+
+    /* Get the number of tasks at a time (-j N or -jN) */
+    while ((arg_i < nb_cmd_args) && !strncmp(cmd_args[arg_i], "-j", 2)) {
+
+        value = cmd_args[arg_i][2] ? cmd_args[arg_i] + 2 : cmd_args[++arg_i];
+        nb_workers = value ? strtol(value, &p_end, 10) : 0;
+
+        if (!value || *p_end || (nb_workers < 1) || (nb_workers > DAG_MAX_WORKERS)) {
+
+            WRITE_ERROR(err_fd, "invalid number of jobs (1 to %u)", DAG_MAX_WORKERS);
+            return;
+        }
+
+        arg_i++;
+    }
+
+    if (nb_cmd_args - arg_i > 1) {
+
+        WRITE_ERROR(err_fd, "usage: dag [-j N] [file]");
+        return;
+    }
+
+    if (is_bg) {
+
+        WRITE_ERROR(err_fd, "cannot run in the background");
+        return;
+    }
+
+    /* Read the specification */
+    if (arg_i < nb_cmd_args) {
+
+        if ((spec_fd = open(cmd_args[arg_i], O_RDONLY | O_CLOEXEC)) == -1) {
+
+            WRITE_ERROR(err_fd, "%s: cannot open the file (%s)", cmd_args[arg_i], strerror(errno));
+            return;
+        }
+    }
+    else {
+
+        spec_fd = fcntl(in_fd, F_DUPFD_CLOEXEC, DAG_MIN_FD);
+    }
+
+    p_run = (dag_t *)calloc(1, sizeof(dag_t));
+
+    p_run->spec = __dag_read(spec_fd);
+    close(spec_fd);
+
+    cmd_tab_init(&p_run->expanded);
+    cmd_tab_init(&p_run->globbed);
+
+    p_run->null_fd = -1;
+    p_run->out_fd = fcntl(out_fd, F_DUPFD_CLOEXEC, DAG_MIN_FD);
+    p_run->err_fd = fcntl(err_fd, F_DUPFD_CLOEXEC, DAG_MIN_FD);
+
+    if (!p_run->spec) {
+
+        WRITE_ERROR(err_fd, "cannot read the specification (%s)", strerror(errno));
+        __dag_free(p_run, 0);
+        return;
+    }
+
+    /* Check the whole graph before any task is run */
+    if (!__dag_parse_spec(p_run) || !__dag_link(p_run)) {
+
+        __dag_free(p_run, 0);
+        return;
+    }
+
+    is_ok = __dag_parse_cmds(p_run);
+    times = __dag_load_times(p_run);
+
+    if (!is_ok || !__dag_rank(p_run)) {
+
+        free(times);
+        __dag_free(p_run, p_run->nb_tasks);
+        return;
+    }
+
+    /* The tasks do not share the input */
+    p_run->null_fd = __dag_high_fd(open("/dev/null", O_RDONLY | O_CLOEXEC));
+
+    /* Every worker can hold all the tasks in its queue */
+    p_run->nb_workers = (int)nb_workers;
+    p_run->workers = (dag_worker_t *)malloc(p_run->nb_workers * sizeof(dag_worker_t));
+
+    for (worker_i = 0; worker_i < p_run->nb_workers; worker_i++) {
+
+        p_run->workers[worker_i].queue = (int *)malloc(p_run->nb_tasks * sizeof(int));
+        p_run->workers[worker_i].nb_ready = 0;
+        p_run->workers[worker_i].task_i = -1;
+    }
+
+    /* Deal the tasks without dependencies to the workers */
+    for (worker_i = 0, task_i = 0; task_i < p_run->nb_tasks; task_i++) {
+
+        if (!p_run->tasks[task_i].nb_deps) {
+
+            __dag_push(p_run, worker_i, task_i);
+            worker_i = (worker_i + 1) % p_run->nb_workers;
+        }
+    }
+
+    /* An interruption before the run is not for it */
+    jobs_is_interrupted();
+
+    while (!__dag_step(p_run)) {
+
+        /* Wait for a task to complete */
+        jobs_wait(-1);
+
+        /* Interrupt the tasks (killed if interrupted again) */
+        if (jobs_is_interrupted()) {
+
+            __dag_stop(p_run, p_run->is_stopping ? SIGKILL : SIGINT);
+        }
+    }
+
+    if (p_run->nb_failed || p_run->nb_skipped || p_run->is_stopping) {
+
+        WRITE_ERROR(p_run->err_fd, "%d of %d tasks failed, %d skipped%s", p_run->nb_failed, p_run->nb_tasks,
+                    p_run->nb_skipped, p_run->is_stopping ? " (interrupted)" : "");
+    }
+
+    __dag_save_times(p_run, times);
+
+    free(times);
+    __dag_free(p_run, p_run->nb_tasks);
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <unistd.h>
 #include <stdlib.h>
 #include <sys/types.h>
@@ -7,189 +8,1820 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <spawn.h>
+#include <limits.h>
+#include <sys/mman.h>
 #include "executor.h"
 #include "jobs.h"
+#include "path_cache.h"
+#include "options.h"
+#include "filter.h"
+#include "builtin.h"
+#include "redirect.h"
+#include "vars.h"
+#include "scan.h"
 
-/* Returns the file descriptor to be used for reading by the ith command,
- * given fds has all the required number of pipe fds */
+/* Returns the file descriptor to be used for reading by the ith command
+ * (not the first), given fds has the pipe between every pair of commands */
 #define GET_RD_END_OF_CMD(fds, i)               \
     ({                                          \
         fds[(2 * ((i) - 1) + 0)];               \
     })
-/* Returns the file descriptor to be used for writing by the ith command,
- * given fds has all the required number of pipe fds */
+/* Returns the file descriptor to be used for writing by the ith command
+ * (not the last), given fds has the pipe between every pair of commands */
 #define GET_WR_END_OF_CMD(fds, i)               \
     ({                                          \
         fds[(2 * (i) + 1)];                     \
     })
 
-/* Opens the file in read mode */
-#define OPEN_RD(file)                           \
-    ({                                          \
-        open(file, O_RDONLY);                   \
+/* Number of file descriptors of a command which can be redirected (0 to
+ * 9), the ones opened by the shell for the redirections are above them */
+#define NB_REDIR_FDS (10)
+
+/* Bytes of ARG_MAX left unused by the batches of a command (the kernel
+ * counts a few more bytes than the arguments and the environment) */
+#define BATCH_ARG_SLACK (2048)
+
+/* Size counted against ARG_MAX for an argument */
+#define ARG_SIZE(arg)                                                       \
+    ({                                                                      \
+        strlen(arg) + 1 + sizeof(char *);                                   \
     })
 
-/* Opens the file in write mode */
-#define OPEN_WR(file)                                       \
-    ({                                                      \
-        open(file, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR);  \
+/* Opens the file in read mode (not inherited by the commands) */
+#define OPEN_RD(file)                                                       \
+    ({                                                                      \
+        open(file, O_RDONLY | O_CLOEXEC);                                   \
     })
 
-#define WRITE_ERROR_CMD(cmd)                                    \
-    ({                                                          \
-        fprintf(stderr, "kavach: `%s` command failed\n", cmd[0]); \
+/* Opens the file in write mode, truncated (not inherited by the commands) */
+#define OPEN_WR(file)                                                       \
+    ({                                                                      \
+        open(file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,                \
+             S_IRUSR | S_IWUSR);                                            \
     })
 
-/* Expands the command in order to pass it to execvp system call */
-#define EXEC(args)                              \
-    ({                                          \
-        execvp(args[0], args);                  \
+/* Opens the file in append mode, so that every write goes to the end of the
+ * file atomically (not inherited by the commands) */
+#define OPEN_APPEND(file)                                                   \
+    ({                                                                      \
+        open(file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,               \
+             S_IRUSR | S_IWUSR);                                            \
+    })
+
+#define WRITE_ERROR_CMD(cmd, err)                                           \
+    ({                                                                      \
+        fprintf(stderr, "kavach: `%s` command failed (%s)\n", cmd[0],      \
+                strerror(err));                                             \
+    })
+
+#define WRITE_ERROR_FILE(file, err)                                         \
+    ({                                                                      \
+        fprintf(stderr, "kavach: %s: cannot open the file (%s)\n", file,   \
+                strerror(err));                                             \
+    })
+
+/* Writes the error of a batch without the stdio (the batches are started by
+ * a forked copy of the shell, which may not take the locks of the threads) */
+#define WRITE_ERROR_BATCH(cmd)                                              \
+    ({                                                                      \
+        write(STDERR_FILENO, "kavach: `", 9);                               \
+        write(STDERR_FILENO, cmd[0], strlen(cmd[0]));                       \
+        write(STDERR_FILENO, "` batch failed\n", 15);                       \
+    })
+
+#define WRITE_ERROR_FD(fd)                                                  \
+    ({                                                                      \
+        fprintf(stderr, "kavach: %s: bad file descriptor\n", fd);          \
+    })
+
+/* Expands the command in order to pass it to posix_spawn (executing the
+ * path directly), the error of the redirections or the exec is returned to
+ * the parent */
+#define EXEC(p_pid, path, args, p_acts, p_attr)                             \
+    ({                                                                      \
+        posix_spawn(p_pid, path, p_acts, p_attr, args, vars_get_envp());    \
     })
 
 /**
- * @brief Executes the command present in the command table
- * @param[in] p_cmd_tab Pointer to the command table instance
+ * @brief File descriptors of a command, as the file descriptors of the shell
+ *        which they are set to
  */
-void executor_exec_cmd_tab(cmd_tab_t *p_cmd_tab) {
+typedef struct __executor_fds_t {
 
-    /* Index for traversing the ith command in the command table */
-    int cmd_i;
-    int cmd_j;
+    /* File descriptor of the shell for every file descriptor of the command
+     * (itself if not redirected, -1 if closed) */
+    int srcs[NB_REDIR_FDS];
 
-    /* Index for traversing the pipes */
-    int pipe_i;
+    /* File descriptors opened for the command, closed by the shell once the
+     * command is started */
+    int *opened;
 
-    /* Get the number of commands in the command table */
-    int nb_cmds = cmd_tab_get_nb_cmds(p_cmd_tab);
+    /* Number of file descriptors opened */
+    int nb_opened;
 
-    /* Allocate the memory for the pipes */
-    int *cmd_pipes = (int *)malloc(2 * (nb_cmds + 1) * sizeof(int));
+} executor_fds_t;
 
-    /* Variable to store the process id of the child */
-    pid_t child_pid;
+/**
+ * @brief Commands of a command table started by the executor, waited for
+ *        once they are all started
+ */
+typedef struct __executor_run_t {
 
-    /* Variable to store the process group for the commands */
-    pid_t group_pid = -1;
+    /* Filters run as threads of the shell (joined if not backgrounded) */
+    filter_t **filters;
 
-    /* Deinitialize any previously linked handlers */
-    jobs_signal_deinit();
+    /* Utilities run in the shell (joined if not backgrounded) */
+    utility_t **utilities;
+
+    /* Redirection threads joining multiple files */
+    redirect_t **redirects;
+
+    /* Number of redirection threads */
+    int nb_redirects;
+
+    /* Process group of the commands (-1 till a process is spawned, else the
+     * commands join it) */
+    pid_t group_pid;
 
-    /* For every pair of pipe file descriptor */
-    for (pipe_i = 0; pipe_i < (nb_cmds + 1); pipe_i++) {
+    /* Number of processes the job of the group can hold */
+    int max_procs;
 
-        /* Initialize the pipes */
-        pipe(cmd_pipes + 2 * pipe_i);
+    /* Exit status of the last command if it is not a process of the group
+     * (run by the shell, or not executed) */
+    int status;
+
+    /* Is the last command a process of the group (its status is the one of
+     * the group once it is waited for) */
+    bool is_last_proc;
+
+} executor_run_t;
+
+/**
+ * @brief Moves the file descriptor above the ones which can be redirected
+ * @param[in] fd File descriptor (closed if moved)
+ * @return File descriptor
+ */
+static int __executor_high_fd(int fd) {
+
+    int high_fd;
+
+    if ((fd == -1) || (fd >= NB_REDIR_FDS)) {
+
+        return fd;
     }
 
-    /* Increment the pointer to the pipes array */
-    cmd_pipes += 2;
+    high_fd = fcntl(fd, F_DUPFD_CLOEXEC, NB_REDIR_FDS);
+    close(fd);
 
-    /* Link the input of first pipe to standard input */
-    dup2(STDIN_FILENO, GET_RD_END_OF_CMD(cmd_pipes, 0));
+    return high_fd;
+}
 
-    /* Link the output of last pipe to standard output */
-    dup2(STDOUT_FILENO, GET_WR_END_OF_CMD(cmd_pipes, nb_cmds - 1));
+/**
+ * @brief Opens the redirection files of a file descriptor of the ith
+ *        command, more than one file is joined to a pipe by a redirection
+ *        thread (the inputs are read one after the other, the outputs all
+ *        get the whole output)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_i The ith command
+ * @param[in] redir_i First redirection of the files
+ * @param[in] nb_files Number of files
+ * @param[in] is_detached Whether the redirection thread is not joined
+ * @param[in,out] redirects Redirection threads (the new one is appended)
+ * @param[in,out] p_nb_redirects Number of redirection threads
+ * @return File descriptor for the command, -1 if a file cannot be opened
+ *         (the error is printed)
+ */
+static int __executor_open_files(
+        cmd_tab_t *p_cmd_tab,
+        int cmd_i,
+        int redir_i,
+        int nb_files,
+        bool is_detached,
+        redirect_t **redirects,
+        int *p_nb_redirects) {
 
-    /* For every command in the command table */
-    for (cmd_i = 0; cmd_i < nb_cmds; cmd_i++) {
+    /* Are the files inputs */
+    bool is_input = (cmd_tab_get_redir_type(p_cmd_tab, cmd_i, redir_i) == CMD_REDIR_IN);
 
-        /* Fork to create a copy process */
-        if (!(child_pid = fork())) {
+    /* File descriptors of the files */
+    int *file_fds;
 
-            /* If the process group id is not set */
-            if (group_pid == -1) {
+    /* Pipe joining the files to the command */
+    int join_fds[2];
 
-                /* Change the process group id of the child to itself */
-                setpgid(child_pid, 0);
-            }
-            else {
+    /* File descriptor for the command */
+    int fd;
 
-                /* Change the process group if the child to child leader */
-                setpgid(child_pid, group_pid);
+    /* File name */
+    char *file;
+
+    int file_i;
+
+    file_fds = (int *)malloc(nb_files * sizeof(int));
+
+    /* Open every file */
+    for (file_i = 0; file_i < nb_files; file_i++) {
+
+        file = cmd_tab_get_redir_arg(p_cmd_tab, cmd_i, redir_i + file_i);
+
+        switch (cmd_tab_get_redir_type(p_cmd_tab, cmd_i, redir_i + file_i)) {
+
+        case CMD_REDIR_IN:
+            file_fds[file_i] = OPEN_RD(file);
+            break;
+
+        case CMD_REDIR_APPEND:
+            file_fds[file_i] = OPEN_APPEND(file);
+            break;
+
+        default:
+            file_fds[file_i] = OPEN_WR(file);
+            break;
+        }
+
+        /* If the file cannot be opened, the command is not executed */
+        if (file_fds[file_i] == -1) {
+
+            WRITE_ERROR_FILE(file, errno);
+
+            while (file_i--) {
+
+                close(file_fds[file_i]);
             }
 
-            /* Prepare the input source for the ith command */
-            if (cmd_tab_is_input_redirected(p_cmd_tab, cmd_i)) {
+            free(file_fds);
+
+            return -1;
+        }
+    }
+
+    /* A single file is used directly */
+    if (nb_files == 1) {
+
+        fd = file_fds[0];
+    }
+    /* Else the files are spliced to a pipe (input) or the pipe is teed to
+     * the files (output) */
+    else {
+
+        pipe2(join_fds, O_CLOEXEC);
+
+        if (is_input) {
+
+            redirects[(*p_nb_redirects)++] = redirect_start(file_fds, nb_files, &join_fds[1], 1, is_detached);
+            fd = join_fds[0];
+        }
+        else {
+
+            redirects[(*p_nb_redirects)++] = redirect_start(&join_fds[0], 1, file_fds, nb_files, is_detached);
+            fd = join_fds[1];
+        }
+    }
+
+    free(file_fds);
+
+    /* Keep it clear of the file descriptors of the command */
+    return __executor_high_fd(fd);
+}
+
+/**
+ * @brief Applies the redirections of the ith command (in the order of the
+ *        command line) to its file descriptors, consecutive files of the
+ *        same file descriptor are joined
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_i The ith command
+ * @param[in] is_detached Whether the redirection threads are not joined
+ * @param[in] kept_fds File descriptors kept as given (a bit per file
+ *            descriptor), their redirections are left out
+ * @param[in,out] p_fds Pointer to the file descriptors of the command
+ * @param[in,out] redirects Redirection threads (the new ones are appended)
+ * @param[in,out] p_nb_redirects Number of redirection threads
+ * @return true If the redirections could be applied
+ * @return false Otherwise (the error is printed)
+ */
+static bool __executor_redirect_fds(
+        cmd_tab_t *p_cmd_tab,
+        int cmd_i,
+        bool is_detached,
+        unsigned int kept_fds,
+        executor_fds_t *p_fds,
+        redirect_t **redirects,
+        int *p_nb_redirects) {
+
+    /* Get the number of redirections */
+    int nb_redirs = cmd_tab_get_nb_redirs(p_cmd_tab, cmd_i);
+
+    /* Type, file descriptor and argument of the redirection */
+    cmd_redir_type_t type;
+    int fd;
+    char *arg;
+
+    /* Source file descriptor */
+    int src;
+    char *p_end;
+
+    int redir_i;
+    int end_i;
+
+    for (redir_i = 0; redir_i < nb_redirs; redir_i = end_i) {
+
+        type = cmd_tab_get_redir_type(p_cmd_tab, cmd_i, redir_i);
+        fd = cmd_tab_get_redir_fd(p_cmd_tab, cmd_i, redir_i);
+        arg = cmd_tab_get_redir_arg(p_cmd_tab, cmd_i, redir_i);
 
-                /* Duplicate the input file argument descriptor  */
-                dup2(OPEN_RD(cmd_tab_get_in_arg(p_cmd_tab, cmd_i)), STDIN_FILENO);
+        end_i = redir_i + 1;
+
+        if (fd >= NB_REDIR_FDS) {
+
+            fprintf(stderr, "kavach: %d: bad file descriptor\n", fd);
+
+            return false;
+        }
+
+        /* If the file descriptor is duplicated or closed */
+        if (type == CMD_REDIR_DUP) {
+
+            if (kept_fds & (1u << fd)) {
+
+                continue;
             }
-            else {
 
-                /* Duplicate the pipe file descriptor */
-                dup2(GET_RD_END_OF_CMD(cmd_pipes, cmd_i), STDIN_FILENO);
+            if (!strcmp(arg, "-")) {
+
+                p_fds->srcs[fd] = -1;
+
+                continue;
             }
 
-            /* Prepare the output source for the ith command */
-            if (cmd_tab_is_output_redirected(p_cmd_tab, cmd_i)) {
+            src = strtol(arg, &p_end, 10);
+
+            if (*p_end || (p_end == arg) || (src < 0) || (src >= NB_REDIR_FDS) ||
+                (fcntl(p_fds->srcs[src], F_GETFD) == -1)) {
 
-                /* Duplicate the output file argument descriptor  */
-                dup2(OPEN_WR(cmd_tab_get_out_arg(p_cmd_tab, cmd_i)), STDOUT_FILENO);
+                WRITE_ERROR_FD(arg);
+
+                return false;
             }
-            else {
 
-                /* Duplicate the pipe file descriptor */
-                dup2(GET_WR_END_OF_CMD(cmd_pipes, cmd_i), STDOUT_FILENO);
+            p_fds->srcs[fd] = p_fds->srcs[src];
+
+            continue;
+        }
+
+        /* Get the following files of the file descriptor (of the same
+         * direction), they are joined */
+        while ((end_i < nb_redirs) &&
+               (cmd_tab_get_redir_fd(p_cmd_tab, cmd_i, end_i) == fd) &&
+               (cmd_tab_get_redir_type(p_cmd_tab, cmd_i, end_i) != CMD_REDIR_DUP) &&
+               ((cmd_tab_get_redir_type(p_cmd_tab, cmd_i, end_i) == CMD_REDIR_IN) == (type == CMD_REDIR_IN))) {
+
+            end_i++;
+        }
+
+        /* The files of a file descriptor kept as given are not opened */
+        if (kept_fds & (1u << fd)) {
+
+            continue;
+        }
+
+        /* Open the files */
+        if ((src = __executor_open_files(p_cmd_tab, cmd_i, redir_i, end_i - redir_i,
+                                         is_detached, redirects, p_nb_redirects)) == -1) {
+
+            return false;
+        }
+
+        p_fds->opened[p_fds->nb_opened++] = src;
+        p_fds->srcs[fd] = src;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Makes sure that the file descriptors of the command can be set one
+ *        after the other (in increasing order), a source which would be
+ *        replaced before it is used is copied above them
+ * @param[in,out] p_fds Pointer to the file descriptors of the command
+ */
+static void __executor_order_fds(executor_fds_t *p_fds) {
+
+    int src;
+    int fd;
+
+    for (fd = 0; fd < NB_REDIR_FDS; fd++) {
+
+        src = p_fds->srcs[fd];
+
+        /* If the source is a lower file descriptor of the command which is
+         * set already */
+        if ((src != -1) && (src < fd) && (p_fds->srcs[src] != src)) {
+
+            p_fds->srcs[fd] = fcntl(src, F_DUPFD_CLOEXEC, NB_REDIR_FDS);
+            p_fds->opened[p_fds->nb_opened++] = p_fds->srcs[fd];
+        }
+    }
+}
+
+/**
+ * @brief Closes the file descriptors opened for the command
+ * @param[in,out] p_fds Pointer to the file descriptors of the command
+ */
+static void __executor_close_fds(executor_fds_t *p_fds) {
+
+    while (p_fds->nb_opened) {
+
+        close(p_fds->opened[--p_fds->nb_opened]);
+    }
+}
+
+/**
+ * @brief Returns the space of ARG_MAX left for the arguments of a command,
+ *        once the environment is given
+ * @return Size in bytes
+ */
+static size_t __executor_get_arg_max() {
+
+    long arg_max = sysconf(_SC_ARG_MAX);
+    size_t env_size = vars_get_envp_size() + BATCH_ARG_SLACK;
+
+    return ((arg_max > 0) && ((size_t)arg_max > env_size)) ? (size_t)arg_max - env_size : 0;
+}
+
+/**
+ * @brief Checks if the arguments of the ith command are too many for a
+ *        single exec
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_i The ith command
+ * @param[in] arg_max Space left for the arguments
+ * @return true if they exceed ARG_MAX
+ */
+static bool __executor_is_too_long(cmd_tab_t *p_cmd_tab, int cmd_i, size_t arg_max) {
+
+    char **cmd_args = cmd_tab_get_cmd_args(p_cmd_tab, cmd_i);
+    int nb_args = cmd_tab_get_nb_cmd_args(p_cmd_tab, cmd_i);
+    size_t size = sizeof(char *);
+    int arg_i;
+
+    /* The arguments are slices of the command line, so the line bounds
+     * them without counting them */
+    if ((size_t)p_cmd_tab->cmd_len + 1 + (nb_args + 1) * sizeof(char *) <= arg_max) {
+
+        return false;
+    }
+
+    for (arg_i = 0; arg_i < nb_args; arg_i++) {
+
+        size += ARG_SIZE(cmd_args[arg_i]);
+    }
+
+    return size > arg_max;
+}
+
+/**
+ * @brief Splits the arguments of the ith command into batches fitting
+ *        ARG_MAX, xargs like, every batch repeats the arguments before and
+ *        after the ones given out (the words of the expansions)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_i The ith command
+ * @param[in] arg_max Space left for the arguments
+ * @param[out] p_nb_batches Number of batches
+ * @return Arguments of the batches one after the other, each NULL
+ *         terminated (to be freed), NULL if an argument does not fit
+ */
+static char **__executor_get_batches(cmd_tab_t *p_cmd_tab, int cmd_i, size_t arg_max, int *p_nb_batches) {
+
+    char **cmd_args = cmd_tab_get_cmd_args(p_cmd_tab, cmd_i);
+    int nb_args = cmd_tab_get_nb_cmd_args(p_cmd_tab, cmd_i);
+    int batch_i = cmd_tab_get_batch_arg_i(p_cmd_tab, cmd_i);
+    int batch_end = batch_i + cmd_tab_get_nb_batch_args(p_cmd_tab, cmd_i);
+    char **batches;
+    int *firsts;
+    size_t fixed_size = sizeof(char *);
+    size_t size;
+    size_t arg_size;
+    int nb_batches = 0;
+    int max_batches = 4;
+    int nb_fixed = nb_args - (batch_end - batch_i);
+    int nb = 0;
+    int arg_i;
+    int start;
+
+    /* Size repeated by every batch */
+    for (arg_i = 0; arg_i < nb_args; arg_i++) {
+
+        if ((arg_i < batch_i) || (arg_i >= batch_end)) {
+
+            fixed_size += ARG_SIZE(cmd_args[arg_i]);
+        }
+    }
+
+    /* Nothing to give out */
+    if (batch_i == batch_end) {
+
+        return NULL;
+    }
+
+    /* Find the first argument of every batch, each taking the arguments
+     * while they fit */
+    firsts = (int *)malloc((max_batches + 1) * sizeof(int));
+
+    for (arg_i = batch_i, size = fixed_size; arg_i < batch_end; arg_i++) {
+
+        arg_size = ARG_SIZE(cmd_args[arg_i]);
+
+        if ((arg_i == batch_i) || (size + arg_size > arg_max)) {
+
+            /* An argument alone does not fit */
+            if (fixed_size + arg_size > arg_max) {
+
+                free(firsts);
+
+                return NULL;
             }
 
-            /* For each of the next command */
-            for (cmd_j = cmd_i + 1; cmd_j < nb_cmds; cmd_j++) {
+            if (nb_batches == max_batches) {
 
-                /* Close the read end */
-                close(GET_RD_END_OF_CMD(cmd_pipes, cmd_j));
-                /* Close the write end */
-                close(GET_WR_END_OF_CMD(cmd_pipes, cmd_j));
+                max_batches *= 2;
+                firsts = (int *)realloc(firsts, (max_batches + 1) * sizeof(int));
             }
 
-            /* Execute the requested command */
-            if (EXEC(cmd_tab_get_cmd_args(p_cmd_tab, cmd_i))) {
+            firsts[nb_batches++] = arg_i;
+            size = fixed_size;
+        }
+
+        size += arg_size;
+    }
+
+    firsts[nb_batches] = batch_end;
 
-                /* Print the error to the standard error */
-                WRITE_ERROR_CMD(cmd_tab_get_cmd_args(p_cmd_tab, cmd_i));
+    /* Build the argument vectors */
+    batches = (char **)malloc(((size_t)(batch_end - batch_i) + (size_t)nb_batches * (nb_fixed + 1)) * sizeof(char *));
 
-                /* Free the command table */
-                cmd_tab_deinit(p_cmd_tab);
+    for (start = 0; start < nb_batches; start++) {
 
-                /* Exit the child process */
-                exit(0);
-            }
+        memcpy(batches + nb, cmd_args, batch_i * sizeof(char *));
+        nb += batch_i;
+        memcpy(batches + nb, cmd_args + firsts[start], (firsts[start + 1] - firsts[start]) * sizeof(char *));
+        nb += firsts[start + 1] - firsts[start];
+        memcpy(batches + nb, cmd_args + batch_end, (nb_args - batch_end) * sizeof(char *));
+        nb += nb_args - batch_end;
+        batches[nb++] = NULL;
+    }
+
+    free(firsts);
+
+    *p_nb_batches = nb_batches;
+
+    return batches;
+}
+
+/**
+ * @brief Returns the exit status of the batches so far, the one of the last
+ *        batch which failed
+ * @param[in] status Exit status of the batches before
+ * @param[in] batch_status Status of the batch which ended (from waitpid)
+ * @return Exit status
+ */
+static int __executor_batch_status(int status, int batch_status) {
+
+    if (WIFSIGNALED(batch_status)) {
+
+        return 128 + WTERMSIG(batch_status);
+    }
+
+    return WEXITSTATUS(batch_status) ? WEXITSTATUS(batch_status) : status;
+}
+
+/**
+ * @brief Forks a copy of the shell standing for a command, in the process
+ *        group with the file descriptors of the command, the signals reset
+ *        and the ones of the shell closed
+ * @param[in] p_fds Pointer to the file descriptors of the command
+ * @param[in] group_pid Process group id (-1 for a new group)
+ * @return Process id of the copy in the shell (-1 if it cannot be forked),
+ *         0 in the copy
+ */
+static pid_t __executor_fork(executor_fds_t *p_fds, pid_t group_pid) {
+
+    /* Default action of a signal */
+    struct sigaction def_act;
+
+    /* Signals unblocked */
+    sigset_t mask_set;
+
+    /* Process id of the copy */
+    pid_t child_pid;
+
+    int fd;
+
+    if ((child_pid = fork())) {
+
+        /* Put the copy in the process group here as well, so that it is
+         * there before the shell waits for it */
+        if (child_pid != -1) {
+
+            setpgid(child_pid, (group_pid == -1) ? child_pid : group_pid);
         }
-        else {
 
-            /* If the process group id is not set */
-            if (group_pid == -1) {
+        return child_pid;
+    }
 
-                /* Update process group id to the current child process id */
-                group_pid = child_pid;
+    /* Put the copy in the process group */
+    setpgid(0, (group_pid == -1) ? 0 : group_pid);
 
-                /* Create a new job */
-                jobs_add_proc_grp(group_pid, p_cmd_tab);
-            }
+    /* Reset the signals which the shell handles or ignores, and unblock
+     * every signal */
+    memset(&def_act, 0, sizeof(def_act));
+    def_act.sa_handler = SIG_DFL;
+    sigaction(SIGINT, &def_act, NULL);
+    sigaction(SIGTSTP, &def_act, NULL);
+    sigaction(SIGTTOU, &def_act, NULL);
+    sigaction(SIGCHLD, &def_act, NULL);
+    sigaction(SIGPIPE, &def_act, NULL);
+    sigemptyset(&mask_set);
+    sigprocmask(SIG_SETMASK, &mask_set, NULL);
 
-            /* Update the process group id of the current child to the
-             * process group id */
-            setpgid(child_pid, group_pid);
+    /* Set the redirected file descriptors and close the ones of the shell
+     * (the pipes of the other commands are not to be held open) */
+    for (fd = 0; fd < NB_REDIR_FDS; fd++) {
 
-            /* Add the process to the job */
-            jobs_add_proc(group_pid, child_pid);
+        if (p_fds->srcs[fd] == -1) {
 
-            /* Close the read end of the current command */
-            close(GET_RD_END_OF_CMD(cmd_pipes, cmd_i));
-            /* Close the write end of the current command */
-            close(GET_WR_END_OF_CMD(cmd_pipes, cmd_i));
+            close(fd);
+        }
+        else if (p_fds->srcs[fd] != fd) {
+
+            dup2(p_fds->srcs[fd], fd);
         }
     }
 
-    /* If the process group is not backgrounded */
-    if (!cmd_tab_is_bg(p_cmd_tab)) {
+    close_range(NB_REDIR_FDS, ~0u, 0);
 
-        /* Initialize the job signals */
-        jobs_signal_init();
+    return 0;
+}
 
-        /* Make the child process group as the foreground group */
-        jobs_fg_proc_grp(group_pid);
+/**
+ * @brief Runs the batches of a command, at most width at once, in a forked
+ *        copy of the shell which stands for the command in the job (it is
+ *        waited, stopped and continued as a single process, the batches
+ *        being in its process group), only async-signal-safe calls are made
+ *        by the copy as the threads of the shell are not in it
+ * @param[in] path Path of the command
+ * @param[in] batches Arguments of the batches one after the other
+ * @param[in] nb_batches Number of batches
+ * @param[in] width Number of batches run at once
+ * @param[in] p_fds Pointer to the file descriptors of the command
+ * @param[in] group_pid Process group id (-1 for a new group)
+ * @return Process id of the copy, -1 if it cannot be forked
+ */
+static pid_t __executor_fork_batches(
+        const char *path,
+        char **batches,
+        int nb_batches,
+        long width,
+        executor_fds_t *p_fds,
+        pid_t group_pid) {
+
+    /* Process id of the copy and of a batch */
+    pid_t child_pid;
+    pid_t batch_pid;
+
+    /* Exit status of the copy, the one of the last failed batch */
+    int status = 0;
+    int batch_status;
+
+    /* Number of batches running */
+    long nb_running = 0;
+
+    /* Environment of the batches (built before the fork) */
+    char **envp = vars_get_envp();
+
+    int batch_i;
+
+    /* The batches join the process group of the copy */
+    if ((child_pid = __executor_fork(p_fds, group_pid))) {
+
+        return child_pid;
+    }
+
+    for (batch_i = 0; batch_i < nb_batches; batch_i++) {
+
+        /* Wait for a batch to end if the width is reached */
+        if ((nb_running == width) && (waitpid(-1, &batch_status, 0) > 0)) {
+
+            nb_running--;
+            status = __executor_batch_status(status, batch_status);
+        }
+
+        if (posix_spawn(&batch_pid, path, NULL, NULL, batches, envp)) {
+
+            WRITE_ERROR_BATCH(batches);
+            status = 126;
+        }
+        else {
+
+            nb_running++;
+        }
+
+        /* Go to the next batch */
+        while (*batches++);
+    }
+
+    /* Wait for the last batches */
+    while (waitpid(-1, &batch_status, 0) > 0) {
+
+        status = __executor_batch_status(status, batch_status);
     }
 
-    /* Free the memory allocated to the pipes */
-    free(cmd_pipes -= 2);
+    _exit(status);
+}
+
+/**
+ * @brief Spawns the ith command of the command table in the process group,
+ *        with its file descriptors set to the given ones
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_i The ith command
+ * @param[in] p_fds Pointer to the file descriptors of the command
+ * @param[in] group_pid Process group of the command (-1 to lead a new one)
+ * @param[out] p_status Exit status if the command could not be executed
+ *             (127 if it is not found, else 126)
+ * @return Process id of the command, -1 if it could not be executed
+ */
+static pid_t __executor_spawn(
+        cmd_tab_t *p_cmd_tab,
+        int cmd_i,
+        executor_fds_t *p_fds,
+        pid_t group_pid,
+        int *p_status) {
+
+    /* File actions performed in the child before the exec */
+    posix_spawn_file_actions_t acts;
+
+    /* Attributes of the child */
+    posix_spawnattr_t attr;
+
+    /* Signals restored to their default actions in the child */
+    sigset_t def_set;
+
+    /* Signals blocked in the child */
+    sigset_t mask_set;
+
+    /* Process id of the child */
+    pid_t child_pid;
+
+    /* Error of the spawn */
+    int err;
+
+    /* File descriptor of the command */
+    int fd;
+
+    /* Command arguments */
+    char **cmd_args = cmd_tab_get_cmd_args(p_cmd_tab, cmd_i);
+
+    /* Path of the command */
+    char path[PATH_MAX];
+
+    /* Arguments of the batches of the command, their number and the number
+     * run at once */
+    char **batches;
+    int nb_batches;
+    long width;
+
+    /* Space of ARG_MAX left for the arguments */
+    size_t arg_max;
+
+    /* Get the path of the command (not searched again if cached) */
+    if (!path_cache_lookup(cmd_args[0], path, sizeof(path))) {
+
+        /* Report a missing command without spawning */
+        WRITE_ERROR_CMD(cmd_args, ENOENT);
+        *p_status = 127;
+
+        return -1;
+    }
+
+    /* Split the arguments into batches if they exceed ARG_MAX (if the
+     * batches are enabled, else the exec fails with E2BIG) */
+    if ((width = options_get(OPTION_BATCH_WIDTH)) &&
+        __executor_is_too_long(p_cmd_tab, cmd_i, arg_max = __executor_get_arg_max())) {
+
+        if (!(batches = __executor_get_batches(p_cmd_tab, cmd_i, arg_max, &nb_batches))) {
+
+            WRITE_ERROR_CMD(cmd_args, E2BIG);
+            *p_status = 126;
+
+            return -1;
+        }
+
+        if ((child_pid = __executor_fork_batches(path, batches, nb_batches, width, p_fds, group_pid)) == -1) {
+
+            WRITE_ERROR_CMD(cmd_args, errno);
+            *p_status = 126;
+        }
+
+        free(batches);
+
+        return child_pid;
+    }
+
+    posix_spawn_file_actions_init(&acts);
+    posix_spawnattr_init(&attr);
+
+    /* Put the child in the process group (a new one led by itself if the
+     * group is not set) */
+    posix_spawnattr_setpgroup(&attr, (group_pid == -1) ? 0 : group_pid);
+
+    /* Reset the signals which the shell handles or ignores, and unblock
+     * every signal */
+    sigemptyset(&def_set);
+    sigaddset(&def_set, SIGINT);
+    sigaddset(&def_set, SIGTSTP);
+    sigaddset(&def_set, SIGTTOU);
+    sigaddset(&def_set, SIGCHLD);
+    sigaddset(&def_set, SIGPIPE);
+    sigemptyset(&mask_set);
+    posix_spawnattr_setsigdefault(&attr, &def_set);
+    posix_spawnattr_setsigmask(&attr, &mask_set);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP |
+                                    POSIX_SPAWN_SETSIGDEF |
+                                    POSIX_SPAWN_SETSIGMASK);
+
+    /* Set the redirected file descriptors (the ones the shell opens are
+     * close-on-exec, so the command keeps only these and the ones kept open
+     * by the exec builtin) */
+    for (fd = 0; fd < NB_REDIR_FDS; fd++) {
+
+        if (p_fds->srcs[fd] == -1) {
+
+            posix_spawn_file_actions_addclose(&acts, fd);
+        }
+        else if (p_fds->srcs[fd] != fd) {
+
+            posix_spawn_file_actions_adddup2(&acts, p_fds->srcs[fd], fd);
+        }
+    }
+
+    /* Execute the requested command */
+    if ((err = EXEC(&child_pid, path, cmd_args, &acts, &attr))) {
+
+        /* Print the error to the standard error */
+        WRITE_ERROR_CMD(cmd_args, err);
+
+        child_pid = -1;
+        *p_status = (err == ENOENT) ? 127 : 126;
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&acts);
+
+    return child_pid;
+}
+
+/**
+ * @brief Starts the ith command of the command table as a filter thread of
+ *        the shell, on duplicates of its standard input and output
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_i The ith command
+ * @param[in] p_fds Pointer to the file descriptors of the command
+ * @param[in] func Function of the filter
+ * @param[out] p_status Exit status if the filter could not be started (its
+ *             standard input or output closed)
+ * @return Pointer to the filter, NULL if it could not be started
+ */
+static filter_t *__executor_start_filter(
+        cmd_tab_t *p_cmd_tab,
+        int cmd_i,
+        executor_fds_t *p_fds,
+        filter_func_t func,
+        int *p_status) {
+
+    /* Command arguments */
+    char **cmd_args = cmd_tab_get_cmd_args(p_cmd_tab, cmd_i);
+
+    /* Filter of the command */
+    filter_t *p_filter;
+
+    /* Duplicates of the standard input and output */
+    int in_fd = fcntl(p_fds->srcs[STDIN_FILENO], F_DUPFD_CLOEXEC, 0);
+    int out_fd = fcntl(p_fds->srcs[STDOUT_FILENO], F_DUPFD_CLOEXEC, 0);
+
+    /* A closed standard input or output (<&- or >&-) fails as the reads or
+     * the writes of a command would, the filter cannot wait for it */
+    if ((in_fd == -1) || (out_fd == -1)) {
+
+        WRITE_ERROR_CMD(cmd_args, errno);
+        *p_status = 1;
+
+        if (in_fd != -1) {
+
+            close(in_fd);
+        }
+
+        if (out_fd != -1) {
+
+            close(out_fd);
+        }
+
+        return NULL;
+    }
+
+    /* Run the filter on its own thread (freed by itself if backgrounded),
+     * it owns the duplicates */
+    p_filter = filter_create(func, cmd_args, cmd_tab_get_nb_cmd_args(p_cmd_tab, cmd_i));
+    filter_start(p_filter, in_fd, out_fd, cmd_tab_is_bg(p_cmd_tab));
+
+    return p_filter;
+}
+
+/**
+ * @brief Runs the ith command of the command table as a filter in a forked
+ *        copy of the shell, in the process group (a filter reading the
+ *        terminal is run so when the group is given the terminal, a thread
+ *        of the shell cannot read it then)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_i The ith command
+ * @param[in] p_fds Pointer to the file descriptors of the command
+ * @param[in] func Function of the filter
+ * @param[in] group_pid Process group of the command (-1 to lead a new one)
+ * @return Process id of the copy, -1 if it cannot be forked
+ */
+static pid_t __executor_fork_filter(
+        cmd_tab_t *p_cmd_tab,
+        int cmd_i,
+        executor_fds_t *p_fds,
+        filter_func_t func,
+        pid_t group_pid) {
+
+    /* Command arguments */
+    char **cmd_args = cmd_tab_get_cmd_args(p_cmd_tab, cmd_i);
+
+    /* Process id of the copy */
+    pid_t child_pid;
+
+    if ((child_pid = __executor_fork(p_fds, group_pid))) {
+
+        if (child_pid == -1) {
+
+            WRITE_ERROR_CMD(cmd_args, errno);
+        }
+
+        return child_pid;
+    }
+
+    /* Run the filter on the only thread of the copy */
+    _exit(filter_run(filter_create(func, cmd_args, cmd_tab_get_nb_cmd_args(p_cmd_tab, cmd_i)),
+                     STDIN_FILENO, STDOUT_FILENO));
+}
+
+/**
+ * @brief Runs the ith command of the command table as a utility of the
+ *        shell, on the calling thread if it is alone in the foreground, else
+ *        on its own thread with duplicates of its standard output and error
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_i The ith command
+ * @param[in] p_fds Pointer to the file descriptors of the command
+ * @param[in] func Function of the utility
+ * @param[out] p_status Exit status of the utility if it is done already
+ * @return Pointer to the utility, NULL if it is done already
+ */
+static utility_t *__executor_start_utility(
+        cmd_tab_t *p_cmd_tab,
+        int cmd_i,
+        executor_fds_t *p_fds,
+        utility_func_t func,
+        int *p_status) {
+
+    /* Command arguments */
+    char **cmd_args = cmd_tab_get_cmd_args(p_cmd_tab, cmd_i);
+
+    /* Command arguments number */
+    int nb_cmd_args = cmd_tab_get_nb_cmd_args(p_cmd_tab, cmd_i);
+
+    /* Utility of the command */
+    utility_t *p_utility;
+
+    /* A single foreground command needs no thread */
+    if ((cmd_tab_get_nb_cmds(p_cmd_tab) == 1) && !cmd_tab_is_bg(p_cmd_tab)) {
+
+        *p_status = func(cmd_args, nb_cmd_args, p_fds->srcs[STDOUT_FILENO], p_fds->srcs[STDERR_FILENO]);
+
+        return NULL;
+    }
+
+    /* Run the utility on its own thread (freed by itself if backgrounded),
+     * it owns the duplicates */
+    p_utility = utility_create(func, cmd_args, nb_cmd_args);
+    utility_start(p_utility,
+                  fcntl(p_fds->srcs[STDOUT_FILENO], F_DUPFD_CLOEXEC, 0),
+                  fcntl(p_fds->srcs[STDERR_FILENO], F_DUPFD_CLOEXEC, 0),
+                  cmd_tab_is_bg(p_cmd_tab));
+
+    return p_utility;
+}
+
+/**
+ * @brief Runs the last command of the command table as a built-in stage on
+ *        the main thread, till it is done (it waits for jobs of its own)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_i The ith command
+ * @param[in] p_fds Pointer to the file descriptors of the command
+ * @param[in] stage Function of the stage
+ */
+static void __executor_run_stage(
+        cmd_tab_t *p_cmd_tab,
+        int cmd_i,
+        executor_fds_t *p_fds,
+        built_in_stage_t stage) {
+
+    /* Command arguments */
+    char **cmd_args = cmd_tab_get_cmd_args(p_cmd_tab, cmd_i);
+
+    /* The stage is the last one, the main thread is free once the others
+     * are started */
+    if (cmd_i != cmd_tab_get_nb_cmds(p_cmd_tab) - 1) {
+
+        fprintf(stderr, "kavach: %s: must be the last command of the pipeline\n", cmd_args[0]);
+
+        return;
+    }
+
+    /* The job table is used with the job signals set */
+    jobs_signal_init();
+
+    stage(cmd_args,
+          cmd_tab_get_nb_cmd_args(p_cmd_tab, cmd_i),
+          p_fds->srcs[STDIN_FILENO],
+          p_fds->srcs[STDOUT_FILENO],
+          p_fds->srcs[STDERR_FILENO],
+          cmd_tab_is_bg(p_cmd_tab));
+
+    /* The next commands are started with the default handlers */
+    jobs_signal_deinit();
+}
+
+/**
+ * @brief Starts the commands of the command table, with the given standard
+ *        file descriptors for the pipeline
+ * @param[in,out] p_run Pointer to the run (its process group and its number
+ *                of processes set by the caller, the status of the last
+ *                command set if it is not a process)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] in_fd Standard input of the first command
+ * @param[in] out_fd Standard output of the last command
+ * @param[in] err_fd Standard error of the commands
+ * @param[in] are_std_kept Whether the redirections of the input of the first
+ *            command and of the output of the last are left out (applied by
+ *            the caller)
+ */
+static void __executor_start(
+        executor_run_t *p_run,
+        cmd_tab_t *p_cmd_tab,
+        int in_fd,
+        int out_fd,
+        int err_fd,
+        bool are_std_kept) {
+
+    /* Index for traversing the ith command in the command table */
+    int cmd_i;
+
+    /* Index for traversing the pipes */
+    int pipe_i;
+
+    /* Get the number of commands in the command table */
+    int nb_cmds = cmd_tab_get_nb_cmds(p_cmd_tab);
+
+    /* Allocate the memory for the pipes (one between every pair) */
+    int *cmd_pipes = (int *)malloc(2 * nb_cmds * sizeof(int));
+
+    /* Capacity of the pipes */
+    long pipe_size = options_get(OPTION_PIPE_SIZE);
+
+    /* Built-in of the command */
+    const built_in_t *p_built_in;
+
+    /* Number of redirections of the commands (in total and at most) */
+    int nb_redirs = 0;
+    int max_redirs = 0;
+
+    /* File descriptors of the command */
+    executor_fds_t fds;
+
+    /* File descriptors of the command kept as given */
+    unsigned int kept_fds;
+
+    /* Are the redirections applied */
+    bool is_redir_ok;
+
+    /* Is a command spawned as a process (its group is given the terminal
+     * if the pipeline is in the foreground) */
+    bool has_procs = false;
+
+    /* Index for traversing the file descriptors */
+    int fd;
+
+    /* Variable to store the process id of the child */
+    pid_t child_pid;
+
+    /* Get the number of redirections (every one may need a thread or a file
+     * descriptor), and whether a command is not run by the shell */
+    for (cmd_i = 0; cmd_i < nb_cmds; cmd_i++) {
+
+        p_built_in = built_in_lookup(cmd_tab_get_cmd_args(p_cmd_tab, cmd_i)[0]);
+
+        if (!p_built_in || !(p_built_in->flags & (BUILT_IN_FILTER | BUILT_IN_PIPELINE | BUILT_IN_STAGE))) {
+
+            has_procs = true;
+        }
+
+        nb_redirs += cmd_tab_get_nb_redirs(p_cmd_tab, cmd_i);
+
+        if (cmd_tab_get_nb_redirs(p_cmd_tab, cmd_i) > max_redirs) {
+
+            max_redirs = cmd_tab_get_nb_redirs(p_cmd_tab, cmd_i);
+        }
+    }
+
+    p_run->filters = (filter_t **)calloc(nb_cmds, sizeof(filter_t *));
+    p_run->utilities = (utility_t **)calloc(nb_cmds, sizeof(utility_t *));
+    p_run->redirects = (redirect_t **)malloc((nb_redirs + 1) * sizeof(redirect_t *));
+    p_run->nb_redirects = 0;
+
+    fds.opened = (int *)malloc((max_redirs + NB_REDIR_FDS) * sizeof(int));
+    fds.nb_opened = 0;
+
+    /* Deinitialize any previously linked handlers */
+    jobs_signal_deinit();
+
+    /* Drop the cached command paths if PATH or its directories changed */
+    path_cache_revalidate();
+
+    /* For every pair of consecutive commands */
+    for (pipe_i = 0; pipe_i < (nb_cmds - 1); pipe_i++) {
+
+        /* Initialize the pipe, not inherited by the commands */
+        pipe2(cmd_pipes + 2 * pipe_i, O_CLOEXEC);
+
+        /* Set the capacity of the pipe if requested */
+        if (pipe_size > 0) {
+
+            fcntl(cmd_pipes[2 * pipe_i], F_SETPIPE_SZ, (int)pipe_size);
+        }
+    }
+
+    /* For every command in the command table */
+    for (cmd_i = 0; cmd_i < nb_cmds; cmd_i++) {
+
+        /* The command gets the file descriptors of the shell, and the pipes
+         * as its standard input and output */
+        for (fd = 0; fd < NB_REDIR_FDS; fd++) {
+
+            fds.srcs[fd] = fd;
+        }
+
+        fds.srcs[STDERR_FILENO] = err_fd;
+
+        if (cmd_i > 0) {
+            fds.srcs[STDIN_FILENO] = GET_RD_END_OF_CMD(cmd_pipes, cmd_i);
+        }
+        else {
+            fds.srcs[STDIN_FILENO] = in_fd;
+        }
+        if (cmd_i < nb_cmds - 1) {
+            fds.srcs[STDOUT_FILENO] = GET_WR_END_OF_CMD(cmd_pipes, cmd_i);
+        }
+        else {
+            fds.srcs[STDOUT_FILENO] = out_fd;
+        }
+
+        /* The ends of the pipeline may be kept as given */
+        kept_fds = 0;
+
+        if (are_std_kept && (cmd_i == 0)) {
+            kept_fds |= 1u << STDIN_FILENO;
+        }
+        if (are_std_kept && (cmd_i == nb_cmds - 1)) {
+            kept_fds |= 1u << STDOUT_FILENO;
+        }
+
+        /* Apply the redirections of the command over them */
+        is_redir_ok = __executor_redirect_fds(p_cmd_tab, cmd_i, cmd_tab_is_bg(p_cmd_tab), kept_fds,
+                                              &fds, p_run->redirects, &p_run->nb_redirects);
+
+        __executor_order_fds(&fds);
+
+        /* Get the built-in of the command (a filter is one as well) */
+        p_built_in = built_in_lookup(cmd_tab_get_cmd_args(p_cmd_tab, cmd_i)[0]);
+
+        /* The status of a thread of the shell is set once it is joined */
+        p_run->status = 0;
+
+        /* If the files could not be opened, the command is skipped (the
+         * error is printed already) */
+        if (!is_redir_ok) {
+
+            child_pid = -1;
+            p_run->status = 1;
+        }
+        /* If the command is a filter reading the terminal, which the
+         * process group of the foreground pipeline takes, run it in the
+         * group */
+        else if (p_built_in && (p_built_in->flags & BUILT_IN_FILTER) &&
+                 has_procs && !cmd_tab_is_bg(p_cmd_tab) && isatty(fds.srcs[STDIN_FILENO])) {
+
+            child_pid = __executor_fork_filter(p_cmd_tab, cmd_i, &fds, p_built_in->filter, p_run->group_pid);
+            p_run->status = (child_pid == -1) ? 126 : 0;
+        }
+        /* If the command is a filter, run it in the shell without a process */
+        else if (p_built_in && (p_built_in->flags & BUILT_IN_FILTER)) {
+
+            p_run->filters[cmd_i] = __executor_start_filter(p_cmd_tab, cmd_i, &fds, p_built_in->filter,
+                                                            &p_run->status);
+            child_pid = -1;
+        }
+        /* If the command is a utility, run it in the shell as well */
+        else if (p_built_in && (p_built_in->flags & BUILT_IN_PIPELINE)) {
+
+            p_run->utilities[cmd_i] = __executor_start_utility(p_cmd_tab, cmd_i, &fds, p_built_in->utility,
+                                                               &p_run->status);
+            child_pid = -1;
+        }
+        /* If the command is a built-in stage, run it on the main thread */
+        else if (p_built_in && (p_built_in->flags & BUILT_IN_STAGE)) {
+
+            __executor_run_stage(p_cmd_tab, cmd_i, &fds, p_built_in->stage);
+            child_pid = -1;
+        }
+        else {
+
+            /* Spawn the command in the process group */
+            child_pid = __executor_spawn(p_cmd_tab, cmd_i, &fds, p_run->group_pid, &p_run->status);
+        }
+
+        /* Close the redirection files (the command has its own copies) */
+        __executor_close_fds(&fds);
+
+        /* If the command could be executed */
+        if (child_pid != -1) {
+
+            /* If the process group id is not set */
+            if (p_run->group_pid == -1) {
+
+                /* Update process group id to the current child process id */
+                p_run->group_pid = child_pid;
+
+                /* Create a new job */
+                jobs_add_proc_grp(p_run->group_pid, p_cmd_tab, p_run->max_procs);
+            }
+
+            /* Add the process to the job */
+            jobs_add_proc(p_run->group_pid, child_pid);
+        }
+
+        p_run->is_last_proc = (child_pid != -1);
+
+        /* Close the read end of the current command */
+        if (cmd_i > 0) {
+            close(GET_RD_END_OF_CMD(cmd_pipes, cmd_i));
+        }
+        /* Close the write end of the current command */
+        if (cmd_i < nb_cmds - 1) {
+            close(GET_WR_END_OF_CMD(cmd_pipes, cmd_i));
+        }
+    }
+
+    /* Free the memory allocated to the file descriptors and the pipes */
+    free(fds.opened);
+    free(cmd_pipes);
+}
+
+/**
+ * @brief Waits for the filters of a foreground pipeline through the event
+ *        loop of the jobs, they are all stopped if the shell is interrupted
+ *        or suspended meanwhile (^C or ^Z while the shell has the terminal,
+ *        a thread cannot be suspended)
+ * @param[in] p_run Pointer to the run
+ * @param[in] nb_cmds Number of commands
+ * @param[in] is_stopping Whether the filters are stopped at once (the
+ *            process group of the pipeline was interrupted or suspended)
+ */
+static void __executor_wait_filters(executor_run_t *p_run, int nb_cmds, bool is_stopping) {
+
+    /* Is the shell interrupted or suspended */
+    bool is_interrupted;
+    bool is_suspended;
+
+    int cmd_i;
+    int stop_i;
+
+    for (cmd_i = 0; cmd_i < nb_cmds; cmd_i++) {
+
+        if (!p_run->filters[cmd_i]) {
+
+            continue;
+        }
+
+        /* Handle the events till the filter is done */
+        while (is_stopping || !jobs_wait(p_run->filters[cmd_i]->done_fd)) {
+
+            is_interrupted = jobs_is_interrupted();
+            is_suspended = jobs_is_suspended();
+
+            /* Stop the last filters first, so that they do not take the
+             * end of the input of the first ones as their own */
+            if (is_stopping || is_interrupted || is_suspended) {
+
+                for (stop_i = nb_cmds - 1; stop_i >= 0; stop_i--) {
+
+                    if (p_run->filters[stop_i]) {
+
+                        filter_stop(p_run->filters[stop_i]);
+                    }
+                }
+
+                is_stopping = false;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Waits for the commands started (the threads of the shell are joined
+ *        unless backgrounded) and frees the run
+ * @param[in,out] p_run Pointer to the run (the status of the last command
+ *                set if it is a thread of the shell)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] do_wait Whether to wait for the processes of a foreground
+ *            pipeline, else they are left as a job
+ */
+static void __executor_finish(executor_run_t *p_run, cmd_tab_t *p_cmd_tab, bool do_wait) {
+
+    int cmd_i;
+
+    /* Was the process group interrupted or suspended */
+    bool is_stopping = false;
+
+    /* Index of the last command */
+    int last_i = cmd_tab_get_nb_cmds(p_cmd_tab) - 1;
+
+    /* Exit status of a thread */
+    int status;
+
+    /* If the process group is not backgrounded (and a command could be
+     * executed) */
+    if (do_wait && !cmd_tab_is_bg(p_cmd_tab) && (p_run->group_pid != -1)) {
+
+        /* Initialize the job signals */
+        jobs_signal_init();
+
+        /* Make the child process group as the foreground group */
+        is_stopping = jobs_fg_proc_grp(p_run->group_pid, &status);
+
+        if (p_run->is_last_proc) {
+
+            p_run->status = status;
+        }
+    }
+
+    /* The filters of a foreground pipeline are stopped with the process
+     * group, or if the shell is interrupted while it waits for them */
+    if (do_wait && !cmd_tab_is_bg(p_cmd_tab)) {
+
+        __executor_wait_filters(p_run, cmd_tab_get_nb_cmds(p_cmd_tab), is_stopping);
+    }
+
+    /* Wait for the filters, the utilities and the redirections of a
+     * foreground pipeline */
+    if (!cmd_tab_is_bg(p_cmd_tab)) {
+
+        for (cmd_i = 0; cmd_i < cmd_tab_get_nb_cmds(p_cmd_tab); cmd_i++) {
+
+            if (p_run->filters[cmd_i]) {
+
+                status = filter_join(p_run->filters[cmd_i]);
+                p_run->status = (cmd_i == last_i) ? status : p_run->status;
+            }
+
+            if (p_run->utilities[cmd_i]) {
+
+                status = utility_join(p_run->utilities[cmd_i]);
+                p_run->status = (cmd_i == last_i) ? status : p_run->status;
+            }
+        }
+
+        while (p_run->nb_redirects) {
+
+            redirect_join(p_run->redirects[--p_run->nb_redirects]);
+        }
+    }
+
+    /* Free the memory allocated to the threads */
+    free(p_run->redirects);
+    free(p_run->utilities);
+    free(p_run->filters);
+}
+
+/**
+ * @brief Executes the command present in the command table
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @return Exit status of the last command (0 if it is backgrounded)
+ */
+int executor_exec_cmd_tab(cmd_tab_t *p_cmd_tab) {
+
+    executor_run_t run;
+
+    run.group_pid = -1;
+    run.max_procs = cmd_tab_get_nb_cmds(p_cmd_tab);
+
+    __executor_start(&run, p_cmd_tab, STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO, false);
+    __executor_finish(&run, p_cmd_tab, true);
+
+    return cmd_tab_is_bg(p_cmd_tab) ? 0 : run.status;
+}
+
+/**
+ * @brief Starts the commands of the command table without waiting for them,
+ *        their processes are left as a job (the threads of the shell are
+ *        joined unless backgrounded)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] in_fd Standard input of the first command
+ * @param[in] out_fd Standard output of the last command
+ * @param[in] err_fd Standard error of the commands
+ * @param[out] p_status Exit status of the commands if no process is spawned
+ *             (the status of the last one, 1 if its redirections failed,
+ *             127 or 126 if it could not be executed), NULL if not needed
+ * @return Process group id of the job (-1 if no process is spawned)
+ */
+pid_t executor_start_cmd_tab(cmd_tab_t *p_cmd_tab, int in_fd, int out_fd, int err_fd, int *p_status) {
+
+    executor_run_t run;
+
+    run.group_pid = -1;
+    run.max_procs = cmd_tab_get_nb_cmds(p_cmd_tab);
+
+    __executor_start(&run, p_cmd_tab, in_fd, out_fd, err_fd, false);
+    __executor_finish(&run, p_cmd_tab, false);
+
+    if (p_status) {
+
+        *p_status = run.status;
+    }
+
+    return run.group_pid;
+}
+
+/**
+ * @brief Checks that the copies of the pipeline can be given the parts of
+ *        its input file, the input file of the first command is its only
+ *        redirection of the standard input, and no other file is opened by
+ *        the commands except the output files of the last one (the files
+ *        would be opened once per copy)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @return Index of the redirection of the input file (of the first
+ *         command), -1 if the pipeline cannot be split
+ */
+static int __executor_get_split_redir(cmd_tab_t *p_cmd_tab) {
+
+    /* Index of the last command */
+    int last_i = cmd_tab_get_nb_cmds(p_cmd_tab) - 1;
+
+    /* Index of the redirection of the input file */
+    int in_redir_i = -1;
+
+    /* Is the standard output of the last command duplicated already */
+    bool is_out_duped = false;
+
+    /* Built-in of the last command */
+    const built_in_t *p_built_in;
+
+    cmd_redir_type_t type;
+    int fd;
+    int cmd_i;
+    int redir_i;
+
+    /* A stage runs on the main thread, the copies would run one after the
+     * other */
+    p_built_in = built_in_lookup(cmd_tab_get_cmd_args(p_cmd_tab, last_i)[0]);
+
+    if (p_built_in && (p_built_in->flags & BUILT_IN_STAGE)) {
+
+        return -1;
+    }
+
+    for (cmd_i = 0; cmd_i <= last_i; cmd_i++) {
+
+        for (redir_i = 0; redir_i < cmd_tab_get_nb_redirs(p_cmd_tab, cmd_i); redir_i++) {
+
+            type = cmd_tab_get_redir_type(p_cmd_tab, cmd_i, redir_i);
+            fd = cmd_tab_get_redir_fd(p_cmd_tab, cmd_i, redir_i);
+
+            /* The standard input of the first command is the input file */
+            if ((cmd_i == 0) && (fd == STDIN_FILENO)) {
+
+                if ((type != CMD_REDIR_IN) || (in_redir_i != -1)) {
+
+                    return -1;
+                }
+
+                in_redir_i = redir_i;
+            }
+            /* The output files of the last command are opened once (the
+             * duplicates of the output made before are not kept) */
+            else if ((cmd_i == last_i) && (fd == STDOUT_FILENO)) {
+
+                if (is_out_duped) {
+
+                    return -1;
+                }
+            }
+            else if (type != CMD_REDIR_DUP) {
+
+                return -1;
+            }
+            else if ((cmd_i == last_i) && !strcmp(cmd_tab_get_redir_arg(p_cmd_tab, cmd_i, redir_i), "1")) {
+
+                is_out_duped = true;
+            }
+        }
+    }
+
+    return in_redir_i;
+}
+
+/**
+ * @brief Executes copies of the pipeline in parallel, each one given a part
+ *        of the input file of the first command (split after a newline),
+ *        the output of the copies is written in the order of the parts
+ *        (the pipeline is executed as is if it cannot be split)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] nb_copies Number of copies
+ */
+void executor_split_cmd_tab(cmd_tab_t *p_cmd_tab, int nb_copies) {
+
+    /* Runs of the copies */
+    executor_run_t *runs;
+
+    /* Redirection threads feeding the parts to the copies */
+    redirect_t **feeders;
+
+    /* Output files of the copies (but the first), written in order once
+     * they are done */
+    int *out_fds;
+
+    /* File descriptors of the output of the pipeline */
+    executor_fds_t out;
+
+    /* Redirection threads of the output of the pipeline */
+    redirect_t **out_redirects;
+    int nb_out_redirects = 0;
+
+    /* Output of the pipeline */
+    int dest_fd;
+
+    /* Input file, its size and its mapping */
+    int in_redir_i;
+    int in_fd;
+    struct stat in_stat;
+    char *map;
+
+    /* Bounds of the part of a copy */
+    size_t start;
+    size_t end;
+    const char *p_nl;
+
+    /* Pipe feeding a part to a copy */
+    int part_pipe[2];
+
+    /* Process group of the copies */
+    pid_t group_pid = -1;
+
+    long pipe_size = options_get(OPTION_PIPE_SIZE);
+    int nb_redirs;
+    int nb_runs = 0;
+    int copy_i;
+    int fd;
+
+    /* A backgrounded pipeline is not split (its output could not be
+     * ordered without the shell waiting) */
+    if ((nb_copies <= 1) || cmd_tab_is_bg(p_cmd_tab) ||
+        ((in_redir_i = __executor_get_split_redir(p_cmd_tab)) == -1)) {
+
+        executor_exec_cmd_tab(p_cmd_tab);
+
+        return;
+    }
+
+    /* Map the input file */
+    if ((in_fd = OPEN_RD(cmd_tab_get_redir_arg(p_cmd_tab, 0, in_redir_i))) == -1) {
+
+        WRITE_ERROR_FILE(cmd_tab_get_redir_arg(p_cmd_tab, 0, in_redir_i), errno);
+
+        return;
+    }
+
+    if ((fstat(in_fd, &in_stat) == -1) || !S_ISREG(in_stat.st_mode) || (in_stat.st_size == 0) ||
+        ((map = mmap(NULL, in_stat.st_size, PROT_READ, MAP_PRIVATE, in_fd, 0)) == MAP_FAILED)) {
+
+        close(in_fd);
+        executor_exec_cmd_tab(p_cmd_tab);
+
+        return;
+    }
+
+    close(in_fd);
+    madvise(map, in_stat.st_size, MADV_SEQUENTIAL);
+
+    /* Apply the output redirections of the last command once, for all the
+     * copies */
+    nb_redirs = cmd_tab_get_nb_redirs(p_cmd_tab, cmd_tab_get_nb_cmds(p_cmd_tab) - 1);
+
+    for (fd = 0; fd < NB_REDIR_FDS; fd++) {
+
+        out.srcs[fd] = fd;
+    }
+
+    out.opened = (int *)malloc((nb_redirs + NB_REDIR_FDS) * sizeof(int));
+    out.nb_opened = 0;
+    out_redirects = (redirect_t **)malloc((nb_redirs + 1) * sizeof(redirect_t *));
+
+    if (!__executor_redirect_fds(p_cmd_tab, cmd_tab_get_nb_cmds(p_cmd_tab) - 1, false, ~(1u << STDOUT_FILENO),
+                                 &out, out_redirects, &nb_out_redirects)) {
+
+        nb_copies = 0;
+    }
+
+    dest_fd = out.srcs[STDOUT_FILENO];
+
+    runs = (executor_run_t *)malloc(nb_copies * sizeof(executor_run_t));
+    feeders = (redirect_t **)malloc(nb_copies * sizeof(redirect_t *));
+    out_fds = (int *)malloc(nb_copies * sizeof(int));
+
+    /* Start a copy of the pipeline for every part (the first one writes to
+     * the output directly) */
+    for (start = 0, copy_i = 0; copy_i < nb_copies; copy_i++, start = end) {
+
+        /* The part ends after the first newline following its share of the
+         * file */
+        end = in_stat.st_size * (copy_i + 1) / nb_copies;
+
+        if (end < start) {
+
+            end = start;
+        }
+
+        if ((end > 0) && (end < (size_t)in_stat.st_size) && (map[end - 1] != '\n')) {
+
+            p_nl = scan_find(map + end, in_stat.st_size - end, "\n", 1);
+            end = p_nl ? (size_t)(p_nl - map + 1) : (size_t)in_stat.st_size;
+        }
+
+        /* Empty parts are not run */
+        if (end == start) {
+
+            continue;
+        }
+
+        pipe2(part_pipe, O_CLOEXEC);
+
+        if (pipe_size > 0) {
+
+            fcntl(part_pipe[0], F_SETPIPE_SZ, (int)pipe_size);
+        }
+
+        if (nb_runs == 0) {
+
+            out_fds[nb_runs] = dest_fd;
+        }
+        else {
+
+            out_fds[nb_runs] = __executor_high_fd(memfd_create("split", MFD_CLOEXEC));
+        }
+
+        /* The copies join a single job */
+        runs[nb_runs].group_pid = group_pid;
+        runs[nb_runs].max_procs = cmd_tab_get_nb_cmds(p_cmd_tab) * nb_copies;
+
+        __executor_start(&runs[nb_runs], p_cmd_tab, part_pipe[0], out_fds[nb_runs], STDERR_FILENO, true);
+        close(part_pipe[0]);
+
+        group_pid = runs[nb_runs].group_pid;
+
+        feeders[nb_runs] = redirect_start_map(map + start, end - start, part_pipe[1], false);
+        nb_runs++;
+    }
+
+    /* Wait for the job of the copies */
+    if (group_pid != -1) {
+
+        jobs_signal_init();
+        jobs_fg_proc_grp(group_pid, NULL);
+    }
+
+    for (copy_i = 0; copy_i < nb_runs; copy_i++) {
+
+        __executor_finish(&runs[copy_i], p_cmd_tab, false);
+        redirect_join(feeders[copy_i]);
+    }
+
+    /* Write the outputs held in order (the redirection owns its file
+     * descriptors) */
+    if (nb_runs > 1) {
+
+        for (copy_i = 1; copy_i < nb_runs; copy_i++) {
+
+            lseek(out_fds[copy_i], 0, SEEK_SET);
+        }
+
+        if (dest_fd == -1) {
+
+            for (copy_i = 1; copy_i < nb_runs; copy_i++) {
+
+                close(out_fds[copy_i]);
+            }
+        }
+        else {
+
+            dest_fd = fcntl(dest_fd, F_DUPFD_CLOEXEC, NB_REDIR_FDS);
+            redirect_join(redirect_start(out_fds + 1, nb_runs - 1, &dest_fd, 1, false));
+        }
+    }
+
+    __executor_close_fds(&out);
+
+    while (nb_out_redirects) {
+
+        redirect_join(out_redirects[--nb_out_redirects]);
+    }
+
+    free(out_fds);
+    free(feeders);
+    free(runs);
+    free(out_redirects);
+    free(out.opened);
+    munmap(map, in_stat.st_size);
+}
+
+/**
+ * @brief Applies the redirections of the ith command to the shell itself, so
+ *        that they stay for the next commands (the exec builtin)
+ * @param[in] p_cmd_tab Pointer to the command table instance
+ * @param[in] cmd_i The ith command
+ * @return true If the redirections could be applied
+ * @return false Otherwise (the error is printed)
+ */
+bool executor_redirect_shell(cmd_tab_t *p_cmd_tab, int cmd_i) {
+
+    /* File descriptors of the shell */
+    executor_fds_t fds;
+
+    /* Redirection threads joining multiple files (never joined) */
+    redirect_t **redirects;
+    int nb_redirects = 0;
+
+    /* Are the redirections applied */
+    bool is_redir_ok;
+
+    int fd;
+
+    redirects = (redirect_t **)malloc((cmd_tab_get_nb_redirs(p_cmd_tab, cmd_i) + 1) * sizeof(redirect_t *));
+    fds.opened = (int *)malloc((cmd_tab_get_nb_redirs(p_cmd_tab, cmd_i) + NB_REDIR_FDS) * sizeof(int));
+    fds.nb_opened = 0;
+
+    for (fd = 0; fd < NB_REDIR_FDS; fd++) {
+
+        fds.srcs[fd] = fd;
+    }
+
+    /* The shell keeps the files, so the threads are detached */
+    if ((is_redir_ok = __executor_redirect_fds(p_cmd_tab, cmd_i, true, 0, &fds, redirects, &nb_redirects))) {
+
+        __executor_order_fds(&fds);
+
+        /* Write the pending output to the old files */
+        fflush(stdout);
+        fflush(stderr);
+
+        /* Set the file descriptors of the shell (the duplicates are not
+         * close-on-exec, so the commands inherit them) */
+        for (fd = 0; fd < NB_REDIR_FDS; fd++) {
+
+            if (fds.srcs[fd] == -1) {
+
+                close(fd);
+            }
+            else if (fds.srcs[fd] != fd) {
+
+                dup2(fds.srcs[fd], fd);
+            }
+        }
+    }
+
+    __executor_close_fds(&fds);
+
+    free(fds.opened);
+    free(redirects);
+
+    return is_redir_ok;
 }
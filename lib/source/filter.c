@@ -0,0 +1,928 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include "filter.h"
+#include "scan.h"
+
+/* Maximum field number selected individually by kcut (larger ones are
+ * selected by an open range only) */
+#define FILTER_MAX_FIELDS (256u)
+
+/**
+ * @brief Buffered input and output of a filter
+ */
+struct __filter_io_t {
+
+    /* Input file descriptor */
+    int in_fd;
+
+    /* Output file descriptor */
+    int out_fd;
+
+    /* Event stopping the filter (-1 if none) */
+    int stop_fd;
+
+    /* Input buffer */
+    char *in_buf;
+
+    /* Size of the input buffer */
+    size_t in_size;
+
+    /* Offset of the first unread byte */
+    size_t in_start;
+
+    /* Offset of the end of the valid data */
+    size_t in_end;
+
+    /* Has the end of the input been read */
+    bool is_eof;
+
+    /* Was a newline added after the last line */
+    bool is_nl_added;
+
+    /* Output buffer */
+    char *out_buf;
+
+    /* Number of bytes in the output buffer */
+    size_t out_len;
+
+    /* Is the output closed by the reader (or failed) */
+    bool is_broken;
+
+};
+
+/**
+ * @brief Moves the file descriptor above the ones which can be redirected
+ * @param[in] fd File descriptor (closed if moved)
+ * @return File descriptor
+ */
+static int __filter_high_fd(int fd) {
+
+    int high_fd;
+
+    if ((fd == -1) || (fd >= FILTER_MIN_FD)) {
+
+        return fd;
+    }
+
+    high_fd = fcntl(fd, F_DUPFD_CLOEXEC, FILTER_MIN_FD);
+    close(fd);
+
+    return high_fd;
+}
+
+/**
+ * @brief Waits till the file descriptor is ready, or till the filter is
+ *        stopped (the stop event is never consumed, so every wait after it
+ *        fails as well)
+ * @param[in] p_io Pointer to the filter io object
+ * @param[in] fd File descriptor
+ * @param[in] events Events waited for (POLLIN or POLLOUT)
+ * @return true If the file descriptor is ready (or cannot be waited for)
+ * @return false If the filter is stopped
+ */
+static bool __filter_wait(filter_io_t *p_io, int fd, short events) {
+
+    /* The event is ignored by poll if there is none */
+    struct pollfd fds[2] = {
+        {p_io->stop_fd, POLLIN, 0},
+        {fd, events, 0}
+    };
+    int nb_ready;
+
+    do {
+
+        nb_ready = poll(fds, 2, -1);
+
+    } while ((nb_ready < 0) && (errno == EINTR));
+
+    return !(fds[0].revents & POLLIN);
+}
+
+/**
+ * @brief Writes all the bytes to the output file descriptor
+ * @param[in,out] p_io Pointer to the filter io object
+ * @param[in] data Data to be written
+ * @param[in] len Number of bytes
+ */
+static void __filter_write_all(filter_io_t *p_io, const char *data, size_t len) {
+
+    ssize_t nb_written;
+
+    while (len && !p_io->is_broken) {
+
+        /* A stopped filter drops its output */
+        if (!__filter_wait(p_io, p_io->out_fd, POLLOUT)) {
+
+            p_io->is_broken = true;
+
+            break;
+        }
+
+        nb_written = write(p_io->out_fd, data, len);
+
+        if (nb_written < 0) {
+
+            /* Retry if interrupted, else the output is gone */
+            if (errno != EINTR) {
+
+                p_io->is_broken = true;
+            }
+
+            continue;
+        }
+
+        data += nb_written;
+        len -= nb_written;
+    }
+}
+
+/**
+ * @brief Writes the buffered output
+ * @param[in,out] p_io Pointer to the filter io object
+ */
+static void __filter_flush(filter_io_t *p_io) {
+
+    __filter_write_all(p_io, p_io->out_buf, p_io->out_len);
+    p_io->out_len = 0;
+}
+
+/**
+ * @brief Appends the data to the output, large data is written directly
+ * @param[in,out] p_io Pointer to the filter io object
+ * @param[in] data Data to be written
+ * @param[in] len Number of bytes
+ */
+static void __filter_put(filter_io_t *p_io, const char *data, size_t len) {
+
+    /* If the data does not fit in the buffer */
+    if (p_io->out_len + len > FILTER_BUF_SIZE) {
+
+        __filter_flush(p_io);
+
+        /* Data larger than the buffer is not copied */
+        if (len >= FILTER_BUF_SIZE) {
+
+            __filter_write_all(p_io, data, len);
+
+            return;
+        }
+    }
+
+    memcpy(p_io->out_buf + p_io->out_len, data, len);
+    p_io->out_len += len;
+}
+
+/**
+ * @brief Reads more input, moving the unread data to the front of the
+ *        buffer and growing it if a line does not fit
+ * @param[in,out] p_io Pointer to the filter io object
+ */
+static void __filter_fill(filter_io_t *p_io) {
+
+    ssize_t nb_read;
+
+    /* Move the unread data to the front of the buffer */
+    if (p_io->in_start) {
+
+        memmove(p_io->in_buf, p_io->in_buf + p_io->in_start, p_io->in_end - p_io->in_start);
+
+        p_io->in_end -= p_io->in_start;
+        p_io->in_start = 0;
+    }
+
+    /* Grow the buffer if it is full (a byte is kept for the newline added
+     * after the last line) */
+    if (p_io->in_end + 1 >= p_io->in_size) {
+
+        p_io->in_size *= 2;
+        p_io->in_buf = (char *)realloc(p_io->in_buf, p_io->in_size);
+    }
+
+    /* Write the output of the lines read so far before waiting for more, so
+     * that a slow input (a terminal, tail -f) is filtered as it comes */
+    if (p_io->out_len) {
+
+        __filter_flush(p_io);
+    }
+
+    /* A stopped filter leaves its input and drops its output (the stop is
+     * seen between the reads even if the input never blocks) */
+    if (!__filter_wait(p_io, p_io->in_fd, POLLIN)) {
+
+        p_io->is_eof = true;
+        p_io->is_broken = true;
+
+        return;
+    }
+
+    do {
+
+        nb_read = read(p_io->in_fd, p_io->in_buf + p_io->in_end,
+                       p_io->in_size - p_io->in_end - 1);
+
+    } while ((nb_read < 0) && (errno == EINTR));
+
+    /* If nothing more can be read */
+    if (nb_read <= 0) {
+
+        p_io->is_eof = true;
+
+        return;
+    }
+
+    p_io->in_end += nb_read;
+}
+
+/**
+ * @brief Returns the next block of complete lines (each ended by a newline,
+ *        one is added after the last line if it has none)
+ * @param[in,out] p_io Pointer to the filter io object
+ * @param[out] p_block Pointer to the block
+ * @param[out] p_len Length of the block
+ * @return true If a block is returned
+ * @return false At the end of the input, or if the output is broken
+ */
+static bool __filter_next_block(filter_io_t *p_io, char **p_block, size_t *p_len) {
+
+    char *p_nl;
+
+    while (!p_io->is_broken) {
+
+        /* Find the end of the last complete line */
+        p_nl = (char *)memrchr(p_io->in_buf + p_io->in_start, '\n',
+                               p_io->in_end - p_io->in_start);
+
+        /* If the input is over, the rest is the last line */
+        if (!p_nl && p_io->is_eof && (p_io->in_start < p_io->in_end)) {
+
+            p_io->in_buf[p_io->in_end++] = '\n';
+            p_io->is_nl_added = true;
+
+            p_nl = p_io->in_buf + p_io->in_end - 1;
+        }
+
+        /* If complete lines are present */
+        if (p_nl) {
+
+            *p_block = p_io->in_buf + p_io->in_start;
+            *p_len = p_nl + 1 - *p_block;
+
+            p_io->in_start += *p_len;
+
+            return true;
+        }
+
+        if (p_io->is_eof) {
+
+            return false;
+        }
+
+        __filter_fill(p_io);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Prints the lines containing (or not containing) the fixed string,
+ *        <kgrep [-v] string>
+ * @param[in,out] p_io Pointer to the filter io object
+ * @param[in] p_filter Pointer to the filter
+ * @return Exit status
+ */
+int filter_grep(filter_io_t *p_io, filter_t *p_filter) {
+
+    bool is_inverted = (p_filter->nb_args == 3) && !strcmp(p_filter->args[1], "-v");
+    char *needle = p_filter->args[p_filter->nb_args - 1];
+    size_t nlen = strlen(needle);
+    const char *p_match;
+    char *line_start;
+    char *line_end;
+    char *p_cur;
+    char *p_end;
+    char *block;
+    size_t len;
+
+    if ((p_filter->nb_args != 2) && !is_inverted) {
+
+        fprintf(stderr, "kavach: incorrect number of arguments <kgrep [-v] string>\n");
+
+        return 1;
+    }
+
+    while (__filter_next_block(p_io, &block, &len)) {
+
+        p_end = block + len;
+
+        /* Search the whole block, not line by line */
+        for (p_cur = block;
+             (p_match = scan_find(p_cur, p_end - p_cur, needle, nlen));
+             p_cur = line_end) {
+
+            /* Get the line of the match */
+            line_start = (char *)memrchr(p_cur, '\n', p_match - p_cur);
+            line_start = line_start ? (line_start + 1) : p_cur;
+            line_end = (char *)memchr(p_match, '\n', p_end - p_match) + 1;
+
+            /* Print the matching line, or the lines before it */
+            if (!is_inverted) {
+
+                __filter_put(p_io, line_start, line_end - line_start);
+            }
+            else {
+
+                __filter_put(p_io, p_cur, line_start - p_cur);
+            }
+        }
+
+        /* Print the lines after the last match */
+        if (is_inverted) {
+
+            __filter_put(p_io, p_cur, p_end - p_cur);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Parses the field list of kcut (numbers and ranges, comma separated)
+ * @param[in] list Field list
+ * @param[out] is_selected Selection of the fields (indexed from 1)
+ * @param[out] p_open_from First field of an open range (0 if none)
+ * @return true If the list is valid (the fields below #FILTER_MAX_FIELDS,
+ *         except the start of an open range)
+ * @return false Otherwise
+ */
+static bool __filter_cut_fields(const char *list, bool *is_selected, size_t *p_open_from) {
+
+    char *p_end;
+    unsigned long first;
+    unsigned long last;
+    unsigned long field;
+
+    *p_open_from = 0;
+
+    while (*list) {
+
+        /* Get the first field of the range (1 if omitted) */
+        first = (*list == '-') ? 1 : strtoul(list, &p_end, 10);
+        list = (*list == '-') ? list : p_end;
+
+        if (!first) {
+
+            return false;
+        }
+
+        last = first;
+
+        /* If it is a range */
+        if (*list == '-') {
+
+            list++;
+
+            /* If the range is open ended */
+            if (!*list || (*list == ',')) {
+
+                if (!*p_open_from || (first < *p_open_from)) {
+
+                    *p_open_from = first;
+                }
+
+                last = first - 1;
+            }
+            else {
+
+                last = strtoul(list, &p_end, 10);
+                list = p_end;
+            }
+        }
+
+        /* The fields selected one by one must fit in the selection (an open
+         * range selects none of them) */
+        if ((last >= first) && (last >= FILTER_MAX_FIELDS)) {
+
+            return false;
+        }
+
+        /* Select the fields of the range */
+        for (field = first; field <= last; field++) {
+
+            is_selected[field] = true;
+        }
+
+        if (*list == ',') {
+
+            list++;
+        }
+        else if (*list) {
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Prints the selected fields of every line,
+ *        <kcut -f list [-d delim]>
+ * @param[in,out] p_io Pointer to the filter io object
+ * @param[in] p_filter Pointer to the filter
+ * @return Exit status
+ */
+int filter_cut(filter_io_t *p_io, filter_t *p_filter) {
+
+    bool is_selected[FILTER_MAX_FIELDS] = {false};
+    size_t open_from = 0;
+    char delim = '\t';
+    char *list = NULL;
+    char *block;
+    size_t len;
+    char *p_line;
+    char *p_line_end;
+    char *p_field;
+    char *p_field_end;
+    size_t field;
+    bool is_first;
+    int arg_i;
+
+    /* Get the options */
+    for (arg_i = 1; arg_i + 1 < p_filter->nb_args; arg_i += 2) {
+
+        if (!strcmp(p_filter->args[arg_i], "-f")) {
+
+            list = p_filter->args[arg_i + 1];
+        }
+        else if (!strcmp(p_filter->args[arg_i], "-d")) {
+
+            delim = p_filter->args[arg_i + 1][0];
+        }
+        else {
+
+            break;
+        }
+    }
+
+    if ((arg_i != p_filter->nb_args) || !list ||
+        !__filter_cut_fields(list, is_selected, &open_from)) {
+
+        fprintf(stderr, "kavach: incorrect arguments <kcut -f list [-d delim]>\n");
+
+        return 1;
+    }
+
+    while (__filter_next_block(p_io, &block, &len)) {
+
+        /* For every line of the block */
+        for (p_line = block; p_line < block + len; p_line = p_line_end + 1) {
+
+            p_line_end = (char *)memchr(p_line, '\n', block + len - p_line);
+
+            /* Lines without the delimiter are printed as they are */
+            if (!memchr(p_line, delim, p_line_end - p_line)) {
+
+                __filter_put(p_io, p_line, p_line_end + 1 - p_line);
+
+                continue;
+            }
+
+            is_first = true;
+
+            /* For every field of the line */
+            for (p_field = p_line, field = 1; p_field <= p_line_end; p_field = p_field_end + 1, field++) {
+
+                p_field_end = (char *)memchr(p_field, delim, p_line_end - p_field);
+                p_field_end = p_field_end ? p_field_end : p_line_end;
+
+                /* Print the field if it is selected */
+                if (((field < FILTER_MAX_FIELDS) && is_selected[field]) ||
+                    (open_from && (field >= open_from))) {
+
+                    if (!is_first) {
+
+                        __filter_put(p_io, &delim, 1);
+                    }
+
+                    __filter_put(p_io, p_field, p_field_end - p_field);
+                    is_first = false;
+                }
+            }
+
+            __filter_put(p_io, "\n", 1);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Prints the number of lines, <kwc [-l]>
+ * @param[in,out] p_io Pointer to the filter io object
+ * @param[in] p_filter Pointer to the filter
+ * @return Exit status
+ */
+int filter_wc(filter_io_t *p_io, filter_t *p_filter) {
+
+    size_t nb_lines = 0;
+    char str[32];
+    char *block;
+    size_t len;
+
+    if ((p_filter->nb_args > 2) ||
+        ((p_filter->nb_args == 2) && strcmp(p_filter->args[1], "-l"))) {
+
+        fprintf(stderr, "kavach: incorrect arguments <kwc [-l]>\n");
+
+        return 1;
+    }
+
+    /* Count the newlines of every block */
+    while (__filter_next_block(p_io, &block, &len)) {
+
+        nb_lines += scan_count(block, len, '\n');
+    }
+
+    /* The newline added after the last line is not counted (as wc does) */
+    nb_lines -= p_io->is_nl_added;
+
+    __filter_put(p_io, str, snprintf(str, sizeof(str), "%zu\n", nb_lines));
+
+    return 0;
+}
+
+/**
+ * @brief Gets the number of lines of khead and ktail, <-n nb_lines>
+ * @param[in] p_filter Pointer to the filter
+ * @param[out] p_nb_lines Number of lines
+ * @return true If the arguments are valid
+ * @return false Otherwise
+ */
+static bool __filter_nb_lines(filter_t *p_filter, size_t *p_nb_lines) {
+
+    char *p_end;
+
+    *p_nb_lines = FILTER_DEFAULT_NB_LINES;
+
+    if (p_filter->nb_args == 1) {
+
+        return true;
+    }
+
+    if ((p_filter->nb_args != 3) || strcmp(p_filter->args[1], "-n")) {
+
+        return false;
+    }
+
+    *p_nb_lines = strtoul(p_filter->args[2], &p_end, 10);
+
+    return !*p_end && (p_end != p_filter->args[2]);
+}
+
+/**
+ * @brief Prints the first lines, <khead [-n nb_lines]>
+ * @param[in,out] p_io Pointer to the filter io object
+ * @param[in] p_filter Pointer to the filter
+ * @return Exit status
+ */
+int filter_head(filter_io_t *p_io, filter_t *p_filter) {
+
+    size_t nb_lines;
+    char *block;
+    char *p_cur;
+    size_t len;
+
+    if (!__filter_nb_lines(p_filter, &nb_lines)) {
+
+        fprintf(stderr, "kavach: incorrect arguments <khead [-n nb_lines]>\n");
+
+        return 1;
+    }
+
+    /* Till the lines are printed (the rest of the input is not read) */
+    while (nb_lines && __filter_next_block(p_io, &block, &len)) {
+
+        /* Find the end of the last line to be printed in the block */
+        for (p_cur = block; nb_lines && (p_cur < block + len); nb_lines--) {
+
+            p_cur = (char *)memchr(p_cur, '\n', block + len - p_cur) + 1;
+        }
+
+        __filter_put(p_io, block, p_cur - block);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Returns the start of the last lines of the data (each line ended
+ *        by a newline)
+ * @param[in] data Data
+ * @param[in] len Number of bytes
+ * @param[in] nb_lines Number of lines
+ * @return Pointer to the start of the last lines
+ */
+static char *__filter_last_lines(char *data, size_t len, size_t nb_lines) {
+
+    char *p_cur = data + len;
+
+    if (!nb_lines || !len) {
+
+        return p_cur;
+    }
+
+    /* Skip the newline of the last line, then find the start of each */
+    for (len--; len; ) {
+
+        if (!(p_cur = (char *)memrchr(data, '\n', len))) {
+
+            return data;
+        }
+
+        if (!--nb_lines) {
+
+            return p_cur + 1;
+        }
+
+        len = p_cur - data;
+    }
+
+    return data;
+}
+
+/**
+ * @brief Prints the last lines, <ktail [-n nb_lines]>
+ * @param[in,out] p_io Pointer to the filter io object
+ * @param[in] p_filter Pointer to the filter
+ * @return Exit status
+ */
+int filter_tail(filter_io_t *p_io, filter_t *p_filter) {
+
+    size_t nb_lines;
+    char *keep = NULL;
+    size_t keep_len = 0;
+    size_t keep_size = 0;
+    char *p_start;
+    char *block;
+    size_t len;
+
+    if (!__filter_nb_lines(p_filter, &nb_lines)) {
+
+        fprintf(stderr, "kavach: incorrect arguments <ktail [-n nb_lines]>\n");
+
+        return 1;
+    }
+
+    while (__filter_next_block(p_io, &block, &len)) {
+
+        /* Only the last lines of the block can be printed */
+        p_start = __filter_last_lines(block, len, nb_lines);
+        len -= p_start - block;
+
+        /* If the kept lines and the block exceed the buffer, drop the kept
+         * lines which cannot be printed anymore */
+        if (keep_len + len > keep_size) {
+
+            block =__filter_last_lines(keep, keep_len, nb_lines);
+            keep_len -= block - keep;
+            memmove(keep, block, keep_len);
+
+            if (keep_len + len > keep_size) {
+
+                keep_size = 2 * (keep_len + len);
+                keep = (char *)realloc(keep, keep_size);
+            }
+        }
+
+        memcpy(keep + keep_len, p_start, len);
+        keep_len += len;
+    }
+
+    /* Print the last lines */
+    if (keep) {
+
+        p_start = __filter_last_lines(keep, keep_len, nb_lines);
+        __filter_put(p_io, p_start, keep + keep_len - p_start);
+    }
+
+    free(keep);
+
+    return 0;
+}
+
+/**
+ * @brief Runs the filter on its input and output, then releases them
+ * @param[in,out] p_filter Pointer to the filter
+ * @return Exit status of the filter
+ */
+static int __filter_run(filter_t *p_filter) {
+
+    filter_io_t io;
+    int status;
+
+    io.in_fd = p_filter->in_fd;
+    io.out_fd = p_filter->out_fd;
+    io.stop_fd = p_filter->stop_fd;
+    io.in_size = FILTER_BUF_SIZE;
+    io.in_buf = (char *)malloc(io.in_size);
+    io.in_start = 0;
+    io.in_end = 0;
+    io.is_eof = false;
+    io.is_nl_added = false;
+    io.out_buf = (char *)malloc(FILTER_BUF_SIZE);
+    io.out_len = 0;
+    io.is_broken = false;
+
+    /* Run the filter */
+    status = p_filter->func(&io, p_filter);
+
+    __filter_flush(&io);
+
+    /* Closing the ends lets the neighbouring stages see the end of file or
+     * the broken pipe */
+    close(p_filter->in_fd);
+    close(p_filter->out_fd);
+
+    free(io.in_buf);
+    free(io.out_buf);
+
+    return status;
+}
+
+/**
+ * @brief Runs the filter on its thread, then signals that it is done (or
+ *        frees it if it is detached)
+ * @param[in] p_arg Pointer to the filter
+ * @return NULL
+ */
+static void *__filter_thread(void *p_arg) {
+
+    filter_t *p_filter = (filter_t *)p_arg;
+    uint64_t done = 1;
+
+    p_filter->status = __filter_run(p_filter);
+
+    if (p_filter->is_detached) {
+
+        free(p_filter);
+    }
+    else {
+
+        write(p_filter->done_fd, &done, sizeof(done));
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Creates a filter with a copy of the arguments (so that it does not
+ *        depend on the command table)
+ * @param[in] func Function of the filter
+ * @param[in] args Arguments
+ * @param[in] nb_args Number of arguments
+ * @return Pointer to the filter
+ */
+filter_t *filter_create(filter_func_t func, char **args, int nb_args) {
+
+    filter_t *p_filter;
+    size_t size;
+    char *p_str;
+    int arg_i;
+
+    /* Size of the record, the argument pointers and the strings */
+    size = sizeof(filter_t) + (nb_args + 1) * sizeof(char *);
+
+    for (arg_i = 0; arg_i < nb_args; arg_i++) {
+
+        size += strlen(args[arg_i]) + 1;
+    }
+
+    p_filter = (filter_t *)malloc(size);
+    p_filter->func = func;
+    p_filter->nb_args = nb_args;
+
+    /* Copy the strings after the argument pointers */
+    p_str = (char *)(p_filter->args + nb_args + 1);
+
+    for (arg_i = 0; arg_i < nb_args; arg_i++) {
+
+        p_filter->args[arg_i] = strcpy(p_str, args[arg_i]);
+        p_str += strlen(p_str) + 1;
+    }
+
+    p_filter->args[nb_args] = NULL;
+
+    return p_filter;
+}
+
+/**
+ * @brief Starts the filter on a new thread
+ * @param[in,out] p_filter Pointer to the filter
+ * @param[in] in_fd Input file descriptor (closed by the filter)
+ * @param[in] out_fd Output file descriptor (closed by the filter)
+ * @param[in] is_detached Whether the filter frees itself when done, else it
+ *            must be joined
+ */
+void filter_start(filter_t *p_filter, int in_fd, int out_fd, bool is_detached) {
+
+    /* Set of all the signals */
+    sigset_t all_set;
+
+    /* Signal mask of the caller */
+    sigset_t old_set;
+
+    p_filter->in_fd = in_fd;
+    p_filter->out_fd = out_fd;
+    p_filter->is_detached = is_detached;
+
+    /* A filter which is joined can be stopped and waited for */
+    if (is_detached) {
+
+        p_filter->stop_fd = -1;
+        p_filter->done_fd = -1;
+    }
+    else {
+
+        p_filter->stop_fd = __filter_high_fd(eventfd(0, EFD_CLOEXEC));
+        p_filter->done_fd = __filter_high_fd(eventfd(0, EFD_CLOEXEC));
+    }
+
+    /* The thread blocks every signal, so that the job control handlers
+     * always run on the main thread */
+    sigfillset(&all_set);
+    pthread_sigmask(SIG_SETMASK, &all_set, &old_set);
+
+    pthread_create(&p_filter->thread, NULL, __filter_thread, p_filter);
+
+    if (is_detached) {
+
+        pthread_detach(p_filter->thread);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+}
+
+/**
+ * @brief Runs the filter on the calling thread till it is done (it cannot
+ *        be stopped) and frees it
+ * @param[in,out] p_filter Pointer to the filter
+ * @param[in] in_fd Input file descriptor (closed by the filter)
+ * @param[in] out_fd Output file descriptor (closed by the filter)
+ * @return Exit status of the filter
+ */
+int filter_run(filter_t *p_filter, int in_fd, int out_fd) {
+
+    int status;
+
+    p_filter->in_fd = in_fd;
+    p_filter->out_fd = out_fd;
+    p_filter->is_detached = false;
+    p_filter->stop_fd = -1;
+    p_filter->done_fd = -1;
+
+    status = __filter_run(p_filter);
+    free(p_filter);
+
+    return status;
+}
+
+/**
+ * @brief Stops the filter, it leaves its input (even if it waits for it)
+ *        and drops its output, it is joined as usual
+ * @param[in] p_filter Pointer to the filter (started and not detached)
+ */
+void filter_stop(filter_t *p_filter) {
+
+    uint64_t stop = 1;
+
+    write(p_filter->stop_fd, &stop, sizeof(stop));
+}
+
+/**
+ * @brief Waits till the filter is done and frees it
+ * @param[in] p_filter Pointer to the filter
+ * @return Exit status of the filter
+ */
+int filter_join(filter_t *p_filter) {
+
+    int status;
+
+    pthread_join(p_filter->thread, NULL);
+
+    status = p_filter->status;
+
+    close(p_filter->stop_fd);
+    close(p_filter->done_fd);
+    free(p_filter);
+
+    return status;
+}
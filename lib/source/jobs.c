@@ -1,47 +1,235 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <string.h>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/pidfd.h>
 #include "jobs.h"
 #include "prompt.h"
 
-/* Maximum number of jobs supported by the shell */
-#define MAX_NB_OF_JOBS  (128u)
+/* Alignment of the packed command table in the job block */
+#define JOB_ALIGN (sizeof(void *))
 
-/* Global array of jobs */
-job_t g_jobs[MAX_NB_OF_JOBS];
+/* Lowest file descriptor of the event loop (above the ones which can be
+ * redirected) */
+#define JOBS_MIN_FD (10)
+
+/* Event of the signal descriptor (the events of the processes are their
+ * process ids) */
+#define JOBS_EVENT_SIGNAL (0u)
+
+/* Event of the input waited for */
+#define JOBS_EVENT_INPUT (UINT64_MAX)
+
+/* Global pool of jobs, a job keeps its slot (its id) till it is removed
+ * (NULL for a free slot) */
+job_t **g_jobs;
+/* Number of slots of the pool */
+int g_nb_slots;
 /* Global count of number of jobs */
 int g_nb_jobs;
+/* Free slots of the pool (the lowest ones on the top at first) */
+static int *g_free_slots;
+/* Number of free slots */
+static int g_nb_free;
+/* Slots of the completed jobs not yet removed, in the order of completion */
+static int *g_done_slots;
+/* Number of completed jobs not yet removed */
+static int g_nb_jobs_done;
+/* Index from the process ids of the processes not yet reaped to the jobs */
+static job_index_t g_pid_index;
+/* Index from the process group ids to the jobs */
+static job_index_t g_gpid_index;
+/* Number of processes not yet reaped without a process descriptor (they are
+ * reaped when SIGCHLD is read) */
+static int g_nb_unwatched;
+/* Is the shell reading commands from a terminal (job control enabled) */
+bool g_is_interactive;
+
+/* Event loop */
+static int g_epoll_fd;
+/* Signal descriptor of the loop */
+static int g_signal_fd;
+/* Has the input waited for become readable */
+static bool g_is_input_ready;
+/* Has the prompt been interrupted */
+static bool g_is_interrupted;
+/* Has the prompt been suspended (^Z read while the shell has the terminal) */
+static bool g_is_suspended;
+/* Function called after the events handled at the prompt (NULL for none) */
+static jobs_hook_t g_hook;
 
 /**
- * @brief Get the index of the job which contains the specified pid
- * @param[in] pid Process id to be searched
- * @return Index in the #g_jobs array which contains #pid
+ * @brief Returns the home slot of the key in the index
+ * @param[in] p_index Pointer to the index
+ * @param[in] key Process id or process group id
+ * @return Slot index
  */
-static int __get_idx_from_pid(int pid) {
+static inline size_t __jobs_index_home(job_index_t *p_index, int key) {
 
-    int job_i;
+    /* Fibonacci hashing, the high bits of the product are spread best */
+    return (size_t)(((uint64_t)(uint32_t)key * 0x9e3779b97f4a7c15ull) >> 32) & (p_index->nb_slots - 1);
+}
 
-    int pid_i;
+/**
+ * @brief Returns the slot of the key, or the free slot where it would be
+ *        added
+ * @param[in] p_index Pointer to the index
+ * @param[in] key Process id or process group id
+ * @return Slot index
+ */
+static size_t __jobs_index_find(job_index_t *p_index, int key) {
+
+    size_t mask = p_index->nb_slots - 1;
+    size_t slot_i;
+
+    for (slot_i = __jobs_index_home(p_index, key); p_index->keys[slot_i].key; slot_i = (slot_i + 1) & mask) {
 
-    /* For each job */
-    for (job_i = 0; job_i < g_nb_jobs; job_i++) {
+        if (p_index->keys[slot_i].key == key) {
 
-        /* For each pid it contains */
-        for (pid_i = 0; pid_i < g_jobs[job_i].nb_pids; pid_i++) {
+            break;
+        }
+    }
+
+    return slot_i;
+}
+
+/**
+ * @brief Returns the entry of the key
+ * @param[in] p_index Pointer to the index
+ * @param[in] key Process id or process group id
+ * @return Pointer to the entry, NULL if not found
+ */
+static job_key_t *__jobs_index_get(job_index_t *p_index, int key) {
 
-            /* If the required pid is found */
-            if (g_jobs[job_i].pids[pid_i] == pid) {
+    job_key_t *p_key;
+
+    if (!p_index->nb_keys) {
+
+        return NULL;
+    }
+
+    p_key = &p_index->keys[__jobs_index_find(p_index, key)];
+
+    return p_key->key ? p_key : NULL;
+}
 
-                /* Return the group pid */
-                return job_i;
+/**
+ * @brief Sets the job of the key (a reused id replaces the old entry)
+ * @param[in,out] p_index Pointer to the index
+ * @param[in] key Process id or process group id
+ * @param[in] job_i Slot of the job
+ * @param[in] proc_i Index of the process in the job
+ */
+static void __jobs_index_put(job_index_t *p_index, int key, int job_i, int proc_i) {
+
+    job_key_t *old_keys = p_index->keys;
+    size_t old_nb_slots = p_index->nb_slots;
+    job_key_t *p_key;
+    size_t slot_i;
+
+    /* Keep the index at most half full, so that the probes stay short */
+    if (2 * (p_index->nb_keys + 1) > p_index->nb_slots) {
+
+        p_index->nb_slots = old_nb_slots ? 2 * old_nb_slots : JOBS_MIN_KEYS;
+        p_index->keys = (job_key_t *)calloc(p_index->nb_slots, sizeof(job_key_t));
+
+        /* Move the entries to their new slots */
+        for (slot_i = 0; slot_i < old_nb_slots; slot_i++) {
+
+            if (old_keys[slot_i].key) {
+
+                p_index->keys[__jobs_index_find(p_index, old_keys[slot_i].key)] = old_keys[slot_i];
             }
         }
+
+        free(old_keys);
+    }
+
+    p_key = &p_index->keys[__jobs_index_find(p_index, key)];
+
+    if (!p_key->key) {
+
+        p_key->key = key;
+        p_index->nb_keys++;
+    }
+
+    p_key->job_i = job_i;
+    p_key->proc_i = proc_i;
+}
+
+/**
+ * @brief Removes the key if it belongs to the job (its id may be used by a
+ *        job added since)
+ * @param[in,out] p_index Pointer to the index
+ * @param[in] key Process id or process group id
+ * @param[in] job_i Slot of the job
+ */
+static void __jobs_index_del(job_index_t *p_index, int key, int job_i) {
+
+    size_t mask = p_index->nb_slots - 1;
+    size_t slot_i;
+    size_t next_i;
+    size_t home_i;
+
+    if (!p_index->nb_keys) {
+
+        return;
+    }
+
+    slot_i = __jobs_index_find(p_index, key);
+
+    if (!p_index->keys[slot_i].key || (p_index->keys[slot_i].job_i != job_i)) {
+
+        return;
+    }
+
+    p_index->nb_keys--;
+
+    /* Shift back the following entries of the probe sequence, so that no
+     * tombstone is needed */
+    for (next_i = (slot_i + 1) & mask; p_index->keys[next_i].key; next_i = (next_i + 1) & mask) {
+
+        home_i = __jobs_index_home(p_index, p_index->keys[next_i].key);
+
+        /* If the home slot lies cyclically in (slot_i, next_i], the entry
+         * stays */
+        if ((slot_i <= next_i) ? ((slot_i < home_i) && (home_i <= next_i)) :
+                                 ((slot_i < home_i) || (home_i <= next_i))) {
+
+            continue;
+        }
+
+        p_index->keys[slot_i] = p_index->keys[next_i];
+        slot_i = next_i;
+    }
+
+    p_index->keys[slot_i].key = 0;
+}
+
+/**
+ * @brief Get the index of the job which contains the specified pid (a
+ *        process not yet reaped, or the process group leader)
+ * @param[in] pid Process id to be searched
+ * @return Index in the #g_jobs array which contains #pid
+ */
+static int __get_idx_from_pid(int pid) {
+
+    job_key_t *p_key;
+
+    if ((p_key = __jobs_index_get(&g_pid_index, pid)) ||
+        (p_key = __jobs_index_get(&g_gpid_index, pid))) {
+
+        return p_key->job_i;
     }
 
     return -1;
@@ -54,46 +242,404 @@ static int __get_idx_from_pid(int pid) {
  */
 static int __get_idx_from_gpid(int gpid) {
 
+    job_key_t *p_key = __jobs_index_get(&g_gpid_index, gpid);
+
+    return p_key ? p_key->job_i : -1;
+}
+
+/**
+ * @brief Returns the state of the job, from the states of its processes
+ * @param[in] p_job Pointer to the job
+ * @return Done if every process is done, stopped if every other process is
+ *         stopped, else running
+ */
+static job_state_t __jobs_get_state(job_t *p_job) {
+
+    if (p_job->nb_procs_comp == p_job->nb_pids) {
+
+        return JOB_DONE;
+    }
+
+    if (p_job->nb_procs_comp + p_job->nb_procs_stopped == p_job->nb_pids) {
+
+        return JOB_STOPPED;
+    }
+
+    return JOB_RUNNING;
+}
+
+/**
+ * @brief Moves the file descriptor above the ones which can be redirected
+ *        (so that the exec built-in does not replace it)
+ * @param[in] fd File descriptor (closed if moved)
+ * @return File descriptor
+ */
+static int __jobs_high_fd(int fd) {
+
+    int high_fd;
+
+    if ((fd == -1) || (fd >= JOBS_MIN_FD)) {
+
+        return fd;
+    }
+
+    high_fd = fcntl(fd, F_DUPFD_CLOEXEC, JOBS_MIN_FD);
+    close(fd);
+
+    return high_fd;
+}
+
+/**
+ * @brief Changes the state of a process of the job, keeping the counts of
+ *        the job
+ * @param[in] job_i Slot of the job
+ * @param[in] proc_i Index of the process in the job
+ * @param[in] state New state
+ */
+static void __jobs_set_proc_state(int job_i, int proc_i, job_state_t state) {
+
+    job_t *p_job = g_jobs[job_i];
+    job_proc_t *p_proc = &p_job->procs[proc_i];
+
+    /* A reaped process does not change any more */
+    if (p_proc->state == JOB_DONE) {
+
+        return;
+    }
+
+    p_job->nb_procs_stopped -= (p_proc->state == JOB_STOPPED);
+    p_job->nb_procs_stopped += (state == JOB_STOPPED);
+    p_job->nb_procs_comp += (state == JOB_DONE);
+    g_nb_unwatched -= (state == JOB_DONE) && (p_proc->pidfd == -1);
+
+    p_proc->state = state;
+
+    /* The descriptor of the process is not needed any more (closing it
+     * removes it from the event loop) */
+    if ((state == JOB_DONE) && (p_proc->pidfd != -1)) {
+
+        close(p_proc->pidfd);
+        p_proc->pidfd = -1;
+    }
+
+    /* The process id may be used again once reaped */
+    if (state == JOB_DONE) {
+
+        __jobs_index_del(&g_pid_index, p_proc->pid, job_i);
+    }
+
+    /* Queue the jobs to be reported */
+    if ((state == JOB_DONE) && (p_job->nb_procs_comp == p_job->nb_pids)) {
+
+        g_done_slots[g_nb_jobs_done++] = job_i;
+    }
+}
+
+/**
+ * @brief Reaps the process whose descriptor became readable (it exited)
+ * @param[in] pid Process id
+ */
+static void __jobs_reap(int pid) {
+
+    job_key_t *p_key;
+    int status;
+    pid_t ret;
+
+    if (!(p_key = __jobs_index_get(&g_pid_index, pid))) {
+
+        return;
+    }
+
+    /* Only this process is reaped (the children waited by others are not
+     * taken), a process reaped already is done as well */
+    ret = waitpid(pid, &status, WNOHANG);
+
+    if ((ret == pid) || ((ret == -1) && (errno == ECHILD))) {
+
+        /* The status of a process reaped by others is not known */
+        if (ret == pid) {
+
+            g_jobs[p_key->job_i]->procs[p_key->proc_i].status =
+                WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status);
+        }
+
+        __jobs_set_proc_state(p_key->job_i, p_key->proc_i, JOB_DONE);
+    }
+}
+
+/**
+ * @brief Reaps the processes without a process descriptor which exited
+ *        (called when SIGCHLD is read)
+ */
+static void __jobs_reap_unwatched() {
+
+    job_t *p_job;
     int job_i;
+    int pid_i;
 
-    /* For every job */
-    for (job_i = 0; job_i < g_nb_jobs; job_i++) {
+    for (job_i = 0; g_nb_unwatched && (job_i < g_nb_slots); job_i++) {
 
-        /* If the requested gpid matched the current job's gpid */
-        if (g_jobs[job_i].gpid == gpid) {
+        if (!(p_job = g_jobs[job_i])) {
 
-            /* Return group pid */
-            return job_i;
+            continue;
+        }
+
+        for (pid_i = 0; pid_i < p_job->nb_pids; pid_i++) {
+
+            if ((p_job->procs[pid_i].state != JOB_DONE) && (p_job->procs[pid_i].pidfd == -1)) {
+
+                __jobs_reap(p_job->procs[pid_i].pid);
+            }
         }
     }
+}
 
-    return -1;
+/**
+ * @brief Updates the processes stopped or continued since the last call,
+ *        every change is taken in a single pass (the SIGCHLD signals may be
+ *        merged)
+ */
+static void __jobs_update_stopped() {
+
+    siginfo_t info;
+    job_key_t *p_key;
+
+    while (1) {
+
+        /* The process id is left untouched when nothing changed */
+        info.si_pid = 0;
+
+        if (waitid(P_ALL, 0, &info, WSTOPPED | WCONTINUED | WNOHANG) || !info.si_pid) {
+
+            return;
+        }
+
+        if (!(p_key = __jobs_index_get(&g_pid_index, info.si_pid))) {
+
+            continue;
+        }
+
+        __jobs_set_proc_state(p_key->job_i, p_key->proc_i, (info.si_code == CLD_CONTINUED) ? JOB_RUNNING : JOB_STOPPED);
+    }
 }
 
 /**
- * @brief Waits for the child so that the PCB entry for that child is removed
- * @param[in] sig_num Signal number
+ * @brief Reads the signals waiting on the signal descriptor
  */
-static void __sigchld_handler(int sig_num) {
+static void __jobs_read_signals() {
 
-    int pid;
-    int idx;
-    int nb_procs_comp;
+    struct signalfd_siginfo info;
+    bool is_chld = false;
+
+    while (read(g_signal_fd, &info, sizeof(info)) == sizeof(info)) {
+
+        if (info.ssi_signo == SIGCHLD) {
+
+            is_chld = true;
+        }
+        else if (info.ssi_signo == SIGINT) {
+
+            g_is_interrupted = true;
+        }
+        else if (info.ssi_signo == SIGTSTP) {
+
+            g_is_suspended = true;
+        }
+    }
+
+    /* The exits are taken from the process descriptors (or here for the
+     * processes without one), the signal gives the stops and continuations */
+    if (is_chld) {
+
+        __jobs_reap_unwatched();
+        __jobs_update_stopped();
+    }
+}
+
+/**
+ * @brief Waits for the events of the loop and handles them, the jobs are
+ *        only updated (they are removed at the safe points)
+ * @param[in] timeout Timeout in milliseconds (-1 to wait for an event)
+ */
+static void __jobs_dispatch(int timeout) {
+
+    struct epoll_event events[JOBS_NB_EVENTS];
+    int nb_events;
+    int event_i;
+
+    nb_events = epoll_wait(g_epoll_fd, events, JOBS_NB_EVENTS, timeout);
+
+    for (event_i = 0; event_i < nb_events; event_i++) {
+
+        switch (events[event_i].data.u64) {
+
+        case JOBS_EVENT_SIGNAL:
+            __jobs_read_signals();
+            break;
+
+        case JOBS_EVENT_INPUT:
+            g_is_input_ready = true;
+            break;
+
+        default:
+            __jobs_reap((int)events[event_i].data.u64);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Removes the job from the pool, its slot is free for the next job
+ *        (the other jobs keep theirs)
+ * @param[in] job_i Slot of the job
+ */
+static void __jobs_remove(int job_i) {
+
+    job_t *p_job = g_jobs[job_i];
+    int pid_i;
+
+    /* Stop watching the processes left */
+    for (pid_i = 0; pid_i < p_job->nb_pids; pid_i++) {
+
+        if (p_job->procs[pid_i].state != JOB_DONE) {
+
+            __jobs_index_del(&g_pid_index, p_job->procs[pid_i].pid, job_i);
+            g_nb_unwatched -= (p_job->procs[pid_i].pidfd == -1);
+        }
+
+        if (p_job->procs[pid_i].pidfd != -1) {
+
+            close(p_job->procs[pid_i].pidfd);
+        }
+    }
+
+    __jobs_index_del(&g_gpid_index, p_job->gpid, job_i);
+
+    /* Deallocate the job (the command table is in the same block) */
+    free(p_job);
 
-    /* Wait for any child, but do not halt if no child's state has changed */
-    pid = waitpid(WAIT_ANY, 0, WNOHANG);
+    /* Free the slot */
+    g_jobs[job_i] = NULL;
+    g_free_slots[g_nb_free++] = job_i;
 
-    /* Mark the pid as complete */
-    jobs_mark_proc_comp(pid, true);
+    /* Decrement the number of jobs */
+    g_nb_jobs--;
 }
 
 /**
- * @brief Initialize the jobs global variables
+ * @brief Removes the completed jobs, in the order of their completion
+ * @param[in] do_print Whether to print the completed jobs
  */
-void jobs_init() {
+static void __jobs_remove_done(bool do_print) {
 
-    /* Set the number of jobs to zero */
+    int done_i;
+    int job_i;
+
+    for (done_i = 0; done_i < g_nb_jobs_done; done_i++) {
+
+        job_i = g_done_slots[done_i];
+
+        if (do_print) {
+
+            /* Print the completed job */
+            printf("[%d] - %d done (%s)\n", job_i, g_jobs[job_i]->gpid,
+                   cmd_tab_get_cmd_str(g_jobs[job_i]->p_cmd_tab));
+        }
+
+        __jobs_remove(job_i);
+    }
+
+    g_nb_jobs_done = 0;
+}
+
+/**
+ * @brief Removes a completed job without reporting it
+ * @param[in] job_i Slot of the job
+ */
+static void __jobs_remove_quiet(int job_i) {
+
+    int done_i;
+
+    /* Take it out of the completed jobs (it is the last one, unless other
+     * jobs completed at the same time) */
+    for (done_i = g_nb_jobs_done - 1; (done_i >= 0) && (g_done_slots[done_i] != job_i); done_i--);
+
+    if (done_i >= 0) {
+
+        memmove(g_done_slots + done_i, g_done_slots + done_i + 1, (g_nb_jobs_done - done_i - 1) * sizeof(int));
+        g_nb_jobs_done--;
+    }
+
+    __jobs_remove(job_i);
+}
+
+/**
+ * @brief Makes sure that the pool has a free slot, the pool is doubled when
+ *        full (its new slots are taken from the lowest)
+ */
+static void __jobs_grow() {
+
+    int old_nb_slots = g_nb_slots;
+    int slot_i;
+
+    if (g_nb_free) {
+
+        return;
+    }
+
+    g_nb_slots = old_nb_slots ? 2 * old_nb_slots : JOBS_MIN_SLOTS;
+    g_jobs = (job_t **)realloc(g_jobs, g_nb_slots * sizeof(job_t *));
+    g_free_slots = (int *)realloc(g_free_slots, g_nb_slots * sizeof(int));
+    g_done_slots = (int *)realloc(g_done_slots, g_nb_slots * sizeof(int));
+
+    for (slot_i = g_nb_slots - 1; slot_i >= old_nb_slots; slot_i--) {
+
+        g_jobs[slot_i] = NULL;
+        g_free_slots[g_nb_free++] = slot_i;
+    }
+}
+
+/**
+ * @brief Initialize the jobs global variables, the changes of the processes
+ *        (and the interruptions of the prompt) are taken by an event loop
+ *        over a signal descriptor and a descriptor per process, the signals
+ *        are blocked so that they only reach the loop
+ * @param[in] is_interactive Whether the shell controls a terminal
+ */
+void jobs_init(bool is_interactive) {
+
+    struct epoll_event event;
+    sigset_t sig_set;
+
+    /* Set the number of jobs to zero (the pool grows with the first one) */
     g_nb_jobs = 0;
+    g_nb_jobs_done = 0;
+
+    /* Set the job control mode */
+    g_is_interactive = is_interactive;
+
+    /* Block the signals taken by the loop (before any thread is started,
+     * the threads keep them blocked), without a terminal SIGINT keeps its
+     * default action so that a running script can be interrupted, SIGTSTP
+     * is taken as well so that the shell is never stopped itself */
+    sigemptyset(&sig_set);
+    sigaddset(&sig_set, SIGCHLD);
+
+    if (is_interactive) {
+
+        sigaddset(&sig_set, SIGINT);
+        sigaddset(&sig_set, SIGTSTP);
+    }
+
+    sigprocmask(SIG_BLOCK, &sig_set, NULL);
+
+    /* Create the event loop and the signal descriptor */
+    g_epoll_fd = __jobs_high_fd(epoll_create1(EPOLL_CLOEXEC));
+    g_signal_fd = __jobs_high_fd(signalfd(-1, &sig_set, SFD_NONBLOCK | SFD_CLOEXEC));
+
+    event.events = EPOLLIN;
+    event.data.u64 = JOBS_EVENT_SIGNAL;
+    epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, g_signal_fd, &event);
 }
 
 /**
@@ -101,17 +647,19 @@ void jobs_init() {
  */
 void jobs_signal_init() {
 
-    /* Initialize the SIGINT handler */
-    signal(SIGINT, SIG_IGN);
+    /* Without a terminal the keyboard signals keep their default action, so
+     * that a running script can be interrupted */
+    if (g_is_interactive) {
 
-    /* Initialize the SIGTSTP handler */
-    signal(SIGTSTP, SIG_IGN);
+        /* Initialize the SIGINT handler */
+        signal(SIGINT, SIG_IGN);
+
+        /* Initialize the SIGTSTP handler */
+        signal(SIGTSTP, SIG_IGN);
+    }
 
     /* Initialize the SIGTTOU handler to be ignored */
     signal(SIGTTOU, SIG_IGN);
-
-    /* Initialize the SIGCHLD handler */
-    signal(SIGCHLD, __sigchld_handler);
 }
 
 /**
@@ -127,42 +675,64 @@ void jobs_signal_deinit() {
 
     /* Reset SIGTTOU handler */
     signal(SIGTTOU, SIG_DFL);
-
-    /* Reset the SIGCHLD handler */
-    signal(SIGCHLD, __sigchld_handler);
 }
 
 /**
  * @brief Creates a new job for the specified process group
  * @param[in] Process group id
  * @param[in] cmd_tab Command table for the group
+ * @param[in] nb_procs Number of processes the group can hold
  */
-void jobs_add_proc_grp(int gpid, cmd_tab_t *p_cmd_tab) {
+void jobs_add_proc_grp(int gpid, cmd_tab_t *p_cmd_tab, int nb_procs) {
+
+    job_t *p_job;
+    size_t tab_off;
+    int job_i;
+
+    /* Take a free slot */
+    __jobs_grow();
+    job_i = g_free_slots[--g_nb_free];
+
+    /* Offset of the command table, after the job and its process array */
+    tab_off = sizeof(job_t) + nb_procs * sizeof(job_proc_t);
+    tab_off = (tab_off + (JOB_ALIGN - 1)) & ~(JOB_ALIGN - 1);
+
+    /* Allocate the job, its process array and the command table copy as a
+     * single block */
+    p_job = (job_t *)malloc(tab_off + cmd_tab_get_packed_size(p_cmd_tab));
 
     /* Initialize a new job for the new process group */
-    g_jobs[g_nb_jobs].gpid = gpid;
+    p_job->gpid = gpid;
 
     /* Initialize the command table for the process group */
-    /* g_jobs[g_nb_jobs].cmd_tab = *p_cmd_tab; */
-    cmd_tab_copy(&g_jobs[g_nb_jobs].cmd_tab, p_cmd_tab);
+    p_job->p_cmd_tab = cmd_tab_pack((char *)p_job + tab_off, p_cmd_tab);
 
     /* Initialize the number of processes currently in the group */
-    g_jobs[g_nb_jobs].nb_pids = 0;
+    p_job->nb_pids = 0;
+    p_job->max_pids = nb_procs;
+
+    /* Initialize the number of processes completed and stopped */
+    p_job->nb_procs_comp = 0;
+    p_job->nb_procs_stopped = 0;
 
-    /* Initialize the number of processes completed */
-    g_jobs[g_nb_jobs].nb_procs_comp = 0;
+    /* Add the job to the pool */
+    g_jobs[job_i] = p_job;
+    __jobs_index_put(&g_gpid_index, gpid, job_i, -1);
 
     /* Increment the number of jobs */
     g_nb_jobs++;
 }
 
 /**
- * @brief Adds the process to the specified process group
+ * @brief Adds the process to the specified process group, its exit is
+ *        watched by the event loop through its process descriptor
  * @param[in] gpid Process group id
  * @param[in] pid Process id
  */
 void jobs_add_proc(int gpid, int pid) {
 
+    struct epoll_event event;
+    job_proc_t *p_proc;
     int idx;
 
     /* Get the index from the group id */
@@ -174,35 +744,63 @@ void jobs_add_proc(int gpid, int pid) {
         return;
     }
 
+    /* If the process list is full */
+    if (g_jobs[idx]->nb_pids == g_jobs[idx]->max_pids) {
+
+        return;
+    }
+
     /* Add the process to the process' list */
-    g_jobs[idx].pids[g_jobs[idx].nb_pids] = pid;
+    p_proc = &g_jobs[idx]->procs[g_jobs[idx]->nb_pids];
+    p_proc->pid = pid;
+    p_proc->state = JOB_RUNNING;
+    p_proc->status = 0;
+    __jobs_index_put(&g_pid_index, pid, idx, g_jobs[idx]->nb_pids);
+
+    /* Watch the process (a process exited already is still there until it
+     * is reaped, so its descriptor is readable at once) */
+    p_proc->pidfd = __jobs_high_fd(pidfd_open(pid, 0));
+
+    event.events = EPOLLIN;
+    event.data.u64 = (uint64_t)pid;
+
+    if ((p_proc->pidfd != -1) && epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, p_proc->pidfd, &event)) {
+
+        close(p_proc->pidfd);
+        p_proc->pidfd = -1;
+    }
 
     /* Increment the nubmer of pids in the process' list */
-    g_jobs[idx].nb_pids++;
+    g_jobs[idx]->nb_pids++;
+
+    /* Without a descriptor (no pidfd support, or no descriptor left) the
+     * process is reaped when SIGCHLD is read (its SIGCHLD is not read yet
+     * if it exited already, the loop is not run meanwhile) */
+    g_nb_unwatched += (p_proc->pidfd == -1);
 }
 
 /**
  * @brief Moves the group in which the specified pid lies, to the foreground
+ *        and runs the event loop till it is done or stopped
  * @param[in] pid Process id
+ * @param[out] p_status Exit status of the group, the status of its last
+ *             process (128 plus SIGTSTP if it is stopped), NULL if not
+ *             needed
+ * @return true If the group was stopped, or a process of it interrupted
+ *         (^C or ^Z while the group had the terminal)
+ * @return false Otherwise
  */
-void jobs_fg_proc_grp(int pid) {
+bool jobs_fg_proc_grp(int pid, int *p_status) {
 
-    int cmd_i;
+    job_t *p_job;
     int idx;
-    int nb_cmds;
+    int pid_i;
     int gpid;
-    int cpid;
-    int status;
+    bool is_interrupted = false;
     /* String to store the controlling terminal name */
     char tty_name[128];
     /* File descriptor for the controlling terminal */
-    int tty_fd;
-
-    /* Get the controlling terminal name */
-    ctermid(tty_name);
-
-    /* Open the controlling terminal file */
-    tty_fd = open(tty_name, O_RDONLY);
+    int tty_fd = -1;
 
     /* Get the index of jobs for the given process */
     idx = __get_idx_from_pid(pid);
@@ -210,46 +808,90 @@ void jobs_fg_proc_grp(int pid) {
     /* If the pid is not found */
     if (idx == -1) {
 
-        return;
+        return false;
     }
 
     /* Get the group pid */
-    gpid = g_jobs[idx].gpid;
+    p_job = g_jobs[idx];
+    gpid = p_job->gpid;
+
+    /* If there is a terminal to be handed over */
+    if (g_is_interactive) {
+
+        /* Get the controlling terminal name */
+        ctermid(tty_name);
+
+        /* Open the controlling terminal file */
+        tty_fd = open(tty_name, O_RDONLY);
 
-    /* Send a stop signal to the entire process group */
-    killpg(gpid, SIGTSTP);
+        /* Send a stop signal to the entire process group */
+        killpg(gpid, SIGTSTP);
 
-    /* Make the entire child process group as foreground process group */
-    tcsetpgrp(tty_fd, gpid);
+        /* Make the entire child process group as foreground process group */
+        tcsetpgrp(tty_fd, gpid);
+    }
 
     /* Send a continuation signal to the entire process group */
     killpg(gpid, SIGCONT);
 
-    /* Get the number of commands for the job */
-    nb_cmds = cmd_tab_get_nb_cmds(&g_jobs[idx].cmd_tab);
+    /* The processes left run again */
+    for (pid_i = 0; pid_i < p_job->nb_pids; pid_i++) {
+
+        __jobs_set_proc_state(idx, pid_i, JOB_RUNNING);
+    }
 
-    /* For each of the child process */
-    for (cmd_i = 0; cmd_i < nb_cmds; cmd_i++) {
+    /* Handle the events till every process is done or stopped (the jobs
+     * are not removed meanwhile, stages run as threads of the shell are
+     * not in the group) */
+    while (__jobs_get_state(p_job) == JOB_RUNNING) {
 
-        /* Wait till the child process either terminates/suspends */
-        cpid = waitpid(-gpid, &status, WUNTRACED);
+        __jobs_dispatch(-1);
+    }
 
-        /* If the process exited normally or by a signal */
-        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+    /* The prompt was not interrupted (the group had the terminal) */
+    g_is_interrupted = false;
+    g_is_suspended = false;
 
-            /* Mark the job complete */
-            jobs_mark_proc_comp(pid, false);
+    /* If the job is done it is removed without a report */
+    if (__jobs_get_state(p_job) == JOB_DONE) {
+
+        for (pid_i = 0; pid_i < p_job->nb_pids; pid_i++) {
+
+            is_interrupted |= (p_job->procs[pid_i].status == 128 + SIGINT);
         }
-        else if (WIFSTOPPED(status)) {
 
-            /* Print the suspended job */
-            printf("\n[%d] - %d suspended (%s)\n", idx, cpid,
-                   cmd_tab_get_cmd_str(&g_jobs[idx].cmd_tab));
+        if (p_status) {
+
+            *p_status = p_job->procs[p_job->nb_pids - 1].status;
         }
+
+        __jobs_remove_quiet(idx);
     }
+    else {
+
+        is_interrupted = true;
+
+        if (p_status) {
 
-    /* Make the current (parent process) as the foreground process group */
-    tcsetpgrp(tty_fd, getpgid(getpid()));
+            *p_status = 128 + SIGTSTP;
+        }
+
+        /* Print the suspended job */
+        printf("\n[%d] - %d suspended (%s)\n", idx, gpid,
+               cmd_tab_get_cmd_str(p_job->p_cmd_tab));
+    }
+
+    /* If the terminal was handed over */
+    if (tty_fd != -1) {
+
+        /* Make the current (parent process) as the foreground process group */
+        tcsetpgrp(tty_fd, getpgid(getpid()));
+
+        /* Close the controlling terminal file */
+        close(tty_fd);
+    }
+
+    return is_interrupted;
 }
 
 /**
@@ -260,6 +902,7 @@ void jobs_bg_proc_grp(int pid) {
 
     int idx;
     int gpid;
+    int pid_i;
 
     /* Get the index using the given pid */
     idx = __get_idx_from_pid(pid);
@@ -271,89 +914,265 @@ void jobs_bg_proc_grp(int pid) {
     }
 
     /* Get the process group id */
-    gpid = g_jobs[idx].gpid;
+    gpid = g_jobs[idx]->gpid;
 
     /* Send a signal to the entire process group */
     killpg(gpid, SIGCONT);
+
+    /* The processes left run again */
+    for (pid_i = 0; pid_i < g_jobs[idx]->nb_pids; pid_i++) {
+
+        __jobs_set_proc_state(idx, pid_i, JOB_RUNNING);
+    }
 }
 
 /**
- * @brief Marks the specified pid as completed
- * @param[in] pid Process id
- * @param[in] do_print Whether to print the debug information
+ * @brief Runs the event loop till the file descriptor is readable, the jobs
+ *        completed meanwhile are reported (and the prompt printed again, as
+ *        it is when the prompt is interrupted)
+ * @param[in] fd File descriptor (the terminal)
  */
-void jobs_mark_proc_comp(int pid, bool do_print) {
+void jobs_wait_fd(int fd) {
 
-    int idx;
-    int nb_procs_comp;
+    struct epoll_event event;
+
+    /* A descriptor which cannot be waited for is read at once */
+    event.events = EPOLLIN;
+    event.data.u64 = JOBS_EVENT_INPUT;
 
-    /* If a valid pid is returned by wait */
-    if (pid < 1) {
+    if (epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
 
         return;
     }
 
-    /* Get the process group id from the pid */
-    idx = __get_idx_from_pid(pid);
+    g_is_input_ready = false;
 
-    /* If pid not found */
-    if (idx == -1) {
+    while (!g_is_input_ready) {
 
-        return;
-    }
+        __jobs_dispatch(-1);
 
-    /* Increment the number of completed processes */
-    nb_procs_comp = ++g_jobs[idx].nb_procs_comp;
+        /* Let the runs in the background start their next jobs */
+        if (g_hook) {
 
-    /* If the number of completed processes is same as the number of commands */
-    if (nb_procs_comp == cmd_tab_get_nb_cmds(&g_jobs[idx].cmd_tab)) {
+            g_hook();
+        }
 
-        if (do_print) {
+        /* Report the completed jobs */
+        if (g_nb_jobs_done) {
 
-            /* Print the completed job */
-            printf("\n[%d] - %d done (%s)\n", idx, g_jobs[idx].gpid,
-                   cmd_tab_get_cmd_str(&g_jobs[idx].cmd_tab));
+            printf("\n");
+            __jobs_remove_done(g_is_interactive);
+            prompt_print();
+        }
+        /* Print the prompt on a new line if interrupted */
+        else if (g_is_interrupted) {
 
-            /* Print the prompt */
+            printf("\n");
             prompt_print();
         }
 
-        /* Deallocate the memory of the command table */
-        cmd_tab_deinit(&g_jobs[idx].cmd_tab);
+        /* ^Z is ignored at the prompt */
+        g_is_interrupted = false;
+        g_is_suspended = false;
+    }
+
+    epoll_ctl(g_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+/**
+ * @brief Handles the events of the loop without waiting, and removes the
+ *        completed jobs (called between the command lines)
+ */
+void jobs_poll() {
+
+    if (g_nb_jobs) {
 
-        /* Remove the process group entry from the job list */
-        for (; idx < g_nb_jobs - 1; idx++) {
+        __jobs_dispatch(0);
 
-            /* Shift the jobs to the left */
-            g_jobs[idx] = g_jobs[idx + 1];
+        if (g_hook) {
+
+            g_hook();
         }
 
-        /* Decrement the number of jobs */
-        g_nb_jobs--;
+        __jobs_remove_done(g_is_interactive);
     }
 }
 
+/**
+ * @brief Reports the completed jobs and removes them (called before the
+ *        prompt)
+ */
+void jobs_report() {
+
+    /* The runs in the background take their jobs first */
+    if (g_hook) {
+
+        g_hook();
+    }
+
+    __jobs_remove_done(g_is_interactive);
+}
+
+/**
+ * @brief Handles the events of the loop, waiting till there is one (the jobs
+ *        are only updated, the completed ones are removed by the caller)
+ * @param[in] fd File descriptor also waited for to be readable (-1 for none)
+ * @return true If the file descriptor is readable (or cannot be waited for)
+ * @return false Otherwise
+ */
+bool jobs_wait(int fd) {
+
+    struct epoll_event event;
+
+    event.events = EPOLLIN;
+    event.data.u64 = JOBS_EVENT_INPUT;
+
+    g_is_input_ready = false;
+
+    /* A descriptor which cannot be waited for (a file) is read at once */
+    if ((fd != -1) && epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+
+        return true;
+    }
+
+    __jobs_dispatch(-1);
+
+    if (fd != -1) {
+
+        epoll_ctl(g_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+
+    return g_is_input_ready;
+}
+
+/**
+ * @brief Checks if the shell was interrupted (^C) while it waited for the
+ *        jobs, the interruption is cleared
+ * @return true If interrupted
+ * @return false Otherwise
+ */
+bool jobs_is_interrupted() {
+
+    bool is_interrupted = g_is_interrupted;
+
+    g_is_interrupted = false;
+
+    return is_interrupted;
+}
+
+/**
+ * @brief Checks if the shell was suspended (^Z) while it waited for the
+ *        jobs, the suspension is cleared
+ * @return true If suspended
+ * @return false Otherwise
+ */
+bool jobs_is_suspended() {
+
+    bool is_suspended = g_is_suspended;
+
+    g_is_suspended = false;
+
+    return is_suspended;
+}
+
+/**
+ * @brief Returns the state of the process group
+ * @param[in] gpid Process group id
+ * @return State of the group (done if it is not a job)
+ */
+job_state_t jobs_get_grp_state(int gpid) {
+
+    int idx = __get_idx_from_gpid(gpid);
+
+    return (idx == -1) ? JOB_DONE : __jobs_get_state(g_jobs[idx]);
+}
+
+/**
+ * @brief Returns the exit status of the process group, the status of its
+ *        last process (as the status of a pipeline)
+ * @param[in] gpid Process group id
+ * @return Exit status (128 plus the signal number if killed), 0 if it is not
+ *         a job or is not done
+ */
+int jobs_get_grp_status(int gpid) {
+
+    int idx = __get_idx_from_gpid(gpid);
+
+    if ((idx == -1) || !g_jobs[idx]->nb_pids) {
+
+        return 0;
+    }
+
+    return g_jobs[idx]->procs[g_jobs[idx]->nb_pids - 1].status;
+}
+
+/**
+ * @brief Removes the completed process group without reporting it
+ * @param[in] gpid Process group id
+ */
+void jobs_remove_grp(int gpid) {
+
+    int idx = __get_idx_from_gpid(gpid);
+
+    if (idx != -1) {
+
+        __jobs_remove_quiet(idx);
+    }
+}
+
+/**
+ * @brief Sets the function called after the events of the loop are handled
+ *        while the shell waits for its input
+ * @param[in] hook Function (NULL for none)
+ */
+void jobs_set_hook(jobs_hook_t hook) {
+
+    g_hook = hook;
+}
+
 /**
  * @brief Prints the jobs maintained by the shell
  */
 void jobs_print() {
 
+    /* Names of the states */
+    static const char *state_names[] = {
+
+        [JOB_RUNNING] = "running",
+        [JOB_STOPPED] = "stopped",
+        [JOB_DONE] = "done"
+    };
+
     int job_i;
 
+    /* Take the changes not handled yet */
+    if (g_nb_jobs) {
+
+        __jobs_dispatch(0);
+    }
+
     /* Print the headers */
-    printf("JOB_ID\tPGID\tCOMMAND\n");
+    printf("JOB_ID\tPGID\tSTATE\tCOMMAND\n");
+
+    /* For every job (in the order of their slots) */
+    for (job_i = 0; job_i < g_nb_slots; job_i++) {
 
-    /* For every job */
-    for (job_i = 0; job_i < g_nb_jobs; job_i++) {
+        if (!g_jobs[job_i]) {
+
+            continue;
+        }
 
         /* Print the job index */
         printf("[%d]\t", job_i);
 
         /* Print the process group id */
-        printf("%d\t", g_jobs[job_i].gpid);
+        printf("%d\t", g_jobs[job_i]->gpid);
+
+        /* Print the state */
+        printf("%s\t", state_names[__jobs_get_state(g_jobs[job_i])]);
 
         /* Print the command string */
-        printf("%s\n", cmd_tab_get_cmd_str(&g_jobs[job_i].cmd_tab));
+        printf("%s\n", cmd_tab_get_cmd_str(g_jobs[job_i]->p_cmd_tab));
     }
 }
 
@@ -367,6 +1186,12 @@ void jobs_kill_grp(int pid, int sig_num) {
     /* Get the index of the job from the global array */
     int idx = __get_idx_from_pid(pid);
 
+    /* If pid not found */
+    if (idx == -1) {
+
+        return;
+    }
+
     /* Send the signal to the process group */
-    killpg(g_jobs[idx].gpid, sig_num);
+    killpg(g_jobs[idx]->gpid, sig_num);
 }
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "options.h"
+
+/* Names of the options */
+static const char *g_option_names[NB_OPTIONS] = {
+
+    [OPTION_PIPE_SIZE] = "pipe_size",
+    [OPTION_BATCH_WIDTH] = "batch_width"
+};
+
+/* Values of the options */
+long g_options[NB_OPTIONS];
+
+/**
+ * @brief Sets every option to its default value
+ */
+void options_init() {
+
+    g_options[OPTION_PIPE_SIZE] = 0;
+    g_options[OPTION_BATCH_WIDTH] = 0;
+}
+
+/**
+ * @brief Returns the value of the option
+ * @param[in] option Option
+ * @return Value
+ */
+long options_get(option_t option) {
+
+    return g_options[option];
+}
+
+/**
+ * @brief Sets the value of the option given its name
+ * @param[in] name Name of the option
+ * @param[in] value Value (non negative integer)
+ * @return 0 On success
+ * @return -1 If the option or the value is invalid
+ */
+int options_set(const char *name, const char *value) {
+
+    int option;
+    long num;
+    char *end;
+
+    /* Parse the value */
+    num = strtol(value, &end, 0);
+
+    if ((end == value) || *end || (num < 0)) {
+
+        return -1;
+    }
+
+    /* Find the option */
+    for (option = 0; option < NB_OPTIONS; option++) {
+
+        if (!strcmp(g_option_names[option], name)) {
+
+            g_options[option] = num;
+
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Prints every option with its value
+ */
+void options_print() {
+
+    int option;
+
+    /* Print the headers */
+    printf("OPTION\tVALUE\n");
+
+    for (option = 0; option < NB_OPTIONS; option++) {
+
+        printf("%s\t%ld\n", g_option_names[option], g_options[option]);
+    }
+}
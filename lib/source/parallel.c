@@ -0,0 +1,665 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include "parallel.h"
+#include "executor.h"
+#include "jobs.h"
+
+/* Lowest file descriptor of a run (above the ones which can be redirected) */
+#define PARALLEL_MIN_FD (10)
+
+/* Writes an error of the built-in */
+#define WRITE_ERROR(err_fd, fmt, ...)                                       \
+    ({                                                                      \
+        dprintf(err_fd, "kavach: parallel: " fmt "\n", ##__VA_ARGS__);     \
+    })
+
+/* Argument of the instance being expanded */
+static const char *g_arg;
+static size_t g_arg_len;
+
+/* Run in the background (NULL if none) */
+static parallel_t *g_p_bg_run;
+
+/**
+ * @brief Expands a token of the template, the placeholders are replaced by
+ *        the argument of the instance
+ * @param[in] str Token
+ * @param[in] len Length of the token
+ * @param[out] out Output
+ * @param[in] size Size of the output
+ * @return Length of the expansion
+ */
+static size_t __parallel_expand(const char *str, size_t len, char *out, size_t size) {
+
+    size_t exp_len = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+
+        if ((i + sizeof(PARALLEL_ARG) - 1 <= len) && !memcmp(str + i, PARALLEL_ARG, sizeof(PARALLEL_ARG) - 1)) {
+
+            if (exp_len + g_arg_len <= size) {
+
+                memcpy(out + exp_len, g_arg, g_arg_len);
+            }
+
+            exp_len += g_arg_len;
+            i += sizeof(PARALLEL_ARG) - 2;
+        }
+        else {
+
+            if (exp_len < size) {
+
+                out[exp_len] = str[i];
+            }
+
+            exp_len++;
+        }
+    }
+
+    return exp_len;
+}
+
+/**
+ * @brief Moves the file descriptor above the ones which can be redirected
+ * @param[in] fd File descriptor (closed)
+ * @return New file descriptor (-1 if the given one is)
+ */
+static int __parallel_high_fd(int fd) {
+
+    int high_fd;
+
+    if (fd == -1) {
+
+        return -1;
+    }
+
+    high_fd = fcntl(fd, F_DUPFD_CLOEXEC, PARALLEL_MIN_FD);
+    close(fd);
+
+    return high_fd;
+}
+
+/**
+ * @brief Sets the command table of the template from its words, the
+ *        placeholder is appended if no word has one
+ * @param[out] p_run Pointer to the run
+ * @param[in] words Words of the template
+ * @param[in] nb_words Number of words
+ */
+static void __parallel_set_tmpl(parallel_t *p_run, char **words, int nb_words) {
+
+    bool has_arg = false;
+    size_t len = 0;
+    size_t off = 0;
+    char *str;
+    int word_i;
+
+    for (word_i = 0; word_i < nb_words; word_i++) {
+
+        len += strlen(words[word_i]) + 1;
+        has_arg |= (strstr(words[word_i], PARALLEL_ARG) != NULL);
+    }
+
+    /* Join the words by spaces */
+    str = (char *)malloc(len + sizeof(PARALLEL_ARG));
+
+    for (word_i = 0; word_i < nb_words; word_i++) {
+
+        len = strlen(words[word_i]);
+        memcpy(str + off, words[word_i], len);
+        str[off + len] = ' ';
+        off += len + 1;
+    }
+
+    if (has_arg) {
+
+        str[off - 1] = '\0';
+    }
+    else {
+
+        memcpy(str + off, PARALLEL_ARG, sizeof(PARALLEL_ARG));
+    }
+
+    /* Add the words as the arguments of a single command (they are not
+     * parsed again) */
+    cmd_tab_set_str(&p_run->tmpl, str);
+    cmd_tab_add_cmd(&p_run->tmpl);
+
+    for (off = 0, word_i = 0; word_i < nb_words; word_i++) {
+
+        len = strlen(words[word_i]);
+        cmd_tab_add_cmd_arg(&p_run->tmpl, off, len);
+        off += len + 1;
+    }
+
+    if (!has_arg) {
+
+        cmd_tab_add_cmd_arg(&p_run->tmpl, off, sizeof(PARALLEL_ARG) - 1);
+    }
+
+    cmd_tab_add_cmd(&p_run->tmpl);
+
+    free(str);
+}
+
+/**
+ * @brief Makes sure that the buffer of the arguments has the space for the
+ *        given number of bytes
+ * @param[in,out] p_run Pointer to the run
+ * @param[in] len Number of bytes
+ */
+static void __parallel_grow(parallel_t *p_run, size_t len) {
+
+    if (p_run->size - p_run->len >= len) {
+
+        return;
+    }
+
+    while (p_run->size - p_run->len < len) {
+
+        p_run->size *= 2;
+    }
+
+    p_run->buf = (char *)realloc(p_run->buf, p_run->size);
+}
+
+/**
+ * @brief Adds an argument to the run
+ * @param[in,out] p_run Pointer to the run
+ * @param[in] arg Argument
+ */
+static void __parallel_push(parallel_t *p_run, const char *arg) {
+
+    size_t len = strlen(arg);
+
+    __parallel_grow(p_run, len + 1);
+
+    memcpy(p_run->buf + p_run->len, arg, len);
+    p_run->buf[p_run->len + len] = '\n';
+    p_run->len += len + 1;
+}
+
+/**
+ * @brief Reads the next arguments from the input of the run, the input is
+ *        closed at its end
+ * @param[in,out] p_run Pointer to the run
+ */
+static void __parallel_read(parallel_t *p_run) {
+
+    ssize_t nb_read;
+
+    /* Drop the arguments used */
+    if (p_run->pos) {
+
+        memmove(p_run->buf, p_run->buf + p_run->pos, p_run->len - p_run->pos);
+        p_run->len -= p_run->pos;
+        p_run->pos = 0;
+    }
+
+    __parallel_grow(p_run, PARALLEL_READ_MIN_SIZE);
+
+    nb_read = read(p_run->in_fd, p_run->buf + p_run->len, p_run->size - p_run->len);
+
+    if (nb_read > 0) {
+
+        p_run->len += nb_read;
+        return;
+    }
+
+    if ((nb_read == -1) && ((errno == EINTR) || (errno == EAGAIN))) {
+
+        return;
+    }
+
+    close(p_run->in_fd);
+    p_run->in_fd = -1;
+
+    /* The last line needs no newline */
+    if ((p_run->len > p_run->pos) && (p_run->buf[p_run->len - 1] != '\n')) {
+
+        p_run->buf[p_run->len++] = '\n';
+    }
+}
+
+/**
+ * @brief Returns the next argument of the run (the blank lines are skipped)
+ * @param[in,out] p_run Pointer to the run
+ * @param[out] p_len Length of the argument
+ * @return Argument (not NULL terminated), NULL if there is none yet
+ */
+static const char *__parallel_next_arg(parallel_t *p_run, size_t *p_len) {
+
+    const char *arg;
+    char *p_nl;
+
+    while ((p_nl = (char *)memchr(p_run->buf + p_run->pos, '\n', p_run->len - p_run->pos))) {
+
+        arg = p_run->buf + p_run->pos;
+        *p_len = p_nl - arg;
+        p_run->pos = p_nl - p_run->buf + 1;
+
+        if (*p_len) {
+
+            return arg;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Creates a memory file holding the output of an instance
+ * @return File descriptor (-1 if it cannot be created)
+ */
+static int __parallel_memfd() {
+
+    return __parallel_high_fd(memfd_create("parallel", MFD_CLOEXEC));
+}
+
+/**
+ * @brief Writes the whole buffer to the file descriptor
+ * @param[in] fd File descriptor
+ * @param[in] buf Buffer
+ * @param[in] len Length of the buffer
+ * @return true If written
+ * @return false Otherwise
+ */
+static bool __parallel_write(int fd, const char *buf, size_t len) {
+
+    ssize_t nb_written;
+
+    while (len) {
+
+        nb_written = write(fd, buf, len);
+
+        if (nb_written <= 0) {
+
+            return false;
+        }
+
+        buf += nb_written;
+        len -= nb_written;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Copies the output held by the memory file to the file descriptor,
+ *        and empties it for the next instance
+ * @param[in] src File descriptor of the memory file
+ * @param[in] dest File descriptor
+ */
+static void __parallel_copy(int src, int dest) {
+
+    char buf[PARALLEL_COPY_SIZE];
+    off_t size;
+    off_t off = 0;
+    ssize_t nb_read;
+
+    /* The instance wrote from the start, through the same offset */
+    size = lseek(src, 0, SEEK_CUR);
+
+    /* Let the kernel copy it (the output is known to be complete) */
+    while ((off < size) && (sendfile(dest, src, &off, size - off) > 0));
+
+    /* Copy the rest by hand if it could not (an output opened to append) */
+    while ((off < size) && ((nb_read = pread(src, buf, sizeof(buf), off)) > 0)) {
+
+        if (!__parallel_write(dest, buf, nb_read)) {
+
+            break;
+        }
+
+        off += nb_read;
+    }
+
+    ftruncate(src, 0);
+    lseek(src, 0, SEEK_SET);
+}
+
+/**
+ * @brief Writes the output of the instance of the slot, at once
+ * @param[in] p_run Pointer to the run
+ * @param[in] p_slot Pointer to the slot
+ */
+static void __parallel_flush(parallel_t *p_run, parallel_slot_t *p_slot) {
+
+    if (p_slot->out_fd != -1) {
+
+        __parallel_copy(p_slot->out_fd, p_run->out_fd);
+    }
+
+    if (p_slot->err_fd != -1) {
+
+        __parallel_copy(p_slot->err_fd, p_run->err_fd);
+    }
+}
+
+/**
+ * @brief Starts the instance of the argument in the free slot, its output is
+ *        held till it is done
+ * @param[in,out] p_run Pointer to the run
+ * @param[in] slot_i Index of the slot
+ * @param[in] arg Argument
+ * @param[in] len Length of the argument
+ */
+static void __parallel_start(parallel_t *p_run, int slot_i, const char *arg, size_t len) {
+
+    parallel_slot_t *p_slot = &p_run->slots[slot_i];
+    int gpid;
+
+    /* The output is written as it comes if it cannot be held */
+    if (p_slot->out_fd == -1) {
+
+        p_slot->out_fd = __parallel_memfd();
+    }
+
+    if (p_slot->err_fd == -1) {
+
+        p_slot->err_fd = __parallel_memfd();
+    }
+
+    /* Replace the placeholders by the argument */
+    g_arg = arg;
+    g_arg_len = len;
+
+    cmd_tab_reset(&p_run->inst);
+    cmd_tab_expand(&p_run->inst, &p_run->tmpl, __parallel_expand);
+
+    /* Start the instance through the executor, its processes are a job */
+    gpid = executor_start_cmd_tab(&p_run->inst,
+                                  p_run->null_fd,
+                                  (p_slot->out_fd != -1) ? p_slot->out_fd : p_run->out_fd,
+                                  (p_slot->err_fd != -1) ? p_slot->err_fd : p_run->err_fd,
+                                  NULL);
+
+    /* The commands are started with the default handlers */
+    jobs_signal_init();
+
+    /* An instance without a process (run by the shell) is done already */
+    if (gpid == -1) {
+
+        __parallel_flush(p_run, p_slot);
+        return;
+    }
+
+    p_slot->gpid = gpid;
+    p_run->nb_running++;
+}
+
+/**
+ * @brief Writes the output of the instances done and frees their slots, the
+ *        jobs are removed without a report
+ * @param[in,out] p_run Pointer to the run
+ */
+static void __parallel_collect(parallel_t *p_run) {
+
+    parallel_slot_t *p_slot;
+    int slot_i;
+
+    for (slot_i = 0; slot_i < p_run->nb_slots; slot_i++) {
+
+        p_slot = &p_run->slots[slot_i];
+
+        if ((p_slot->gpid != -1) && (jobs_get_grp_state(p_slot->gpid) == JOB_DONE)) {
+
+            __parallel_flush(p_run, p_slot);
+            jobs_remove_grp(p_slot->gpid);
+
+            p_slot->gpid = -1;
+            p_run->nb_running--;
+        }
+    }
+}
+
+/**
+ * @brief Signals the instances running, no instance is started anymore
+ * @param[in,out] p_run Pointer to the run
+ * @param[in] sig_num Signal number
+ */
+static void __parallel_stop(parallel_t *p_run, int sig_num) {
+
+    int slot_i;
+
+    p_run->is_stopping = true;
+
+    for (slot_i = 0; slot_i < p_run->nb_slots; slot_i++) {
+
+        if (p_run->slots[slot_i].gpid != -1) {
+
+            killpg(p_run->slots[slot_i].gpid, sig_num);
+            killpg(p_run->slots[slot_i].gpid, SIGCONT);
+        }
+    }
+}
+
+/**
+ * @brief Collects the instances done and starts the next ones in the free
+ *        slots
+ * @param[in,out] p_run Pointer to the run
+ * @return true If the run is done
+ * @return false Otherwise
+ */
+static bool __parallel_step(parallel_t *p_run) {
+
+    const char *arg;
+    size_t len;
+    int slot_i = 0;
+
+    __parallel_collect(p_run);
+
+    while (!p_run->is_stopping && (p_run->nb_running < p_run->nb_slots) &&
+           (arg = __parallel_next_arg(p_run, &len))) {
+
+        /* The slots before are taken */
+        while (p_run->slots[slot_i].gpid != -1) {
+
+            slot_i++;
+        }
+
+        __parallel_start(p_run, slot_i, arg, len);
+    }
+
+    return !p_run->nb_running && (p_run->is_stopping || (p_run->in_fd == -1));
+}
+
+/**
+ * @brief Frees the run
+ * @param[in] p_run Pointer to the run
+ */
+static void __parallel_free(parallel_t *p_run) {
+
+    int slot_i;
+
+    for (slot_i = 0; slot_i < p_run->nb_slots; slot_i++) {
+
+        if (p_run->slots[slot_i].out_fd != -1) {
+
+            close(p_run->slots[slot_i].out_fd);
+        }
+
+        if (p_run->slots[slot_i].err_fd != -1) {
+
+            close(p_run->slots[slot_i].err_fd);
+        }
+    }
+
+    if (p_run->in_fd != -1) {
+
+        close(p_run->in_fd);
+    }
+
+    close(p_run->null_fd);
+    close(p_run->out_fd);
+    close(p_run->err_fd);
+
+    cmd_tab_deinit(&p_run->inst);
+    cmd_tab_deinit(&p_run->tmpl);
+
+    free(p_run->slots);
+    free(p_run->buf);
+    free(p_run);
+}
+
+/**
+ * @brief Steps the run in the background, after the events of the loop are
+ *        handled at the prompt (the run is freed once done)
+ */
+static void __parallel_poll() {
+
+    if (__parallel_step(g_p_bg_run)) {
+
+        __parallel_free(g_p_bg_run);
+        g_p_bg_run = NULL;
+
+        jobs_set_hook(NULL);
+    }
+}
+
+/**
+ * @brief Runs a command template once per argument, at most the given
+ *        number of instances at a time, the arguments follow ::: or are the
+ *        lines of the input (parallel [-j N] command [{}]... [::: arg...])
+ * @param[in] cmd_args Arguments of the command
+ * @param[in] nb_cmd_args Number of arguments
+ * @param[in] in_fd Standard input (the arguments without :::)
+ * @param[in] out_fd Standard output
+ * @param[in] err_fd Standard error
+ * @param[in] is_bg Whether to run in the background, driven by the
+ *            completions of the instances at the prompt
+ */
+void parallel_run(char **cmd_args, int nb_cmd_args, int in_fd, int out_fd, int err_fd, bool is_bg) {
+
+    parallel_t *p_run;
+    long nb_slots = sysconf(_SC_NPROCESSORS_ONLN);
+    char *value;
+    char *p_end;
+    bool is_readable;
+    int arg_i = 1;
+    int sep_i;
+    int slot_i;
+
+    /* Get the number of instances at a time (-j N or -jN) */
+    while ((arg_i < nb_cmd_args) && !strncmp(cmd_args[arg_i], "-j", 2)) {
+
+        value = cmd_args[arg_i][2] ? cmd_args[arg_i] + 2 : cmd_args[++arg_i];
+        nb_slots = value ? strtol(value, &p_end, 10) : 0;
+
+        if (!value || *p_end || (nb_slots < 1) || (nb_slots > PARALLEL_MAX_SLOTS)) {
+
+            WRITE_ERROR(err_fd, "invalid number of jobs (1 to %u)", PARALLEL_MAX_SLOTS);
+            return;
+        }
+
+        arg_i++;
+    }
+
+    /* The template goes till the separator */
+    for (sep_i = arg_i; (sep_i < nb_cmd_args) && strcmp(cmd_args[sep_i], PARALLEL_SEP); sep_i++);
+
+    if (sep_i == arg_i) {
+
+        WRITE_ERROR(err_fd, "usage: parallel [-j N] command [{}]... [::: argument...]");
+        return;
+    }
+
+    if (is_bg && g_p_bg_run) {
+
+        WRITE_ERROR(err_fd, "a run is in the background already");
+        return;
+    }
+
+    p_run = (parallel_t *)calloc(1, sizeof(parallel_t));
+
+    cmd_tab_init(&p_run->tmpl);
+    cmd_tab_init(&p_run->inst);
+    __parallel_set_tmpl(p_run, cmd_args + arg_i, sep_i - arg_i);
+
+    p_run->size = PARALLEL_BUF_MIN_SIZE;
+    p_run->buf = (char *)malloc(p_run->size);
+
+    /* The arguments are given, else they are read */
+    if (sep_i < nb_cmd_args) {
+
+        for (arg_i = sep_i + 1; arg_i < nb_cmd_args; arg_i++) {
+
+            __parallel_push(p_run, cmd_args[arg_i]);
+        }
+
+        p_run->in_fd = -1;
+    }
+    else {
+
+        p_run->in_fd = fcntl(in_fd, F_DUPFD_CLOEXEC, PARALLEL_MIN_FD);
+    }
+
+    /* The instances do not share the input, their outputs are written at
+     * once through copies kept by the run */
+    p_run->null_fd = __parallel_high_fd(open("/dev/null", O_RDONLY | O_CLOEXEC));
+    p_run->out_fd = fcntl(out_fd, F_DUPFD_CLOEXEC, PARALLEL_MIN_FD);
+    p_run->err_fd = fcntl(err_fd, F_DUPFD_CLOEXEC, PARALLEL_MIN_FD);
+
+    p_run->nb_slots = (nb_slots > 0) ? (int)nb_slots : 1;
+    p_run->slots = (parallel_slot_t *)malloc(p_run->nb_slots * sizeof(parallel_slot_t));
+
+    for (slot_i = 0; slot_i < p_run->nb_slots; slot_i++) {
+
+        p_run->slots[slot_i].gpid = -1;
+        p_run->slots[slot_i].out_fd = -1;
+        p_run->slots[slot_i].err_fd = -1;
+    }
+
+    if (is_bg) {
+
+        /* The input is read first (the prompt does not wait for it) */
+        while (p_run->in_fd != -1) {
+
+            __parallel_read(p_run);
+        }
+
+        /* The next instances are started as the ones running complete */
+        if (!__parallel_step(p_run)) {
+
+            g_p_bg_run = p_run;
+            jobs_set_hook(__parallel_poll);
+
+            return;
+        }
+    }
+    else {
+
+        /* An interruption before the run is not for it */
+        jobs_is_interrupted();
+
+        while (!__parallel_step(p_run)) {
+
+            /* Wait for an instance to complete, or for the next arguments if
+             * a slot is free */
+            is_readable = jobs_wait(((p_run->in_fd != -1) && !p_run->is_stopping &&
+                                     (p_run->nb_running < p_run->nb_slots)) ? p_run->in_fd : -1);
+
+            /* Interrupt the instances (killed if interrupted again) */
+            if (jobs_is_interrupted()) {
+
+                __parallel_stop(p_run, p_run->is_stopping ? SIGKILL : SIGINT);
+            }
+
+            if (is_readable) {
+
+                __parallel_read(p_run);
+            }
+        }
+    }
+
+    __parallel_free(p_run);
+}
@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "str_util.h"
+#include "parse_ahead.h"
+
+/**
+ * @brief Reads and parses the lines into the free entries of the ring, till
+ *        the end of the input
+ * @param[in] p_arg Pointer to the parse ahead object
+ * @return NULL
+ */
+static void *__parse_ahead_thread(void *p_arg) {
+
+    parse_ahead_t *p_ahead = (parse_ahead_t *)p_arg;
+
+    /* Index of the next entry to be filled */
+    unsigned int tail = 0;
+
+    /* Entry being filled */
+    parse_ahead_line_t *p_line;
+
+    /* Line given by the reader */
+    char *cmd_str;
+
+    /* Length of the line */
+    size_t len;
+
+    while (1) {
+
+        /* Wait till an entry is free */
+        pthread_mutex_lock(&p_ahead->lock);
+
+        while (p_ahead->nb_lines == PARSE_AHEAD_DEPTH) {
+
+            pthread_cond_wait(&p_ahead->released, &p_ahead->lock);
+        }
+
+        pthread_mutex_unlock(&p_ahead->lock);
+
+        /* The free entry is owned by this thread till it is published */
+        p_line = &p_ahead->lines[tail];
+
+        /* Get the next line which is not a comment */
+        do {
+
+            cmd_str = reader_get_line(p_ahead->p_reader);
+
+        } while (cmd_str && IS_COMMENT_LINE(cmd_str));
+
+        /* If the input is over */
+        if (!cmd_str) {
+
+            pthread_mutex_lock(&p_ahead->lock);
+            p_ahead->is_eof = true;
+            pthread_cond_signal(&p_ahead->parsed);
+            pthread_mutex_unlock(&p_ahead->lock);
+
+            return NULL;
+        }
+
+        /* Copy the line, the reader may reuse its buffer */
+        len = strlen(cmd_str);
+
+        if (len + 1 > p_line->cmd_size) {
+
+            p_line->cmd_size = len + 1;
+            p_line->cmd_str = (char *)realloc(p_line->cmd_str, p_line->cmd_size);
+        }
+
+        memcpy(p_line->cmd_str, cmd_str, len + 1);
+
+        /* Note where the commands of the line should continue the input */
+        p_line->off = reader_tell(p_ahead->p_reader);
+
+        /* Parse the line into the table of the entry */
+        cmd_tab_reset(&p_line->cmd_tab);
+        parser_ctx_init(&p_line->ctx, &p_line->cmd_tab);
+        parser_ctx_parse(&p_line->ctx, p_line->cmd_str);
+
+        /* Publish the entry */
+        pthread_mutex_lock(&p_ahead->lock);
+        p_ahead->nb_lines++;
+        pthread_cond_signal(&p_ahead->parsed);
+        pthread_mutex_unlock(&p_ahead->lock);
+
+        tail = (tail + 1) % PARSE_AHEAD_DEPTH;
+    }
+}
+
+/**
+ * @brief Starts the helper thread parsing the lines of the reader, the
+ *        reader must not be used by the caller afterwards
+ * @param[out] p_ahead Pointer to the parse ahead object
+ * @param[in] p_reader Pointer to the reader object
+ */
+void parse_ahead_start(parse_ahead_t *p_ahead, reader_t *p_reader) {
+
+    unsigned int i;
+
+    /* Set of all the signals */
+    sigset_t all_set;
+
+    /* Signal mask of the caller */
+    sigset_t old_set;
+
+    p_ahead->p_reader = p_reader;
+    p_ahead->head = 0;
+    p_ahead->nb_lines = 0;
+    p_ahead->is_eof = false;
+
+    /* Initialize the entries of the ring */
+    for (i = 0; i < PARSE_AHEAD_DEPTH; i++) {
+
+        p_ahead->lines[i].cmd_str = NULL;
+        p_ahead->lines[i].cmd_size = 0;
+        cmd_tab_init(&p_ahead->lines[i].cmd_tab);
+    }
+
+    pthread_mutex_init(&p_ahead->lock, NULL);
+    pthread_cond_init(&p_ahead->parsed, NULL);
+    pthread_cond_init(&p_ahead->released, NULL);
+
+    /* The helper thread inherits a mask blocking every signal, so that the
+     * job control handlers always run on the main thread */
+    sigfillset(&all_set);
+    pthread_sigmask(SIG_SETMASK, &all_set, &old_set);
+
+    pthread_create(&p_ahead->thread, NULL, __parse_ahead_thread, p_ahead);
+    pthread_detach(p_ahead->thread);
+
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+}
+
+/**
+ * @brief Returns the next parsed line, waiting for the helper thread if
+ *        required
+ * @param[in] p_ahead Pointer to the parse ahead object
+ * @return Pointer to the line (valid till it is released), NULL at the end
+ *         of the input
+ */
+parse_ahead_line_t *parse_ahead_get(parse_ahead_t *p_ahead) {
+
+    parse_ahead_line_t *p_line = NULL;
+
+    pthread_mutex_lock(&p_ahead->lock);
+
+    /* Wait till a line is parsed or the input is over */
+    while (!p_ahead->nb_lines && !p_ahead->is_eof) {
+
+        pthread_cond_wait(&p_ahead->parsed, &p_ahead->lock);
+    }
+
+    if (p_ahead->nb_lines) {
+
+        p_line = &p_ahead->lines[p_ahead->head];
+    }
+
+    pthread_mutex_unlock(&p_ahead->lock);
+
+    return p_line;
+}
+
+/**
+ * @brief Releases the line given by parse_ahead_get, so that its entry is
+ *        filled again
+ * @param[in] p_ahead Pointer to the parse ahead object
+ */
+void parse_ahead_release(parse_ahead_t *p_ahead) {
+
+    pthread_mutex_lock(&p_ahead->lock);
+
+    p_ahead->head = (p_ahead->head + 1) % PARSE_AHEAD_DEPTH;
+    p_ahead->nb_lines--;
+    pthread_cond_signal(&p_ahead->released);
+
+    pthread_mutex_unlock(&p_ahead->lock);
+}
@@ -3,356 +3,469 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include "parser.h"
+#include "scan.h"
 #include "str_util.h"
 
-/* Maximum token string length */
-#define MAX_TOKEN_SIZE (512u)
-/* String to store the tokens */
-char g_tok_str[MAX_TOKEN_SIZE];
-/* Index to traverse the token string */
-int g_tok_i;
-/* Parser state */
-parser_state_t g_state;
-/* Parser expected argument type */
-parser_arg_type_t g_arg_type;
+/**
+ * @brief Actions performed by the parser on a token
+ */
+typedef enum __parser_action_t {
+
+    /* Nothing to be done */
+    PARSER_ACTION_NONE = 0,
+    /* Add a new command with the token as its first argument */
+    PARSER_ACTION_CMD,
+    /* Add the token depending on the argument type expected */
+    PARSER_ACTION_ARG,
+    /* Expect command arguments after the whitespace */
+    PARSER_ACTION_WHITE,
+    /* Expect an input redirection file */
+    PARSER_ACTION_IN,
+    /* Expect an output redirection file */
+    PARSER_ACTION_OUT,
+    /* Add a new command (pipe indicates end of previous one) */
+    PARSER_ACTION_PIPE,
+    /* Terminate the command table */
+    PARSER_ACTION_END,
+    /* Set the backgrounded status for the commands */
+    PARSER_ACTION_BG,
+    /* Invalid syntax/grammar */
+    PARSER_ACTION_GRAMMAR_ERR,
+    /* Unsupported character */
+    PARSER_ACTION_CHARACTER_ERR
+
+} parser_action_t;
 
 /**
- * @brief Function to perform action if the current state if INIT
- * @param[in] Pointer to the command table instance
- * @param[in] cmd_ch The current character from the command string
- * @return PARSER_OK On success
- * @return PARSER_GRAMMAR_ERR On invalid syntax/grammar
- * @return PARSER_CHARACTER_ERR On unsupported character
+ * @brief Transition of the parser on a token of a character class
  */
-static inline parser_err_t __parser_action_init(
-        cmd_tab_t *p_cmd_tab,
-        char cmd_ch) {
+typedef struct __parser_trans_t {
+
+    /* Action to be performed */
+    parser_action_t action;
+
+    /* Next state */
+    parser_state_t next_state;
+
+} parser_trans_t;
+
+/* Shorthand for the transition table entries */
+#define TRANS(action, state) {PARSER_ACTION_##action, PARSER_STATE_##state}
+
+/* Transition table of the parser, indexed by the current state and the
+ * class of the token (a whole identifier or a single other character) */
+static const parser_trans_t g_trans[NB_PARSER_STATES][NB_CHAR_CLASSES] = {
+
+    [PARSER_STATE_INIT] = {
+        [CHAR_CLASS_INVALID] = TRANS(CHARACTER_ERR, INIT),
+        [CHAR_CLASS_NULL]    = TRANS(NONE,          INIT),
+        [CHAR_CLASS_WHITE]   = TRANS(NONE,          INIT),
+        [CHAR_CLASS_IDENT]   = TRANS(CMD,           ARGS),
+        [CHAR_CLASS_IN]      = TRANS(GRAMMAR_ERR,   INIT),
+        [CHAR_CLASS_OUT]     = TRANS(GRAMMAR_ERR,   INIT),
+        [CHAR_CLASS_PIPE]    = TRANS(GRAMMAR_ERR,   INIT),
+        [CHAR_CLASS_BG]      = TRANS(CHARACTER_ERR, INIT)
+    },
+    [PARSER_STATE_ARGS] = {
+        [CHAR_CLASS_INVALID] = TRANS(CHARACTER_ERR, ARGS),
+        [CHAR_CLASS_NULL]    = TRANS(END,           ARGS),
+        [CHAR_CLASS_WHITE]   = TRANS(WHITE,         WHITE),
+        [CHAR_CLASS_IDENT]   = TRANS(ARG,           ARGS),
+        [CHAR_CLASS_IN]      = TRANS(IN,            SPECIAL),
+        [CHAR_CLASS_OUT]     = TRANS(OUT,           SPECIAL),
+        [CHAR_CLASS_PIPE]    = TRANS(PIPE,          SPECIAL),
+        [CHAR_CLASS_BG]      = TRANS(BG,            BACKGROUND)
+    },
+    [PARSER_STATE_WHITE] = {
+        [CHAR_CLASS_INVALID] = TRANS(CHARACTER_ERR, WHITE),
+        [CHAR_CLASS_NULL]    = TRANS(END,           WHITE),
+        [CHAR_CLASS_WHITE]   = TRANS(NONE,          WHITE),
+        [CHAR_CLASS_IDENT]   = TRANS(ARG,           ARGS),
+        [CHAR_CLASS_IN]      = TRANS(IN,            SPECIAL),
+        [CHAR_CLASS_OUT]     = TRANS(OUT,           SPECIAL),
+        [CHAR_CLASS_PIPE]    = TRANS(PIPE,          SPECIAL),
+        [CHAR_CLASS_BG]      = TRANS(BG,            BACKGROUND)
+    },
+    [PARSER_STATE_SPECIAL] = {
+        [CHAR_CLASS_INVALID] = TRANS(CHARACTER_ERR, SPECIAL),
+        [CHAR_CLASS_NULL]    = TRANS(GRAMMAR_ERR,   SPECIAL),
+        [CHAR_CLASS_WHITE]   = TRANS(NONE,          SPECIAL),
+        [CHAR_CLASS_IDENT]   = TRANS(ARG,           ARGS),
+        [CHAR_CLASS_IN]      = TRANS(GRAMMAR_ERR,   SPECIAL),
+        [CHAR_CLASS_OUT]     = TRANS(GRAMMAR_ERR,   SPECIAL),
+        [CHAR_CLASS_PIPE]    = TRANS(GRAMMAR_ERR,   SPECIAL),
+        [CHAR_CLASS_BG]      = TRANS(GRAMMAR_ERR,   SPECIAL)
+    },
+    [PARSER_STATE_BACKGROUND] = {
+        [CHAR_CLASS_INVALID] = TRANS(CHARACTER_ERR, BACKGROUND),
+        [CHAR_CLASS_NULL]    = TRANS(END,           BACKGROUND),
+        [CHAR_CLASS_WHITE]   = TRANS(NONE,          BACKGROUND),
+        [CHAR_CLASS_IDENT]   = TRANS(GRAMMAR_ERR,   BACKGROUND),
+        [CHAR_CLASS_IN]      = TRANS(GRAMMAR_ERR,   BACKGROUND),
+        [CHAR_CLASS_OUT]     = TRANS(GRAMMAR_ERR,   BACKGROUND),
+        [CHAR_CLASS_PIPE]    = TRANS(GRAMMAR_ERR,   BACKGROUND),
+        [CHAR_CLASS_BG]      = TRANS(GRAMMAR_ERR,   BACKGROUND)
+    }
+};
 
-    parser_err_t ret_err;
+/* Largest file descriptor number accepted before a redirection operator */
+#define MAX_REDIR_FD (999)
 
-    if (IS_WHITESPACE(cmd_ch) ||
-        IS_NULL(cmd_ch)) {
+/* File descriptor number of a redirection larger than #MAX_REDIR_FD */
+#define REDIR_FD_INVALID (-2)
 
-        /* Return success */
-        ret_err = PARSER_OK;
-    }
-    else if (IS_INPUT_REDIREC_OP(cmd_ch)  ||
-             IS_OUTPUT_REDIREC_OP(cmd_ch) ||
-             IS_PIPE_OP(cmd_ch)) {
+/**
+ * @brief Returns the length of the redirection operator at the offset
+ *        (< <& > >> >&)
+ * @param[in] str Command line string
+ * @param[in] len Length of the string
+ * @param[in] off Offset of the operator
+ * @return Length of the operator
+ */
+static inline size_t __parser_redir_len(const char *str, size_t len, size_t off) {
 
-        /* Return error */
-        ret_err = PARSER_GRAMMAR_ERR;
-    }
-    else if (IS_VALID_IDENTIFIER(cmd_ch)) {
+    /* Output may be appended */
+    if ((str[off] == '>') && (off + 1 < len) && (str[off + 1] == '>')) {
 
-        /* Add a new command */
-        cmd_tab_add_cmd(p_cmd_tab);
-        /* Update the token string index */
-        g_tok_i = 0;
-        /* Update the token string */
-        g_tok_str[g_tok_i++] = cmd_ch;
-        /* Update the state */
-        g_state = PARSER_STATE_ARGS;
-        /* Update the expected argument type */
-        g_arg_type = ARG_TYPE_CMD;
-        /* Return success */
-        ret_err = PARSER_OK;
+        return 2;
     }
-    else {
 
-        /* Return error */
-        ret_err = PARSER_CHARACTER_ERR;
+    /* Either may duplicate a file descriptor */
+    if ((off + 1 < len) && (str[off + 1] == '&')) {
+
+        return 2;
     }
 
-    return ret_err;
+    return 1;
 }
 
 /**
- * @brief Function to perform action if the current state if ARGS
- * @param[in] Pointer to the command table instance
- * @param[in] cmd_ch The current character from the command string
- * @return PARSER_OK On success
- * @return PARSER_GRAMMAR_ERR On invalid syntax/grammar
- * @return PARSER_CHARACTER_ERR On unsupported character
+ * @brief Returns the length of the token starting at the offset (a whole
+ *        identifier or whitespace run, a redirection operator, else a single
+ *        character), a number right before a redirection operator is taken
+ *        as the file descriptor of the redirection
+ * @param[in] str Command line string
+ * @param[in] len Length of the string
+ * @param[in] off Offset of the token
+ * @param[in,out] p_class Class of the first character of the token (set to
+ *                the class of the operator for a file descriptor)
+ * @return Length of the token
  */
-static inline parser_err_t __parser_action_args(
-        cmd_tab_t *p_cmd_tab,
-        char cmd_ch) {
-
-    parser_err_t ret_err;
-
-    /* If the character is the token terminator */
-    if (IS_WHITESPACE(cmd_ch)        ||
-        IS_INPUT_REDIREC_OP(cmd_ch)  ||
-        IS_OUTPUT_REDIREC_OP(cmd_ch) ||
-        IS_PIPE_OP(cmd_ch)           ||
-        IS_BACKGROUND_OP(cmd_ch)     ||
-        IS_NULL(cmd_ch)) {
-
-        /* Add the end of string character */
-        g_tok_str[g_tok_i] = '\0';
-        /* Add the token depending on the argument type exepected  */
-        if (g_arg_type == ARG_TYPE_CMD) {
-            cmd_tab_add_cmd_arg(p_cmd_tab, g_tok_str);
-        }
-        else if (g_arg_type == ARG_TYPE_IN)  {
-            cmd_tab_set_in_arg(p_cmd_tab, g_tok_str);
-        }
-        else if (g_arg_type == ARG_TYPE_OUT) {
-            cmd_tab_set_out_arg(p_cmd_tab, g_tok_str);
-        }
+static inline size_t __parser_tok_len(
+        const char *str,
+        size_t len,
+        size_t off,
+        char_class_t *p_class) {
 
-        /* Update the states depending on the terminator */
-        if (IS_WHITESPACE(cmd_ch)) {
+    size_t tok_len;
+    size_t ch_i;
 
-            /* Update the argument type */
-            g_arg_type = ARG_TYPE_CMD;
-            /* Update the parser state */
-            g_state = PARSER_STATE_WHITE;
-            /* Return success */
-            ret_err = PARSER_OK;
-        }
-        else if (IS_INPUT_REDIREC_OP(cmd_ch)) {
-
-            /* Update the argument type */
-            g_arg_type = ARG_TYPE_IN;
-            /* Update the parser state */
-            g_state = PARSER_STATE_SPECIAL;
-            /* Return success */
-            ret_err = PARSER_OK;
-        }
-        else if (IS_OUTPUT_REDIREC_OP(cmd_ch)) {
-
-            /* Update the argument type */
-            g_arg_type = ARG_TYPE_OUT;
-            /* Update the parser state */
-            g_state = PARSER_STATE_SPECIAL;
-            /* Return success */
-            ret_err = PARSER_OK;
-        }
-        else if (IS_PIPE_OP(cmd_ch)) {
-
-            /* Add a new command (pipe indicates end
-             * of previous one) */
-            cmd_tab_add_cmd(p_cmd_tab);
-            /* Update the argument type */
-            g_arg_type = ARG_TYPE_CMD;
-            /* Update the parser state */
-            g_state = PARSER_STATE_SPECIAL;
-            /* Return success */
-            ret_err = PARSER_OK;
-        }
-        else if (IS_NULL(cmd_ch)) {
+    if (*p_class == CHAR_CLASS_IDENT) {
 
-            /* Add a new command */
-            cmd_tab_add_cmd(p_cmd_tab);
-            /* Return success */
-            ret_err = PARSER_OK;
-        }
-        else if (IS_BACKGROUND_OP(cmd_ch)) {
-
-            /* Set the backgrounded status for the commands */
-            cmd_tab_set_bg(p_cmd_tab);
-            /* Update the parser state */
-            g_state = PARSER_STATE_BACKGROUND;
-            /* Return success */
-            ret_err = PARSER_OK;
+        tok_len = scan_ident(str + off, len - off);
+
+        /* If the identifier is followed by a redirection operator */
+        if ((off + tok_len < len) &&
+            ((str[off + tok_len] == '<') || (str[off + tok_len] == '>'))) {
+
+            /* Check if it is a number */
+            for (ch_i = off; (ch_i < off + tok_len) && (str[ch_i] >= '0') && (str[ch_i] <= '9'); ch_i++);
+
+            /* The number and the operator form a single token */
+            if (ch_i == off + tok_len) {
+
+                *p_class = CHAR_CLASS(str[off + tok_len]);
+
+                return tok_len + __parser_redir_len(str, len, off + tok_len);
+            }
         }
+
+        return tok_len;
     }
-    else if (IS_VALID_IDENTIFIER(cmd_ch)) {
+    else if (*p_class == CHAR_CLASS_WHITE) {
 
-        /* Add the character to the token string */
-        g_tok_str[g_tok_i++] = cmd_ch;
-        /* Return success */
-        ret_err = PARSER_OK;
+        return scan_white(str + off, len - off);
     }
-    else {
+    else if ((*p_class == CHAR_CLASS_IN) || (*p_class == CHAR_CLASS_OUT)) {
 
-        /* Return error */
-        ret_err = PARSER_CHARACTER_ERR;
+        return __parser_redir_len(str, len, off);
     }
 
-    return ret_err;
+    return 1;
 }
 
 /**
- * @brief Function to perform action if the current state if WHITE
- * @param[in] Pointer to the command table instance
- * @param[in] cmd_ch The current character from the command string
- * @return PARSER_OK On success
- * @return PARSER_GRAMMAR_ERR On invalid syntax/grammar
- * @return PARSER_CHARACTER_ERR On unsupported character
+ * @brief Returns the file descriptor number of a redirection operator token,
+ *        checked the same way by the parser and the lexer
+ * @param[in] tok Redirection operator token ([fd]< [fd]<& [fd]> [fd]>> [fd]>&)
+ * @param[out] p_op_i Offset of the operator in the token
+ * @return File descriptor number (-1 if none is given), #REDIR_FD_INVALID if
+ *         it is larger than #MAX_REDIR_FD
  */
-static inline parser_err_t __parser_action_white(
-        cmd_tab_t *p_cmd_tab,
-        char cmd_ch) {
+static int __parser_redir_fd(const char *tok, int *p_op_i) {
 
-    parser_err_t ret_err;
+    int fd = -1;
+    int ch_i;
 
-    /* Initalize the token string index */
-    g_tok_i = 0;
+    for (ch_i = 0; (tok[ch_i] >= '0') && (tok[ch_i] <= '9'); ch_i++) {
 
-    if (IS_WHITESPACE(cmd_ch)) {
+        fd = ((fd == -1) ? 0 : (10 * fd)) + (tok[ch_i] - '0');
 
-        /* Return success */
-        ret_err = PARSER_OK;
-    }
-    else if (IS_INPUT_REDIREC_OP(cmd_ch)) {
+        if (fd > MAX_REDIR_FD) {
 
-        /* Update the expected argument type */
-        g_arg_type = ARG_TYPE_IN;
-        /* Update the state */
-        g_state = PARSER_STATE_SPECIAL;
-        /* Return success */
-        ret_err = PARSER_OK;
+            return REDIR_FD_INVALID;
+        }
     }
-    else if (IS_OUTPUT_REDIREC_OP(cmd_ch)) {
 
-        /* Update the expected argument type */
-        g_arg_type = ARG_TYPE_OUT;
-        /* Update the state */
-        g_state = PARSER_STATE_SPECIAL;
-        /* Return success */
-        ret_err = PARSER_OK;
+    *p_op_i = ch_i;
+
+    return fd;
+}
+
+/**
+ * @brief Sets the redirection expecting its argument from the operator token
+ *        ([fd]< [fd]<& [fd]> [fd]>> [fd]>&)
+ * @param[in,out] p_ctx Pointer to the parser context
+ * @param[in] tok_off Offset of the token in the command line string
+ * @param[in] tok_len Length of the token
+ * @return PARSER_OK On success
+ * @return PARSER_GRAMMAR_ERR If the file descriptor is too large
+ */
+static parser_err_t __parser_set_redir(parser_ctx_t *p_ctx, int tok_off, int tok_len) {
+
+    const char *tok = p_ctx->cmd_str + tok_off;
+    int fd;
+    int ch_i;
+
+    /* Get the file descriptor number, if any */
+    if ((fd = __parser_redir_fd(tok, &ch_i)) == REDIR_FD_INVALID) {
+
+        return PARSER_GRAMMAR_ERR;
     }
-    else if (IS_PIPE_OP(cmd_ch)) {
 
-        /* Add a new command to the command table */
-        cmd_tab_add_cmd(p_cmd_tab);
-        /* Update the state */
-        g_state = PARSER_STATE_SPECIAL;
-        /* Return success */
-        ret_err = PARSER_OK;
+    /* The input is redirected by default, else the output */
+    if (tok[ch_i] == '<') {
+
+        p_ctx->arg_type = ARG_TYPE_IN;
+        p_ctx->redir_type = CMD_REDIR_IN;
+        p_ctx->redir_fd = (fd == -1) ? 0 : fd;
     }
-    else if (IS_NULL(cmd_ch)) {
+    else {
 
-        /* Add a new command to the command table */
-        cmd_tab_add_cmd(p_cmd_tab);
-        /* Return success */
-        ret_err = PARSER_OK;
+        p_ctx->arg_type = ARG_TYPE_OUT;
+        p_ctx->redir_type = CMD_REDIR_OUT;
+        p_ctx->redir_fd = (fd == -1) ? 1 : fd;
     }
-    else if (IS_VALID_IDENTIFIER(cmd_ch)) {
 
-        /* Save the character in token string */
-        g_tok_str[g_tok_i++] = cmd_ch;
-        /* Update the state */
-        g_state = PARSER_STATE_ARGS;
-        /* Return success */
-        ret_err = PARSER_OK;
+    /* Get the kind of the operator */
+    if (ch_i + 1 < tok_len) {
+
+        p_ctx->redir_type = (tok[ch_i + 1] == '&') ? CMD_REDIR_DUP : CMD_REDIR_APPEND;
     }
-    else if (IS_BACKGROUND_OP(cmd_ch)) {
 
-        /* Set the backgrounded status for the commands */
-        cmd_tab_set_bg(p_cmd_tab);
-        /* Update the parser state */
-        g_state = PARSER_STATE_BACKGROUND;
-        /* Return success */
-        ret_err = PARSER_OK;
+    return PARSER_OK;
+}
+
+/**
+ * @brief Adds the token to the command table depending on the argument type
+ *        expected
+ * @param[in] p_ctx Pointer to the parser context
+ * @param[in] tok_off Offset of the token in the command line string
+ * @param[in] tok_len Length of the token
+ */
+static void __parser_add_token(
+        parser_ctx_t *p_ctx,
+        int tok_off,
+        int tok_len) {
+
+    /* Add the slice depending on the argument type exepected  */
+    if (p_ctx->arg_type == ARG_TYPE_CMD) {
+        cmd_tab_add_cmd_arg(p_ctx->p_cmd_tab, tok_off, tok_len);
     }
     else {
-
-        /* Return error */
-        ret_err = PARSER_CHARACTER_ERR;
+        cmd_tab_add_redir(p_ctx->p_cmd_tab, p_ctx->redir_type, p_ctx->redir_fd, tok_off, tok_len);
     }
-
-    return ret_err;
 }
 
 /**
- * @brief Function to perform action if the current state if SPECIAL
- * @param[in] Pointer to the command table instance
- * @param[in] cmd_ch The current character from the command string
+ * @brief Performs the action of a transition
+ * @param[in] p_ctx Pointer to the parser context
+ * @param[in] action Action to be performed
+ * @param[in] tok_off Offset of the token in the command line string
+ * @param[in] tok_len Length of the token
  * @return PARSER_OK On success
  * @return PARSER_GRAMMAR_ERR On invalid syntax/grammar
  * @return PARSER_CHARACTER_ERR On unsupported character
  */
-static inline parser_err_t __parser_action_special(
-        cmd_tab_t *p_cmd_tab,
-        char cmd_ch) {
+static inline parser_err_t __parser_action(
+        parser_ctx_t *p_ctx,
+        parser_action_t action,
+        int tok_off,
+        int tok_len) {
+
+    switch (action) {
+
+    case PARSER_ACTION_NONE:
+        break;
 
-    parser_err_t ret_err;
+    case PARSER_ACTION_CMD:
+        /* Add a new command */
+        cmd_tab_add_cmd(p_ctx->p_cmd_tab);
+        /* Update the expected argument type */
+        p_ctx->arg_type = ARG_TYPE_CMD;
+        /* Add the token as the command */
+        __parser_add_token(p_ctx, tok_off, tok_len);
+        break;
 
-    /* Initalize the token string index */
-    g_tok_i = 0;
+    case PARSER_ACTION_ARG:
+        /* Add the token as per the expected argument type */
+        __parser_add_token(p_ctx, tok_off, tok_len);
+        break;
 
-    if (IS_WHITESPACE(cmd_ch)) {
+    case PARSER_ACTION_WHITE:
+        /* Update the expected argument type */
+        p_ctx->arg_type = ARG_TYPE_CMD;
+        break;
 
-        /* Return success */
-        ret_err = PARSER_OK;
-    }
-    else if (IS_INPUT_REDIREC_OP(cmd_ch)  ||
-             IS_OUTPUT_REDIREC_OP(cmd_ch) ||
-             IS_PIPE_OP(cmd_ch)           ||
-             IS_BACKGROUND_OP(cmd_ch)     ||
-             IS_NULL(cmd_ch)) {
-
-        /* Return failure */
-        ret_err = PARSER_GRAMMAR_ERR;
-    }
-    else if (IS_VALID_IDENTIFIER(cmd_ch)) {
+    case PARSER_ACTION_IN:
+    case PARSER_ACTION_OUT:
+        /* Update the expected argument type and the redirection */
+        return __parser_set_redir(p_ctx, tok_off, tok_len);
 
-        /* Save the character in token string */
-        g_tok_str[g_tok_i++] = cmd_ch;
-        /* Update the state */
-        g_state = PARSER_STATE_ARGS;
-        /* Return success */
-        ret_err = PARSER_OK;
-    }
-    else {
+    case PARSER_ACTION_PIPE:
+        /* Add a new command (pipe indicates end of previous one) */
+        cmd_tab_add_cmd(p_ctx->p_cmd_tab);
+        /* Update the expected argument type */
+        p_ctx->arg_type = ARG_TYPE_CMD;
+        break;
 
-        /* Return error */
-        ret_err = PARSER_CHARACTER_ERR;
+    case PARSER_ACTION_END:
+        /* Add a new command */
+        cmd_tab_add_cmd(p_ctx->p_cmd_tab);
+        break;
+
+    case PARSER_ACTION_BG:
+        /* Set the backgrounded status for the commands */
+        cmd_tab_set_bg(p_ctx->p_cmd_tab);
+        break;
+
+    case PARSER_ACTION_GRAMMAR_ERR:
+        return PARSER_GRAMMAR_ERR;
+
+    case PARSER_ACTION_CHARACTER_ERR:
+        return PARSER_CHARACTER_ERR;
     }
 
-    return ret_err;
+    return PARSER_OK;
 }
 
 /**
- * @brief Function to perform action if the current state if BACKGROUND
- * @param[in] Pointer to the command table instance
- * @param[in] cmd_ch The current character from the command string
+ * @brief Initializes the parser context for the command table
+ * @param[out] p_ctx Pointer to the parser context
+ * @param[in] p_cmd_tab Pointer to the command table instance to be set
+ */
+void parser_ctx_init(parser_ctx_t *p_ctx, cmd_tab_t *p_cmd_tab) {
+
+    p_ctx->p_cmd_tab = p_cmd_tab;
+    p_ctx->cmd_str = NULL;
+    p_ctx->cmd_len = 0;
+    p_ctx->cmd_i = 0;
+    p_ctx->state = PARSER_STATE_INIT;
+    p_ctx->arg_type = ARG_TYPE_CMD;
+    p_ctx->redir_type = CMD_REDIR_IN;
+    p_ctx->redir_fd = 0;
+    p_ctx->err = PARSER_OK;
+}
+
+/**
+ * @brief Sets the command table of the context appropriately, given the
+ *        entire command line string (errors are not printed)
+ * @param[in,out] p_ctx Pointer to the parser context
+ * @param[in] cmd_str Command line string
  * @return PARSER_OK On success
  * @return PARSER_GRAMMAR_ERR On invalid syntax/grammar
  * @return PARSER_CHARACTER_ERR On unsupported character
  */
-static inline parser_err_t __parser_action_background(
-        cmd_tab_t *p_cmd_tab,
-        char cmd_ch) {
+parser_err_t parser_ctx_parse(parser_ctx_t *p_ctx, char *cmd_str) {
 
-    parser_err_t ret_err;
+    /* Class of the current character */
+    char_class_t ch_class;
 
-    if (IS_WHITESPACE(cmd_ch)) {
+    /* Length of the current token */
+    size_t tok_len;
 
-        /* Return success */
-        ret_err = PARSER_OK;
-    }
-    else if (IS_NULL(cmd_ch)) {
+    /* Transition for the current token */
+    const parser_trans_t *p_trans;
 
-        /* Add a new command to the command table */
-        cmd_tab_add_cmd(p_cmd_tab);
-        /* Return success */
-        ret_err = PARSER_OK;
-    }
-    else if (IS_INPUT_REDIREC_OP(cmd_ch)  ||
-             IS_OUTPUT_REDIREC_OP(cmd_ch) ||
-             IS_BACKGROUND_OP(cmd_ch)     ||
-             IS_PIPE_OP(cmd_ch)           ||
-             IS_VALID_IDENTIFIER(cmd_ch)) {
-
-        /* Return error */
-        ret_err = PARSER_GRAMMAR_ERR;
+    /* Initialize the parsing state (the terminator is scanned as well) */
+    p_ctx->cmd_str = cmd_str;
+    p_ctx->cmd_len = strlen(cmd_str);
+    p_ctx->cmd_i = 0;
+    p_ctx->state = PARSER_STATE_INIT;
+    p_ctx->arg_type = ARG_TYPE_CMD;
+
+    /* Set the command line string in the command table, the tokens are
+     * slices of the table's copy */
+    cmd_tab_set_str(p_ctx->p_cmd_tab, cmd_str);
+
+    /* For each token */
+    while (1) {
+
+        /* Classify the current character */
+        ch_class = CHAR_CLASS(cmd_str[p_ctx->cmd_i]);
+
+        /* Get the whole token starting at the character */
+        tok_len = __parser_tok_len(cmd_str, p_ctx->cmd_len, p_ctx->cmd_i, &ch_class);
+
+        /* Get the transition depending on the current state */
+        p_trans = &g_trans[p_ctx->state][ch_class];
+
+        /* Perform the action of the transition */
+        p_ctx->err = __parser_action(p_ctx, p_trans->action, p_ctx->cmd_i, tok_len);
+
+        /* If the action resulted in an error, return with the context
+         * pointing at the token */
+        if (p_ctx->err != PARSER_OK) {
+
+            return p_ctx->err;
+        }
+
+        /* Update the state */
+        p_ctx->state = p_trans->next_state;
+
+        /* If the end of the string is reached */
+        if (ch_class == CHAR_CLASS_NULL) {
+
+            break;
+        }
+
+        /* Move to the next token */
+        p_ctx->cmd_i += tok_len;
     }
-    else {
 
-        ret_err = PARSER_CHARACTER_ERR;
+    /* Return with success */
+    return PARSER_OK;
+}
+
+/**
+ * @brief Prints the error of the last parsing of the context (if any)
+ * @param[in] p_ctx Pointer to the parser context
+ */
+void parser_ctx_print_err(parser_ctx_t *p_ctx) {
+
+    if (p_ctx->err == PARSER_GRAMMAR_ERR) {
+
+        fprintf(stderr, "kavach: parser grammar error occurred near `%c`\n", p_ctx->cmd_str[p_ctx->cmd_i]);
     }
+    else if (p_ctx->err == PARSER_CHARACTER_ERR) {
 
-    return ret_err;
+        fprintf(stderr, "kavach: parser character error occurred near `%c`\n", p_ctx->cmd_str[p_ctx->cmd_i]);
+    }
 }
 
 /**
  * @brief Sets the command table appropriately, given the entire command line
- *        string
+ *        string (errors are printed)
  * @param[in] Pointer to the command table instance
  * @param[in] cmd_str Command line string
  * @return PARSER_OK On success
@@ -361,56 +474,236 @@ static inline parser_err_t __parser_action_background(
  */
 parser_err_t parser_set_cmd_tab(cmd_tab_t *p_cmd_tab, char *cmd_str) {
 
-    /* Index for traversing the command string */
-    int cmd_i = 0;
+    /* Context of the parsing (on the stack, so that it is reentrant) */
+    parser_ctx_t ctx;
+
+    parser_ctx_init(&ctx, p_cmd_tab);
+
+    /* Parse the string and print the error if any */
+    if (parser_ctx_parse(&ctx, cmd_str) != PARSER_OK) {
 
-    /* Initialize the function pointers for performing actions depending
-     * on the current state */
-    parser_err_t (*action[NB_PARSER_STATES])(cmd_tab_t *, char) =
-            {__parser_action_init,
-             __parser_action_args,
-             __parser_action_white,
-             __parser_action_special,
-             __parser_action_background};
+        parser_ctx_print_err(&ctx);
+    }
+
+    return ctx.err;
+}
 
-    /* Error number of the state actions */
-    parser_err_t ret_err;
+/**
+ * @brief Initializes the lexer (no memory is allocated)
+ * @param[out] p_lex Pointer to the lexer object
+ */
+void parser_lexer_init(parser_lexer_t *p_lex) {
+
+    p_lex->str = NULL;
+    p_lex->len = 0;
+    p_lex->snaps = NULL;
+    p_lex->nb_snaps = 0;
+    p_lex->max_snaps = 0;
+
+    /* Start at the beginning of the line */
+    p_lex->snap.off = 0;
+    p_lex->snap.state = PARSER_STATE_INIT;
+    p_lex->snap.arg_type = ARG_TYPE_CMD;
+}
 
-    /* Initialize the initial state of the parser */
-    g_state = PARSER_STATE_INIT;
+/**
+ * @brief Sets the (edited) line of the lexer, the tokens before the edit
+ *        point are kept and the lexing resumes from the snapshot of the token
+ *        touching the edit point
+ * @param[in,out] p_lex Pointer to the lexer object
+ * @param[in] str Line (need not be NULL terminated)
+ * @param[in] len Length of the line
+ * @param[in] edit_off Offset of the first changed byte from the previous line
+ *                     (0 for a new line)
+ */
+void parser_lexer_set_str(
+        parser_lexer_t *p_lex,
+        const char *str,
+        size_t len,
+        size_t edit_off) {
 
-    /* Set the command line string in the command table  */
-    cmd_tab_set_str(p_cmd_tab, cmd_str);
+    /* Low and high bounds of the search */
+    size_t lo = 0;
+    size_t hi = p_lex->nb_snaps;
+    size_t mid;
 
-    /* For each character */
-    while (cmd_i <= strlen(cmd_str)) {
+    p_lex->str = str;
+    p_lex->len = len;
 
-        /* Perform the action depending on the current state */
-        ret_err = action[g_state](p_cmd_tab, cmd_str[cmd_i]);
+    /* Find the number of tokens starting before the edit point */
+    while (lo < hi) {
 
-        /* If the action resulted in an error */
-        if (ret_err == PARSER_GRAMMAR_ERR) {
+        mid = (lo + hi) / 2;
 
-            /* Print the error */
-            fprintf(stderr, "kavach: parser grammar error occurred near `%c`\n", cmd_str[cmd_i]);
+        if (p_lex->snaps[mid].off < edit_off) {
 
-            /* Then return with error */
-            return ret_err;
+            lo = mid + 1;
         }
-        else if (ret_err == PARSER_CHARACTER_ERR) {
+        else {
 
-            /* Print the error */
-            fprintf(stderr, "kavach: parser character error occurred near `%c`\n", cmd_str[cmd_i]);
+            hi = mid;
+        }
+    }
+
+    /* The last of those tokens may extend to the edit point, so it is lexed
+     * again along with the rest */
+    if (lo) {
+
+        p_lex->nb_snaps = lo - 1;
+        p_lex->snap = p_lex->snaps[lo - 1];
+    }
+    else {
+
+        p_lex->nb_snaps = 0;
+        p_lex->snap.off = 0;
+        p_lex->snap.state = PARSER_STATE_INIT;
+        p_lex->snap.arg_type = ARG_TYPE_CMD;
+    }
+}
+
+/**
+ * @brief Lexes the next token and snapshots the state before it, a token
+ *        with an error does not change the state so the lexing can go on
+ * @param[in,out] p_lex Pointer to the lexer object
+ * @param[out] p_tok Pointer to the token
+ * @return PARSER_OK If the token is valid
+ * @return PARSER_GRAMMAR_ERR If the token violates the syntax/grammar
+ * @return PARSER_CHARACTER_ERR If the token is an unsupported character
+ */
+parser_err_t parser_lexer_next(parser_lexer_t *p_lex, parser_tok_t *p_tok) {
 
+    /* Current state */
+    parser_snap_t *p_snap = &p_lex->snap;
 
-            /* Then return with error */
-            return ret_err;
+    /* Class of the first character of the token */
+    char_class_t ch_class;
+
+    /* Transition for the token */
+    const parser_trans_t *p_trans;
+
+    /* Offset of the operator of a redirection token */
+    int op_i;
+
+    /* Grow the snapshots array if it is full */
+    if (p_lex->nb_snaps == p_lex->max_snaps) {
+
+        p_lex->max_snaps = p_lex->max_snaps ? (2 * p_lex->max_snaps) : 64;
+        p_lex->snaps = (parser_snap_t *)realloc(p_lex->snaps, p_lex->max_snaps * sizeof(parser_snap_t));
+    }
+
+    /* Snapshot the state at the token boundary */
+    p_lex->snaps[p_lex->nb_snaps++] = *p_snap;
+
+    /* Classify the token (the end of the line acts as the terminator) */
+    ch_class = (p_snap->off < p_lex->len) ?
+               CHAR_CLASS(p_lex->str[p_snap->off]) :
+               CHAR_CLASS_NULL;
+
+    p_tok->off = p_snap->off;
+    p_tok->len = (ch_class == CHAR_CLASS_NULL) ?
+                 0 :
+                 __parser_tok_len(p_lex->str, p_lex->len, p_snap->off, &ch_class);
+
+    /* Get the transition depending on the current state */
+    p_trans = &g_trans[p_snap->state][ch_class];
+
+    /* Get the type of the token */
+    switch (ch_class) {
+
+    case CHAR_CLASS_IDENT:
+        if (p_trans->action == PARSER_ACTION_CMD) {
+            p_tok->type = PARSER_TOK_CMD;
+        }
+        else if (p_snap->arg_type == ARG_TYPE_IN) {
+            p_tok->type = PARSER_TOK_IN_FILE;
         }
+        else if (p_snap->arg_type == ARG_TYPE_OUT) {
+            p_tok->type = PARSER_TOK_OUT_FILE;
+        }
+        else {
+            p_tok->type = PARSER_TOK_ARG;
+        }
+        break;
+
+    case CHAR_CLASS_NULL:
+        p_tok->type = PARSER_TOK_END;
+        break;
+
+    case CHAR_CLASS_WHITE:
+        p_tok->type = PARSER_TOK_WHITE;
+        break;
+
+    case CHAR_CLASS_IN:
+        p_tok->type = PARSER_TOK_IN;
+        break;
+
+    case CHAR_CLASS_OUT:
+        p_tok->type = PARSER_TOK_OUT;
+        break;
 
-        /* Increment the command string index */
-        cmd_i++;
+    case CHAR_CLASS_PIPE:
+        p_tok->type = PARSER_TOK_PIPE;
+        break;
+
+    case CHAR_CLASS_BG:
+        p_tok->type = PARSER_TOK_BG;
+        break;
+
+    default:
+        p_tok->type = PARSER_TOK_INVALID;
+        break;
     }
 
-    /* Return with success */
-    return PARSER_OK;
+    /* Get the error of the token (the file descriptor of a redirection
+     * is checked as the parser does) */
+    if (p_trans->action == PARSER_ACTION_GRAMMAR_ERR) {
+
+        p_tok->err = PARSER_GRAMMAR_ERR;
+    }
+    else if (((p_trans->action == PARSER_ACTION_IN) || (p_trans->action == PARSER_ACTION_OUT)) &&
+             (__parser_redir_fd(p_lex->str + p_tok->off, &op_i) == REDIR_FD_INVALID)) {
+
+        p_tok->err = PARSER_GRAMMAR_ERR;
+    }
+    else if (p_trans->action == PARSER_ACTION_CHARACTER_ERR) {
+
+        p_tok->err = PARSER_CHARACTER_ERR;
+    }
+    else {
+
+        p_tok->err = PARSER_OK;
+    }
+
+    /* Update the expected argument type as the parser does */
+    if ((p_trans->action == PARSER_ACTION_CMD) ||
+        (p_trans->action == PARSER_ACTION_WHITE) ||
+        (p_trans->action == PARSER_ACTION_PIPE)) {
+
+        p_snap->arg_type = ARG_TYPE_CMD;
+    }
+    else if (p_trans->action == PARSER_ACTION_IN) {
+
+        p_snap->arg_type = ARG_TYPE_IN;
+    }
+    else if (p_trans->action == PARSER_ACTION_OUT) {
+
+        p_snap->arg_type = ARG_TYPE_OUT;
+    }
+
+    /* Update the state and move to the next token */
+    p_snap->state = p_trans->next_state;
+    p_snap->off += p_tok->len;
+
+    return p_tok->err;
+}
+
+/**
+ * @brief Frees the snapshots of the lexer
+ * @param[out] p_lex Pointer to the lexer object
+ */
+void parser_lexer_deinit(parser_lexer_t *p_lex) {
+
+    free(p_lex->snaps);
+
+    parser_lexer_init(p_lex);
 }
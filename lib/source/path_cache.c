@@ -0,0 +1,458 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "path_cache.h"
+#include "hash.h"
+#include "vars.h"
+
+/* Identifies an initialized index */
+#define PATH_INDEX_MAGIC (0x6b61766163686831ull)
+
+/* Search path used when PATH is not set */
+#define DEFAULT_PATH "/usr/local/bin:/usr/bin:/bin"
+
+/* Returns the check of the entry fields */
+#define ENTRY_CHECK(hash, dir_i)                                \
+    ({                                                          \
+        HASH_MIX(hash, (uint64_t)(unsigned int)(dir_i));        \
+    })
+
+/* Index in the memory of the shell */
+path_index_t g_path_local_index;
+/* Index in use (local or shared) */
+path_index_t *g_p_path_index;
+/* File of the shared index (-1 if not shared) */
+int g_path_index_fd = -1;
+/* Copy of PATH the directories are split from */
+char *g_path_str;
+/* Directories of PATH */
+char *g_path_dirs[PATH_CACHE_MAX_DIRS];
+unsigned int g_nb_path_dirs;
+/* Hash of PATH */
+uint64_t g_path_hash;
+
+/**
+ * @brief Locks the index against the other shells (shared index only)
+ */
+static void __path_lock() {
+
+    if (g_path_index_fd != -1) {
+
+        flock(g_path_index_fd, LOCK_EX);
+    }
+}
+
+/**
+ * @brief Unlocks the index
+ */
+static void __path_unlock() {
+
+    if (g_path_index_fd != -1) {
+
+        flock(g_path_index_fd, LOCK_UN);
+    }
+}
+
+/**
+ * @brief Returns the current search path (the variable of the shell)
+ * @return PATH, or the default one if it is not set
+ */
+static const char *__path_get() {
+
+    const char *path = vars_get("PATH", 4);
+
+    return path ? path : DEFAULT_PATH;
+}
+
+/**
+ * @brief Splits the current PATH into the directories
+ */
+static void __path_split() {
+
+    char *dir;
+    char *save;
+
+    /* Copy PATH, so that it can be split in place */
+    free(g_path_str);
+    g_path_str = strdup(__path_get());
+    g_path_hash = hash_bytes(g_path_str, strlen(g_path_str));
+
+    g_nb_path_dirs = 0;
+
+    /* Split the directories (an empty one is the current directory) */
+    for (dir = g_path_str; dir && (g_nb_path_dirs < PATH_CACHE_MAX_DIRS); dir = save) {
+
+        if ((save = strchr(dir, ':'))) {
+
+            *save++ = '\0';
+        }
+
+        g_path_dirs[g_nb_path_dirs++] = *dir ? dir : ".";
+    }
+}
+
+/**
+ * @brief Checks if PATH is changed since it was split
+ * @return true If it is changed
+ * @return false Otherwise
+ */
+static bool __path_is_changed() {
+
+    const char *path = __path_get();
+    size_t len = strlen(path);
+
+    return (hash_bytes(path, len) != g_path_hash);
+}
+
+/**
+ * @brief Empties the index and sets it up for the current directories
+ *        (called with the index locked)
+ * @param[in] mtimes Modification times of the directories
+ */
+static void __path_reset(struct timespec *mtimes) {
+
+    path_index_t *p_index = g_p_path_index;
+
+    /* Free every entry */
+    memset(p_index->entries, 0, sizeof(p_index->entries));
+    p_index->nb_used = 0;
+
+    /* Note the directories the index is built for */
+    p_index->path_hash = g_path_hash;
+    p_index->nb_dirs = g_nb_path_dirs;
+    memcpy(p_index->dir_mtimes, mtimes, g_nb_path_dirs * sizeof(struct timespec));
+
+    __atomic_store_n(&p_index->magic, PATH_INDEX_MAGIC, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Finds the entry of the command, the entries written partially by
+ *        other shells are skipped
+ * @param[in] name Command name
+ * @param[in] hash Hash of the name
+ * @param[out] p_dir_i Index of the directory of the command
+ * @return Pointer to the entry, NULL if not found
+ */
+static path_entry_t *__path_find(char *name, uint64_t hash, int *p_dir_i) {
+
+    path_entry_t *p_entry;
+    unsigned int entry_i;
+    unsigned int nb_probes;
+    uint64_t entry_hash;
+    uint64_t check;
+
+    /* Probe the entries from the home entry of the hash */
+    for (entry_i = hash & (PATH_CACHE_SIZE - 1), nb_probes = 0;
+         nb_probes < PATH_CACHE_SIZE;
+         entry_i = (entry_i + 1) & (PATH_CACHE_SIZE - 1), nb_probes++) {
+
+        p_entry = &g_p_path_index->entries[entry_i];
+
+        entry_hash = __atomic_load_n(&p_entry->hash, __ATOMIC_ACQUIRE);
+
+        /* A free entry ends the probing */
+        if (!entry_hash) {
+
+            return NULL;
+        }
+
+        if (entry_hash != hash) {
+
+            continue;
+        }
+
+        /* Read the fields, then make sure the entry was not rewritten */
+        *p_dir_i = p_entry->dir_i;
+        check = p_entry->check;
+
+        if (strncmp(p_entry->name, name, PATH_CACHE_NAME_LEN)) {
+
+            continue;
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if ((__atomic_load_n(&p_entry->hash, __ATOMIC_RELAXED) == hash) &&
+            (check == ENTRY_CHECK(hash, *p_dir_i))) {
+
+            return p_entry;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Adds (or replaces) the entry of the command
+ * @param[in] name Command name
+ * @param[in] len Length of the name
+ * @param[in] hash Hash of the name
+ * @param[in] dir_i Index of the directory of the command (-1 if not found)
+ */
+static void __path_insert(char *name, size_t len, uint64_t hash, int dir_i) {
+
+    path_index_t *p_index = g_p_path_index;
+    path_entry_t *p_entry;
+    unsigned int entry_i;
+
+    __path_lock();
+
+    /* Keep the probe sequences short */
+    if (p_index->nb_used >= PATH_CACHE_MAX_USED) {
+
+        __path_reset(p_index->dir_mtimes);
+    }
+
+    /* Find a free entry or the entry of the same command */
+    for (entry_i = hash & (PATH_CACHE_SIZE - 1);
+         ;
+         entry_i = (entry_i + 1) & (PATH_CACHE_SIZE - 1)) {
+
+        p_entry = &p_index->entries[entry_i];
+
+        if (!p_entry->hash) {
+
+            p_index->nb_used++;
+            break;
+        }
+
+        if ((p_entry->hash == hash) &&
+            !strncmp(p_entry->name, name, PATH_CACHE_NAME_LEN)) {
+
+            break;
+        }
+    }
+
+    /* Invalidate the entry while it is written, then publish it */
+    __atomic_store_n(&p_entry->hash, 0, __ATOMIC_RELEASE);
+
+    p_entry->dir_i = dir_i;
+    p_entry->hits = 0;
+    memcpy(p_entry->name, name, len + 1);
+    p_entry->check = ENTRY_CHECK(hash, dir_i);
+
+    __atomic_store_n(&p_entry->hash, hash, __ATOMIC_RELEASE);
+
+    __path_unlock();
+}
+
+/**
+ * @brief Searches the command in the directories of PATH
+ * @param[in] name Command name
+ * @param[out] path Buffer for the path of the command
+ * @param[in] size Size of the buffer
+ * @return Index of the directory of the command, -1 if not found
+ */
+static int __path_search(char *name, char *path, size_t size) {
+
+    struct stat st;
+    unsigned int dir_i;
+
+    for (dir_i = 0; dir_i < g_nb_path_dirs; dir_i++) {
+
+        snprintf(path, size, "%s/%s", g_path_dirs[dir_i], name);
+
+        /* The first executable regular file is taken, as execvp does */
+        if (!stat(path, &st) && S_ISREG(st.st_mode) && !access(path, X_OK)) {
+
+            return dir_i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Initialize the command path cache, in a file shared by the shells
+ *        if #PATH_CACHE_FILE_ENV names one
+ */
+void path_cache_init() {
+
+    char *file = getenv(PATH_CACHE_FILE_ENV);
+    struct stat st;
+    void *p_map;
+    int fd;
+
+    g_p_path_index = &g_path_local_index;
+
+    /* If the index is to be shared */
+    if (file && ((fd = open(file, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR)) != -1)) {
+
+        /* Make sure the file can hold the index */
+        if (!fstat(fd, &st) &&
+            ((st.st_size >= (off_t)sizeof(path_index_t)) || !ftruncate(fd, sizeof(path_index_t))) &&
+            ((p_map = mmap(NULL, sizeof(path_index_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) != MAP_FAILED)) {
+
+            g_p_path_index = (path_index_t *)p_map;
+            g_path_index_fd = fd;
+        }
+        else {
+
+            close(fd);
+        }
+    }
+
+    /* Build the index for the current PATH */
+    path_cache_revalidate();
+}
+
+/**
+ * @brief Empties the index if PATH is changed or any of its directories is
+ *        modified (a command added, removed or replaced), called before the
+ *        commands of a line are looked up
+ */
+void path_cache_revalidate() {
+
+    struct timespec mtimes[PATH_CACHE_MAX_DIRS];
+    path_index_t *p_index = g_p_path_index;
+    struct stat st;
+    unsigned int dir_i;
+
+    /* Split PATH again if it is changed */
+    if (!g_path_str || __path_is_changed()) {
+
+        __path_split();
+    }
+
+    /* Get the modification times of the directories */
+    for (dir_i = 0; dir_i < g_nb_path_dirs; dir_i++) {
+
+        if (!stat(g_path_dirs[dir_i], &st)) {
+
+            mtimes[dir_i] = st.st_mtim;
+        }
+        else {
+
+            mtimes[dir_i].tv_sec = 0;
+            mtimes[dir_i].tv_nsec = 0;
+        }
+    }
+
+    /* If the index is built for the same directories, unmodified */
+    if ((__atomic_load_n(&p_index->magic, __ATOMIC_ACQUIRE) == PATH_INDEX_MAGIC) &&
+        (p_index->path_hash == g_path_hash) &&
+        (p_index->nb_dirs == g_nb_path_dirs) &&
+        !memcmp(p_index->dir_mtimes, mtimes, g_nb_path_dirs * sizeof(struct timespec))) {
+
+        return;
+    }
+
+    __path_lock();
+    __path_reset(mtimes);
+    __path_unlock();
+}
+
+/**
+ * @brief Returns the path of the command, searching PATH only if the command
+ *        is not cached (or is too long to be cached)
+ * @param[in] name Command name (used as is if it has a slash)
+ * @param[out] path Buffer for the path
+ * @param[in] size Size of the buffer
+ * @return #path, NULL if the command is not found
+ */
+char *path_cache_lookup(char *name, char *path, size_t size) {
+
+    path_entry_t *p_entry;
+    size_t len;
+    uint64_t hash;
+    int dir_i;
+
+    /* Paths are not searched */
+    if (strchr(name, '/')) {
+
+        snprintf(path, size, "%s", name);
+
+        return path;
+    }
+
+    /* If PATH is changed since the last revalidation (or another shell
+     * rebuilt the shared index for its own PATH) */
+    if (__path_is_changed() || (g_p_path_index->path_hash != g_path_hash)) {
+
+        path_cache_revalidate();
+    }
+
+    len = strlen(name);
+
+    /* Long names are searched every time */
+    if (len >= PATH_CACHE_NAME_LEN) {
+
+        return (__path_search(name, path, size) != -1) ? path : NULL;
+    }
+
+    /* The hash 0 marks the free entries */
+    if (!(hash = hash_bytes(name, len))) {
+
+        hash = 1;
+    }
+
+    /* If the command is cached */
+    if ((p_entry = __path_find(name, hash, &dir_i))) {
+
+        p_entry->hits++;
+    }
+    else {
+
+        /* Search it and cache the result, found or not */
+        dir_i = __path_search(name, path, size);
+
+        __path_insert(name, len, hash, dir_i);
+    }
+
+    /* If the command is not found */
+    if ((dir_i < 0) || (dir_i >= (int)g_nb_path_dirs)) {
+
+        return NULL;
+    }
+
+    snprintf(path, size, "%s/%s", g_path_dirs[dir_i], name);
+
+    return path;
+}
+
+/**
+ * @brief Prints the cached commands with their paths
+ */
+void path_cache_print() {
+
+    path_entry_t *p_entry;
+    unsigned int entry_i;
+
+    /* Print the headers */
+    printf("HITS\tCOMMAND\n");
+
+    for (entry_i = 0; entry_i < PATH_CACHE_SIZE; entry_i++) {
+
+        p_entry = &g_p_path_index->entries[entry_i];
+
+        if (!p_entry->hash) {
+
+            continue;
+        }
+
+        if ((p_entry->dir_i >= 0) && (p_entry->dir_i < (int)g_nb_path_dirs)) {
+
+            printf("%u\t%s/%s\n", p_entry->hits, g_path_dirs[p_entry->dir_i], p_entry->name);
+        }
+        else {
+
+            printf("%u\t%s (not found)\n", p_entry->hits, p_entry->name);
+        }
+    }
+}
+
+/**
+ * @brief Removes all the cached commands
+ */
+void path_cache_clear() {
+
+    __path_lock();
+    __path_reset(g_p_path_index->dir_mtimes);
+    __path_unlock();
+}
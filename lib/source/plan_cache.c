@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "plan_cache.h"
+#include "hash.h"
+
+/* No entry index */
+#define NO_ENTRY (-1)
+
+/* Alignment of the key after the plan in the entry block */
+#define PLAN_ALIGN (sizeof(void *))
+
+/**
+ * @brief Entry of the plan cache
+ */
+typedef struct __plan_entry_t {
+
+    /* Hash of the command line string */
+    uint64_t hash;
+
+    /* Command line string (stored in the plan block) */
+    char *key;
+
+    /* Length of the command line string */
+    size_t key_len;
+
+    /* Packed and materialized command table (start of the block) */
+    cmd_tab_t *p_plan;
+
+    /* Neighbouring entries in the least recently used order */
+    int lru_prev;
+    int lru_next;
+
+    /* Next entry in the same hash bucket */
+    int bucket_next;
+
+} plan_entry_t;
+
+/* Global array of cache entries */
+plan_entry_t g_plan_entries[PLAN_CACHE_SIZE];
+/* Global count of cache entries */
+int g_nb_plan_entries;
+/* First entry of each hash bucket */
+int g_plan_buckets[PLAN_CACHE_BUCKETS];
+/* Most and least recently used entries */
+int g_plan_lru_head;
+int g_plan_lru_tail;
+/* Cache statistics */
+unsigned long g_plan_hits;
+unsigned long g_plan_misses;
+unsigned long g_plan_evictions;
+
+/**
+ * @brief Removes the entry from the least recently used list
+ * @param[in] entry_i Entry index
+ */
+static void __lru_unlink(int entry_i) {
+
+    plan_entry_t *p_entry = &g_plan_entries[entry_i];
+
+    if (p_entry->lru_prev != NO_ENTRY) {
+        g_plan_entries[p_entry->lru_prev].lru_next = p_entry->lru_next;
+    }
+    else {
+        g_plan_lru_head = p_entry->lru_next;
+    }
+
+    if (p_entry->lru_next != NO_ENTRY) {
+        g_plan_entries[p_entry->lru_next].lru_prev = p_entry->lru_prev;
+    }
+    else {
+        g_plan_lru_tail = p_entry->lru_prev;
+    }
+}
+
+/**
+ * @brief Inserts the entry as the most recently used one
+ * @param[in] entry_i Entry index
+ */
+static void __lru_push_head(int entry_i) {
+
+    plan_entry_t *p_entry = &g_plan_entries[entry_i];
+
+    p_entry->lru_prev = NO_ENTRY;
+    p_entry->lru_next = g_plan_lru_head;
+
+    if (g_plan_lru_head != NO_ENTRY) {
+        g_plan_entries[g_plan_lru_head].lru_prev = entry_i;
+    }
+    else {
+        g_plan_lru_tail = entry_i;
+    }
+
+    g_plan_lru_head = entry_i;
+}
+
+/**
+ * @brief Removes the entry from its hash bucket
+ * @param[in] entry_i Entry index
+ */
+static void __bucket_unlink(int entry_i) {
+
+    int *p_link = &g_plan_buckets[g_plan_entries[entry_i].hash & (PLAN_CACHE_BUCKETS - 1)];
+
+    /* Find the link pointing to the entry */
+    while (*p_link != entry_i) {
+
+        p_link = &g_plan_entries[*p_link].bucket_next;
+    }
+
+    *p_link = g_plan_entries[entry_i].bucket_next;
+}
+
+/**
+ * @brief Initialize the plan cache
+ */
+void plan_cache_init() {
+
+    int bucket_i;
+
+    /* Set the number of entries to zero */
+    g_nb_plan_entries = 0;
+
+    /* Empty the buckets and the least recently used list */
+    for (bucket_i = 0; bucket_i < PLAN_CACHE_BUCKETS; bucket_i++) {
+
+        g_plan_buckets[bucket_i] = NO_ENTRY;
+    }
+
+    g_plan_lru_head = NO_ENTRY;
+    g_plan_lru_tail = NO_ENTRY;
+}
+
+/**
+ * @brief Returns the plan for the command line string if it is cached
+ * @param[in] cmd_str Command line string
+ * @return Pointer to the immutable plan (owned by the cache, valid till the
+ *         next #plan_cache_put), NULL if not cached
+ */
+cmd_tab_t *plan_cache_get(char *cmd_str) {
+
+    int entry_i;
+    plan_entry_t *p_entry;
+
+    /* Hash the command line string */
+    size_t len = strlen(cmd_str);
+    uint64_t hash = hash_bytes(cmd_str, len);
+
+    /* For each entry in the bucket */
+    for (entry_i = g_plan_buckets[hash & (PLAN_CACHE_BUCKETS - 1)];
+         entry_i != NO_ENTRY;
+         entry_i = p_entry->bucket_next) {
+
+        p_entry = &g_plan_entries[entry_i];
+
+        /* If the string matches */
+        if ((p_entry->hash == hash) &&
+            (p_entry->key_len == len) &&
+            !memcmp(p_entry->key, cmd_str, len)) {
+
+            /* Make it the most recently used entry */
+            __lru_unlink(entry_i);
+            __lru_push_head(entry_i);
+
+            g_plan_hits++;
+
+            return p_entry->p_plan;
+        }
+    }
+
+    g_plan_misses++;
+
+    return NULL;
+}
+
+/**
+ * @brief Caches the plan of the command line string, evicting the least
+ *        recently used one if the cache is full
+ * @param[in] cmd_str Command line string
+ * @param[in] p_cmd_tab Command table parsed from the string
+ * @return Pointer to the cached immutable plan, or #p_cmd_tab itself if the
+ *         table is not worth caching (no commands)
+ */
+cmd_tab_t *plan_cache_put(char *cmd_str, cmd_tab_t *p_cmd_tab) {
+
+    int entry_i;
+    size_t plan_size;
+    size_t len;
+    plan_entry_t *p_entry;
+    uint64_t hash;
+
+    /* Blank lines are not cached */
+    if (cmd_tab_get_nb_cmds(p_cmd_tab) < 1) {
+
+        return p_cmd_tab;
+    }
+
+    /* If the cache is full */
+    if (g_nb_plan_entries == PLAN_CACHE_SIZE) {
+
+        /* Evict the least recently used entry, reusing its slot */
+        entry_i = g_plan_lru_tail;
+
+        __lru_unlink(entry_i);
+        __bucket_unlink(entry_i);
+        free(g_plan_entries[entry_i].p_plan);
+
+        g_plan_evictions++;
+    }
+    else {
+
+        entry_i = g_nb_plan_entries++;
+    }
+
+    p_entry = &g_plan_entries[entry_i];
+
+    /* Hash the command line string */
+    len = strlen(cmd_str);
+    hash = hash_bytes(cmd_str, len);
+
+    /* Allocate the plan and the key as a single block */
+    plan_size = cmd_tab_get_packed_size(p_cmd_tab);
+    plan_size = (plan_size + (PLAN_ALIGN - 1)) & ~(PLAN_ALIGN - 1);
+    p_entry->p_plan = (cmd_tab_t *)malloc(plan_size + len + 1);
+
+    /* Pack the command table and materialize it once, so that it is never
+     * written again */
+    cmd_tab_pack(p_entry->p_plan, p_cmd_tab);
+    cmd_tab_materialize(p_entry->p_plan);
+
+    /* Copy the key */
+    p_entry->key = (char *)p_entry->p_plan + plan_size;
+    memcpy(p_entry->key, cmd_str, len + 1);
+    p_entry->key_len = len;
+    p_entry->hash = hash;
+
+    /* Link the entry in its bucket */
+    p_entry->bucket_next = g_plan_buckets[hash & (PLAN_CACHE_BUCKETS - 1)];
+    g_plan_buckets[hash & (PLAN_CACHE_BUCKETS - 1)] = entry_i;
+
+    /* Make it the most recently used entry */
+    __lru_push_head(entry_i);
+
+    return p_entry->p_plan;
+}
+
+/**
+ * @brief Prints the statistics of the plan cache
+ */
+void plan_cache_print_stats() {
+
+    /* Print the headers */
+    printf("HITS\tMISSES\tEVICTED\tENTRIES\n");
+
+    /* Print the counters */
+    printf("%lu\t%lu\t%lu\t%d\n", g_plan_hits, g_plan_misses,
+           g_plan_evictions, g_nb_plan_entries);
+}
+
+/**
+ * @brief Removes all the plans and resets the statistics
+ */
+void plan_cache_clear() {
+
+    int entry_i;
+
+    /* Free every plan */
+    for (entry_i = 0; entry_i < g_nb_plan_entries; entry_i++) {
+
+        free(g_plan_entries[entry_i].p_plan);
+    }
+
+    /* Reset the statistics */
+    g_plan_hits = 0;
+    g_plan_misses = 0;
+    g_plan_evictions = 0;
+
+    /* Empty the cache */
+    plan_cache_init();
+}
@@ -5,25 +5,18 @@
 /* Current working directory string size */
 #define CWD_STR_SIZE (128u)
 
-/* Prototypes for the handlers */
-static void __sigint_handler(int sig_num);
-
 /**
- * @brief Initialize the signal handlers for the prompt
+ * @brief Initialize the signal handlers for the prompt (SIGINT is blocked
+ *        and taken by the event loop of the jobs, which prints the prompt
+ *        again)
  */
 void prompt_signal_init() {
 
-    /* Initialize the SIGINT handler */
-    signal(SIGINT, __sigint_handler);
-
     /* Initialize the SIGTSTP handler */
     signal(SIGTSTP, SIG_IGN);
 
     /* Initialize the SIGTTOU handler */
     signal(SIGTTOU, SIG_DFL);
-
-    /* Initialize the SIGCHLD handler */
-    signal(SIGCHLD, SIG_DFL);
 }
 
 /**
@@ -43,16 +36,3 @@ void prompt_print() {
     /* Flush the output */
     fflush(stdout);
 }
-
-/**
- * @brief SIGINT handler
- * @param[in] sig_num Signal number
- */
-static void __sigint_handler(int sig_num) {
-
-    /* Print newline */
-    printf("\n");
-
-    /* Print the prompt */
-    prompt_print();
-}
@@ -0,0 +1,255 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "reader.h"
+
+/**
+ * @brief Sets the reader variables to base values
+ * @param[out] p_reader Pointer to the reader object
+ * @param[in] fd File descriptor (-1 for a string)
+ */
+static void __reader_clear(reader_t *p_reader, int fd) {
+
+    p_reader->fd = fd;
+    p_reader->buf = NULL;
+    p_reader->size = 0;
+    p_reader->start = 0;
+    p_reader->end = 0;
+    p_reader->file_off = 0;
+    p_reader->is_mapped = false;
+    p_reader->is_eof = false;
+    p_reader->tail = NULL;
+}
+
+/**
+ * @brief Reads more data from the file descriptor into the buffer, moving
+ *        the unread data to the front and growing the buffer if required
+ * @param[out] p_reader Pointer to the reader object
+ */
+static void __reader_fill(reader_t *p_reader) {
+
+    ssize_t nb_read;
+
+    /* Move the unread data to the front of the buffer */
+    if (p_reader->start) {
+
+        memmove(p_reader->buf, p_reader->buf + p_reader->start,
+                p_reader->end - p_reader->start);
+
+        p_reader->file_off += p_reader->start;
+        p_reader->end -= p_reader->start;
+        p_reader->start = 0;
+    }
+
+    /* Grow the buffer if it is full (one byte is kept for the terminator) */
+    if (p_reader->end + 1 >= p_reader->size) {
+
+        p_reader->size *= 2;
+        p_reader->buf = (char *)realloc(p_reader->buf, p_reader->size);
+    }
+
+    /* Read as much as the buffer can hold */
+    do {
+
+        nb_read = read(p_reader->fd, p_reader->buf + p_reader->end,
+                       p_reader->size - p_reader->end - 1);
+
+    } while ((nb_read < 0) && (errno == EINTR));
+
+    /* If nothing more can be read */
+    if (nb_read <= 0) {
+
+        p_reader->is_eof = true;
+
+        return;
+    }
+
+    p_reader->end += nb_read;
+}
+
+/**
+ * @brief Opens a line reader on the file descriptor, regular files are
+ *        mapped at once, anything else is read through a large buffer
+ * @param[out] p_reader Pointer to the reader object
+ * @param[in] fd File descriptor
+ */
+void reader_open_fd(reader_t *p_reader, int fd) {
+
+    struct stat st;
+    void *p_map;
+
+    __reader_clear(p_reader, fd);
+
+    /* If the file is a non empty regular file */
+    if (!fstat(fd, &st) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+
+        /* Map it privately, so that the lines can be terminated in place */
+        p_map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+        if (p_map != MAP_FAILED) {
+
+            /* The lines are read only once, from the start to the end */
+            madvise(p_map, st.st_size, MADV_SEQUENTIAL);
+
+            p_reader->buf = (char *)p_map;
+            p_reader->size = st.st_size;
+            p_reader->end = st.st_size;
+            p_reader->file_off = lseek(fd, 0, SEEK_CUR);
+            p_reader->is_mapped = true;
+            p_reader->is_eof = true;
+
+            /* Skip the part of the file which is already consumed */
+            p_reader->start = (p_reader->file_off > 0) ? p_reader->file_off : 0;
+            p_reader->file_off = 0;
+
+            return;
+        }
+    }
+
+    /* Allocate the read buffer */
+    p_reader->size = READER_BUF_SIZE;
+    p_reader->buf = (char *)malloc(p_reader->size);
+}
+
+/**
+ * @brief Opens a line reader on a string (may contain multiple lines)
+ * @param[out] p_reader Pointer to the reader object
+ * @param[in] str String
+ */
+void reader_open_str(reader_t *p_reader, const char *str) {
+
+    __reader_clear(p_reader, -1);
+
+    /* Copy the string, so that the lines can be terminated in place */
+    p_reader->buf = strdup(str);
+    p_reader->size = strlen(str) + 1;
+    p_reader->end = p_reader->size - 1;
+    p_reader->is_eof = true;
+}
+
+/**
+ * @brief Returns the next line (without the newline)
+ * @param[in,out] p_reader Pointer to the reader object
+ * @return NULL terminated line owned by the reader (valid till the next
+ *         call), NULL at the end of the input
+ */
+char *reader_get_line(reader_t *p_reader) {
+
+    char *line;
+    char *p_nl;
+    size_t len;
+
+    while (1) {
+
+        line = p_reader->buf + p_reader->start;
+
+        /* Search the end of the line in the unread data */
+        p_nl = (char *)memchr(line, '\n', p_reader->end - p_reader->start);
+
+        /* If a complete line is present */
+        if (p_nl) {
+
+            /* Terminate the line in place and consume it */
+            *p_nl = '\0';
+            p_reader->start = p_nl - p_reader->buf + 1;
+
+            return line;
+        }
+
+        /* If nothing more can be read */
+        if (p_reader->is_eof) {
+
+            /* If no data is left */
+            if (p_reader->start == p_reader->end) {
+
+                return NULL;
+            }
+
+            len = p_reader->end - p_reader->start;
+            p_reader->start = p_reader->end;
+
+            /* A mapping has no space for the terminator after the last
+             * line, so the line is copied */
+            if (p_reader->is_mapped) {
+
+                free(p_reader->tail);
+                p_reader->tail = strndup(line, len);
+
+                return p_reader->tail;
+            }
+
+            /* Terminate the last line in the spare byte */
+            line[len] = '\0';
+
+            return line;
+        }
+
+        /* Read more data */
+        __reader_fill(p_reader);
+    }
+}
+
+/**
+ * @brief Returns the file offset of the end of the consumed lines
+ * @param[in] p_reader Pointer to the reader object
+ * @return Offset
+ */
+off_t reader_tell(reader_t *p_reader) {
+
+    return p_reader->file_off + p_reader->start;
+}
+
+/**
+ * @brief Checks if every byte read is consumed, so that the next line needs
+ *        a read
+ * @param[in] p_reader Pointer to the reader object
+ * @return true if nothing is left in the buffer
+ */
+bool reader_is_empty(reader_t *p_reader) {
+
+    return (p_reader->start >= p_reader->end) && !p_reader->is_eof;
+}
+
+/**
+ * @brief Moves the file offset to the end of the consumed lines (given by
+ *        reader_tell), so that the commands sharing the file descriptor
+ *        continue from there (seekable files only)
+ * @param[in] p_reader Pointer to the reader object
+ * @param[in] off Offset of the end of the consumed lines
+ */
+void reader_sync(reader_t *p_reader, off_t off) {
+
+    /* Strings do not have a file offset */
+    if (p_reader->fd < 0) {
+
+        return;
+    }
+
+    /* Fails harmlessly on pipes and terminals */
+    lseek(p_reader->fd, off, SEEK_SET);
+}
+
+/**
+ * @brief Releases the memory of the reader (the file descriptor is not closed)
+ * @param[out] p_reader Pointer to the reader object
+ */
+void reader_close(reader_t *p_reader) {
+
+    /* Release the buffer */
+    if (p_reader->is_mapped) {
+
+        munmap(p_reader->buf, p_reader->size);
+    }
+    else {
+
+        free(p_reader->buf);
+    }
+
+    /* Release the copy of the last line */
+    free(p_reader->tail);
+
+    __reader_clear(p_reader, -1);
+}
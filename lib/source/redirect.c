@@ -0,0 +1,479 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "redirect.h"
+
+/**
+ * @brief Writes all the bytes to the file descriptor (the errors are
+ *        ignored, the other outputs still get the data)
+ * @param[in] fd File descriptor
+ * @param[in] data Data to be written
+ * @param[in] len Number of bytes
+ */
+static void __redirect_write_all(int fd, const char *data, size_t len) {
+
+    ssize_t nb_written;
+
+    while (len) {
+
+        nb_written = write(fd, data, len);
+
+        if (nb_written < 0) {
+
+            if (errno == EINTR) {
+
+                continue;
+            }
+
+            return;
+        }
+
+        data += nb_written;
+        len -= nb_written;
+    }
+}
+
+/**
+ * @brief Reads exactly the number of bytes (less at the end of the input)
+ * @param[in] fd File descriptor
+ * @param[out] buf Buffer
+ * @param[in] len Number of bytes
+ * @return Number of bytes read
+ */
+static size_t __redirect_read_all(int fd, char *buf, size_t len) {
+
+    size_t total = 0;
+    ssize_t nb_read;
+
+    while (total < len) {
+
+        nb_read = read(fd, buf + total, len - total);
+
+        if (nb_read < 0) {
+
+            if (errno == EINTR) {
+
+                continue;
+            }
+
+            break;
+        }
+
+        if (!nb_read) {
+
+            break;
+        }
+
+        total += nb_read;
+    }
+
+    return total;
+}
+
+/**
+ * @brief Moves the bytes from the pipe to the output with splice, the bytes
+ *        which cannot be spliced (the output does not support it or failed)
+ *        are copied through the buffer
+ * @param[in] pipe_fd Read end of the pipe
+ * @param[in] out_fd Output file descriptor
+ * @param[in] len Number of bytes present in the pipe
+ * @param[in] buf Buffer of #REDIRECT_BUF_SIZE bytes
+ */
+static void __redirect_drain(int pipe_fd, int out_fd, size_t len, char *buf) {
+
+    ssize_t nb_moved;
+
+    while (len) {
+
+        nb_moved = splice(pipe_fd, NULL, out_fd, NULL, len, SPLICE_F_MOVE);
+
+        if (nb_moved > 0) {
+
+            len -= nb_moved;
+
+            continue;
+        }
+
+        if ((nb_moved < 0) && (errno == EINTR)) {
+
+            continue;
+        }
+
+        /* Copy the next part of the bytes instead */
+        nb_moved = __redirect_read_all(pipe_fd, buf, (len < REDIRECT_BUF_SIZE) ? len : REDIRECT_BUF_SIZE);
+
+        if (!nb_moved) {
+
+            return;
+        }
+
+        __redirect_write_all(out_fd, buf, nb_moved);
+        len -= nb_moved;
+    }
+}
+
+/**
+ * @brief Copies the input to all the outputs through the buffer
+ * @param[in] p_redirect Pointer to the redirection
+ * @param[in] in_fd Input file descriptor
+ * @param[in] buf Buffer of #REDIRECT_BUF_SIZE bytes
+ */
+static void __redirect_copy(redirect_t *p_redirect, int in_fd, char *buf) {
+
+    int *out_fds = p_redirect->fds + p_redirect->nb_in_fds;
+    size_t len;
+    int out_i;
+
+    while ((len = __redirect_read_all(in_fd, buf, REDIRECT_BUF_SIZE))) {
+
+        for (out_i = 0; out_i < p_redirect->nb_out_fds; out_i++) {
+
+            __redirect_write_all(out_fds[out_i], buf, len);
+        }
+    }
+}
+
+/**
+ * @brief Splices the input to the only output
+ * @param[in] in_fd Input file descriptor
+ * @param[in] out_fd Output file descriptor
+ * @param[in] buf Buffer of #REDIRECT_BUF_SIZE bytes
+ * @return true If the input is done
+ * @return false If nothing could be spliced (to be copied instead)
+ */
+static bool __redirect_splice(int in_fd, int out_fd, char *buf) {
+
+    ssize_t nb_moved;
+    bool is_spliced = false;
+
+    while (1) {
+
+        nb_moved = splice(in_fd, NULL, out_fd, NULL, INT_MAX, SPLICE_F_MOVE);
+
+        if (!nb_moved) {
+
+            return true;
+        }
+
+        if (nb_moved < 0) {
+
+            if (errno == EINTR) {
+
+                continue;
+            }
+
+            /* Neither side is a pipe or supports splice */
+            if ((errno == EINVAL) && !is_spliced) {
+
+                return false;
+            }
+
+            /* The output is gone, consume the rest of the input */
+            while (__redirect_read_all(in_fd, buf, REDIRECT_BUF_SIZE));
+
+            return true;
+        }
+
+        is_spliced = true;
+    }
+}
+
+/**
+ * @brief Duplicates the input pipe to all the outputs with tee, the last
+ *        output consumes the input
+ * @param[in] p_redirect Pointer to the redirection
+ * @param[in] in_fd Input file descriptor (a pipe)
+ * @param[in] buf Buffer of #REDIRECT_BUF_SIZE bytes
+ * @return true If the input is done
+ * @return false If the input could not be teed (to be copied instead)
+ */
+static bool __redirect_tee(redirect_t *p_redirect, int in_fd, char *buf) {
+
+    int *out_fds = p_redirect->fds + p_redirect->nb_in_fds;
+    int nb_out_fds = p_redirect->nb_out_fds;
+    char *round_buf = NULL;
+    int tmp_fds[2];
+    ssize_t len;
+    ssize_t dup_len;
+    int pipe_size;
+    int out_i;
+
+    /* Pipe holding the duplicate of the input, of the same capacity so that
+     * all the data of the input can be duplicated at once */
+    if (pipe2(tmp_fds, O_CLOEXEC)) {
+
+        return false;
+    }
+
+    if ((pipe_size = fcntl(in_fd, F_GETPIPE_SZ)) > 0) {
+
+        fcntl(tmp_fds[1], F_SETPIPE_SZ, pipe_size);
+    }
+
+    while (1) {
+
+        /* Duplicate the data present in the input */
+        len = tee(in_fd, tmp_fds[1], INT_MAX, 0);
+
+        if (len < 0) {
+
+            if (errno == EINTR) {
+
+                continue;
+            }
+
+            break;
+        }
+
+        if (!len) {
+
+            break;
+        }
+
+        /* Give the duplicate to every output except the last */
+        for (out_i = 0; out_i < nb_out_fds - 1; out_i++) {
+
+            /* The first duplicate is done already */
+            dup_len = out_i ? tee(in_fd, tmp_fds[1], len, 0) : len;
+
+            /* If the whole data could not be duplicated again */
+            if (dup_len != len) {
+
+                /* Drop the partial duplicate */
+                __redirect_drain(tmp_fds[0], -1, (dup_len > 0) ? dup_len : 0, buf);
+
+                break;
+            }
+
+            __redirect_drain(tmp_fds[0], out_fds[out_i], len, buf);
+        }
+
+        /* Give the data to the last output, consuming it */
+        if (out_i == nb_out_fds - 1) {
+
+            __redirect_drain(in_fd, out_fds[out_i], len, buf);
+
+            continue;
+        }
+
+        /* Else copy the data to the outputs remaining in the round */
+        if (!round_buf) {
+
+            round_buf = (char *)malloc((pipe_size > 0) ? pipe_size : len);
+        }
+
+        len = __redirect_read_all(in_fd, round_buf, len);
+
+        for (; out_i < nb_out_fds; out_i++) {
+
+            __redirect_write_all(out_fds[out_i], round_buf, len);
+        }
+    }
+
+    free(round_buf);
+    close(tmp_fds[0]);
+    close(tmp_fds[1]);
+
+    /* If not a single byte could be teed from the input */
+    return (len >= 0) || (errno != EINVAL);
+}
+
+/**
+ * @brief Gives the mapped data to the output, the pages are referenced by
+ *        the pipe instead of being copied
+ * @param[in] data Mapped data
+ * @param[in] len Number of bytes
+ * @param[in] out_fd Output file descriptor
+ */
+static void __redirect_vmsplice(const char *data, size_t len, int out_fd) {
+
+    struct iovec iov;
+    ssize_t nb_moved;
+
+    while (len) {
+
+        iov.iov_base = (void *)data;
+        iov.iov_len = len;
+
+        nb_moved = vmsplice(out_fd, &iov, 1, 0);
+
+        if (nb_moved < 0) {
+
+            if (errno == EINTR) {
+
+                continue;
+            }
+
+            /* Not a pipe, the data is written */
+            if (errno == EINVAL) {
+
+                __redirect_write_all(out_fd, data, len);
+            }
+
+            /* Else the reader is gone */
+            return;
+        }
+
+        data += nb_moved;
+        len -= nb_moved;
+    }
+}
+
+/**
+ * @brief Copies every input to all the outputs, then closes them
+ * @param[in] p_arg Pointer to the redirection
+ * @return NULL
+ */
+static void *__redirect_thread(void *p_arg) {
+
+    redirect_t *p_redirect = (redirect_t *)p_arg;
+    int *out_fds = p_redirect->fds + p_redirect->nb_in_fds;
+    char *buf = (char *)malloc(REDIRECT_BUF_SIZE);
+    bool is_done;
+    int in_i;
+    int fd_i;
+
+    /* The mapped data comes first (there is no input then) */
+    if (p_redirect->data) {
+
+        __redirect_vmsplice(p_redirect->data, p_redirect->len, out_fds[0]);
+    }
+
+    /* For every input, one after the other */
+    for (in_i = 0; in_i < p_redirect->nb_in_fds; in_i++) {
+
+        if (p_redirect->nb_out_fds == 1) {
+
+            is_done = __redirect_splice(p_redirect->fds[in_i], out_fds[0], buf);
+        }
+        else {
+
+            is_done = __redirect_tee(p_redirect, p_redirect->fds[in_i], buf);
+        }
+
+        /* Copy through the buffer if the kernel cannot move the data */
+        if (!is_done) {
+
+            __redirect_copy(p_redirect, p_redirect->fds[in_i], buf);
+        }
+    }
+
+    /* Closing the outputs lets the reader of the pipe see the end of file */
+    for (fd_i = 0; fd_i < p_redirect->nb_in_fds + p_redirect->nb_out_fds; fd_i++) {
+
+        close(p_redirect->fds[fd_i]);
+    }
+
+    free(buf);
+
+    if (p_redirect->is_detached) {
+
+        free(p_redirect);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Starts the thread of the redirection
+ * @param[in] p_redirect Pointer to the redirection
+ * @return Pointer to the redirection
+ */
+static redirect_t *__redirect_run(redirect_t *p_redirect) {
+
+    /* Set of all the signals */
+    sigset_t all_set;
+
+    /* Signal mask of the caller */
+    sigset_t old_set;
+
+    /* A detached redirection may be freed as soon as it is started */
+    bool is_detached = p_redirect->is_detached;
+
+    /* The thread blocks every signal, so that the job control handlers
+     * always run on the main thread */
+    sigfillset(&all_set);
+    pthread_sigmask(SIG_SETMASK, &all_set, &old_set);
+
+    pthread_create(&p_redirect->thread, NULL, __redirect_thread, p_redirect);
+
+    if (is_detached) {
+
+        pthread_detach(p_redirect->thread);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+
+    return p_redirect;
+}
+
+/**
+ * @brief Starts copying the inputs (one after the other) to all the outputs
+ *        on a new thread
+ * @param[in] in_fds Input file descriptors (closed by the redirection)
+ * @param[in] nb_in_fds Number of inputs
+ * @param[in] out_fds Output file descriptors (closed by the redirection)
+ * @param[in] nb_out_fds Number of outputs
+ * @param[in] is_detached Whether the redirection frees itself when done,
+ *            else it must be joined
+ * @return Pointer to the redirection
+ */
+redirect_t *redirect_start(int *in_fds, int nb_in_fds, int *out_fds, int nb_out_fds, bool is_detached) {
+
+    redirect_t *p_redirect;
+
+    p_redirect = (redirect_t *)malloc(sizeof(redirect_t) + (nb_in_fds + nb_out_fds) * sizeof(int));
+    p_redirect->nb_in_fds = nb_in_fds;
+    p_redirect->nb_out_fds = nb_out_fds;
+    p_redirect->is_detached = is_detached;
+    p_redirect->data = NULL;
+    p_redirect->len = 0;
+
+    /* Copy the file descriptors */
+    memcpy(p_redirect->fds, in_fds, nb_in_fds * sizeof(int));
+    memcpy(p_redirect->fds + nb_in_fds, out_fds, nb_out_fds * sizeof(int));
+
+    return __redirect_run(p_redirect);
+}
+
+/**
+ * @brief Starts giving the mapped data to the output on a new thread
+ * @param[in] data Mapped data (kept mapped till the redirection is done)
+ * @param[in] len Number of bytes
+ * @param[in] out_fd Output file descriptor, a pipe for the pages to be moved
+ *            without a copy (closed by the redirection)
+ * @param[in] is_detached Whether the redirection frees itself when done,
+ *            else it must be joined
+ * @return Pointer to the redirection
+ */
+redirect_t *redirect_start_map(const char *data, size_t len, int out_fd, bool is_detached) {
+
+    redirect_t *p_redirect;
+
+    p_redirect = (redirect_t *)malloc(sizeof(redirect_t) + sizeof(int));
+    p_redirect->nb_in_fds = 0;
+    p_redirect->nb_out_fds = 1;
+    p_redirect->is_detached = is_detached;
+    p_redirect->data = data;
+    p_redirect->len = len;
+    p_redirect->fds[0] = out_fd;
+
+    return __redirect_run(p_redirect);
+}
+
+/**
+ * @brief Waits till the redirection is done and frees it
+ * @param[in] p_redirect Pointer to the redirection
+ */
+void redirect_join(redirect_t *p_redirect) {
+
+    pthread_join(p_redirect->thread, NULL);
+
+    free(p_redirect);
+}
@@ -0,0 +1,397 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "scan.h"
+#include "str_util.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_HAVE_X86 (1)
+#endif
+
+/**
+ * @brief Scalar scan for the identifier characters, using the class table
+ * @param[in] str String to be scanned
+ * @param[in] len Number of bytes in the string
+ * @return Number of leading identifier bytes
+ */
+static size_t __scan_ident_scalar(const char *str, size_t len) {
+
+    size_t i;
+
+    /* Till a non identifier byte is found */
+    for (i = 0; (i < len) && (CHAR_CLASS(str[i]) == CHAR_CLASS_IDENT); i++);
+
+    return i;
+}
+
+#ifdef SCAN_HAVE_X86
+
+/* Mask of the bytes of #v which lie in [lo, hi] (unsigned comparison) */
+#define SSE2_IN_RANGE(v, lo, hi)                                        \
+    ({                                                                  \
+        __m128i __t = _mm_sub_epi8((v), _mm_set1_epi8((char)(lo)));     \
+        _mm_cmpeq_epi8(_mm_min_epu8(__t, _mm_set1_epi8((char)((hi) - (lo)))), __t); \
+    })
+
+#define AVX2_IN_RANGE(v, lo, hi)                                        \
+    ({                                                                  \
+        __m256i __t = _mm256_sub_epi8((v), _mm256_set1_epi8((char)(lo))); \
+        _mm256_cmpeq_epi8(_mm256_min_epu8(__t, _mm256_set1_epi8((char)((hi) - (lo)))), __t); \
+    })
+
+/**
+ * @brief SSE2 scan for the identifier characters, 16 bytes at a time
+ * @param[in] str String to be scanned
+ * @param[in] len Number of bytes in the string
+ * @return Number of leading identifier bytes
+ */
+__attribute__((target("sse2")))
+static size_t __scan_ident_sse2(const char *str, size_t len) {
+
+    size_t i;
+    __m128i v;
+    __m128i ident;
+    unsigned int mask;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+
+        /* Load the next 16 bytes */
+        v = _mm_loadu_si128((const __m128i *)(str + i));
+
+        /* Identifier ranges (same as the class table) */
+        ident = _mm_or_si128(SSE2_IN_RANGE(v, '*', ':'), SSE2_IN_RANGE(v, '?', '_'));
+        ident = _mm_or_si128(ident, SSE2_IN_RANGE(v, 'a', '{'));
+        ident = _mm_or_si128(ident, _mm_cmpeq_epi8(v, _mm_set1_epi8('!')));
+        ident = _mm_or_si128(ident, SSE2_IN_RANGE(v, '$', '%'));
+        ident = _mm_or_si128(ident, _mm_cmpeq_epi8(v, _mm_set1_epi8('=')));
+        ident = _mm_or_si128(ident, _mm_cmpeq_epi8(v, _mm_set1_epi8('}')));
+        ident = _mm_or_si128(ident, _mm_cmpeq_epi8(v, _mm_set1_epi8('~')));
+        ident = _mm_or_si128(ident, _mm_cmplt_epi8(v, _mm_setzero_si128()));
+
+        /* If any of the bytes is not an identifier */
+        if ((mask = ~_mm_movemask_epi8(ident) & 0xffffu)) {
+
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    /* Scan the tail */
+    return i + __scan_ident_scalar(str + i, len - i);
+}
+
+/**
+ * @brief AVX2 scan for the identifier characters, 32 bytes at a time
+ * @param[in] str String to be scanned
+ * @param[in] len Number of bytes in the string
+ * @return Number of leading identifier bytes
+ */
+__attribute__((target("avx2")))
+static size_t __scan_ident_avx2(const char *str, size_t len) {
+
+    size_t i;
+    __m256i v;
+    __m256i ident;
+    uint32_t mask;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+
+        /* Load the next 32 bytes */
+        v = _mm256_loadu_si256((const __m256i *)(str + i));
+
+        /* Identifier ranges (same as the class table) */
+        ident = _mm256_or_si256(AVX2_IN_RANGE(v, '*', ':'), AVX2_IN_RANGE(v, '?', '_'));
+        ident = _mm256_or_si256(ident, AVX2_IN_RANGE(v, 'a', '{'));
+        ident = _mm256_or_si256(ident, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('!')));
+        ident = _mm256_or_si256(ident, AVX2_IN_RANGE(v, '$', '%'));
+        ident = _mm256_or_si256(ident, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('=')));
+        ident = _mm256_or_si256(ident, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('}')));
+        ident = _mm256_or_si256(ident, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('~')));
+        ident = _mm256_or_si256(ident, _mm256_cmpgt_epi8(_mm256_setzero_si256(), v));
+
+        /* If any of the bytes is not an identifier */
+        if ((mask = ~(uint32_t)_mm256_movemask_epi8(ident))) {
+
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    /* Scan the tail with the narrower vectors */
+    return i + __scan_ident_sse2(str + i, len - i);
+}
+
+/**
+ * @brief SSE2 count of the byte, 16 bytes at a time
+ * @param[in] str String to be scanned
+ * @param[in] len Number of bytes in the string
+ * @param[in] ch Byte to be counted
+ * @return Number of occurrences
+ */
+__attribute__((target("sse2,popcnt")))
+static size_t __scan_count_sse2(const char *str, size_t len, char ch) {
+
+    size_t i;
+    size_t count = 0;
+    __m128i needle = _mm_set1_epi8(ch);
+
+    for (i = 0; i + 16 <= len; i += 16) {
+
+        count += __builtin_popcount(_mm_movemask_epi8(
+                 _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(str + i)), needle)));
+    }
+
+    /* Count in the tail */
+    for (; i < len; i++) {
+
+        count += (str[i] == ch);
+    }
+
+    return count;
+}
+
+/**
+ * @brief AVX2 count of the byte, 64 bytes at a time
+ * @param[in] str String to be scanned
+ * @param[in] len Number of bytes in the string
+ * @param[in] ch Byte to be counted
+ * @return Number of occurrences
+ */
+__attribute__((target("avx2,popcnt")))
+static size_t __scan_count_avx2(const char *str, size_t len, char ch) {
+
+    size_t i;
+    size_t count = 0;
+    __m256i needle = _mm256_set1_epi8(ch);
+    uint64_t mask;
+
+    for (i = 0; i + 64 <= len; i += 64) {
+
+        /* Masks of the two halves as a single word */
+        mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+               _mm256_loadu_si256((const __m256i *)(str + i)), needle));
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                _mm256_loadu_si256((const __m256i *)(str + i + 32)), needle)) << 32;
+
+        count += __builtin_popcountll(mask);
+    }
+
+    /* Count in the tail with the narrower vectors */
+    return count + __scan_count_sse2(str + i, len - i, ch);
+}
+
+/**
+ * @brief SSE2 search of the string (at least 2 bytes long), the first and
+ *        the last bytes of the needle are compared at 16 positions at a
+ *        time and only the candidates are compared fully
+ * @param[in] hay String to be searched
+ * @param[in] len Number of bytes in the string
+ * @param[in] needle String to be found
+ * @param[in] nlen Number of bytes in the needle
+ * @return Pointer to the first occurrence, NULL if not found
+ */
+__attribute__((target("sse2")))
+static const char *__scan_find_sse2(
+        const char *hay,
+        size_t len,
+        const char *needle,
+        size_t nlen) {
+
+    size_t i;
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i last = _mm_set1_epi8(needle[nlen - 1]);
+    unsigned int mask;
+    unsigned int bit;
+
+    for (i = 0; i + nlen - 1 + 16 <= len; i += 16) {
+
+        /* Positions where both the first and the last bytes match */
+        mask = _mm_movemask_epi8(_mm_and_si128(
+               _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(hay + i)), first),
+               _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(hay + i + nlen - 1)), last)));
+
+        /* Compare the middle of every candidate */
+        while (mask) {
+
+            bit = __builtin_ctz(mask);
+
+            if (!memcmp(hay + i + bit + 1, needle + 1, nlen - 2)) {
+
+                return hay + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    /* Search the tail */
+    return (const char *)memmem(hay + i, len - i, needle, nlen);
+}
+
+/**
+ * @brief AVX2 search of the string (at least 2 bytes long), 32 positions at
+ *        a time
+ * @param[in] hay String to be searched
+ * @param[in] len Number of bytes in the string
+ * @param[in] needle String to be found
+ * @param[in] nlen Number of bytes in the needle
+ * @return Pointer to the first occurrence, NULL if not found
+ */
+__attribute__((target("avx2")))
+static const char *__scan_find_avx2(
+        const char *hay,
+        size_t len,
+        const char *needle,
+        size_t nlen) {
+
+    size_t i;
+    __m256i first = _mm256_set1_epi8(needle[0]);
+    __m256i last = _mm256_set1_epi8(needle[nlen - 1]);
+    uint32_t mask;
+    unsigned int bit;
+
+    for (i = 0; i + nlen - 1 + 32 <= len; i += 32) {
+
+        /* Positions where both the first and the last bytes match */
+        mask = _mm256_movemask_epi8(_mm256_and_si256(
+               _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(hay + i)), first),
+               _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(hay + i + nlen - 1)), last)));
+
+        /* Compare the middle of every candidate */
+        while (mask) {
+
+            bit = __builtin_ctz(mask);
+
+            if (!memcmp(hay + i + bit + 1, needle + 1, nlen - 2)) {
+
+                return hay + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    /* Search the tail with the narrower vectors */
+    return __scan_find_sse2(hay + i, len - i, needle, nlen);
+}
+
+#endif
+
+/* Short runs are scanned without the vector setup cost */
+#define SCAN_VECTOR_MIN_LEN (16u)
+
+/**
+ * @brief Returns the length of the run of identifier characters at the
+ *        start of the string (the whole token), using the widest vector
+ *        instructions supported by the CPU
+ * @param[in] str String to be scanned
+ * @param[in] len Number of bytes in the string
+ * @return Number of leading identifier bytes
+ */
+size_t scan_ident(const char *str, size_t len) {
+
+#ifdef SCAN_HAVE_X86
+    /* Scanner selected on the first call */
+    static size_t (*scan_fn)(const char *, size_t) = NULL;
+
+    if (len < SCAN_VECTOR_MIN_LEN) {
+
+        return __scan_ident_scalar(str, len);
+    }
+
+    if (!scan_fn) {
+
+        scan_fn = (__builtin_cpu_supports("avx2")) ? __scan_ident_avx2 :
+                  (__builtin_cpu_supports("sse2")) ? __scan_ident_sse2 :
+                                                     __scan_ident_scalar;
+    }
+
+    return scan_fn(str, len);
+#else
+    return __scan_ident_scalar(str, len);
+#endif
+}
+
+/**
+ * @brief Returns the length of the run of whitespace at the start of the
+ *        string
+ * @param[in] str String to be scanned
+ * @param[in] len Number of bytes in the string
+ * @return Number of leading whitespace bytes
+ */
+size_t scan_white(const char *str, size_t len) {
+
+    size_t i;
+
+    /* Whitespace runs are short, no vectors needed */
+    for (i = 0; (i < len) && (CHAR_CLASS(str[i]) == CHAR_CLASS_WHITE); i++);
+
+    return i;
+}
+
+/**
+ * @brief Returns the number of occurrences of the byte in the string (the
+ *        newlines of a buffer for example)
+ * @param[in] str String to be scanned
+ * @param[in] len Number of bytes in the string
+ * @param[in] ch Byte to be counted
+ * @return Number of occurrences
+ */
+size_t scan_count(const char *str, size_t len, char ch) {
+
+#ifdef SCAN_HAVE_X86
+    /* Counter selected on the first call */
+    static size_t (*count_fn)(const char *, size_t, char) = NULL;
+
+    if (!count_fn) {
+
+        count_fn = (__builtin_cpu_supports("avx2")) ? __scan_count_avx2 :
+                                                      __scan_count_sse2;
+    }
+
+    return count_fn(str, len, ch);
+#else
+    size_t count = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+
+        count += (str[i] == ch);
+    }
+
+    return count;
+#endif
+}
+
+/**
+ * @brief Returns the first occurrence of the needle in the string (memmem
+ *        with the vectorized first and last byte filter)
+ * @param[in] hay String to be searched
+ * @param[in] len Number of bytes in the string
+ * @param[in] needle String to be found
+ * @param[in] nlen Number of bytes in the needle
+ * @return Pointer to the first occurrence, NULL if not found
+ */
+const char *scan_find(const char *hay, size_t len, const char *needle, size_t nlen) {
+
+    /* Single bytes are found by memchr (vectorized by the C library) */
+    if (nlen < 2) {
+
+        return nlen ? (const char *)memchr(hay, needle[0], len) : hay;
+    }
+
+#ifdef SCAN_HAVE_X86
+    /* Searcher selected on the first call */
+    static const char *(*find_fn)(const char *, size_t, const char *, size_t) = NULL;
+
+    if (!find_fn) {
+
+        find_fn = (__builtin_cpu_supports("avx2")) ? __scan_find_avx2 :
+                                                     __scan_find_sse2;
+    }
+
+    return find_fn(hay, len, needle, nlen);
+#else
+    return (const char *)memmem(hay, len, needle, nlen);
+#endif
+}
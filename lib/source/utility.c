@@ -0,0 +1,1261 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "utility.h"
+
+/* Maximum length of a printf conversion specification */
+#define UTILITY_MAX_SPEC_LEN (32)
+
+/* Writes an error of the utility */
+#define WRITE_ERROR(err_fd, name, fmt, ...)                                 \
+    ({                                                                      \
+        dprintf(err_fd, "kavach: %s: " fmt "\n", name, ##__VA_ARGS__);     \
+    })
+
+/**
+ * @brief Buffered output of a utility
+ */
+typedef struct __utility_out_t {
+
+    /* Output file descriptor */
+    int fd;
+
+    /* Number of bytes in the buffer */
+    size_t len;
+
+    /* Is the output closed by the reader (or failed) */
+    bool is_broken;
+
+    /* Buffer */
+    char buf[UTILITY_BUF_SIZE];
+
+} utility_out_t;
+
+/**
+ * @brief Arguments of the test utility, parsed by recursive descent
+ */
+typedef struct __utility_test_t {
+
+    /* Arguments of the expression */
+    char **args;
+
+    /* Number of arguments of the expression */
+    int nb_args;
+
+    /* Next argument */
+    int arg_i;
+
+    /* Is the expression invalid */
+    bool is_err;
+
+    /* Error file descriptor */
+    int err_fd;
+
+} utility_test_t;
+
+/**
+ * @brief Signal names (without the SIG prefix) understood by kill
+ */
+static const struct {
+
+    const char *name;
+    int nb;
+
+} g_signals[] = {
+
+    {"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT}, {"ILL", SIGILL},
+    {"TRAP", SIGTRAP}, {"ABRT", SIGABRT}, {"BUS", SIGBUS}, {"FPE", SIGFPE},
+    {"KILL", SIGKILL}, {"USR1", SIGUSR1}, {"SEGV", SIGSEGV}, {"USR2", SIGUSR2},
+    {"PIPE", SIGPIPE}, {"ALRM", SIGALRM}, {"TERM", SIGTERM}, {"CHLD", SIGCHLD},
+    {"CONT", SIGCONT}, {"STOP", SIGSTOP}, {"TSTP", SIGTSTP}, {"TTIN", SIGTTIN},
+    {"TTOU", SIGTTOU}, {"URG", SIGURG}, {"XCPU", SIGXCPU}, {"XFSZ", SIGXFSZ},
+    {"VTALRM", SIGVTALRM}, {"PROF", SIGPROF}, {"WINCH", SIGWINCH}, {"IO", SIGIO},
+    {"SYS", SIGSYS}
+};
+
+/**
+ * @brief Initializes the buffered output
+ * @param[out] p_out Pointer to the output
+ * @param[in] fd Output file descriptor
+ */
+static void __utility_out_init(utility_out_t *p_out, int fd) {
+
+    p_out->fd = fd;
+    p_out->len = 0;
+    p_out->is_broken = false;
+}
+
+/**
+ * @brief Writes the buffered output
+ * @param[in,out] p_out Pointer to the output
+ */
+static void __utility_flush(utility_out_t *p_out) {
+
+    char *data = p_out->buf;
+    ssize_t nb_written;
+
+    while (p_out->len && !p_out->is_broken) {
+
+        nb_written = write(p_out->fd, data, p_out->len);
+
+        if (nb_written < 0) {
+
+            /* Retry if interrupted, else the output is gone */
+            if (errno != EINTR) {
+
+                p_out->is_broken = true;
+            }
+
+            continue;
+        }
+
+        data += nb_written;
+        p_out->len -= nb_written;
+    }
+
+    p_out->len = 0;
+}
+
+/**
+ * @brief Writes the rest of the buffered output
+ * @param[in,out] p_out Pointer to the output
+ * @param[in] status Exit status of the utility
+ * @return Exit status, failed if the output is closed by its reader
+ */
+static int __utility_out_end(utility_out_t *p_out, int status) {
+
+    __utility_flush(p_out);
+
+    return p_out->is_broken ? 1 : status;
+}
+
+/**
+ * @brief Appends the data to the output
+ * @param[in,out] p_out Pointer to the output
+ * @param[in] data Data to be written
+ * @param[in] len Number of bytes
+ */
+static void __utility_put(utility_out_t *p_out, const char *data, size_t len) {
+
+    size_t part_len;
+
+    while (len) {
+
+        /* Write the buffer once it is full */
+        if (p_out->len == UTILITY_BUF_SIZE) {
+
+            __utility_flush(p_out);
+        }
+
+        part_len = UTILITY_BUF_SIZE - p_out->len;
+        part_len = (len < part_len) ? len : part_len;
+
+        memcpy(p_out->buf + p_out->len, data, part_len);
+        p_out->len += part_len;
+
+        data += part_len;
+        len -= part_len;
+    }
+}
+
+/**
+ * @brief Appends the formatted string to the output
+ * @param[in,out] p_out Pointer to the output
+ * @param[in] fmt Format (of printf)
+ */
+static void __utility_put_fmt(utility_out_t *p_out, const char *fmt, ...) {
+
+    char str[256];
+    char *p_str = str;
+    va_list args;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(str, sizeof(str), fmt, args);
+    va_end(args);
+
+    if (len < 0) {
+
+        return;
+    }
+
+    /* Format again in a large enough string if it does not fit */
+    if ((size_t)len >= sizeof(str)) {
+
+        p_str = (char *)malloc(len + 1);
+
+        va_start(args, fmt);
+        vsnprintf(p_str, len + 1, fmt, args);
+        va_end(args);
+    }
+
+    __utility_put(p_out, p_str, len);
+
+    if (p_str != str) {
+
+        free(p_str);
+    }
+}
+
+/**
+ * @brief Appends the character of a backslash escape to the output
+ * @param[in,out] p_out Pointer to the output
+ * @param[in] str Pointer to the backslash
+ * @param[in] is_zero_octal Whether the octal escapes start with \0 (echo and
+ *            %b), else they are \ddd (printf format)
+ * @param[out] p_is_stop Pointer to the flag set by a \c (no more output)
+ * @return Pointer to the character after the escape
+ */
+static const char *__utility_put_escape(utility_out_t *p_out, const char *str, bool is_zero_octal, bool *p_is_stop) {
+
+    char ch;
+    int nb_digits;
+
+    switch (*++str) {
+
+    case 'a': ch = '\a'; break;
+    case 'b': ch = '\b'; break;
+    case 'f': ch = '\f'; break;
+    case 'n': ch = '\n'; break;
+    case 'r': ch = '\r'; break;
+    case 't': ch = '\t'; break;
+    case 'v': ch = '\v'; break;
+    case '\\': ch = '\\'; break;
+
+    case 'c':
+        *p_is_stop = true;
+        return str + 1;
+
+    case '\0':
+        /* A trailing backslash is kept */
+        __utility_put(p_out, "\\", 1);
+        return str;
+
+    default:
+        /* Octal value of at most three digits (after the 0) */
+        if ((*str >= '0') && (*str <= '7')) {
+
+            if (is_zero_octal && (*str == '0')) {
+
+                str++;
+            }
+
+            for (ch = 0, nb_digits = 0; (nb_digits < 3) && (*str >= '0') && (*str <= '7'); nb_digits++) {
+
+                ch = (ch << 3) | (*str++ - '0');
+            }
+
+            __utility_put(p_out, &ch, 1);
+
+            return str;
+        }
+
+        /* Unknown escapes are kept */
+        __utility_put(p_out, "\\", 1);
+        ch = *str;
+        break;
+    }
+
+    __utility_put(p_out, &ch, 1);
+
+    return str + 1;
+}
+
+/**
+ * @brief Appends the string to the output, with its backslash escapes
+ *        replaced (as by echo -e and %b)
+ * @param[in,out] p_out Pointer to the output
+ * @param[in] str String
+ * @return false If stopped by a \c (no more output), else true
+ */
+static bool __utility_put_escaped(utility_out_t *p_out, const char *str) {
+
+    const char *p_start;
+    bool is_stop = false;
+
+    while (*str && !is_stop) {
+
+        /* Copy the characters till the next escape */
+        for (p_start = str; *str && (*str != '\\'); str++);
+
+        __utility_put(p_out, p_start, str - p_start);
+
+        if (*str) {
+
+            str = __utility_put_escape(p_out, str, true, &is_stop);
+        }
+    }
+
+    return !is_stop;
+}
+
+/**
+ * @brief Prints the arguments separated by spaces, <echo [-neE] [string ...]>
+ * @param[in,out] p_out Pointer to the output
+ * @param[in] args Arguments
+ * @param[in] nb_args Number of arguments
+ * @return Exit status
+ */
+static int __utility_echo(utility_out_t *p_out, char **args, int nb_args) {
+
+    bool is_nl = true;
+    bool is_escaped = false;
+    const char *p_opt;
+    int arg_i;
+
+    /* Get the options (an argument which is not only n, e and E is printed) */
+    for (arg_i = 1; (arg_i < nb_args) && (args[arg_i][0] == '-') && args[arg_i][1]; arg_i++) {
+
+        for (p_opt = args[arg_i] + 1; *p_opt && strchr("neE", *p_opt); p_opt++);
+
+        if (*p_opt) {
+
+            break;
+        }
+
+        for (p_opt = args[arg_i] + 1; *p_opt; p_opt++) {
+
+            if (*p_opt == 'n') {
+
+                is_nl = false;
+            }
+            else {
+
+                is_escaped = (*p_opt == 'e');
+            }
+        }
+    }
+
+    for (; arg_i < nb_args; arg_i++) {
+
+        if (!is_escaped) {
+
+            __utility_put(p_out, args[arg_i], strlen(args[arg_i]));
+        }
+        /* A \c stops the output (and the newline) */
+        else if (!__utility_put_escaped(p_out, args[arg_i])) {
+
+            return 0;
+        }
+
+        if (arg_i < nb_args - 1) {
+
+            __utility_put(p_out, " ", 1);
+        }
+    }
+
+    if (is_nl) {
+
+        __utility_put(p_out, "\n", 1);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Returns the numeric value of a printf argument (a leading quote
+ *        gives the value of the next character)
+ * @param[in] arg Argument (NULL if missing)
+ * @param[in] is_signed Whether the value is signed
+ * @param[in,out] p_status Pointer to the exit status (set if invalid)
+ * @param[in] err_fd Error file descriptor
+ * @return Value
+ */
+static unsigned long long __utility_printf_nb(const char *arg, bool is_signed, int *p_status, int err_fd) {
+
+    unsigned long long value;
+    char *p_end;
+
+    if (!arg || !*arg) {
+
+        return 0;
+    }
+
+    if ((arg[0] == '\'') || (arg[0] == '"')) {
+
+        return (unsigned char)arg[1];
+    }
+
+    errno = 0;
+    value = is_signed ? (unsigned long long)strtoll(arg, &p_end, 0) : strtoull(arg, &p_end, 0);
+
+    if (*p_end || errno) {
+
+        WRITE_ERROR(err_fd, "printf", "`%s` invalid number", arg);
+        *p_status = 1;
+    }
+
+    return value;
+}
+
+/**
+ * @brief Prints the arguments in the format, which is reused while
+ *        arguments remain, <printf format [arg ...]>
+ * @param[in,out] p_out Pointer to the output
+ * @param[in] args Arguments
+ * @param[in] nb_args Number of arguments
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status
+ */
+static int __utility_printf(utility_out_t *p_out, char **args, int nb_args, int err_fd) {
+
+    /* Conversion specification, with the length modifier added */
+    char spec[UTILITY_MAX_SPEC_LEN + 4];
+    size_t spec_len;
+
+    /* First argument used by the current pass over the format */
+    int pass_arg_i;
+    int arg_i = 2;
+
+    const char *p_fmt;
+    const char *p_start;
+    const char *arg;
+    char conv;
+    bool is_stop = false;
+    int status = 0;
+
+    if (nb_args < 2) {
+
+        WRITE_ERROR(err_fd, "printf", "incorrect number of arguments <printf format [arg ...]>");
+
+        return 2;
+    }
+
+    do {
+
+        pass_arg_i = arg_i;
+
+        for (p_fmt = args[1]; *p_fmt;) {
+
+            /* Copy the characters till the next escape or conversion */
+            for (p_start = p_fmt; *p_fmt && (*p_fmt != '\\') && (*p_fmt != '%'); p_fmt++);
+
+            __utility_put(p_out, p_start, p_fmt - p_start);
+
+            if (*p_fmt == '\\') {
+
+                p_fmt = __utility_put_escape(p_out, p_fmt, false, &is_stop);
+
+                /* A \c stops the output */
+                if (is_stop) {
+
+                    return status;
+                }
+
+                continue;
+            }
+
+            if (*p_fmt != '%') {
+
+                continue;
+            }
+
+            /* A literal percent */
+            if (p_fmt[1] == '%') {
+
+                __utility_put(p_out, "%", 1);
+                p_fmt += 2;
+
+                continue;
+            }
+
+            /* Get the flags, the width and the precision */
+            for (p_start = p_fmt++; *p_fmt && strchr("-+ #0", *p_fmt); p_fmt++);
+            for (; (*p_fmt >= '0') && (*p_fmt <= '9'); p_fmt++);
+            if (*p_fmt == '.') {
+                for (p_fmt++; (*p_fmt >= '0') && (*p_fmt <= '9'); p_fmt++);
+            }
+
+            conv = *p_fmt;
+            spec_len = p_fmt - p_start;
+
+            if (!conv || !strchr("diouxXcsbeEfgGaA", conv) || (spec_len > UTILITY_MAX_SPEC_LEN)) {
+
+                WRITE_ERROR(err_fd, "printf", "`%s` invalid conversion", p_start);
+
+                return 1;
+            }
+
+            p_fmt++;
+
+            /* Get the argument of the conversion */
+            arg = (arg_i < nb_args) ? args[arg_i++] : NULL;
+
+            memcpy(spec, p_start, spec_len);
+
+            switch (conv) {
+
+            case 'd':
+            case 'i':
+                strcpy(spec + spec_len, "lld");
+                __utility_put_fmt(p_out, spec, (long long)__utility_printf_nb(arg, true, &status, err_fd));
+                break;
+
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+                spec[spec_len] = 'l';
+                spec[spec_len + 1] = 'l';
+                spec[spec_len + 2] = conv;
+                spec[spec_len + 3] = '\0';
+                __utility_put_fmt(p_out, spec, __utility_printf_nb(arg, false, &status, err_fd));
+                break;
+
+            case 'c':
+                /* The first character of the argument */
+                if (arg && *arg) {
+
+                    strcpy(spec + spec_len, "c");
+                    __utility_put_fmt(p_out, spec, arg[0]);
+                }
+                break;
+
+            case 's':
+                strcpy(spec + spec_len, "s");
+                __utility_put_fmt(p_out, spec, arg ? arg : "");
+                break;
+
+            case 'b':
+                /* The argument with its escapes replaced, a \c stops the
+                 * output */
+                if (arg && !__utility_put_escaped(p_out, arg)) {
+
+                    return status;
+                }
+                break;
+
+            default:
+                spec[spec_len] = conv;
+                spec[spec_len + 1] = '\0';
+                __utility_put_fmt(p_out, spec, (arg && *arg) ? strtod(arg, NULL) : 0.0);
+                break;
+            }
+        }
+
+    /* Reuse the format while it uses arguments and some remain */
+    } while ((arg_i < nb_args) && (arg_i > pass_arg_i));
+
+    return status;
+}
+
+static bool __utility_test_or(utility_test_t *p_test);
+
+/**
+ * @brief Returns the integer of a test argument
+ * @param[in,out] p_test Pointer to the test
+ * @param[in] arg Argument
+ * @return Integer (0 and the error set if invalid)
+ */
+static long long __utility_test_nb(utility_test_t *p_test, const char *arg) {
+
+    long long value;
+    char *p_end;
+
+    errno = 0;
+    value = strtoll(arg, &p_end, 10);
+
+    if (!*arg || *p_end || errno) {
+
+        WRITE_ERROR(p_test->err_fd, "test", "`%s` integer expected", arg);
+        p_test->is_err = true;
+
+        return 0;
+    }
+
+    return value;
+}
+
+/**
+ * @brief Evaluates a unary operator
+ * @param[in,out] p_test Pointer to the test
+ * @param[in] op Operator character (after the -)
+ * @param[in] arg Argument
+ * @param[out] p_is_true Pointer to the result
+ * @return false If the operator is not a unary one, else true
+ */
+static bool __utility_test_unary(utility_test_t *p_test, char op, const char *arg, bool *p_is_true) {
+
+    struct stat st;
+
+    switch (op) {
+
+    case 'n': *p_is_true = (*arg != '\0'); return true;
+    case 'z': *p_is_true = (*arg == '\0'); return true;
+    case 'r': *p_is_true = !access(arg, R_OK); return true;
+    case 'w': *p_is_true = !access(arg, W_OK); return true;
+    case 'x': *p_is_true = !access(arg, X_OK); return true;
+    case 't': *p_is_true = isatty(__utility_test_nb(p_test, arg)); return true;
+
+    case 'h':
+    case 'L':
+        *p_is_true = !lstat(arg, &st) && S_ISLNK(st.st_mode);
+        return true;
+
+    case 'e':
+    case 'f':
+    case 'd':
+    case 's':
+    case 'p':
+    case 'S':
+    case 'b':
+    case 'c':
+        if (stat(arg, &st)) {
+
+            *p_is_true = false;
+
+            return true;
+        }
+        break;
+
+    default:
+        return false;
+    }
+
+    switch (op) {
+
+    case 'f': *p_is_true = S_ISREG(st.st_mode); break;
+    case 'd': *p_is_true = S_ISDIR(st.st_mode); break;
+    case 's': *p_is_true = (st.st_size > 0); break;
+    case 'p': *p_is_true = S_ISFIFO(st.st_mode); break;
+    case 'S': *p_is_true = S_ISSOCK(st.st_mode); break;
+    case 'b': *p_is_true = S_ISBLK(st.st_mode); break;
+    case 'c': *p_is_true = S_ISCHR(st.st_mode); break;
+    default: *p_is_true = true; break;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Evaluates a binary operator
+ * @param[in,out] p_test Pointer to the test
+ * @param[in] left Left argument
+ * @param[in] op Operator
+ * @param[in] right Right argument
+ * @param[out] p_is_true Pointer to the result
+ * @return false If the operator is not a binary one, else true
+ */
+static bool __utility_test_binary(utility_test_t *p_test, const char *left, const char *op, const char *right, bool *p_is_true) {
+
+    struct stat left_st;
+    struct stat right_st;
+    long long left_nb;
+    long long right_nb;
+
+    /* String comparisons */
+    if (!strcmp(op, "=") || !strcmp(op, "==")) {
+
+        *p_is_true = !strcmp(left, right);
+    }
+    else if (!strcmp(op, "!=")) {
+
+        *p_is_true = !!strcmp(left, right);
+    }
+    else if (!strcmp(op, "<")) {
+
+        *p_is_true = (strcmp(left, right) < 0);
+    }
+    else if (!strcmp(op, ">")) {
+
+        *p_is_true = (strcmp(left, right) > 0);
+    }
+    /* File comparisons */
+    else if (!strcmp(op, "-nt") || !strcmp(op, "-ot") || !strcmp(op, "-ef")) {
+
+        if (stat(left, &left_st) || stat(right, &right_st)) {
+
+            *p_is_true = false;
+        }
+        else if (op[1] == 'e') {
+
+            *p_is_true = (left_st.st_dev == right_st.st_dev) && (left_st.st_ino == right_st.st_ino);
+        }
+        else {
+
+            *p_is_true = (op[1] == 'n') ?
+                         ((left_st.st_mtim.tv_sec > right_st.st_mtim.tv_sec) ||
+                          ((left_st.st_mtim.tv_sec == right_st.st_mtim.tv_sec) &&
+                           (left_st.st_mtim.tv_nsec > right_st.st_mtim.tv_nsec))) :
+                         ((left_st.st_mtim.tv_sec < right_st.st_mtim.tv_sec) ||
+                          ((left_st.st_mtim.tv_sec == right_st.st_mtim.tv_sec) &&
+                           (left_st.st_mtim.tv_nsec < right_st.st_mtim.tv_nsec)));
+        }
+    }
+    /* Integer comparisons */
+    else if ((op[0] == '-') && op[1] && op[2] && !op[3] && strstr("-eq-ne-lt-le-gt-ge", op)) {
+
+        left_nb = __utility_test_nb(p_test, left);
+        right_nb = __utility_test_nb(p_test, right);
+
+        switch (op[1]) {
+
+        case 'e': *p_is_true = (left_nb == right_nb); break;
+        case 'n': *p_is_true = (left_nb != right_nb); break;
+        case 'l': *p_is_true = (op[2] == 't') ? (left_nb < right_nb) : (left_nb <= right_nb); break;
+        default: *p_is_true = (op[2] == 't') ? (left_nb > right_nb) : (left_nb >= right_nb); break;
+        }
+    }
+    else {
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Evaluates a primary expression, (expr), -op arg, arg op arg or arg
+ * @param[in,out] p_test Pointer to the test
+ * @return Result
+ */
+static bool __utility_test_primary(utility_test_t *p_test) {
+
+    char **args = p_test->args + p_test->arg_i;
+    int nb_left = p_test->nb_args - p_test->arg_i;
+    bool is_true;
+
+    if (nb_left < 1) {
+
+        WRITE_ERROR(p_test->err_fd, "test", "argument expected");
+        p_test->is_err = true;
+
+        return false;
+    }
+
+    /* A binary operator takes precedence (test -n = -n compares strings) */
+    if ((nb_left >= 3) && __utility_test_binary(p_test, args[0], args[1], args[2], &is_true)) {
+
+        p_test->arg_i += 3;
+
+        return is_true;
+    }
+
+    /* A parenthesized expression */
+    if (!strcmp(args[0], "(") && (nb_left >= 2)) {
+
+        p_test->arg_i++;
+        is_true = __utility_test_or(p_test);
+
+        if ((p_test->arg_i >= p_test->nb_args) || strcmp(p_test->args[p_test->arg_i], ")")) {
+
+            WRITE_ERROR(p_test->err_fd, "test", "`)` expected");
+            p_test->is_err = true;
+
+            return false;
+        }
+
+        p_test->arg_i++;
+
+        return is_true;
+    }
+
+    /* A unary operator */
+    if ((nb_left >= 2) && (args[0][0] == '-') && args[0][1] && !args[0][2] &&
+        __utility_test_unary(p_test, args[0][1], args[1], &is_true)) {
+
+        p_test->arg_i += 2;
+
+        return is_true;
+    }
+
+    /* A single string is true if not empty */
+    p_test->arg_i++;
+
+    return (args[0][0] != '\0');
+}
+
+/**
+ * @brief Evaluates a negation, ! expr
+ * @param[in,out] p_test Pointer to the test
+ * @return Result
+ */
+static bool __utility_test_not(utility_test_t *p_test) {
+
+    /* A ! followed by something negates it */
+    if ((p_test->arg_i < p_test->nb_args - 1) && !strcmp(p_test->args[p_test->arg_i], "!")) {
+
+        p_test->arg_i++;
+
+        return !__utility_test_not(p_test);
+    }
+
+    return __utility_test_primary(p_test);
+}
+
+/**
+ * @brief Evaluates a conjunction, expr -a expr
+ * @param[in,out] p_test Pointer to the test
+ * @return Result
+ */
+static bool __utility_test_and(utility_test_t *p_test) {
+
+    bool is_true = __utility_test_not(p_test);
+
+    while ((p_test->arg_i < p_test->nb_args) && !strcmp(p_test->args[p_test->arg_i], "-a")) {
+
+        p_test->arg_i++;
+
+        /* Both sides are parsed (and checked) */
+        is_true = __utility_test_not(p_test) && is_true;
+    }
+
+    return is_true;
+}
+
+/**
+ * @brief Evaluates a disjunction, expr -o expr
+ * @param[in,out] p_test Pointer to the test
+ * @return Result
+ */
+static bool __utility_test_or(utility_test_t *p_test) {
+
+    bool is_true = __utility_test_and(p_test);
+
+    while ((p_test->arg_i < p_test->nb_args) && !strcmp(p_test->args[p_test->arg_i], "-o")) {
+
+        p_test->arg_i++;
+
+        is_true = __utility_test_and(p_test) || is_true;
+    }
+
+    return is_true;
+}
+
+/**
+ * @brief Evaluates the expression, <test expr> or <[ expr ]>
+ * @param[in] args Arguments
+ * @param[in] nb_args Number of arguments
+ * @param[in] is_bracket Whether the utility is [ (a ] must end the
+ *            expression)
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status, 0 if true, 1 if false, 2 if invalid
+ */
+static int __utility_test(char **args, int nb_args, bool is_bracket, int err_fd) {
+
+    utility_test_t test;
+    bool is_true;
+
+    if (is_bracket) {
+
+        if (strcmp(args[nb_args - 1], "]")) {
+
+            WRITE_ERROR(err_fd, "[", "`]` expected");
+
+            return 2;
+        }
+
+        nb_args--;
+    }
+
+    /* Without an expression the test is false */
+    if (nb_args == 1) {
+
+        return 1;
+    }
+
+    test.args = args + 1;
+    test.nb_args = nb_args - 1;
+    test.arg_i = 0;
+    test.is_err = false;
+    test.err_fd = err_fd;
+
+    is_true = __utility_test_or(&test);
+
+    if (!test.is_err && (test.arg_i < test.nb_args)) {
+
+        WRITE_ERROR(err_fd, "test", "`%s` unexpected argument", test.args[test.arg_i]);
+        test.is_err = true;
+    }
+
+    return test.is_err ? 2 : !is_true;
+}
+
+/**
+ * @brief Prints the current directory, <pwd>
+ * @param[in,out] p_out Pointer to the output
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status
+ */
+static int __utility_pwd(utility_out_t *p_out, int err_fd) {
+
+    char path[PATH_MAX];
+
+    if (!getcwd(path, sizeof(path))) {
+
+        WRITE_ERROR(err_fd, "pwd", "cannot get the current directory (%s)", strerror(errno));
+
+        return 1;
+    }
+
+    __utility_put(p_out, path, strlen(path));
+    __utility_put(p_out, "\n", 1);
+
+    return 0;
+}
+
+/**
+ * @brief Returns the signal number of a name (with or without the SIG
+ *        prefix, in any case) or a number
+ * @param[in] name Signal name or number
+ * @return Signal number, -1 if invalid
+ */
+static int __utility_signal_nb(const char *name) {
+
+    char *p_end;
+    long nb;
+    size_t sig_i;
+
+    /* A number */
+    nb = strtol(name, &p_end, 10);
+
+    if (*name && !*p_end) {
+
+        return ((nb >= 0) && (nb < NSIG)) ? (int)nb : -1;
+    }
+
+    if (!strncasecmp(name, "SIG", 3)) {
+
+        name += 3;
+    }
+
+    for (sig_i = 0; sig_i < sizeof(g_signals) / sizeof(g_signals[0]); sig_i++) {
+
+        if (!strcasecmp(name, g_signals[sig_i].name)) {
+
+            return g_signals[sig_i].nb;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Sends the signal to the processes (a negative id is a process
+ *        group), <kill [-s sig | -sig] pid ...> or <kill -l>
+ * @param[in,out] p_out Pointer to the output
+ * @param[in] args Arguments
+ * @param[in] nb_args Number of arguments
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status
+ */
+static int __utility_kill(utility_out_t *p_out, char **args, int nb_args, int err_fd) {
+
+    int sig_nb = SIGTERM;
+    int status = 0;
+    char *p_end;
+    long pid;
+    size_t sig_i;
+    int arg_i = 1;
+
+    /* List the signal names */
+    if ((nb_args == 2) && !strcmp(args[1], "-l")) {
+
+        for (sig_i = 0; sig_i < sizeof(g_signals) / sizeof(g_signals[0]); sig_i++) {
+
+            __utility_put_fmt(p_out, "%d) SIG%s\n", g_signals[sig_i].nb, g_signals[sig_i].name);
+        }
+
+        return 0;
+    }
+
+    /* Get the signal */
+    if ((arg_i < nb_args) && (args[arg_i][0] == '-') && args[arg_i][1] && strcmp(args[arg_i], "--")) {
+
+        if (!strcmp(args[arg_i], "-s")) {
+
+            arg_i++;
+        }
+        else {
+
+            args[arg_i]++;
+        }
+
+        if ((arg_i >= nb_args) || ((sig_nb = __utility_signal_nb(args[arg_i])) == -1)) {
+
+            WRITE_ERROR(err_fd, "kill", "invalid signal");
+
+            return 2;
+        }
+
+        arg_i++;
+    }
+
+    if ((arg_i < nb_args) && !strcmp(args[arg_i], "--")) {
+
+        arg_i++;
+    }
+
+    if (arg_i >= nb_args) {
+
+        WRITE_ERROR(err_fd, "kill", "incorrect number of arguments <kill [-s sig | -sig] pid ...>");
+
+        return 2;
+    }
+
+    /* Signal every process */
+    for (; arg_i < nb_args; arg_i++) {
+
+        pid = strtol(args[arg_i], &p_end, 10);
+
+        if (!args[arg_i][0] || *p_end) {
+
+            WRITE_ERROR(err_fd, "kill", "`%s` invalid process id", args[arg_i]);
+            status = 1;
+
+            continue;
+        }
+
+        if (kill((pid_t)pid, sig_nb)) {
+
+            WRITE_ERROR(err_fd, "kill", "(%ld) cannot send the signal (%s)", pid, strerror(errno));
+            status = 1;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief Runs the utility on the calling thread
+ * @param[in] p_arg Pointer to the utility
+ * @return NULL
+ */
+static void *__utility_thread(void *p_arg) {
+
+    utility_t *p_utility = (utility_t *)p_arg;
+
+    p_utility->status = p_utility->func(p_utility->args, p_utility->nb_args, p_utility->out_fd, p_utility->err_fd);
+
+    /* Closing the output lets the next stage see the end of file */
+    close(p_utility->out_fd);
+    close(p_utility->err_fd);
+
+    if (p_utility->is_detached) {
+
+        free(p_utility);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Prints the arguments separated by spaces, <echo [-neE] [string ...]>
+ * @param[in] args Arguments (NULL terminated)
+ * @param[in] nb_args Number of arguments
+ * @param[in] out_fd Output file descriptor
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status
+ */
+int utility_echo(char **args, int nb_args, int out_fd, int err_fd) {
+
+    utility_out_t out;
+
+    __utility_out_init(&out, out_fd);
+
+    return __utility_out_end(&out, __utility_echo(&out, args, nb_args));
+}
+
+/**
+ * @brief Prints the arguments in the format, <printf format [arg ...]>
+ * @param[in] args Arguments (NULL terminated)
+ * @param[in] nb_args Number of arguments
+ * @param[in] out_fd Output file descriptor
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status
+ */
+int utility_printf(char **args, int nb_args, int out_fd, int err_fd) {
+
+    utility_out_t out;
+
+    __utility_out_init(&out, out_fd);
+
+    return __utility_out_end(&out, __utility_printf(&out, args, nb_args, err_fd));
+}
+
+/**
+ * @brief Does nothing, successfully, <true>
+ * @param[in] args Arguments (NULL terminated)
+ * @param[in] nb_args Number of arguments
+ * @param[in] out_fd Output file descriptor
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status, 0
+ */
+int utility_true(char **args, int nb_args, int out_fd, int err_fd) {
+
+    return 0;
+}
+
+/**
+ * @brief Does nothing, unsuccessfully, <false>
+ * @param[in] args Arguments (NULL terminated)
+ * @param[in] nb_args Number of arguments
+ * @param[in] out_fd Output file descriptor
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status, 1
+ */
+int utility_false(char **args, int nb_args, int out_fd, int err_fd) {
+
+    return 1;
+}
+
+/**
+ * @brief Evaluates the expression, <test expr>
+ * @param[in] args Arguments (NULL terminated)
+ * @param[in] nb_args Number of arguments
+ * @param[in] out_fd Output file descriptor
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status, 0 if true, 1 if false, 2 if invalid
+ */
+int utility_test(char **args, int nb_args, int out_fd, int err_fd) {
+
+    return __utility_test(args, nb_args, false, err_fd);
+}
+
+/**
+ * @brief Evaluates the expression, <[ expr ]>
+ * @param[in] args Arguments (NULL terminated)
+ * @param[in] nb_args Number of arguments
+ * @param[in] out_fd Output file descriptor
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status, 0 if true, 1 if false, 2 if invalid
+ */
+int utility_bracket(char **args, int nb_args, int out_fd, int err_fd) {
+
+    return __utility_test(args, nb_args, true, err_fd);
+}
+
+/**
+ * @brief Prints the current directory, <pwd>
+ * @param[in] args Arguments (NULL terminated)
+ * @param[in] nb_args Number of arguments
+ * @param[in] out_fd Output file descriptor
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status
+ */
+int utility_pwd(char **args, int nb_args, int out_fd, int err_fd) {
+
+    utility_out_t out;
+
+    __utility_out_init(&out, out_fd);
+
+    return __utility_out_end(&out, __utility_pwd(&out, err_fd));
+}
+
+/**
+ * @brief Sends the signal to the processes, <kill [-s sig | -sig] pid ...>
+ * @param[in] args Arguments (NULL terminated)
+ * @param[in] nb_args Number of arguments
+ * @param[in] out_fd Output file descriptor
+ * @param[in] err_fd Error file descriptor
+ * @return Exit status
+ */
+int utility_kill(char **args, int nb_args, int out_fd, int err_fd) {
+
+    utility_out_t out;
+
+    __utility_out_init(&out, out_fd);
+
+    return __utility_out_end(&out, __utility_kill(&out, args, nb_args, err_fd));
+}
+
+/**
+ * @brief Creates a utility with a copy of the arguments (so that it does
+ *        not depend on the command table)
+ * @param[in] func Function of the utility
+ * @param[in] args Arguments
+ * @param[in] nb_args Number of arguments
+ * @return Pointer to the utility
+ */
+utility_t *utility_create(utility_func_t func, char **args, int nb_args) {
+
+    utility_t *p_utility;
+    size_t size;
+    char *p_str;
+    int arg_i;
+
+    /* Size of the record, the argument pointers and the strings */
+    size = sizeof(utility_t) + (nb_args + 1) * sizeof(char *);
+
+    for (arg_i = 0; arg_i < nb_args; arg_i++) {
+
+        size += strlen(args[arg_i]) + 1;
+    }
+
+    p_utility = (utility_t *)malloc(size);
+    p_utility->func = func;
+    p_utility->nb_args = nb_args;
+
+    /* Copy the strings after the argument pointers */
+    p_str = (char *)(p_utility->args + nb_args + 1);
+
+    for (arg_i = 0; arg_i < nb_args; arg_i++) {
+
+        p_utility->args[arg_i] = strcpy(p_str, args[arg_i]);
+        p_str += strlen(p_str) + 1;
+    }
+
+    p_utility->args[nb_args] = NULL;
+
+    return p_utility;
+}
+
+/**
+ * @brief Starts the utility on a new thread
+ * @param[in,out] p_utility Pointer to the utility
+ * @param[in] out_fd Output file descriptor (closed by the utility)
+ * @param[in] err_fd Error file descriptor (closed by the utility)
+ * @param[in] is_detached Whether the utility frees itself when done, else
+ *            it must be joined
+ */
+void utility_start(utility_t *p_utility, int out_fd, int err_fd, bool is_detached) {
+
+    /* Set of all the signals */
+    sigset_t all_set;
+
+    /* Signal mask of the caller */
+    sigset_t old_set;
+
+    p_utility->out_fd = out_fd;
+    p_utility->err_fd = err_fd;
+    p_utility->is_detached = is_detached;
+
+    /* The thread blocks every signal, so that the job control handlers
+     * always run on the main thread */
+    sigfillset(&all_set);
+    pthread_sigmask(SIG_SETMASK, &all_set, &old_set);
+
+    pthread_create(&p_utility->thread, NULL, __utility_thread, p_utility);
+
+    if (is_detached) {
+
+        pthread_detach(p_utility->thread);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+}
+
+/**
+ * @brief Waits till the utility is done and frees it
+ * @param[in] p_utility Pointer to the utility
+ * @return Exit status of the utility
+ */
+int utility_join(utility_t *p_utility) {
+
+    int status;
+
+    pthread_join(p_utility->thread, NULL);
+
+    status = p_utility->status;
+    free(p_utility);
+
+    return status;
+}
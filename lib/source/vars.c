@@ -0,0 +1,448 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vars.h"
+#include "hash.h"
+
+/* Is the character allowed in a variable name (not as the first one for a
+ * digit) */
+#define IS_NAME_CHAR(ch, is_first)                                          \
+    ({                                                                      \
+        char __ch = (ch);                                                   \
+        ((__ch >= 'a') && (__ch <= 'z')) || ((__ch >= 'A') && (__ch <= 'Z')) || \
+        (__ch == '_') || (!(is_first) && (__ch >= '0') && (__ch <= '9'));   \
+    })
+
+/* Appends the bytes to the expansion (only the part which fits the output
+ * is written, the length counts all of them) */
+#define EXPAND_PUT(data, n)                                                 \
+    ({                                                                      \
+        size_t __n = (n);                                                   \
+        if (out_len < size) {                                               \
+            memcpy(out + out_len, (data), (__n < size - out_len) ? __n : size - out_len); \
+        }                                                                   \
+        out_len += __n;                                                     \
+    })
+
+/* Open addressing table of the variables (linear probing) */
+static var_t *g_vars;
+
+/* Number of slots of the table (a power of 2) */
+static size_t g_nb_slots;
+
+/* Number of variables */
+static size_t g_nb_vars;
+
+/* Number of exported variables */
+static size_t g_nb_exported;
+
+/* Environment of the commands (the strings of the exported variables) */
+static char **g_envp;
+
+/* Size of the environment given to an exec (the strings and the pointers,
+ * counted as ARG_MAX counts them) */
+static size_t g_envp_size;
+
+/* Is the environment to be built again (an exported variable changed) */
+static bool g_is_envp_stale;
+
+/**
+ * @brief Returns the slot of the variable, or the free slot where it would
+ *        be added
+ * @param[in] name Name of the variable
+ * @param[in] name_len Length of the name
+ * @param[in] hash Hash of the name
+ * @return Slot index
+ */
+static size_t __vars_find(const char *name, size_t name_len, uint64_t hash) {
+
+    size_t slot_i;
+
+    for (slot_i = hash & (g_nb_slots - 1); g_vars[slot_i].str; slot_i = (slot_i + 1) & (g_nb_slots - 1)) {
+
+        if ((g_vars[slot_i].hash == hash) && (g_vars[slot_i].name_len == name_len) &&
+            !memcmp(g_vars[slot_i].str, name, name_len)) {
+
+            break;
+        }
+    }
+
+    return slot_i;
+}
+
+/**
+ * @brief Doubles the number of slots of the table if it is half full
+ */
+static void __vars_grow() {
+
+    var_t *old_vars = g_vars;
+    size_t old_nb_slots = g_nb_slots;
+    size_t slot_i;
+
+    /* Keep the table at most half full, so that the probes stay short */
+    if (2 * (g_nb_vars + 1) <= g_nb_slots) {
+
+        return;
+    }
+
+    g_nb_slots = old_nb_slots ? 2 * old_nb_slots : VARS_MIN_SLOTS;
+    g_vars = (var_t *)calloc(g_nb_slots, sizeof(var_t));
+
+    /* Move the variables to their new slots */
+    for (slot_i = 0; slot_i < old_nb_slots; slot_i++) {
+
+        if (old_vars[slot_i].str) {
+
+            g_vars[__vars_find(old_vars[slot_i].str, old_vars[slot_i].name_len, old_vars[slot_i].hash)] = old_vars[slot_i];
+        }
+    }
+
+    free(old_vars);
+}
+
+/**
+ * @brief Sets the variable, given as a NAME=value string
+ * @param[in] str NAME=value string (owned by the table)
+ * @param[in] name_len Length of the name
+ * @param[in] is_exported Whether the variable is exported (else it keeps its
+ *            current state)
+ */
+static void __vars_put(char *str, size_t name_len, bool is_exported) {
+
+    uint64_t hash = hash_bytes(str, name_len);
+    var_t *p_var;
+
+    __vars_grow();
+
+    p_var = &g_vars[__vars_find(str, name_len, hash)];
+
+    /* If the variable is new */
+    if (!p_var->str) {
+
+        p_var->name_len = name_len;
+        p_var->hash = hash;
+        p_var->is_exported = false;
+        g_nb_vars++;
+    }
+
+    free(p_var->str);
+    p_var->str = str;
+
+    if (is_exported && !p_var->is_exported) {
+
+        p_var->is_exported = true;
+        g_nb_exported++;
+    }
+
+    /* The environment holds the old string */
+    if (p_var->is_exported) {
+
+        g_is_envp_stale = true;
+    }
+}
+
+/**
+ * @brief Initializes the variables from the environment of the shell (all
+ *        of them exported)
+ * @param[in] envp Environment (NULL terminated)
+ */
+void vars_init(char **envp) {
+
+    char *p_eq;
+
+    for (; *envp; envp++) {
+
+        /* Every entry is kept, even if its name is not a valid one */
+        if ((p_eq = strchr(*envp, '='))) {
+
+            __vars_put(strdup(*envp), p_eq - *envp, true);
+        }
+    }
+
+    g_is_envp_stale = true;
+}
+
+/**
+ * @brief Returns the length of the variable name at the start of the string
+ * @param[in] str String
+ * @param[in] len Length of the string
+ * @return Length of the name, 0 if the string does not start with a name
+ */
+size_t vars_get_name_len(const char *str, size_t len) {
+
+    size_t name_len;
+
+    for (name_len = 0; (name_len < len) && IS_NAME_CHAR(str[name_len], !name_len); name_len++);
+
+    return name_len;
+}
+
+/**
+ * @brief Returns the length of the name if the string is an assignment,
+ *        NAME=value
+ * @param[in] str String
+ * @return Length of the name, 0 if the string is not an assignment
+ */
+size_t vars_get_assign_len(const char *str) {
+
+    /* The name stops at the terminator at the latest */
+    size_t name_len = vars_get_name_len(str, SIZE_MAX);
+
+    return (name_len && (str[name_len] == '=')) ? name_len : 0;
+}
+
+/**
+ * @brief Returns the value of the variable
+ * @param[in] name Name of the variable
+ * @param[in] name_len Length of the name
+ * @return Value (owned by the table, till the variable changes), NULL if the
+ *         variable is not set
+ */
+const char *vars_get(const char *name, size_t name_len) {
+
+    var_t *p_var;
+
+    if (!g_nb_vars) {
+
+        return NULL;
+    }
+
+    p_var = &g_vars[__vars_find(name, name_len, hash_bytes(name, name_len))];
+
+    return p_var->str ? p_var->str + name_len + 1 : NULL;
+}
+
+/**
+ * @brief Sets the variable
+ * @param[in] name Name of the variable
+ * @param[in] name_len Length of the name
+ * @param[in] value Value (NULL to keep the current one, or empty if none)
+ * @param[in] is_exported Whether the variable is exported (else it keeps its
+ *            current state)
+ */
+void vars_set(const char *name, size_t name_len, const char *value, bool is_exported) {
+
+    size_t value_len;
+    char *str;
+
+    /* Keep the current value */
+    if (!value && !(value = vars_get(name, name_len))) {
+
+        value = "";
+    }
+
+    value_len = strlen(value);
+
+    /* Build the NAME=value string */
+    str = (char *)malloc(name_len + value_len + 2);
+    memcpy(str, name, name_len);
+    str[name_len] = '=';
+    memcpy(str + name_len + 1, value, value_len + 1);
+
+    __vars_put(str, name_len, is_exported);
+}
+
+/**
+ * @brief Removes the variable
+ * @param[in] name Name of the variable
+ * @param[in] name_len Length of the name
+ */
+void vars_unset(const char *name, size_t name_len) {
+
+    size_t slot_i;
+    size_t next_i;
+    size_t home_i;
+    size_t mask = g_nb_slots - 1;
+
+    if (!g_nb_vars) {
+
+        return;
+    }
+
+    slot_i = __vars_find(name, name_len, hash_bytes(name, name_len));
+
+    if (!g_vars[slot_i].str) {
+
+        return;
+    }
+
+    if (g_vars[slot_i].is_exported) {
+
+        g_nb_exported--;
+        g_is_envp_stale = true;
+    }
+
+    free(g_vars[slot_i].str);
+    g_nb_vars--;
+
+    /* Shift back the following variables of the probe sequence, so that no
+     * tombstone is needed */
+    for (next_i = (slot_i + 1) & mask; g_vars[next_i].str; next_i = (next_i + 1) & mask) {
+
+        home_i = g_vars[next_i].hash & mask;
+
+        /* If the home slot lies cyclically in (slot_i, next_i], the
+         * variable stays */
+        if ((slot_i <= next_i) ? ((slot_i < home_i) && (home_i <= next_i)) :
+                                 ((slot_i < home_i) || (home_i <= next_i))) {
+
+            continue;
+        }
+
+        g_vars[slot_i] = g_vars[next_i];
+        slot_i = next_i;
+    }
+
+    g_vars[slot_i].str = NULL;
+}
+
+/**
+ * @brief Returns the environment of the commands, built again only if an
+ *        exported variable changed since the last call
+ * @return Environment (NULL terminated, owned by the table)
+ */
+char **vars_get_envp() {
+
+    size_t slot_i;
+    size_t env_i = 0;
+
+    if (g_is_envp_stale) {
+
+        g_envp = (char **)realloc(g_envp, (g_nb_exported + 1) * sizeof(char *));
+        g_envp_size = sizeof(char *);
+
+        for (slot_i = 0; slot_i < g_nb_slots; slot_i++) {
+
+            if (g_vars[slot_i].str && g_vars[slot_i].is_exported) {
+
+                g_envp_size += strlen(g_vars[slot_i].str) + 1 + sizeof(char *);
+                g_envp[env_i++] = g_vars[slot_i].str;
+            }
+        }
+
+        g_envp[env_i] = NULL;
+        g_is_envp_stale = false;
+    }
+
+    return g_envp;
+}
+
+/**
+ * @brief Returns the size of the environment of the commands, as counted
+ *        against ARG_MAX by an exec (the strings with their terminators and
+ *        the pointers)
+ * @return Size in bytes
+ */
+size_t vars_get_envp_size() {
+
+    /* Build the environment again if needed */
+    vars_get_envp();
+
+    return g_envp_size;
+}
+
+/**
+ * @brief Compares two variable strings by name
+ * @param[in] p_a Pointer to the first string
+ * @param[in] p_b Pointer to the second string
+ * @return Comparison result (of strcmp)
+ */
+static int __vars_cmp(const void *p_a, const void *p_b) {
+
+    return strcmp(*(char * const *)p_a, *(char * const *)p_b);
+}
+
+/**
+ * @brief Prints the variables, sorted by name
+ * @param[in] is_exported_only Whether only the exported ones are printed
+ */
+void vars_print(bool is_exported_only) {
+
+    char **strs = (char **)malloc((g_nb_vars + 1) * sizeof(char *));
+    size_t nb_strs = 0;
+    size_t slot_i;
+
+    for (slot_i = 0; slot_i < g_nb_slots; slot_i++) {
+
+        if (g_vars[slot_i].str && (g_vars[slot_i].is_exported || !is_exported_only)) {
+
+            strs[nb_strs++] = g_vars[slot_i].str;
+        }
+    }
+
+    qsort(strs, nb_strs, sizeof(char *), __vars_cmp);
+
+    for (slot_i = 0; slot_i < nb_strs; slot_i++) {
+
+        printf("%s%s\n", is_exported_only ? "export " : "", strs[slot_i]);
+    }
+
+    free(strs);
+}
+
+/**
+ * @brief Expands the variables of the string, $NAME and ${NAME} (an unset
+ *        variable is empty, a $ not followed by a name is kept)
+ * @param[in] str String
+ * @param[in] len Length of the string
+ * @param[out] out Output (not NULL terminated, may be NULL if size is 0)
+ * @param[in] size Size of the output
+ * @return Length of the expansion (written if it fits the output)
+ */
+size_t vars_expand(const char *str, size_t len, char *out, size_t size) {
+
+    size_t out_len = 0;
+    size_t name_len;
+    const char *p_dollar;
+    const char *p_end = str + len;
+    const char *p_close;
+    const char *value;
+
+    while (str < p_end) {
+
+        /* Copy the characters till the next $ */
+        if (!(p_dollar = (const char *)memchr(str, '$', p_end - str))) {
+
+            p_dollar = p_end;
+        }
+
+        EXPAND_PUT(str, p_dollar - str);
+
+        if ((str = p_dollar) == p_end) {
+
+            break;
+        }
+
+        /* A braced name, ${NAME} */
+        if ((str + 1 < p_end) && (str[1] == '{') &&
+            (p_close = (const char *)memchr(str + 2, '}', p_end - str - 2)) &&
+            (name_len = vars_get_name_len(str + 2, p_close - str - 2)) &&
+            (name_len == (size_t)(p_close - str - 2))) {
+
+            if ((value = vars_get(str + 2, name_len))) {
+
+                EXPAND_PUT(value, strlen(value));
+            }
+
+            str = p_close + 1;
+        }
+        /* A name, $NAME */
+        else if ((name_len = vars_get_name_len(str + 1, p_end - str - 1))) {
+
+            if ((value = vars_get(str + 1, name_len))) {
+
+                EXPAND_PUT(value, strlen(value));
+            }
+
+            str += 1 + name_len;
+        }
+        /* Else the $ is kept */
+        else {
+
+            EXPAND_PUT(str, 1);
+            str++;
+        }
+    }
+
+    return out_len;
+}
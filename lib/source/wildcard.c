@@ -0,0 +1,839 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "wildcard.h"
+
+/* Sets the character in the bitmap of a set */
+#define SET_ADD(set, ch)                                                    \
+    ({                                                                      \
+        (set)[(unsigned char)(ch) >> 3] |= 1u << ((unsigned char)(ch) & 7u); \
+    })
+
+/* Checks if the character is in the bitmap of a set */
+#define SET_HAS(set, ch)                                                    \
+    ({                                                                      \
+        ((set)[(unsigned char)(ch) >> 3] >> ((unsigned char)(ch) & 7u)) & 1u; \
+    })
+
+/* Checks if the name is . or .. */
+#define IS_DOT_NAME(name)                                                   \
+    ({                                                                      \
+        ((name)[0] == '.') &&                                               \
+        (!(name)[1] || (((name)[1] == '.') && !(name)[2]));                 \
+    })
+
+/**
+ * @brief Record of a directory entry as read by getdents64
+ */
+typedef struct __wildcard_dirent_t {
+
+    /* Inode of the entry */
+    uint64_t ino;
+
+    /* Offset of the next record */
+    int64_t off;
+
+    /* Length of the record */
+    unsigned short reclen;
+
+    /* Type of the entry (DT_*) */
+    unsigned char type;
+
+    /* Name (NULL terminated) */
+    char name[];
+
+} wildcard_dirent_t;
+
+/**
+ * @brief List of paths, NULL terminated strings one after the other
+ */
+typedef struct __wildcard_paths_t {
+
+    /* Strings */
+    char *buf;
+
+    /* Number of bytes of the strings */
+    size_t len;
+
+    /* Size of the buffer */
+    size_t size;
+
+} wildcard_paths_t;
+
+/**
+ * @brief Output of the expansion, snprintf like (the words are separated by
+ *        NULL characters)
+ */
+typedef struct __wildcard_out_t {
+
+    /* Output */
+    char *out;
+
+    /* Size of the output */
+    size_t size;
+
+    /* Length of the expansion */
+    size_t len;
+
+    /* Number of words */
+    int nb_words;
+
+} wildcard_out_t;
+
+/* Cached directory listings */
+static wildcard_dir_t g_wildcard_dirs[WILDCARD_NB_DIRS];
+
+/* Clock of the uses of the listings */
+static unsigned long g_wildcard_use;
+
+/**
+ * @brief Compares two names of a listing
+ * @param[in] p_a Pointer to the first name
+ * @param[in] p_b Pointer to the second name
+ * @return Comparison result (of strcmp)
+ */
+static int __wildcard_name_cmp(const void *p_a, const void *p_b) {
+
+    const wildcard_name_t *p_name_a = (const wildcard_name_t *)p_a;
+    const wildcard_name_t *p_name_b = (const wildcard_name_t *)p_b;
+
+    /* Most of the names differ in their first bytes */
+    if (p_name_a->key != p_name_b->key) {
+
+        return (p_name_a->key < p_name_b->key) ? -1 : 1;
+    }
+
+    return strcmp(p_name_a->name, p_name_b->name);
+}
+
+/**
+ * @brief Sorts the names of the listing, a radix sort on the first bytes,
+ *        then the names sharing them are sorted on the rest
+ * @param[in,out] p_dir Pointer to the listing
+ */
+static void __wildcard_sort(wildcard_dir_t *p_dir) {
+
+    wildcard_name_t *p_src = p_dir->names;
+    wildcard_name_t *p_dest;
+    wildcard_name_t *p_tmp;
+    size_t counts[256];
+    size_t nb_names = p_dir->nb_names;
+    size_t name_i;
+    size_t run_i;
+    size_t sum;
+    size_t count;
+    unsigned int shift;
+    unsigned int digit;
+
+    if (nb_names < 2) {
+
+        return;
+    }
+
+    p_tmp = (wildcard_name_t *)malloc(nb_names * sizeof(wildcard_name_t));
+    p_dest = p_tmp;
+
+    /* Sort on every byte of the key, the lowest first */
+    for (shift = 0; shift < 64; shift += 8) {
+
+        memset(counts, 0, sizeof(counts));
+
+        for (name_i = 0; name_i < nb_names; name_i++) {
+
+            counts[(p_src[name_i].key >> shift) & 0xffu]++;
+        }
+
+        /* Skip the byte if every name has the same */
+        if (counts[(p_src[0].key >> shift) & 0xffu] == nb_names) {
+
+            continue;
+        }
+
+        for (digit = 0, sum = 0; digit < 256; digit++) {
+
+            count = counts[digit];
+            counts[digit] = sum;
+            sum += count;
+        }
+
+        for (name_i = 0; name_i < nb_names; name_i++) {
+
+            p_dest[counts[(p_src[name_i].key >> shift) & 0xffu]++] = p_src[name_i];
+        }
+
+        p_tmp = p_src;
+        p_src = p_dest;
+        p_dest = p_tmp;
+    }
+
+    if (p_src != p_dir->names) {
+
+        memcpy(p_dir->names, p_src, nb_names * sizeof(wildcard_name_t));
+        p_dest = p_src;
+    }
+
+    free(p_dest);
+
+    /* Sort the names sharing the first bytes on the rest */
+    for (name_i = 0; name_i < nb_names; name_i = run_i) {
+
+        for (run_i = name_i + 1; (run_i < nb_names) && (p_dir->names[run_i].key == p_dir->names[name_i].key); run_i++);
+
+        if (run_i - name_i > 1) {
+
+            qsort(p_dir->names + name_i, run_i - name_i, sizeof(wildcard_name_t), __wildcard_name_cmp);
+        }
+    }
+}
+
+/**
+ * @brief Reads the directory into the listing (the records are kept as
+ *        they are)
+ * @param[out] p_dir Pointer to the listing
+ * @param[in] path Path of the directory
+ * @return true If read
+ * @return false Otherwise
+ */
+static bool __wildcard_dir_read(wildcard_dir_t *p_dir, const char *path) {
+
+    struct stat st;
+    struct timespec now;
+    wildcard_dirent_t *p_ent;
+    uint64_t key;
+    size_t off;
+    long nb_read;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+
+        return false;
+    }
+
+    /* The time of the read, before reading */
+    fstat(fd, &st);
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    p_dir->len = 0;
+
+    while (1) {
+
+        /* Keep room for a large read, big directories are read in few
+         * system calls */
+        if (p_dir->size - p_dir->len < WILDCARD_READ_MIN_SIZE) {
+
+            p_dir->size = p_dir->size ? 2 * p_dir->size : WILDCARD_LIST_MIN_SIZE;
+            p_dir->buf = (char *)realloc(p_dir->buf, p_dir->size);
+        }
+
+        if ((nb_read = syscall(SYS_getdents64, fd, p_dir->buf + p_dir->len, p_dir->size - p_dir->len)) <= 0) {
+
+            break;
+        }
+
+        p_dir->len += nb_read;
+    }
+
+    close(fd);
+
+    /* Index the names and sort them once, the matches of every expansion
+     * then come in order */
+    p_dir->nb_names = 0;
+
+    for (off = 0; off < p_dir->len; off += p_ent->reclen) {
+
+        p_ent = (wildcard_dirent_t *)(p_dir->buf + off);
+
+        if (IS_DOT_NAME(p_ent->name)) {
+
+            continue;
+        }
+
+        if (p_dir->nb_names == p_dir->max_names) {
+
+            p_dir->max_names = p_dir->max_names ? 2 * p_dir->max_names : 256;
+            p_dir->names = (wildcard_name_t *)realloc(p_dir->names, p_dir->max_names * sizeof(wildcard_name_t));
+        }
+
+        p_dir->names[p_dir->nb_names].name = p_ent->name;
+        p_dir->names[p_dir->nb_names].len = strlen(p_ent->name);
+        p_dir->names[p_dir->nb_names].type = p_ent->type;
+
+        /* The first bytes as a big endian word (zero padded) */
+        key = 0;
+        memcpy(&key, p_ent->name, (p_dir->names[p_dir->nb_names].len < 8) ? p_dir->names[p_dir->nb_names].len : 8);
+        p_dir->names[p_dir->nb_names++].key = __builtin_bswap64(key);
+    }
+
+    __wildcard_sort(p_dir);
+
+    p_dir->dev = st.st_dev;
+    p_dir->ino = st.st_ino;
+    p_dir->mtime = st.st_mtim;
+
+    /* A directory modified around the read may be modified again without a
+     * change of its (coarse) modification time, so it is read every time */
+    p_dir->is_stable = st.st_mtim.tv_sec + 1 < now.tv_sec;
+
+    return true;
+}
+
+/**
+ * @brief Returns the listing of the directory, from the cache if the
+ *        directory is not modified since it was read
+ * @param[in] path Path of the directory
+ * @return Pointer to the listing (valid till the next call), NULL if the
+ *         directory cannot be read
+ */
+static wildcard_dir_t *__wildcard_dir_get(const char *path) {
+
+    struct stat st;
+    wildcard_dir_t *p_dir = NULL;
+    unsigned int dir_i;
+
+    if ((stat(path, &st) == -1) || !S_ISDIR(st.st_mode)) {
+
+        return NULL;
+    }
+
+    g_wildcard_use++;
+
+    for (dir_i = 0; dir_i < WILDCARD_NB_DIRS; dir_i++) {
+
+        /* If the directory is cached */
+        if (g_wildcard_dirs[dir_i].buf &&
+            (g_wildcard_dirs[dir_i].dev == st.st_dev) && (g_wildcard_dirs[dir_i].ino == st.st_ino)) {
+
+            p_dir = &g_wildcard_dirs[dir_i];
+            break;
+        }
+
+        /* Else take the least recently used listing */
+        if (!p_dir || (g_wildcard_dirs[dir_i].last_use < p_dir->last_use)) {
+
+            p_dir = &g_wildcard_dirs[dir_i];
+        }
+    }
+
+    p_dir->last_use = g_wildcard_use;
+
+    /* Reuse the listing if the directory is the same */
+    if ((dir_i < WILDCARD_NB_DIRS) && p_dir->is_stable &&
+        (p_dir->mtime.tv_sec == st.st_mtim.tv_sec) && (p_dir->mtime.tv_nsec == st.st_mtim.tv_nsec)) {
+
+        return p_dir;
+    }
+
+    if (!__wildcard_dir_read(p_dir, path)) {
+
+        p_dir->is_stable = false;
+
+        return NULL;
+    }
+
+    return p_dir;
+}
+
+/**
+ * @brief Compiles the pattern of a path component
+ * @param[out] p_pat Pointer to the pattern
+ * @param[in] comp Path component
+ * @param[in] len Length of the component
+ * @param[out] ops Operations (room for len operations)
+ * @return true If the component has a wildcard
+ * @return false Otherwise (it is a single literal)
+ */
+static bool __wildcard_compile(wildcard_pat_t *p_pat, const char *comp, size_t len, wildcard_op_t *ops) {
+
+    wildcard_op_t *p_op = NULL;
+    size_t i;
+    size_t j;
+    size_t first;
+    bool is_neg;
+    bool has_star = false;
+    int ch;
+
+    p_pat->ops = ops;
+    p_pat->nb_ops = 0;
+    p_pat->min_len = 0;
+
+    for (i = 0; i < len; i++) {
+
+        /* Any string (a run of * is a single one) */
+        if (comp[i] == '*') {
+
+            if (!p_op || (p_op->type != WILDCARD_OP_STAR)) {
+
+                p_op = &ops[p_pat->nb_ops++];
+                p_op->type = WILDCARD_OP_STAR;
+            }
+
+            has_star = true;
+            continue;
+        }
+
+        /* Any character */
+        if (comp[i] == '?') {
+
+            p_op = &ops[p_pat->nb_ops++];
+            p_op->type = WILDCARD_OP_ANY;
+            p_pat->min_len++;
+            continue;
+        }
+
+        /* Set of characters, [abc] [a-z] [!abc] (a ] first is literal) */
+        if (comp[i] == '[') {
+
+            j = i + 1;
+            is_neg = (j < len) && ((comp[j] == '!') || (comp[j] == '^'));
+            j += is_neg;
+            first = j;
+
+            if ((j < len) && (comp[j] == ']')) {
+                j++;
+            }
+
+            while ((j < len) && (comp[j] != ']')) {
+                j++;
+            }
+
+            /* If the set is closed */
+            if (j < len) {
+
+                p_op = &ops[p_pat->nb_ops++];
+                p_op->type = WILDCARD_OP_SET;
+                memset(p_op->set, 0, sizeof(p_op->set));
+
+                for (; first < j; first++) {
+
+                    /* A range, a-z */
+                    if ((first + 2 < j) && (comp[first + 1] == '-')) {
+
+                        for (ch = (unsigned char)comp[first]; ch <= (unsigned char)comp[first + 2]; ch++) {
+
+                            SET_ADD(p_op->set, ch);
+                        }
+
+                        first += 2;
+                    }
+                    else {
+
+                        SET_ADD(p_op->set, comp[first]);
+                    }
+                }
+
+                if (is_neg) {
+
+                    for (ch = 0; ch < (int)sizeof(p_op->set); ch++) {
+
+                        p_op->set[ch] = ~p_op->set[ch];
+                    }
+                }
+
+                /* A name never holds a / or a NULL character */
+                p_op->set[0] &= ~1u;
+                p_op->set['/' >> 3] &= ~(1u << ('/' & 7u));
+
+                p_pat->min_len++;
+                i = j;
+                continue;
+            }
+        }
+
+        /* Literal character, joined to the previous ones */
+        if (p_op && (p_op->type == WILDCARD_OP_LIT)) {
+
+            p_op->len++;
+        }
+        else {
+
+            p_op = &ops[p_pat->nb_ops++];
+            p_op->type = WILDCARD_OP_LIT;
+            p_op->lit = comp + i;
+            p_op->len = 1;
+        }
+
+        p_pat->min_len++;
+    }
+
+    /* The leading literal is checked first */
+    p_pat->prefix = NULL;
+    p_pat->prefix_len = 0;
+    if (p_pat->nb_ops && (ops[0].type == WILDCARD_OP_LIT)) {
+
+        p_pat->prefix = ops[0].lit;
+        p_pat->prefix_len = ops[0].len;
+    }
+
+    /* The trailing literal (after a *) is checked next, *.log */
+    p_pat->suffix = NULL;
+    p_pat->suffix_len = 0;
+    if (has_star && (ops[p_pat->nb_ops - 1].type == WILDCARD_OP_LIT)) {
+
+        p_pat->suffix = ops[p_pat->nb_ops - 1].lit;
+        p_pat->suffix_len = ops[p_pat->nb_ops - 1].len;
+    }
+
+    return !((p_pat->nb_ops == 1) && (ops[0].type == WILDCARD_OP_LIT));
+}
+
+/**
+ * @brief Matches the name with the compiled pattern (a leading . must be
+ *        matched by a literal)
+ * @param[in] p_pat Pointer to the pattern
+ * @param[in] name Name
+ * @param[in] len Length of the name
+ * @return true If it matches
+ * @return false Otherwise
+ */
+static bool __wildcard_match(const wildcard_pat_t *p_pat, const char *name, size_t len) {
+
+    const wildcard_op_t *p_op;
+    int op_i = 0;
+    int star_op_i = -1;
+    size_t pos = 0;
+    size_t star_pos = 0;
+
+    /* Reject most of the names on the literal parts */
+    if ((len < p_pat->min_len) ||
+        (p_pat->prefix_len && memcmp(name, p_pat->prefix, p_pat->prefix_len)) ||
+        (p_pat->suffix_len && memcmp(name + len - p_pat->suffix_len, p_pat->suffix, p_pat->suffix_len))) {
+
+        return false;
+    }
+
+    /* A hidden name is only matched by a leading . */
+    if ((name[0] == '.') && !(p_pat->prefix_len && (p_pat->prefix[0] == '.'))) {
+
+        return false;
+    }
+
+    while (1) {
+
+        if (op_i < p_pat->nb_ops) {
+
+            p_op = &p_pat->ops[op_i];
+
+            switch (p_op->type) {
+
+                case WILDCARD_OP_STAR:
+
+                    /* Match the empty string first, longer ones on a
+                     * mismatch */
+                    star_op_i = op_i++;
+                    star_pos = pos;
+                    continue;
+
+                case WILDCARD_OP_LIT:
+
+                    if ((pos + p_op->len <= len) && !memcmp(name + pos, p_op->lit, p_op->len)) {
+
+                        pos += p_op->len;
+                        op_i++;
+                        continue;
+                    }
+                    break;
+
+                case WILDCARD_OP_ANY:
+
+                    if (pos < len) {
+
+                        pos++;
+                        op_i++;
+                        continue;
+                    }
+                    break;
+
+                case WILDCARD_OP_SET:
+
+                    if ((pos < len) && SET_HAS(p_op->set, name[pos])) {
+
+                        pos++;
+                        op_i++;
+                        continue;
+                    }
+                    break;
+            }
+        }
+        else if (pos == len) {
+
+            return true;
+        }
+
+        /* On a mismatch the last * takes one more character */
+        if ((star_op_i == -1) || (star_pos >= len)) {
+
+            return false;
+        }
+
+        pos = ++star_pos;
+        op_i = star_op_i + 1;
+    }
+}
+
+/**
+ * @brief Appends the bytes to the output
+ * @param[out] p_out Pointer to the output
+ * @param[in] data Bytes
+ * @param[in] len Number of bytes
+ */
+static void __wildcard_put(wildcard_out_t *p_out, const char *data, size_t len) {
+
+    if (p_out->len < p_out->size) {
+
+        memcpy(p_out->out + p_out->len, data, (len < p_out->size - p_out->len) ? len : p_out->size - p_out->len);
+    }
+
+    p_out->len += len;
+}
+
+/**
+ * @brief Appends a path, directory followed by name, to the list
+ * @param[out] p_paths Pointer to the list
+ * @param[in] dir Directory (with a trailing / if not empty)
+ * @param[in] dir_len Length of the directory
+ * @param[in] name Name
+ * @param[in] name_len Length of the name
+ * @param[in] is_dir Whether a / is added (to list the path next)
+ */
+static void __wildcard_paths_add(wildcard_paths_t *p_paths, const char *dir, size_t dir_len,
+                                 const char *name, size_t name_len, bool is_dir) {
+
+    size_t len = dir_len + name_len + is_dir + 1;
+
+    if (p_paths->len + len > p_paths->size) {
+
+        p_paths->size = (2 * p_paths->size > p_paths->len + len) ? 2 * p_paths->size : p_paths->len + len;
+        p_paths->buf = (char *)realloc(p_paths->buf, p_paths->size);
+    }
+
+    memcpy(p_paths->buf + p_paths->len, dir, dir_len);
+    memcpy(p_paths->buf + p_paths->len + dir_len, name, name_len);
+    p_paths->len += dir_len + name_len;
+
+    if (is_dir) {
+        p_paths->buf[p_paths->len++] = '/';
+    }
+
+    p_paths->buf[p_paths->len++] = '\0';
+}
+
+/**
+ * @brief Checks if the matched entry is a directory
+ * @param[in] dir Directory of the entry (with a trailing / if not empty)
+ * @param[in] dir_len Length of the directory
+ * @param[in] p_name Pointer to the matched entry
+ * @return true If it is a directory (or a link to one)
+ * @return false Otherwise
+ */
+static bool __wildcard_is_dir(const char *dir, size_t dir_len, const wildcard_name_t *p_name) {
+
+    struct stat st;
+    char path[PATH_MAX];
+
+    if (p_name->type == DT_DIR) {
+
+        return true;
+    }
+
+    /* The type of a link (or of an entry of some file systems) is known by
+     * its status only */
+    if ((p_name->type != DT_LNK) && (p_name->type != DT_UNKNOWN)) {
+
+        return false;
+    }
+
+    if (dir_len + p_name->len + 1 > sizeof(path)) {
+
+        return false;
+    }
+
+    memcpy(path, dir, dir_len);
+    memcpy(path + dir_len, p_name->name, p_name->len + 1);
+
+    return !stat(path, &st) && S_ISDIR(st.st_mode);
+}
+
+/**
+ * @brief Matches the component of the pattern in the directory, the
+ *        matches are added to the list of paths, or to the output for the
+ *        last component (in the order of the names)
+ * @param[in] dir Directory (with a trailing / if not empty)
+ * @param[in] p_pat Pointer to the compiled component
+ * @param[in] is_dir Whether the matches must be directories
+ * @param[out] p_next Pointer to the list of paths (NULL for the last
+ *             component)
+ * @param[out] p_out Pointer to the output
+ */
+static void __wildcard_match_dir(const char *dir, const wildcard_pat_t *p_pat, bool is_dir,
+                                 wildcard_paths_t *p_next, wildcard_out_t *p_out) {
+
+    wildcard_dir_t *p_dir;
+    wildcard_name_t *p_name;
+    size_t dir_len = strlen(dir);
+    size_t name_i;
+
+    if (!(p_dir = __wildcard_dir_get(dir_len ? dir : "."))) {
+
+        return;
+    }
+
+    for (name_i = 0; name_i < p_dir->nb_names; name_i++) {
+
+        p_name = &p_dir->names[name_i];
+
+        if (!__wildcard_match(p_pat, p_name->name, p_name->len) ||
+            (is_dir && !__wildcard_is_dir(dir, dir_len, p_name))) {
+
+            continue;
+        }
+
+        /* Search the next component in the directory */
+        if (p_next) {
+
+            __wildcard_paths_add(p_next, dir, dir_len, p_name->name, p_name->len, true);
+            continue;
+        }
+
+        /* Copy the path straight from the listing to the output */
+        if (p_out->nb_words++) {
+
+            __wildcard_put(p_out, "", 1);
+        }
+
+        __wildcard_put(p_out, dir, dir_len);
+        __wildcard_put(p_out, p_name->name, p_name->len);
+
+        if (is_dir) {
+
+            __wildcard_put(p_out, "/", 1);
+        }
+    }
+}
+
+/**
+ * @brief Expands the pathname pattern (* ? [...] in any component), the
+ *        sorted matching paths are separated by NULL characters, a pattern
+ *        matching nothing is kept as it is
+ * @param[in] str Pattern
+ * @param[in] len Length of the pattern
+ * @param[out] out Output (not NULL terminated)
+ * @param[in] size Size of the output
+ * @return Length of the expansion (written if it fits the output)
+ */
+size_t wildcard_expand(const char *str, size_t len, char *out, size_t size) {
+
+    wildcard_out_t exp = {out, size, 0, 0};
+    wildcard_paths_t paths[2] = {{NULL, 0, 0}, {NULL, 0, 0}};
+    wildcard_paths_t *p_cur = &paths[0];
+    wildcard_paths_t *p_next = &paths[1];
+    wildcard_paths_t *p_tmp;
+    wildcard_pat_t pat;
+    wildcard_op_t *ops;
+    struct stat st;
+    char *pattern;
+    char *comp;
+    char *comp_end;
+    char *path;
+    bool is_last;
+    bool is_dir;
+
+    /* Words without a wildcard are kept (most of them) */
+    if (!memchr(str, '*', len) && !memchr(str, '?', len) && !memchr(str, '[', len)) {
+
+        __wildcard_put(&exp, str, len);
+
+        return exp.len;
+    }
+
+    /* Copy of the pattern, split into the components in place */
+    pattern = strndup(str, len);
+    ops = (wildcard_op_t *)malloc((len + 1) * sizeof(wildcard_op_t));
+
+    /* Start from the root or the current directory */
+    __wildcard_paths_add(p_cur, "/", pattern[0] == '/', "", 0, false);
+
+    for (comp = pattern; *comp; comp = comp_end) {
+
+        /* Skip the slashes */
+        while (*comp == '/') {
+            comp++;
+        }
+
+        if (!*comp) {
+            break;
+        }
+
+        for (comp_end = comp; *comp_end && (*comp_end != '/'); comp_end++);
+
+        /* The last component, directories only if followed by a / */
+        is_last = !comp_end[strspn(comp_end, "/")];
+        is_dir = !is_last || *comp_end;
+
+        if (*comp_end) {
+            *comp_end++ = '\0';
+        }
+
+        p_next->len = 0;
+
+        /* A literal component is added to every path */
+        if (!__wildcard_compile(&pat, comp, strlen(comp), ops)) {
+
+            for (path = p_cur->buf; path < p_cur->buf + p_cur->len; path += strlen(path) + 1) {
+
+                __wildcard_paths_add(p_next, path, strlen(path), comp, strlen(comp), is_dir);
+            }
+        }
+        /* Else the component is matched in every directory */
+        else {
+
+            for (path = p_cur->buf; path < p_cur->buf + p_cur->len; path += strlen(path) + 1) {
+
+                __wildcard_match_dir(path, &pat, is_dir, is_last ? NULL : p_next, &exp);
+            }
+
+            if (is_last) {
+
+                p_cur->len = 0;
+                break;
+            }
+        }
+
+        p_tmp = p_cur;
+        p_cur = p_next;
+        p_next = p_tmp;
+    }
+
+    /* The paths left end with a literal component, they must exist */
+    for (path = p_cur->buf; path < p_cur->buf + p_cur->len; path += strlen(path) + 1) {
+
+        if (!lstat(path, &st)) {
+
+            if (exp.nb_words++) {
+
+                __wildcard_put(&exp, "", 1);
+            }
+
+            __wildcard_put(&exp, path, strlen(path));
+        }
+    }
+
+    /* A pattern matching nothing is kept */
+    if (!exp.nb_words) {
+
+        __wildcard_put(&exp, str, len);
+    }
+
+    free(paths[0].buf);
+    free(paths[1].buf);
+    free(ops);
+    free(pattern);
+
+    return exp.len;
+}
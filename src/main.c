@@ -2,76 +2,285 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <signal.h>
+#include "reader.h"
 #include "command_table.h"
 #include "parser.h"
 #include "executor.h"
 #include "prompt.h"
 #include "jobs.h"
 #include "builtin.h"
+#include "plan_cache.h"
+#include "path_cache.h"
+#include "options.h"
+#include "parse_ahead.h"
+#include "str_util.h"
+#include "vars.h"
+#include "wildcard.h"
 
-/* Maximum command line string input length */
-#define MAX_CMD_STR_LEN (1024u)
-
-/* Declaration of gets (to prevent the warning) */
-char *gets(char *);
+/* Environment of the shell */
+extern char **environ;
 
 /**
- * @brief Reads a command line string, parses to find meaningful commands,
+ * @brief Reads command line strings (from the terminal, a script file, the
+ *        -c argument or a pipe), parses to find meaningful commands,
  *        arguments and executes them accordingly
+ * @param[in] argc Number of arguments
+ * @param[in] argv Arguments, <kavach [-c cmd_str | script]>
  */
-int main() {
+int main(int argc, char *argv[]) {
 
     /* Create the command table */
     cmd_tab_t cmd_tab;
 
-    /* Create the command string */
-    char cmd_str[MAX_CMD_STR_LEN];
+    /* Command table to be executed (parsed or cached) */
+    cmd_tab_t *p_cmd_tab;
+
+    /* Command table with the variables expanded (reused for every command
+     * line holding a $) */
+    cmd_tab_t expanded;
+
+    /* Command table with the wildcards expanded (reused for every command
+     * line holding one) */
+    cmd_tab_t globbed;
+
+    /* Command line string (owned by the reader) */
+    char *cmd_str;
+
+    /* Reader of the command lines */
+    reader_t reader;
+
+    /* Lines parsed ahead of their execution (without a terminal) */
+    parse_ahead_t ahead;
+
+    /* Line parsed ahead */
+    parse_ahead_line_t *p_line = NULL;
+
+    /* File descriptor of the script file */
+    int script_fd;
+
+    /* Is the shell reading the commands from a terminal */
+    bool is_interactive;
+
+    /* Built-in of the first command */
+    const built_in_t *p_built_in;
+
+    /* Exit status of the last command line (the exit status of the shell) */
+    int status = 0;
+
+    /* If the command lines are given as an argument */
+    if ((argc == 3) && !strcmp(argv[1], "-c")) {
+
+        reader_open_str(&reader, argv[2]);
+    }
+    /* If the command lines are given in a script file */
+    else if (argc == 2) {
+
+        /* Open the script file (not inherited by the commands) */
+        if ((script_fd = open(argv[1], O_RDONLY | O_CLOEXEC)) == -1) {
+
+            fprintf(stderr, "kavach: %s: cannot open the script file\n", argv[1]);
+            exit(127);
+        }
+
+        /* Keep it clear of the file descriptors redirected by exec */
+        script_fd = fcntl(script_fd, F_DUPFD_CLOEXEC, 10);
+
+        reader_open_fd(&reader, script_fd);
+    }
+    /* If the command lines are given on the standard input */
+    else if (argc == 1) {
+
+        reader_open_fd(&reader, STDIN_FILENO);
+    }
+    else {
+
+        fprintf(stderr, "kavach: incorrect arguments <kavach [-c cmd_str | script]>\n");
+        exit(2);
+    }
 
-    /* Variable to store the type of built-in command */
-    built_in_cmd_t built_in_type;
+    /* The prompt and the terminal control are only used with a terminal */
+    is_interactive = (argc == 1) && isatty(STDIN_FILENO);
 
     /* Create a new session for the shell */
-    setsid();
+    if (is_interactive) {
+
+        setsid();
+    }
 
     /* Initialize the jobs */
-    jobs_init();
+    jobs_init(is_interactive);
+
+    /* A filter thread writing to a closed pipe gets an error instead of the
+     * signal ending the shell (the commands get the default action back) */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Initialize the variables from the environment */
+    vars_init(environ);
+
+    /* Initialize the options */
+    options_init();
+
+    /* Initialize the table of the built-ins */
+    built_in_init();
+
+    /* Initialize the cache of parsed command lines */
+    plan_cache_init();
+
+    /* Initialize the cache of command paths */
+    path_cache_init();
+
+    /* Init command table (reused for every command line) */
+    cmd_tab_init(&cmd_tab);
+    cmd_tab_init(&expanded);
+    cmd_tab_init(&globbed);
+
+    /* Without a terminal the next lines are parsed while the current one
+     * executes */
+    if (!is_interactive) {
+
+        parse_ahead_start(&ahead, &reader);
+    }
 
     while (1) {
 
-        /* Initialize the prompt */
-        prompt_signal_init();
+        /* If the shell is used from a terminal */
+        if (is_interactive) {
+
+            /* Initialize the prompt */
+            prompt_signal_init();
+
+            /* Report the jobs completed while the last line ran */
+            jobs_report();
 
-        /* Print the prompt */
-        prompt_print();
+            /* Print the prompt */
+            prompt_print();
 
-        /* Input the command line string from the user */
-        if (!gets(cmd_str)) {
+            /* Handle the jobs till a line is typed (unless one is read
+             * already) */
+            if (reader_is_empty(&reader)) {
 
-            /* Exit if EOF (Ctrl-D) is entered */
-            exit(0);
+                jobs_wait_fd(STDIN_FILENO);
+            }
+
+            /* Input the next command line string */
+            if (!(cmd_str = reader_get_line(&reader))) {
+
+                /* Exit if EOF (Ctrl-D) is entered */
+                reader_close(&reader);
+                exit(status);
+            }
+
+            /* Skip the comment lines */
+            if (IS_COMMENT_LINE(cmd_str)) {
+
+                continue;
+            }
+
+            /* Let the commands sharing the input continue after this line */
+            reader_sync(&reader, reader_tell(&reader));
+
+            /* Get the plan of the line from the cache, else run the parser
+             * on the given string to set the command table and cache it */
+            if (!(p_cmd_tab = plan_cache_get(cmd_str)) &&
+                (parser_set_cmd_tab(&cmd_tab, cmd_str) == PARSER_OK)) {
+
+                p_cmd_tab = plan_cache_put(cmd_str, &cmd_tab);
+            }
         }
+        else {
+
+            /* Get the next parsed line */
+            if (!(p_line = parse_ahead_get(&ahead))) {
+
+                /* Exit if the input is over */
+                exit(status);
+            }
+
+            /* Let the commands sharing the input continue after this line */
+            reader_sync(&reader, p_line->off);
 
-        /* Init command table */
-        cmd_tab_init(&cmd_tab);
+            /* Reap the background jobs completed meanwhile */
+            jobs_poll();
 
-        /* Run the parser on the given string to set the command table */
-        if (parser_set_cmd_tab(&cmd_tab, cmd_str) == PARSER_OK) {
+            /* Get the plan of the line from the cache, else use the parsed
+             * command table and cache it */
+            if (!(p_cmd_tab = plan_cache_get(p_line->cmd_str))) {
 
-            /* If the command is a built-in */
-            if ((built_in_type = is_built_in(&cmd_tab)) != BUILT_IN_NOT) {
+                if (p_line->ctx.err == PARSER_OK) {
+
+                    p_cmd_tab = plan_cache_put(p_line->cmd_str, &p_line->cmd_tab);
+                }
+                else {
+
+                    parser_ctx_print_err(&p_line->ctx);
+                }
+            }
+        }
+
+        /* Expand the variables with their current values (the plan stays
+         * cached unexpanded) */
+        if (p_cmd_tab && p_cmd_tab->has_vars) {
+
+            cmd_tab_reset(&expanded);
+            cmd_tab_expand(&expanded, p_cmd_tab, vars_expand);
+            p_cmd_tab = &expanded;
+        }
+
+        /* Expand the wildcards to the matching paths (after the variables,
+         * which may hold some) */
+        if (p_cmd_tab && p_cmd_tab->has_globs) {
+
+            cmd_tab_reset(&globbed);
+            cmd_tab_expand(&globbed, p_cmd_tab, wildcard_expand);
+            p_cmd_tab = &globbed;
+        }
+
+        /* A line which cannot be parsed fails (as a syntax error) */
+        if (!p_cmd_tab) {
+
+            status = 2;
+        }
+        /* If the line is valid and not blank */
+        else if (cmd_tab_get_nb_cmds(p_cmd_tab) > 0) {
+
+            /* Get the built-in of the first command */
+            p_built_in = built_in_lookup(cmd_tab_get_cmd_args(p_cmd_tab, 0)[0]);
+
+            /* The built-ins of the shell always succeed */
+            status = 0;
+
+            /* If the line assigns variables */
+            if (vars_get_assign_len(cmd_tab_get_cmd_args(p_cmd_tab, 0)[0])) {
+
+                built_in_assign(p_cmd_tab);
+            }
+            /* If the command is a built-in of the shell (the utilities, the
+             * filters and the built-in stages run as the stages of the
+             * pipeline) */
+            else if (p_built_in && !(p_built_in->flags & (BUILT_IN_PIPELINE | BUILT_IN_STAGE | BUILT_IN_FILTER))) {
 
                 /* Call the required built-in function */
-                built_in_exec_cmd_tab(&cmd_tab, built_in_type);
+                built_in_exec_cmd_tab(p_cmd_tab, p_built_in);
             }
             else {
 
                 /* If not built-in then fork-exec it */
-                executor_exec_cmd_tab(&cmd_tab);
+                status = executor_exec_cmd_tab(p_cmd_tab);
             }
         }
 
-        /* Deinit the command table */
-        cmd_tab_deinit(&cmd_tab);
+        /* Reset the command table for the next command line */
+        if (is_interactive) {
+
+            cmd_tab_reset(&cmd_tab);
+        }
+        else {
+
+            parse_ahead_release(&ahead);
+        }
     }
 
     return 0;